@@ -17,6 +17,22 @@
 
 #include "qgsaspectfilter.h"
 
+#include <QVector>
+
+static inline float aspect( float derX, float derY, float outputNodataValue )
+{
+  if ( derX == outputNodataValue ||
+       derY == outputNodataValue ||
+       ( derX == 0.0 && derY == 0.0 ) )
+  {
+    return outputNodataValue;
+  }
+  else
+  {
+    return 180.0 + atan2( derX, derY ) * 180.0 / M_PI;
+  }
+}
+
 QgsAspectFilter::QgsAspectFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat ) :
     QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -35,16 +51,18 @@ float QgsAspectFilter::processNineCellWindow(
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return aspect( derX, derY, mOutputNodataValue );
+}
 
-  if ( derX == mOutputNodataValue ||
-       derY == mOutputNodataValue ||
-       ( derX == 0.0 && derY == 0.0 ) )
-  {
-    return mOutputNodataValue;
-  }
-  else
+void QgsAspectFilter::processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  QVector<float> derX( nCells );
+  QVector<float> derY( nCells );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), nCells );
+
+  for ( int j = 0; j < nCells; ++j )
   {
-    return 180.0 + atan2( derX, derY ) * 180.0 / M_PI;
+    result[j] = aspect( derX[j], derY[j], mOutputNodataValue );
   }
 }
 
@@ -33,6 +33,11 @@ class ANALYSIS_EXPORT QgsAspectFilter: public QgsDerivativeFilter
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 ) override;
 
+  protected:
+    /** Calculates the values of a row of cells without a virtual call per cell
+      @note added in QGIS 2.12*/
+    void processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells ) override;
+
 };
 
 #endif // QGSASPECTFILTER_H
@@ -162,7 +162,35 @@ float QgsDerivativeFilter::calcFirstDerY( float* x11, float* x21, float* x31, fl
   return sum / ( weight * mCellSizeY * mZFactor );
 }
 
-
-
-
-
+void QgsDerivativeFilter::calcFirstDerRow( float* rowAbove, float* row, float* rowBelow, float* derX, float* derY, int nCells )
+{
+  //the basic formula for all cells. The loop has no branches and can be vectorized by the compiler
+  double divisorX = 8 * mCellSizeX * mZFactor;
+  double divisorY = 8 * mCellSizeY * mZFactor;
+  for ( int j = 0; j < nCells; ++j )
+  {
+    double sumX = ( rowAbove[j+2] - rowAbove[j] );
+    sumX += 2 * ( row[j+2] - row[j] );
+    sumX += ( rowBelow[j+2] - rowBelow[j] );
+    derX[j] = sumX / divisorX;
+
+    double sumY = ( rowAbove[j] - rowBelow[j] );
+    sumY += 2 * ( rowAbove[j+1] - rowBelow[j+1] );
+    sumY += ( rowAbove[j+2] - rowBelow[j+2] );
+    derY[j] = sumY / divisorY;
+  }
+
+  //windows with nodata values (e.g. at the border) need the weighted formulas
+  for ( int j = 0; j < nCells; ++j )
+  {
+    if ( rowAbove[j] == mInputNodataValue || rowAbove[j+1] == mInputNodataValue || rowAbove[j+2] == mInputNodataValue
+         || row[j] == mInputNodataValue || row[j+2] == mInputNodataValue
+         || rowBelow[j] == mInputNodataValue || rowBelow[j+1] == mInputNodataValue || rowBelow[j+2] == mInputNodataValue )
+    {
+      derX[j] = calcFirstDerX( &rowAbove[j], &rowAbove[j+1], &rowAbove[j+2], &row[j], &row[j+1], &row[j+2],
+                               &rowBelow[j], &rowBelow[j+1], &rowBelow[j+2] );
+      derY[j] = calcFirstDerY( &rowAbove[j], &rowAbove[j+1], &rowAbove[j+2], &row[j], &row[j+1], &row[j+2],
+                               &rowBelow[j], &rowBelow[j+1], &rowBelow[j+2] );
+    }
+  }
+}
@@ -36,6 +36,11 @@ class ANALYSIS_EXPORT QgsDerivativeFilter : public QgsNineCellFilter
     float calcFirstDerX( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 );
     /** Calculates the first order derivative in y-direction according to Horn (1981)*/
     float calcFirstDerY( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 );
+    /** Calculates the first order derivatives of a row of cells (see QgsNineCellFilter::processRow() for the layout of the rows).
+      Gives the same results as calcFirstDerX() and calcFirstDerY(), but only windows containing nodata values are
+      computed cell by cell.
+      @note added in QGIS 2.12*/
+    void calcFirstDerRow( float* rowAbove, float* row, float* rowBelow, float* derX, float* derY, int nCells );
 };
 
 #endif // QGSDERIVATIVEFILTER_H
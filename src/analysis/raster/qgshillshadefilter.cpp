@@ -17,6 +17,30 @@
 
 #include "qgshillshadefilter.h"
 
+#include <QVector>
+
+static inline float hillshade( float derX, float derY, float lightAzimuth, float lightAngle, float outputNodataValue )
+{
+  if ( derX == outputNodataValue || derY == outputNodataValue )
+  {
+    return outputNodataValue;
+  }
+
+  float zenith_rad = lightAngle * M_PI / 180.0;
+  float slope_rad = atan( sqrt( derX * derX + derY * derY ) );
+  float azimuth_rad = lightAzimuth * M_PI / 180.0;
+  float aspect_rad = 0;
+  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
+  {
+    aspect_rad = azimuth_rad / 2.0;
+  }
+  else
+  {
+    aspect_rad = M_PI + atan2( derX, derY );
+  }
+  return qMax( 0.0, 255.0 * (( cos( zenith_rad ) * cos( slope_rad ) ) + ( sin( zenith_rad ) * sin( slope_rad ) * cos( azimuth_rad - aspect_rad ) ) ) );
+}
+
 QgsHillshadeFilter::QgsHillshadeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat, double lightAzimuth,
                                         double lightAngle )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -35,23 +59,17 @@ float QgsHillshadeFilter::processNineCellWindow( float* x11, float* x21, float*
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return hillshade( derX, derY, mLightAzimuth, mLightAngle, mOutputNodataValue );
+}
 
-  if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
-  {
-    return mOutputNodataValue;
-  }
+void QgsHillshadeFilter::processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  QVector<float> derX( nCells );
+  QVector<float> derY( nCells );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), nCells );
 
-  float zenith_rad = mLightAngle * M_PI / 180.0;
-  float slope_rad = atan( sqrt( derX * derX + derY * derY ) );
-  float azimuth_rad = mLightAzimuth * M_PI / 180.0;
-  float aspect_rad = 0;
-  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
+  for ( int j = 0; j < nCells; ++j )
   {
-    aspect_rad = azimuth_rad / 2.0;
+    result[j] = hillshade( derX[j], derY[j], mLightAzimuth, mLightAngle, mOutputNodataValue );
   }
-  else
-  {
-    aspect_rad = M_PI + atan2( derX, derY );
-  }
-  return qMax( 0.0, 255.0 * (( cos( zenith_rad ) * cos( slope_rad ) ) + ( sin( zenith_rad ) * sin( slope_rad ) * cos( azimuth_rad - aspect_rad ) ) ) );
 }
@@ -38,6 +38,11 @@ class ANALYSIS_EXPORT QgsHillshadeFilter: public QgsDerivativeFilter
     float lightAngle() const { return mLightAngle; }
     void setLightAngle( float angle ) { mLightAngle = angle; }
 
+  protected:
+    /** Calculates the values of a row of cells without a virtual call per cell
+      @note added in QGIS 2.12*/
+    void processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells ) override;
+
   private:
     float mLightAzimuth;
     float mLightAngle;
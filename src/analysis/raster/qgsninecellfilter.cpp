@@ -19,6 +19,10 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <algorithm>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8F(x) (x).toUtf8().constData()
@@ -26,6 +30,37 @@
 #define TO8F(x) QFile::encodeName( x ).constData()
 #endif
 
+//number of rows read, processed and written at once
+static const int BLOCK_ROWS = 128;
+
+/** Computes one row of a block of rows */
+class QgsNineCellFilter::RowFunctor
+{
+  public:
+    typedef void result_type;
+
+    RowFunctor( QgsNineCellFilter* filter, float* inputBlock, float* resultBlock, int nCells )
+        : mFilter( filter )
+        , mInputBlock( inputBlock )
+        , mResultBlock( resultBlock )
+        , mNCells( nCells )
+    {}
+
+    void operator()( int row )
+    {
+      //row i of the block is at index i + 1 of the input block
+      int paddedSize = mNCells + 2;
+      float* rowAbove = mInputBlock + row * paddedSize;
+      mFilter->processRow( rowAbove, rowAbove + paddedSize, rowAbove + 2 * paddedSize, mResultBlock + row * mNCells, mNCells );
+    }
+
+  private:
+    QgsNineCellFilter* mFilter;
+    float* mInputBlock;
+    float* mResultBlock;
+    int mNCells;
+};
+
 QgsNineCellFilter::QgsNineCellFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : mInputFile( inputFile )
     , mOutputFile( outputFile )
@@ -106,24 +141,30 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float* scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  float* resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  //the raster is processed in blocks of rows. Each input block has an additional row above and below and
+  //an additional column on either side, filled with (input) nodata values outside of the layer extent
+  int paddedSize = xSize + 2;
+  int maxBlockRows = qMin( BLOCK_ROWS, ySize );
+  QVector<float> inputBlock( paddedSize * ( maxBlockRows + 2 ) );
+  QVector<float> nextInputBlock( paddedSize * ( maxBlockRows + 2 ) );
+  QVector<float> resultBlock( xSize * maxBlockRows );
+  QVector<float> previousResultBlock( xSize * maxBlockRows );
 
   if ( p )
   {
     p->setMaximum( ySize );
   }
 
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  readBlock( rasterBand, 0, maxBlockRows, xSize, ySize, inputBlock.data() );
+
+  //the rows of a block are processed on the thread pool while the next block is read and the previous one is written
+  int previousStartRow = -1;
+  int previousRows = 0;
+  for ( int startRow = 0; startRow < ySize; startRow += BLOCK_ROWS )
   {
     if ( p )
     {
-      p->setValue( i );
+      p->setValue( startRow );
     }
 
     if ( p && p->wasCanceled() )
@@ -131,56 +172,36 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
       break;
     }
 
-    if ( i == 0 )
-    {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 );
-    }
-    else
+    int rows = qMin( BLOCK_ROWS, ySize - startRow );
+    QList<int> rowList;
+    for ( int i = 0; i < rows; ++i )
     {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+      rowList << i;
     }
+    QFuture<void> future = QtConcurrent::map( rowList, RowFunctor( this, inputBlock.data(), resultBlock.data(), xSize ) );
 
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
-    {
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine3[a] = mInputNodataValue;
-      }
-    }
-    else
+    int nextStartRow = startRow + BLOCK_ROWS;
+    if ( nextStartRow < ySize )
     {
-      GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 );
+      readBlock( rasterBand, nextStartRow, qMin( BLOCK_ROWS, ySize - nextStartRow ), xSize, ySize, nextInputBlock.data() );
     }
 
-    for ( int j = 0; j < xSize; ++j )
+    if ( previousStartRow >= 0 )
     {
-      if ( j == 0 )
-      {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j+1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j+1], &mInputNodataValue, &scanLine3[j], &scanLine3[j+1] );
-      }
-      else if ( j == xSize - 1 )
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &mInputNodataValue, &scanLine2[j-1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j-1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &scanLine1[j+1], &scanLine2[j-1], &scanLine2[j],
-                                               &scanLine2[j+1], &scanLine3[j-1], &scanLine3[j], &scanLine3[j+1] );
-      }
+      GDALRasterIO( outputRasterBand, GF_Write, 0, previousStartRow, xSize, previousRows, previousResultBlock.data(), xSize, previousRows, GDT_Float32, 0, 0 );
     }
 
-    GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 );
+    future.waitForFinished();
+
+    inputBlock.swap( nextInputBlock );
+    resultBlock.swap( previousResultBlock );
+    previousStartRow = startRow;
+    previousRows = rows;
+  }
+
+  if ( previousStartRow >= 0 && !( p && p->wasCanceled() ) )
+  {
+    GDALRasterIO( outputRasterBand, GF_Write, 0, previousStartRow, xSize, previousRows, previousResultBlock.data(), xSize, previousRows, GDT_Float32, 0, 0 );
   }
 
   if ( p )
@@ -188,11 +209,6 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     p->setValue( ySize );
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   GDALClose( inputDataset );
 
   if ( p && p->wasCanceled() )
@@ -206,6 +222,45 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
   return 0;
 }
 
+void QgsNineCellFilter::processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  for ( int j = 0; j < nCells; ++j )
+  {
+    result[j] = processNineCellWindow( &rowAbove[j], &rowAbove[j+1], &rowAbove[j+2],
+                                       &row[j], &row[j+1], &row[j+2],
+                                       &rowBelow[j], &rowBelow[j+1], &rowBelow[j+2] );
+  }
+}
+
+void QgsNineCellFilter::readBlock( GDALRasterBandH rasterBand, int startRow, int rows, int nCellsX, int nCellsY, float* block )
+{
+  int paddedSize = nCellsX + 2;
+
+  //rows of the layer which are needed for the block, including the rows above and below
+  int firstRow = qMax( 0, startRow - 1 );
+  int lastRow = qMin( nCellsY - 1, startRow + rows );
+  float* firstRowStart = block + ( firstRow - startRow + 1 ) * paddedSize;
+
+  if ( firstRow > startRow - 1 )
+  {
+    std::fill( block, firstRowStart, mInputNodataValue );
+  }
+  if ( lastRow < startRow + rows )
+  {
+    std::fill( block + ( rows + 1 ) * paddedSize, block + ( rows + 2 ) * paddedSize, mInputNodataValue );
+  }
+
+  for ( int i = firstRow; i <= lastRow; ++i )
+  {
+    float* line = block + ( i - startRow + 1 ) * paddedSize;
+    line[0] = mInputNodataValue;
+    line[nCellsX + 1] = mInputNodataValue;
+  }
+
+  GDALRasterIO( rasterBand, GF_Read, 0, firstRow, nCellsX, lastRow - firstRow + 1, firstRowStart + 1, nCellsX, lastRow - firstRow + 1,
+                GDT_Float32, 0, paddedSize * sizeof( float ) );
+}
+
 GDALDatasetH QgsNineCellFilter::openInputFile( int& nCellsX, int& nCellsY )
 {
   GDALDatasetH inputDataset = GDALOpen( TO8F( mInputFile ), GA_ReadOnly );
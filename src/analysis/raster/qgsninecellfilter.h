@@ -52,12 +52,24 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     void setOutputNodataValue( double value ) { mOutputNodataValue = value; }
 
     /** Calculates output value from nine input values. The input values and the output value can be equal to the
-      nodata value if not present or outside of the border. Must be implemented by subclasses*/
+      nodata value if not present or outside of the border. Must be implemented by subclasses.
+      @note may be called from several threads at the same time*/
     virtual float processNineCellWindow( float* x11, float* x21, float* x31,
                                          float* x12, float* x22, float* x32,
                                          float* x13, float* x23, float* x33 ) = 0;
 
+  protected:
+    /** Calculates the output values of one row of cells. Each input row has an additional (input) nodata cell
+      on either side, i.e. the first cell of the row is at index 1 and the window of result[j] is centered on row[j+1].
+      The default implementation calls processNineCellWindow() for every cell. Subclasses can override it to avoid
+      the virtual call per cell and to process the row in tight loops.
+      @note may be called from several threads at the same time
+      @note added in QGIS 2.12*/
+    virtual void processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells );
+
   private:
+    class RowFunctor;
+
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter();
 
@@ -69,6 +81,9 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     /** Opens the output file and sets the same geotransform and CRS as the input data
       @return the output dataset or NULL in case of error*/
     GDALDatasetH openOutputFile( GDALDatasetH inputDataset, GDALDriverH outputDriver );
+    /** Reads rows startRow - 1 to startRow + rows of the input band into a block with one additional column on either side.
+      Cells outside of the layer extent are set to the input nodata value*/
+    void readBlock( GDALRasterBandH rasterBand, int startRow, int rows, int nCellsX, int nCellsY, float* block );
 
   protected:
 
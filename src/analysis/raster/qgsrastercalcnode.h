@@ -96,6 +96,8 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     static QgsRasterCalcNode* parseRasterCalcString( const QString& str, QString& parserErrorMsg );
 
   private:
+    friend class QgsRasterCalcProgram;
+
     Type mType;
     QgsRasterCalcNode* mLeft;
     QgsRasterCalcNode* mRight;
@@ -0,0 +1,402 @@
+/***************************************************************************
+    qgsrastercalcprogram.cpp
+    ---------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrastercalcprogram.h"
+#include "qgsrasterblock.h"
+
+#include <qmath.h>
+
+#include <algorithm>
+
+//number of cells of a row processed by one instruction
+static const int RUN_LENGTH = 256;
+
+// The operators mirror QgsRasterMatrix. They return the nodata value for invalid
+// arguments, nodata arguments are handled by the loops.
+
+struct QgsRasterCalcSqrt
+{
+  inline double operator()( double v, double nodata ) const { return v < 0 ? nodata : sqrt( v ); }
+};
+
+struct QgsRasterCalcLog
+{
+  inline double operator()( double v, double nodata ) const { return v <= 0 ? nodata : ::log( v ); }
+};
+
+struct QgsRasterCalcLog10
+{
+  inline double operator()( double v, double nodata ) const { return v <= 0 ? nodata : ::log10( v ); }
+};
+
+struct QgsRasterCalcSin
+{
+  inline double operator()( double v, double ) const { return sin( v ); }
+};
+
+struct QgsRasterCalcCos
+{
+  inline double operator()( double v, double ) const { return cos( v ); }
+};
+
+struct QgsRasterCalcTan
+{
+  inline double operator()( double v, double ) const { return tan( v ); }
+};
+
+struct QgsRasterCalcAsin
+{
+  inline double operator()( double v, double ) const { return asin( v ); }
+};
+
+struct QgsRasterCalcAcos
+{
+  inline double operator()( double v, double ) const { return acos( v ); }
+};
+
+struct QgsRasterCalcAtan
+{
+  inline double operator()( double v, double ) const { return atan( v ); }
+};
+
+struct QgsRasterCalcSign
+{
+  inline double operator()( double v, double ) const { return -v; }
+};
+
+struct QgsRasterCalcPlus
+{
+  inline double operator()( double a, double b, double ) const { return a + b; }
+};
+
+struct QgsRasterCalcMinus
+{
+  inline double operator()( double a, double b, double ) const { return a - b; }
+};
+
+struct QgsRasterCalcMul
+{
+  inline double operator()( double a, double b, double ) const { return a * b; }
+};
+
+struct QgsRasterCalcDiv
+{
+  inline double operator()( double a, double b, double nodata ) const { return b == 0 ? nodata : a / b; }
+};
+
+struct QgsRasterCalcPow
+{
+  inline double operator()( double a, double b, double nodata ) const
+  {
+    if (( a == 0 && b < 0 ) || ( a < 0 && ( b - floor( b ) ) > 0 ) )
+      return nodata;
+    return qPow( a, b );
+  }
+};
+
+struct QgsRasterCalcEq
+{
+  inline double operator()( double a, double b, double ) const { return a == b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterCalcNe
+{
+  inline double operator()( double a, double b, double ) const { return a == b ? 0.0 : 1.0; }
+};
+
+struct QgsRasterCalcGt
+{
+  inline double operator()( double a, double b, double ) const { return a > b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterCalcLt
+{
+  inline double operator()( double a, double b, double ) const { return a < b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterCalcGe
+{
+  inline double operator()( double a, double b, double ) const { return a >= b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterCalcLe
+{
+  inline double operator()( double a, double b, double ) const { return a <= b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterCalcAnd
+{
+  inline double operator()( double a, double b, double ) const { return a != 0 && b != 0 ? 1.0 : 0.0; }
+};
+
+struct QgsRasterCalcOr
+{
+  inline double operator()( double a, double b, double ) const { return a != 0 || b != 0 ? 1.0 : 0.0; }
+};
+
+template <typename Function>
+static void unaryLoop( double* values, int n, double nodata, Function f )
+{
+  for ( int i = 0; i < n; ++i )
+  {
+    double value = values[i];
+    double result = f( value, nodata );
+    values[i] = value == nodata ? nodata : result;
+  }
+}
+
+template <typename Function>
+static void binaryLoop( double* left, const double* right, int n, double nodata, Function f )
+{
+  for ( int i = 0; i < n; ++i )
+  {
+    double a = left[i];
+    double b = right[i];
+    double result = f( a, b, nodata );
+    left[i] = ( a == nodata || b == nodata ) ? nodata : result;
+  }
+}
+
+
+QgsRasterCalcProgram* QgsRasterCalcProgram::compile( const QgsRasterCalcNode* node, double nodataValue )
+{
+  if ( !node )
+    return 0;
+
+  QgsRasterCalcProgram* program = new QgsRasterCalcProgram();
+  program->mNodataValue = nodataValue;
+  if ( !program->compileNode( node, 1 ) )
+  {
+    delete program;
+    return 0;
+  }
+  return program;
+}
+
+bool QgsRasterCalcProgram::isUnaryOperator( QgsRasterCalcNode::Operator op )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+    case QgsRasterCalcNode::opSIN:
+    case QgsRasterCalcNode::opCOS:
+    case QgsRasterCalcNode::opTAN:
+    case QgsRasterCalcNode::opASIN:
+    case QgsRasterCalcNode::opACOS:
+    case QgsRasterCalcNode::opATAN:
+    case QgsRasterCalcNode::opSIGN:
+    case QgsRasterCalcNode::opLOG:
+    case QgsRasterCalcNode::opLOG10:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool QgsRasterCalcProgram::compileNode( const QgsRasterCalcNode* node, int depth )
+{
+  mStackSize = qMax( mStackSize, depth );
+
+  switch ( node->mType )
+  {
+    case QgsRasterCalcNode::tNumber:
+      mCode.append( Instruction( OpNumber, 0, node->mNumber ) );
+      return true;
+
+    case QgsRasterCalcNode::tRasterRef:
+    {
+      int index = mRasterNames.indexOf( node->mRasterName );
+      if ( index < 0 )
+      {
+        index = mRasterNames.count();
+        mRasterNames << node->mRasterName;
+      }
+      mCode.append( Instruction( OpRaster, index ) );
+      return true;
+    }
+
+    case QgsRasterCalcNode::tOperator:
+    {
+      if ( node->mOperator == QgsRasterCalcNode::opNONE || !node->mLeft || !compileNode( node->mLeft, depth ) )
+        return false;
+
+      if ( isUnaryOperator( node->mOperator ) )
+      {
+        mCode.append( Instruction( OpUnary, node->mOperator ) );
+        return true;
+      }
+
+      if ( !node->mRight || !compileNode( node->mRight, depth + 1 ) )
+        return false;
+
+      mCode.append( Instruction( OpBinary, node->mOperator ) );
+      return true;
+    }
+
+    case QgsRasterCalcNode::tMatrix:
+      // matrices have their own size, they do not map to blocks of cells
+      break;
+  }
+
+  return false;
+}
+
+void QgsRasterCalcProgram::run( const QVector<QgsRasterBlock*>& inputs, int startRow, int nRows, int startColumn, int nColumns,
+                                float* result, int resultStride ) const
+{
+  QVector<double> stack( mStackSize * RUN_LENGTH );
+  double nodata = mNodataValue;
+
+  for ( int row = 0; row < nRows; ++row )
+  {
+    for ( int column = 0; column < nColumns; column += RUN_LENGTH )
+    {
+      int n = qMin( RUN_LENGTH, nColumns - column );
+      int depth = 0;
+
+      Q_FOREACH ( const Instruction& ins, mCode )
+      {
+        switch ( ins.op )
+        {
+          case OpRaster:
+          {
+            //convert input raster values to double, also convert input no data to result no data
+            double* values = stack.data() + depth++ * RUN_LENGTH;
+            QgsRasterBlock* block = inputs[ins.arg];
+            qgssize index = ( qgssize )( startRow + row ) * block->width() + startColumn + column;
+            for ( int i = 0; i < n; ++i, ++index )
+            {
+              values[i] = block->isNoData( index ) ? nodata : block->value( index );
+            }
+            break;
+          }
+
+          case OpNumber:
+          {
+            double* values = stack.data() + depth++ * RUN_LENGTH;
+            std::fill( values, values + n, ins.number );
+            break;
+          }
+
+          case OpUnary:
+            runUnary(( QgsRasterCalcNode::Operator ) ins.arg, stack.data() + ( depth - 1 ) * RUN_LENGTH, n );
+            break;
+
+          case OpBinary:
+          {
+            --depth;
+            double* left = stack.data() + ( depth - 1 ) * RUN_LENGTH;
+            runBinary(( QgsRasterCalcNode::Operator ) ins.arg, left, left + RUN_LENGTH, n );
+            break;
+          }
+        }
+      }
+
+      const double* values = stack.constData();
+      float* out = result + row * resultStride + column;
+      for ( int i = 0; i < n; ++i )
+      {
+        out[i] = ( float ) values[i];
+      }
+    }
+  }
+}
+
+void QgsRasterCalcProgram::runUnary( QgsRasterCalcNode::Operator op, double* values, int n ) const
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcSqrt() );
+      break;
+    case QgsRasterCalcNode::opSIN:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcSin() );
+      break;
+    case QgsRasterCalcNode::opCOS:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcCos() );
+      break;
+    case QgsRasterCalcNode::opTAN:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcTan() );
+      break;
+    case QgsRasterCalcNode::opASIN:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcAsin() );
+      break;
+    case QgsRasterCalcNode::opACOS:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcAcos() );
+      break;
+    case QgsRasterCalcNode::opATAN:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcAtan() );
+      break;
+    case QgsRasterCalcNode::opSIGN:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcSign() );
+      break;
+    case QgsRasterCalcNode::opLOG:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcLog() );
+      break;
+    case QgsRasterCalcNode::opLOG10:
+      unaryLoop( values, n, mNodataValue, QgsRasterCalcLog10() );
+      break;
+    default:
+      break;
+  }
+}
+
+void QgsRasterCalcProgram::runBinary( QgsRasterCalcNode::Operator op, double* left, const double* right, int n ) const
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opPLUS:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcPlus() );
+      break;
+    case QgsRasterCalcNode::opMINUS:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcMinus() );
+      break;
+    case QgsRasterCalcNode::opMUL:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcMul() );
+      break;
+    case QgsRasterCalcNode::opDIV:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcDiv() );
+      break;
+    case QgsRasterCalcNode::opPOW:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcPow() );
+      break;
+    case QgsRasterCalcNode::opEQ:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcEq() );
+      break;
+    case QgsRasterCalcNode::opNE:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcNe() );
+      break;
+    case QgsRasterCalcNode::opGT:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcGt() );
+      break;
+    case QgsRasterCalcNode::opLT:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcLt() );
+      break;
+    case QgsRasterCalcNode::opGE:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcGe() );
+      break;
+    case QgsRasterCalcNode::opLE:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcLe() );
+      break;
+    case QgsRasterCalcNode::opAND:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcAnd() );
+      break;
+    case QgsRasterCalcNode::opOR:
+      binaryLoop( left, right, n, mNodataValue, QgsRasterCalcOr() );
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+    qgsrastercalcprogram.h
+    ---------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERCALCPROGRAM_H
+#define QGSRASTERCALCPROGRAM_H
+
+#include "qgsrastercalcnode.h"
+
+#include <QStringList>
+#include <QVector>
+
+class QgsRasterBlock;
+
+/**
+ * Flat instruction stream compiled from a QgsRasterCalcNode tree.
+ *
+ * The program is a stack machine working on runs of cells instead of single values:
+ * each instruction processes up to 256 cells of a row in one tight loop without
+ * branches (nodata handling is done with selects), so the loops can be vectorized by
+ * the compiler. The stack is allocated once per call of run(), there are no
+ * temporary matrices per node.
+ *
+ * Results are identical to QgsRasterCalcNode::calculate(). Trees containing matrix
+ * nodes can not be compiled.
+ *
+ * run() is const and can be called from several threads at the same time.
+ *
+ * @note not available in Python bindings
+ * @note added in QGIS 2.12
+ */
+class ANALYSIS_EXPORT QgsRasterCalcProgram
+{
+  public:
+
+    /** Compiles a calculation tree. Returns null if the tree can not be compiled.
+     * @param node root node of the tree
+     * @param nodataValue nodata value of the results
+     */
+    static QgsRasterCalcProgram* compile( const QgsRasterCalcNode* node, double nodataValue );
+
+    /** Names of the rasters referenced by the program. The input blocks passed to run()
+     * must be in the same order.
+     */
+    QStringList rasterNames() const { return mRasterNames; }
+
+    //! Returns number of instructions of the program
+    int instructionCount() const { return mCode.count(); }
+
+    /** Calculates the results for a rectangle of cells.
+     * @param inputs input blocks, in the order of rasterNames(). All blocks must have the same size.
+     * @param startRow first row of the rectangle in the input blocks
+     * @param nRows number of rows of the rectangle
+     * @param startColumn first column of the rectangle in the input blocks
+     * @param nColumns number of columns of the rectangle
+     * @param result receives the results, the first value is the result of cell startRow/startColumn
+     * @param resultStride distance between the rows of the result
+     */
+    void run( const QVector<QgsRasterBlock*>& inputs, int startRow, int nRows, int startColumn, int nColumns,
+              float* result, int resultStride ) const;
+
+  private:
+
+    QgsRasterCalcProgram() : mStackSize( 0 ), mNodataValue( 0 ) {}
+
+    enum OpCode
+    {
+      OpRaster,   //!< push values of raster arg
+      OpNumber,   //!< push number
+      OpUnary,    //!< one argument operator arg applied on top of stack
+      OpBinary,   //!< two argument operator arg applied on two values on top of stack
+    };
+
+    struct Instruction
+    {
+      Instruction( OpCode o = OpNumber, int a = 0, double n = 0 ) : op( o ), arg( a ), number( n ) {}
+
+      OpCode op;
+      int arg;
+      double number;
+    };
+
+    bool compileNode( const QgsRasterCalcNode* node, int depth );
+    static bool isUnaryOperator( QgsRasterCalcNode::Operator op );
+
+    void runUnary( QgsRasterCalcNode::Operator op, double* values, int n ) const;
+    void runBinary( QgsRasterCalcNode::Operator op, double* left, const double* right, int n ) const;
+
+    QVector<Instruction> mCode;
+    QStringList mRasterNames;
+    int mStackSize;
+    double mNodataValue;
+};
+
+#endif // QGSRASTERCALCPROGRAM_H
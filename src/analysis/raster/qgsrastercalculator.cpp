@@ -17,11 +17,13 @@
 
 #include "qgsrastercalculator.h"
 #include "qgsrastercalcnode.h"
+#include "qgsrastercalcprogram.h"
 #include "qgsrasterlayer.h"
 #include "qgsrastermatrix.h"
 
 #include <QProgressDialog>
 #include <QFile>
+#include <QtConcurrentMap>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -34,6 +36,36 @@
 #define TO8F(x)  QFile::encodeName( x ).constData()
 #endif
 
+//number of rows of the strips and number of columns of the tiles calculated in one go
+static const int BLOCK_SIZE = 256;
+
+/** Calculates a tile of a strip of rows */
+class QgsRasterCalcTileFunctor
+{
+  public:
+    typedef void result_type;
+
+    QgsRasterCalcTileFunctor( const QgsRasterCalcProgram* program, const QVector<QgsRasterBlock*>& inputs, int nRows, int nColumns, float* result )
+        : mProgram( program )
+        , mInputs( inputs )
+        , mNRows( nRows )
+        , mNColumns( nColumns )
+        , mResult( result )
+    {}
+
+    void operator()( int startColumn )
+    {
+      mProgram->run( mInputs, 0, mNRows, startColumn, qMin( BLOCK_SIZE, mNColumns - startColumn ), mResult + startColumn, mNColumns );
+    }
+
+  private:
+    const QgsRasterCalcProgram* mProgram;
+    QVector<QgsRasterBlock*> mInputs;
+    int mNRows;
+    int mNColumns;
+    float* mResult;
+};
+
 QgsRasterCalculator::QgsRasterCalculator( const QString& formulaString, const QString& outputFile, const QString& outputFormat,
     const QgsRectangle& outputExtent, int nOutputColumns, int nOutputRows, const QVector<QgsRasterCalculatorEntry>& rasterEntries )
     : mFormulaString( formulaString )
@@ -77,37 +109,21 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     return 4;
   }
 
-  QMap< QString, QgsRasterBlock* > inputBlocks;
   QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
   for ( ; it != mRasterEntries.constEnd(); ++it )
   {
     if ( !it->raster ) // no raster layer in entry
     {
+      delete calcNode;
       return 2;
     }
-
-    QgsRasterBlock* block = 0;
-    // if crs transform needed
-    if ( it->raster->crs() != mOutputCrs )
-    {
-      QgsRasterProjector proj;
-      proj.setCRS( it->raster->crs(), mOutputCrs );
-      proj.setInput( it->raster->dataProvider() );
-      proj.setPrecision( QgsRasterProjector::Exact );
-
-      block = proj.block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    else
-    {
-      block = it->raster->dataProvider()->block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    inputBlocks.insert( it->ref, block );
   }
 
   //open output dataset for writing
   GDALDriverH outputDriver = openOutputDriver();
   if ( outputDriver == NULL )
   {
+    delete calcNode;
     return 1;
   }
 
@@ -123,6 +139,69 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     p->setMaximum( mNumOutputRows );
   }
 
+  //evaluate the compiled formula block by block if possible, otherwise the tree row by row
+  QgsRasterCalcProgram* program = QgsRasterCalcProgram::compile( calcNode, outputNodataValue );
+  QVector<int> entryIndexes;
+  if ( program )
+  {
+    Q_FOREACH ( const QString& name, program->rasterNames() )
+    {
+      int index = -1;
+      for ( int i = 0; i < mRasterEntries.size(); ++i )
+      {
+        if ( mRasterEntries.at( i ).ref == name )
+        {
+          index = i;
+          break;
+        }
+      }
+      if ( index < 0 )
+      {
+        delete program;
+        program = 0;
+        break;
+      }
+      entryIndexes << index;
+    }
+  }
+
+  if ( program )
+  {
+    calculateBlocks( *program, entryIndexes, outputRasterBand, p );
+    delete program;
+  }
+  else
+  {
+    calculateRows( calcNode, outputRasterBand, outputNodataValue, p );
+  }
+
+  if ( p )
+  {
+    p->setValue( mNumOutputRows );
+  }
+
+  delete calcNode;
+
+  if ( p && p->wasCanceled() )
+  {
+    //delete the dataset without closing (because it is faster)
+    GDALDeleteDataset( outputDriver, TO8F( mOutputFile ) );
+    return 3;
+  }
+  GDALClose( outputDataset );
+
+  return 0;
+}
+
+void QgsRasterCalculator::calculateRows( QgsRasterCalcNode* calcNode, GDALRasterBandH outputRasterBand, float outputNodataValue, QProgressDialog* p )
+{
+  QMap< QString, QgsRasterBlock* > inputBlocks;
+  QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
+  for ( ; it != mRasterEntries.constEnd(); ++it )
+  {
+    inputBlocks.insert( it->ref, readBlock( *it, mOutputRectangle, mNumOutputRows ) );
+  }
+
   QgsRasterMatrix resultMatrix;
   resultMatrix.setNodataValue( outputNodataValue );
 
@@ -157,28 +236,113 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
 
       delete[] calcData;
     }
+  }
+
+  qDeleteAll( inputBlocks );
+}
 
+void QgsRasterCalculator::calculateBlocks( const QgsRasterCalcProgram& program, const QVector<int>& entryIndexes, GDALRasterBandH outputRasterBand, QProgressDialog* p )
+{
+  //the inputs are read in strips of BLOCK_SIZE rows. While the tiles of a strip are calculated
+  //on the thread pool, the next strip is read and the results of the previous strip are written
+  QList<int> tileColumns;
+  for ( int column = 0; column < mNumOutputColumns; column += BLOCK_SIZE )
+  {
+    tileColumns << column;
   }
 
-  if ( p )
+  int maxRows = qMin( BLOCK_SIZE, mNumOutputRows );
+  QVector<float> result( mNumOutputColumns * maxRows );
+  QVector<float> previousResult( mNumOutputColumns * maxRows );
+
+  QVector<QgsRasterBlock*> inputs = readStrip( entryIndexes, 0, maxRows );
+  int previousStartRow = -1;
+  int previousRows = 0;
+
+  for ( int startRow = 0; startRow < mNumOutputRows; startRow += BLOCK_SIZE )
   {
-    p->setValue( mNumOutputRows );
+    if ( p )
+    {
+      p->setValue( startRow );
+    }
+
+    if ( p && p->wasCanceled() )
+    {
+      break;
+    }
+
+    int rows = qMin( BLOCK_SIZE, mNumOutputRows - startRow );
+    QFuture<void> future = QtConcurrent::map( tileColumns, QgsRasterCalcTileFunctor( &program, inputs, rows, mNumOutputColumns, result.data() ) );
+
+    QVector<QgsRasterBlock*> nextInputs;
+    int nextStartRow = startRow + BLOCK_SIZE;
+    if ( nextStartRow < mNumOutputRows )
+    {
+      nextInputs = readStrip( entryIndexes, nextStartRow, qMin( BLOCK_SIZE, mNumOutputRows - nextStartRow ) );
+    }
+
+    if ( previousStartRow >= 0 )
+    {
+      writeStrip( outputRasterBand, previousStartRow, previousRows, previousResult.data() );
+    }
+
+    future.waitForFinished();
+
+    qDeleteAll( inputs );
+    inputs = nextInputs;
+    result.swap( previousResult );
+    previousStartRow = startRow;
+    previousRows = rows;
   }
+  qDeleteAll( inputs );
 
-  //close datasets and release memory
-  delete calcNode;
-  qDeleteAll( inputBlocks );
-  inputBlocks.clear();
+  if ( previousStartRow >= 0 && !( p && p->wasCanceled() ) )
+  {
+    writeStrip( outputRasterBand, previousStartRow, previousRows, previousResult.data() );
+  }
+}
 
-  if ( p && p->wasCanceled() )
+QVector<QgsRasterBlock*> QgsRasterCalculator::readStrip( const QVector<int>& entryIndexes, int startRow, int nRows ) const
+{
+  double cellHeight = mOutputRectangle.height() / mNumOutputRows;
+  int endRow = startRow + nRows;
+  QgsRectangle extent( mOutputRectangle.xMinimum(),
+                       endRow == mNumOutputRows ? mOutputRectangle.yMinimum() : mOutputRectangle.yMaximum() - endRow * cellHeight,
+                       mOutputRectangle.xMaximum(),
+                       mOutputRectangle.yMaximum() - startRow * cellHeight );
+
+  QVector<QgsRasterBlock*> blocks;
+  Q_FOREACH ( int index, entryIndexes )
   {
-    //delete the dataset without closing (because it is faster)
-    GDALDeleteDataset( outputDriver, TO8F( mOutputFile ) );
-    return 3;
+    blocks << readBlock( mRasterEntries.at( index ), extent, nRows );
   }
-  GDALClose( outputDataset );
+  return blocks;
+}
 
-  return 0;
+void QgsRasterCalculator::writeStrip( GDALRasterBandH outputRasterBand, int startRow, int nRows, float* data ) const
+{
+  if ( GDALRasterIO( outputRasterBand, GF_Write, 0, startRow, mNumOutputColumns, nRows, data, mNumOutputColumns, nRows, GDT_Float32, 0, 0 ) != CE_None )
+  {
+    qWarning( "RasterIO error!" );
+  }
+}
+
+QgsRasterBlock* QgsRasterCalculator::readBlock( const QgsRasterCalculatorEntry& entry, const QgsRectangle& extent, int nRows ) const
+{
+  // if crs transform needed
+  if ( entry.raster->crs() != mOutputCrs )
+  {
+    QgsRasterProjector proj;
+    proj.setCRS( entry.raster->crs(), mOutputCrs );
+    proj.setInput( entry.raster->dataProvider() );
+    proj.setPrecision( QgsRasterProjector::Exact );
+
+    return proj.block( entry.bandNumber, extent, mNumOutputColumns, nRows );
+  }
+  else
+  {
+    return entry.raster->dataProvider()->block( entry.bandNumber, extent, mNumOutputColumns, nRows );
+  }
 }
 
 QgsRasterCalculator::QgsRasterCalculator()
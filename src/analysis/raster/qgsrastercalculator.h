@@ -25,6 +25,9 @@
 #include <QVector>
 #include "gdal.h"
 
+class QgsRasterBlock;
+class QgsRasterCalcNode;
+class QgsRasterCalcProgram;
 class QgsRasterLayer;
 class QProgressDialog;
 
@@ -90,6 +93,24 @@ class ANALYSIS_EXPORT QgsRasterCalculator
       @param transform double[6] array that receives the GDAL parameters*/
     void outputGeoTransform( double* transform ) const;
 
+    /** Evaluates the calculation tree row by row on input blocks covering the whole output extent*/
+    void calculateRows( QgsRasterCalcNode* calcNode, GDALRasterBandH outputRasterBand, float outputNodataValue, QProgressDialog* p );
+
+    /** Evaluates the compiled calculation in blocks of rows, the tiles of a block are calculated in parallel
+      @param program compiled calculation
+      @param entryIndexes indexes of the raster entries for the rasters referenced by the program*/
+    void calculateBlocks( const QgsRasterCalcProgram& program, const QVector<int>& entryIndexes, GDALRasterBandH outputRasterBand, QProgressDialog* p );
+
+    /** Reads the input blocks for nRows output rows starting at startRow*/
+    QVector<QgsRasterBlock*> readStrip( const QVector<int>& entryIndexes, int startRow, int nRows ) const;
+
+    /** Writes nRows rows of results starting at startRow*/
+    void writeStrip( GDALRasterBandH outputRasterBand, int startRow, int nRows, float* data ) const;
+
+    /** Reads an input block for the given extent with the output number of columns, reprojecting if necessary
+      @note caller takes ownership of the block*/
+    QgsRasterBlock* readBlock( const QgsRasterCalculatorEntry& entry, const QgsRectangle& extent, int nRows ) const;
+
     QString mFormulaString;
     QString mOutputFile;
     QString mOutputFormat;
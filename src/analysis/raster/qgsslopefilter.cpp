@@ -17,6 +17,18 @@
 
 #include "qgsslopefilter.h"
 
+#include <QVector>
+
+static inline float slope( float derX, float derY, float outputNodataValue )
+{
+  if ( derX == outputNodataValue || derY == outputNodataValue )
+  {
+    return outputNodataValue;
+  }
+
+  return atan( sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
+}
+
 QgsSlopeFilter::QgsSlopeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -33,12 +45,18 @@ float QgsSlopeFilter::processNineCellWindow( float* x11, float* x21, float* x31,
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return slope( derX, derY, mOutputNodataValue );
+}
+
+void QgsSlopeFilter::processRow( float* rowAbove, float* row, float* rowBelow, float* result, int nCells )
+{
+  QVector<float> derX( nCells );
+  QVector<float> derY( nCells );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), nCells );
 
-  if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
+  for ( int j = 0; j < nCells; ++j )
   {
-    return mOutputNodataValue;
+    result[j] = slope( derX[j], derY[j], mOutputNodataValue );
   }
-
-  return atan( sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
 }
 
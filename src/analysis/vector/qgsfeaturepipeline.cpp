@@ -0,0 +1,151 @@
+/***************************************************************************
+    qgsfeaturepipeline.cpp
+    ---------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsfeaturepipeline.h"
+
+#include "qgsfeatureiterator.h"
+#include "qgsvectorfilewriter.h"
+#include "qgsvectorlayer.h"
+
+#include <QProgressDialog>
+#include <QtConcurrentMap>
+
+// number of features handed to the thread pool at once
+static const int FEATURE_BLOCK_SIZE = 1000;
+
+// functor for QtConcurrent::mapped
+struct QgsFeaturePipelineFunctor
+{
+  explicit QgsFeaturePipelineFunctor( const QgsFeaturePipeline* pipeline ) : mPipeline( pipeline ) {}
+
+  typedef QgsFeatureList result_type;
+
+  QgsFeatureList operator()( const QgsFeature& f ) const { return mPipeline->processFeature( f ); }
+
+  const QgsFeaturePipeline* mPipeline;
+};
+
+
+QgsFeaturePipeline::QgsFeaturePipeline( QProgressDialog* p )
+    : mProgress( p )
+{
+}
+
+QgsFeaturePipeline::~QgsFeaturePipeline()
+{
+}
+
+bool QgsFeaturePipeline::run( QgsFeatureIterator& fit, int featureCount )
+{
+  if ( mProgress )
+  {
+    mProgress->setMaximum( featureCount );
+  }
+
+  QgsFeatureList block;
+  fit.nextFeatures( block, FEATURE_BLOCK_SIZE );
+
+  QFuture<QgsFeatureList> future;
+  int pendingFeatures = 0;
+  int processedFeatures = 0;
+  bool canceled = false;
+
+  while ( !block.isEmpty() )
+  {
+    // the future keeps its own copy of the block
+    QFuture<QgsFeatureList> next = QtConcurrent::mapped( block, QgsFeaturePipelineFunctor( this ) );
+    int nextFeatures = block.count();
+
+    // read ahead while the workers are busy
+    block.clear();
+    fit.nextFeatures( block, FEATURE_BLOCK_SIZE );
+
+    if ( pendingFeatures > 0 )
+    {
+      Q_FOREACH ( QgsFeatureList features, future.results() )
+      {
+        writeFeatures( features );
+      }
+      processedFeatures += pendingFeatures;
+    }
+    future = next;
+    pendingFeatures = nextFeatures;
+
+    if ( mProgress )
+    {
+      mProgress->setValue( processedFeatures );
+      if ( mProgress->wasCanceled() )
+      {
+        canceled = true;
+        break;
+      }
+    }
+  }
+
+  if ( pendingFeatures > 0 )
+  {
+    if ( canceled )
+    {
+      future.cancel();
+      future.waitForFinished();
+    }
+    else
+    {
+      Q_FOREACH ( QgsFeatureList features, future.results() )
+      {
+        writeFeatures( features );
+      }
+    }
+  }
+
+  if ( mProgress && !canceled )
+  {
+    mProgress->setValue( featureCount );
+  }
+
+  return !canceled;
+}
+
+bool QgsFeaturePipeline::run( QgsVectorLayer* layer, bool onlySelectedFeatures, QgsFeatureRequest request )
+{
+  int featureCount;
+  if ( onlySelectedFeatures )
+  {
+    request.setFilterFids( layer->selectedFeaturesIds() );
+    featureCount = layer->selectedFeatureCount();
+  }
+  else
+  {
+    featureCount = layer->featureCount();
+  }
+
+  QgsFeatureIterator fit = layer->getFeatures( request );
+  return run( fit, featureCount );
+}
+
+
+QgsFeatureWriterPipeline::QgsFeatureWriterPipeline( QgsVectorFileWriter* writer, QProgressDialog* p )
+    : QgsFeaturePipeline( p )
+    , mWriter( writer )
+{
+}
+
+void QgsFeatureWriterPipeline::writeFeatures( QgsFeatureList& features )
+{
+  for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
+  {
+    mWriter->addFeature( *it );
+  }
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+    qgsfeaturepipeline.h
+    ---------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSFEATUREPIPELINE_H
+#define QGSFEATUREPIPELINE_H
+
+#include "qgsfeature.h"
+#include "qgsfeaturerequest.h"
+
+class QgsFeatureIterator;
+class QgsVectorLayer;
+class QgsVectorFileWriter;
+class QProgressDialog;
+
+/**
+ * Processes features of an iterator on the global thread pool.
+ *
+ * Features are read in blocks by the calling thread. While the worker threads process
+ * one block with processFeature(), the results of the previous block are passed to
+ * writeFeatures() and the next block is read. Results are written in the order of the
+ * input features.
+ *
+ * @note not part of public API
+ * @note added in QGIS 2.12
+ */
+class QgsFeaturePipeline
+{
+  public:
+
+    /** Constructor
+     * @param p progress dialog (or 0 if no progress dialog is to be shown)
+     */
+    explicit QgsFeaturePipeline( QProgressDialog* p = 0 );
+    virtual ~QgsFeaturePipeline();
+
+    /** Processes all features of an iterator.
+     * @param fit iterator over input features, only used by the calling thread
+     * @param featureCount number of features (for the progress dialog)
+     * @returns false if canceled by the progress dialog
+     */
+    bool run( QgsFeatureIterator& fit, int featureCount );
+
+    /** Processes all (or only the selected) features of a layer.
+     * @param layer input vector layer
+     * @param onlySelectedFeatures if true, only selected features are considered, else all the features
+     * @param request request for the features (the selection is applied as feature id filter)
+     * @returns false if canceled by the progress dialog
+     */
+    bool run( QgsVectorLayer* layer, bool onlySelectedFeatures, QgsFeatureRequest request = QgsFeatureRequest() );
+
+    /** Computes the output features for an input feature. Called from worker threads,
+     * so implementations must not modify shared state or access layers.
+     */
+    virtual QgsFeatureList processFeature( const QgsFeature& f ) const = 0;
+
+    /** Takes the output of a feature. Called from the thread calling run(). */
+    virtual void writeFeatures( QgsFeatureList& features ) = 0;
+
+  private:
+    QProgressDialog* mProgress;
+};
+
+/**
+ * Pipeline writing the output features to a vector file writer.
+ *
+ * @note not part of public API
+ * @note added in QGIS 2.12
+ */
+class QgsFeatureWriterPipeline : public QgsFeaturePipeline
+{
+  public:
+    QgsFeatureWriterPipeline( QgsVectorFileWriter* writer, QProgressDialog* p = 0 );
+
+    virtual void writeFeatures( QgsFeatureList& features ) override;
+
+  private:
+    QgsVectorFileWriter* mWriter;
+};
+
+#endif // QGSFEATUREPIPELINE_H
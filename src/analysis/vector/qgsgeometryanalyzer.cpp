@@ -20,244 +20,259 @@
 #include "qgsapplication.h"
 #include "qgsfield.h"
 #include "qgsfeature.h"
+#include "qgsfeaturepipeline.h"
 #include "qgslogger.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsvectorfilewriter.h"
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
 #include <QProgressDialog>
+#include <QtConcurrentMap>
 
-bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer,
-                                    const QString& shapefileName,
-                                    double tolerance,
-                                    bool onlySelectedFeatures,
-                                    QProgressDialog *p )
+//! Simplifies the geometry of each feature
+class QgsSimplifyPipeline : public QgsFeatureWriterPipeline
 {
-  if ( !layer )
-  {
-    return false;
-  }
-
-  QgsVectorDataProvider* dp = layer->dataProvider();
-  if ( !dp )
-  {
-    return false;
-  }
-
-  QGis::WkbType outputType = dp->geometryType();
-  const QgsCoordinateReferenceSystem crs = layer->crs();
-
-  QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-
-  //take only selection
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    if ( p )
-    {
-      p->setMaximum( selection.size() );
-    }
+  public:
+    QgsSimplifyPipeline( QgsVectorFileWriter* writer, double tolerance, QProgressDialog* p )
+        : QgsFeatureWriterPipeline( writer, p )
+        , mTolerance( tolerance )
+    {}
 
-    int processedFeatures = 0;
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
+    virtual QgsFeatureList processFeature( const QgsFeature& f ) const override
     {
-      if ( p )
+      QgsFeatureList result;
+      if ( f.constGeometry() )
       {
-        p->setValue( processedFeatures );
+        QgsFeature newFeature;
+        newFeature.setGeometry( f.constGeometry()->simplify( mTolerance ) );
+        newFeature.setAttributes( f.attributes() );
+        result << newFeature;
       }
+      return result;
+    }
 
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
+  private:
+    double mTolerance;
+};
+
+//! Replaces the geometry of each feature by its centroid
+class QgsCentroidPipeline : public QgsFeatureWriterPipeline
+{
+  public:
+    QgsCentroidPipeline( QgsVectorFileWriter* writer, QProgressDialog* p )
+        : QgsFeatureWriterPipeline( writer, p )
+    {}
+
+    virtual QgsFeatureList processFeature( const QgsFeature& f ) const override
+    {
+      QgsFeatureList result;
+      if ( f.constGeometry() )
       {
-        continue;
+        QgsFeature newFeature;
+        newFeature.setGeometry( f.constGeometry()->centroid() );
+        newFeature.setAttributes( f.attributes() );
+        result << newFeature;
       }
-      simplifyFeature( currentFeature, &vWriter, tolerance );
-      ++processedFeatures;
+      return result;
     }
+};
 
-    if ( p )
+//! Buffers each feature, buffers are either written or collected for dissolving
+class QgsBufferPipeline : public QgsFeatureWriterPipeline
+{
+  public:
+    QgsBufferPipeline( QgsVectorFileWriter* writer, double bufferDistance, int bufferDistanceField, bool dissolve, QProgressDialog* p )
+        : QgsFeatureWriterPipeline( writer, p )
+        , mBufferDistance( bufferDistance )
+        , mBufferDistanceField( bufferDistanceField )
+        , mDissolve( dissolve )
+    {}
+
+    ~QgsBufferPipeline()
     {
-      p->setValue( selection.size() );
+      qDeleteAll( mBuffers );
     }
-  }
-  //take all features
-  else
-  {
-    QgsFeatureIterator fit = layer->getFeatures();
 
-    int featureCount = layer->featureCount();
-    if ( p )
+    virtual QgsFeatureList processFeature( const QgsFeature& f ) const override
     {
-      p->setMaximum( featureCount );
+      QgsFeatureList result;
+      if ( !f.constGeometry() )
+        return result;
+
+      double distance = mBufferDistanceField == -1 ? mBufferDistance : f.attribute( mBufferDistanceField ).toDouble();
+      QgsGeometry* bufferGeometry = f.constGeometry()->buffer( distance, 5 );
+      if ( !bufferGeometry )
+        return result;
+
+      QgsFeature newFeature;
+      newFeature.setGeometry( bufferGeometry );
+      if ( !mDissolve )
+        newFeature.setAttributes( f.attributes() );
+      result << newFeature;
+      return result;
     }
-    int processedFeatures = 0;
 
-    while ( fit.nextFeature( currentFeature ) )
+    virtual void writeFeatures( QgsFeatureList& features ) override
     {
-      if ( p )
+      if ( !mDissolve )
       {
-        p->setValue( processedFeatures );
+        QgsFeatureWriterPipeline::writeFeatures( features );
+        return;
       }
-      if ( p && p->wasCanceled() )
+
+      Q_FOREACH ( const QgsFeature& f, features )
       {
-        break;
+        mBuffers << new QgsGeometry( *f.constGeometry() );
       }
-      simplifyFeature( currentFeature, &vWriter, tolerance );
-      ++processedFeatures;
     }
-    if ( p )
+
+    //! Returns union of all buffers (caller takes ownership)
+    QgsGeometry* dissolvedBuffers() const
     {
-      p->setValue( featureCount );
+      return mBuffers.isEmpty() ? 0 : QgsGeometry::unaryUnion( mBuffers );
     }
-  }
 
-  return true;
+  private:
+    double mBufferDistance;
+    int mBufferDistanceField;
+    bool mDissolve;
+    QList<QgsGeometry*> mBuffers;
+};
+
+//! Geometries of features sharing a value of the dissolve field
+struct QgsDissolveGroup
+{
+  QgsDissolveGroup() : result( 0 ) {}
+
+  QList<QgsGeometry*> geometries;
+  QgsAttributes attributes;
+  QgsGeometry* result;
+};
+
+//! Computes the union of a group with a cascaded union instead of merging one geometry after another
+static void unionGroup( QgsDissolveGroup& group )
+{
+  group.result = group.geometries.isEmpty() ? 0 : QgsGeometry::unaryUnion( group.geometries );
+  qDeleteAll( group.geometries );
+  group.geometries.clear();
 }
 
-void QgsGeometryAnalyzer::simplifyFeature( QgsFeature& f, QgsVectorFileWriter* vfw, double tolerance )
+static void convexHullGroup( QgsDissolveGroup& group )
 {
-  if ( !f.constGeometry() )
+  unionGroup( group );
+  if ( group.result )
   {
-    return;
+    QgsGeometry* hull = group.result->convexHull();
+    delete group.result;
+    group.result = hull;
   }
+}
 
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = 0;
+//! Computes convex hulls of features and groups them by the value of a field
+class QgsConvexHullPipeline : public QgsFeaturePipeline
+{
+  public:
+    QgsConvexHullPipeline( int uniqueIdField, bool useField, QProgressDialog* p )
+        : QgsFeaturePipeline( p )
+        , mUniqueIdField( uniqueIdField )
+        , mUseField( useField )
+    {}
+
+    virtual QgsFeatureList processFeature( const QgsFeature& f ) const override
+    {
+      QgsFeatureList result;
+      if ( f.constGeometry() )
+      {
+        QgsFeature newFeature;
+        newFeature.setGeometry( f.constGeometry()->convexHull() );
+        newFeature.setAttributes( f.attributes() );
+        result << newFeature;
+      }
+      return result;
+    }
 
-  // simplify feature
-  tmpGeometry = featureGeometry->simplify( tolerance );
+    virtual void writeFeatures( QgsFeatureList& features ) override
+    {
+      Q_FOREACH ( const QgsFeature& f, features )
+      {
+        QString key = f.attribute( mUniqueIdField ).toString();
+        if ( !mUseField )
+        {
+          // all hulls are merged, the output is named after the smallest key
+          if ( mFirstKey.isNull() || key < mFirstKey )
+            mFirstKey = key;
+          key = QString();
+        }
+        mGroups[key].geometries << new QgsGeometry( *f.constGeometry() );
+      }
+    }
 
-  QgsFeature newFeature;
-  newFeature.setGeometry( tmpGeometry );
-  newFeature.setAttributes( f.attributes() );
+    //! Returns the key of the output feature of a group
+    QString groupName( const QString& key ) const { return mUseField ? key : mFirstKey; }
 
-  //add it to vector file writer
-  if ( vfw )
-  {
-    vfw->addFeature( newFeature );
-  }
-}
+    //! Convex hulls of the features grouped by key
+    QMap<QString, QgsDissolveGroup>& groups() { return mGroups; }
 
-bool QgsGeometryAnalyzer::centroids( QgsVectorLayer* layer, const QString& shapefileName,
-                                     bool onlySelectedFeatures, QProgressDialog* p )
+  private:
+    QMap<QString, QgsDissolveGroup> mGroups;
+    int mUniqueIdField;
+    bool mUseField;
+    QString mFirstKey;
+};
+
+bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer,
+                                    const QString& shapefileName,
+                                    double tolerance,
+                                    bool onlySelectedFeatures,
+                                    QProgressDialog *p )
 {
   if ( !layer )
   {
-    QgsDebugMsg( "No layer passed to centroids" );
     return false;
   }
 
   QgsVectorDataProvider* dp = layer->dataProvider();
   if ( !dp )
   {
-    QgsDebugMsg( "No data provider for layer passed to centroids" );
     return false;
   }
 
-  QGis::WkbType outputType = QGis::WKBPoint;
+  QGis::WkbType outputType = dp->geometryType();
   const QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
-  QgsFeature currentFeature;
 
-  //take only selection
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    if ( p )
-    {
-      p->setMaximum( selection.size() );
-    }
-
-    int processedFeatures = 0;
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      centroidFeature( currentFeature, &vWriter );
-      ++processedFeatures;
-    }
-
-    if ( p )
-    {
-      p->setValue( selection.size() );
-    }
-  }
-  //take all features
-  else
-  {
-    QgsFeatureIterator fit = layer->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
-
-    int featureCount = layer->featureCount();
-    if ( p )
-    {
-      p->setMaximum( featureCount );
-    }
-    int processedFeatures = 0;
-
-    while ( fit.nextFeature( currentFeature ) )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      centroidFeature( currentFeature, &vWriter );
-      ++processedFeatures;
-    }
-    if ( p )
-    {
-      p->setValue( featureCount );
-    }
-  }
+  QgsSimplifyPipeline pipeline( &vWriter, tolerance, p );
+  pipeline.run( layer, onlySelectedFeatures );
 
   return true;
 }
 
-
-void QgsGeometryAnalyzer::centroidFeature( QgsFeature& f, QgsVectorFileWriter* vfw )
+bool QgsGeometryAnalyzer::centroids( QgsVectorLayer* layer, const QString& shapefileName,
+                                     bool onlySelectedFeatures, QProgressDialog* p )
 {
-  if ( !f.constGeometry() )
+  if ( !layer )
   {
-    return;
+    QgsDebugMsg( "No layer passed to centroids" );
+    return false;
+  }
+
+  QgsVectorDataProvider* dp = layer->dataProvider();
+  if ( !dp )
+  {
+    QgsDebugMsg( "No data provider for layer passed to centroids" );
+    return false;
   }
 
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = 0;
+  QGis::WkbType outputType = QGis::WKBPoint;
+  const QgsCoordinateReferenceSystem crs = layer->crs();
 
-  tmpGeometry = featureGeometry->centroid();
+  QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
 
-  QgsFeature newFeature;
-  newFeature.setGeometry( tmpGeometry );
-  newFeature.setAttributes( f.attributes() );
+  QgsCentroidPipeline pipeline( &vWriter, p );
+  pipeline.run( layer, onlySelectedFeatures );
 
-  //add it to vector file writer
-  if ( vfw )
-  {
-    vfw->addFeature( newFeature );
-  }
+  return true;
 }
 
 bool QgsGeometryAnalyzer::extent( QgsVectorLayer* layer,
@@ -417,186 +432,37 @@ bool QgsGeometryAnalyzer::convexHull( QgsVectorLayer* layer, const QString& shap
   const QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), fields, outputType, &crs );
-  QgsFeature currentFeature;
-  QgsGeometry* dissolveGeometry = 0; //dissolve geometry
-  QMultiMap<QString, QgsFeatureId> map;
 
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-#if 0
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        // break; // it may be better to do something else here?
-        return false;
-      }
-#endif
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
-  }
-  else
-  {
-    QgsFeatureIterator fit = layer->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
-    {
-#if 0
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        // break; // it may be better to do something else here?
-        return false;
-      }
-#endif
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
-  }
+  // convex hulls of the single features
+  QgsConvexHullPipeline pipeline( uniqueIdField, useField, p );
+  pipeline.run( layer, onlySelectedFeatures );
 
-  QMultiMap<QString, QgsFeatureId>::const_iterator jt = map.constBegin();
-  while ( jt != map.constEnd() )
+  // convex hulls of the groups
+  QtConcurrent::blockingMap( pipeline.groups(), convexHullGroup );
+
+  QMap<QString, QgsDissolveGroup>::iterator it = pipeline.groups().begin();
+  for ( ; it != pipeline.groups().end(); ++it )
   {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    //take only selection
-    if ( onlySelectedFeatures )
+    if ( !it->result )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
-      {
-        p->setMaximum( selection.size() );
-      }
-      processedFeatures = 0;
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-          {
-            continue;
-          }
-          convexFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
-      }
-      QList<double> values;
-      if ( !dissolveGeometry )
-      {
-        QgsDebugMsg( "no dissolved geometry - should not happen" );
-        return false;
-      }
-      dissolveGeometry = dissolveGeometry->convexHull();
-      values = simpleMeasure( dissolveGeometry );
-      QgsAttributes attributes( 3 );
-      attributes[0] = QVariant( currentKey );
-      attributes[1] = values[ 0 ];
-      attributes[2] = values[ 1 ];
-      QgsFeature dissolveFeature;
-      dissolveFeature.setAttributes( attributes );
-      dissolveFeature.setGeometry( dissolveGeometry );
-      vWriter.addFeature( dissolveFeature );
+      QgsDebugMsg( "no dissolved geometry - should not happen" );
+      continue;
     }
-    //take all features
-    else
-    {
-      int featureCount = layer->featureCount();
-      if ( p )
-      {
-        p->setMaximum( featureCount );
-      }
-      processedFeatures = 0;
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
 
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-        {
-          continue;
-        }
-        convexFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
-      }
-      QList<double> values;
-      // QgsGeometry* tmpGeometry = 0;
-      if ( !dissolveGeometry )
-      {
-        QgsDebugMsg( "no dissolved geometry - should not happen" );
-        return false;
-      }
-      dissolveGeometry = dissolveGeometry->convexHull();
-      // values = simpleMeasure( tmpGeometry );
-      values = simpleMeasure( dissolveGeometry );
-      QgsAttributes attributes;
-      attributes[0] = QVariant( currentKey );
-      attributes[1] = QVariant( values[ 0 ] );
-      attributes[2] = QVariant( values[ 1 ] );
-      QgsFeature dissolveFeature;
-      dissolveFeature.setAttributes( attributes );
-      dissolveFeature.setGeometry( dissolveGeometry );
-      vWriter.addFeature( dissolveFeature );
-    }
+    QList<double> values = simpleMeasure( it->result );
+    QgsAttributes attributes( 3 );
+    attributes[0] = QVariant( pipeline.groupName( it.key() ) );
+    attributes[1] = values.value( 0 );
+    attributes[2] = values.value( 1 );
+    QgsFeature dissolveFeature;
+    dissolveFeature.setAttributes( attributes );
+    dissolveFeature.setGeometry( it->result );
+    it->result = 0;
+    vWriter.addFeature( dissolveFeature );
   }
   return true;
 }
 
-
-void QgsGeometryAnalyzer::convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
-{
-  if ( !f.constGeometry() )
-  {
-    return;
-  }
-
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = 0;
-  QgsGeometry* convexGeometry = 0;
-
-  convexGeometry = featureGeometry->convexHull();
-
-  if ( nProcessedFeatures == 0 )
-  {
-    *dissolveGeometry = convexGeometry;
-  }
-  else
-  {
-    tmpGeometry = *dissolveGeometry;
-    *dissolveGeometry = ( *dissolveGeometry )->combine( convexGeometry );
-    delete tmpGeometry;
-    delete convexGeometry;
-  }
-}
-
 bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapefileName,
                                     bool onlySelectedFeatures, int uniqueIdField, QProgressDialog* p )
 {
@@ -623,135 +489,69 @@ bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapef
   const QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-  QMultiMap<QString, QgsFeatureId> map;
 
+  QgsFeatureRequest request;
+  int featureCount;
   if ( onlySelectedFeatures )
   {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
+    request.setFilterFids( layer->selectedFeaturesIds() );
+    featureCount = layer->selectedFeatureCount();
   }
   else
   {
-    QgsFeatureIterator fit = layer->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
-    {
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
+    featureCount = layer->featureCount();
+  }
+  if ( p )
+  {
+    p->setMaximum( featureCount );
   }
 
-  QgsGeometry *dissolveGeometry = 0; //dissolve geometry
-  QMultiMap<QString, QgsFeatureId>::const_iterator jt = map.constBegin();
-  QgsFeature outputFeature;
-  while ( jt != map.constEnd() )
+  // collect the geometries of each group
+  QMap<QString, QgsDissolveGroup> groups;
+  QgsFeatureIterator fit = layer->getFeatures( request );
+  QgsFeature currentFeature;
+  int processedFeatures = 0;
+  while ( fit.nextFeature( currentFeature ) )
   {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    bool first = true;
-    //take only selection
-    if ( onlySelectedFeatures )
+    if ( p )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
-      {
-        p->setMaximum( selection.size() );
-      }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-          {
-            continue;
-          }
-          if ( first )
-          {
-            outputFeature.setAttributes( currentFeature.attributes() );
-            first = false;
-          }
-          dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
-      }
+      p->setValue( processedFeatures );
     }
-    //take all features
-    else
+    if ( p && p->wasCanceled() )
     {
-      int featureCount = layer->featureCount();
-      if ( p )
-      {
-        p->setMaximum( featureCount );
-      }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
-
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-        {
-          continue;
-        }
-        {
-          outputFeature.setAttributes( currentFeature.attributes() );
-          first = false;
-        }
-        dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
-      }
+      break;
     }
-    outputFeature.setGeometry( dissolveGeometry );
-    vWriter.addFeature( outputFeature );
-  }
-  return true;
-}
+    ++processedFeatures;
 
-void QgsGeometryAnalyzer::dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
-{
-  if ( !f.constGeometry() )
-  {
-    return;
+    QgsDissolveGroup& group = groups[ useField ? currentFeature.attribute( uniqueIdField ).toString() : QString()];
+    if ( group.attributes.isEmpty() )
+    {
+      group.attributes = currentFeature.attributes();
+    }
+    if ( currentFeature.constGeometry() )
+    {
+      group.geometries << new QgsGeometry( *currentFeature.constGeometry() );
+    }
   }
 
-  const QgsGeometry* featureGeometry = f.constGeometry();
+  // the groups are dissolved in parallel
+  QtConcurrent::blockingMap( groups, unionGroup );
 
-  if ( nProcessedFeatures == 0 )
+  QMap<QString, QgsDissolveGroup>::iterator it = groups.begin();
+  for ( ; it != groups.end(); ++it )
   {
-    size_t geomSize = featureGeometry->wkbSize();
-    *dissolveGeometry = new QgsGeometry();
-    unsigned char* wkb = new unsigned char[geomSize];
-    memcpy( wkb, featureGeometry->asWkb(), geomSize );
-    ( *dissolveGeometry )->fromWkb( wkb, geomSize );
+    QgsFeature outputFeature;
+    outputFeature.setAttributes( it->attributes );
+    outputFeature.setGeometry( it->result );
+    it->result = 0;
+    vWriter.addFeature( outputFeature );
   }
-  else
+
+  if ( p )
   {
-    *dissolveGeometry = ( *dissolveGeometry )->combine( featureGeometry );
+    p->setValue( featureCount );
   }
+  return true;
 }
 
 bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefileName, double bufferDistance,
@@ -776,142 +576,25 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   const QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-  QgsGeometry *dissolveGeometry = 0; //dissolve geometry (if dissolve enabled)
-
-  //take only selection
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    if ( p )
-    {
-      p->setMaximum( selection.size() );
-    }
-
-    int processedFeatures = 0;
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
-      ++processedFeatures;
-    }
-
-    if ( p )
-    {
-      p->setValue( selection.size() );
-    }
-  }
-  //take all features
-  else
-  {
-    QgsFeatureIterator fit = layer->getFeatures();
-
-    int featureCount = layer->featureCount();
-    if ( p )
-    {
-      p->setMaximum( featureCount );
-    }
-    int processedFeatures = 0;
 
-    while ( fit.nextFeature( currentFeature ) )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
-      ++processedFeatures;
-    }
-    if ( p )
-    {
-      p->setValue( featureCount );
-    }
-  }
+  QgsBufferPipeline pipeline( &vWriter, bufferDistance, bufferDistanceField, dissolve, p );
+  pipeline.run( layer, onlySelectedFeatures );
 
   if ( dissolve )
   {
-    QgsFeature dissolveFeature;
+    QgsGeometry* dissolveGeometry = pipeline.dissolvedBuffers();
     if ( !dissolveGeometry )
     {
       QgsDebugMsg( "no dissolved geometry - should not happen" );
       return false;
     }
+    QgsFeature dissolveFeature;
     dissolveFeature.setGeometry( dissolveGeometry );
     vWriter.addFeature( dissolveFeature );
   }
   return true;
 }
 
-void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve,
-    QgsGeometry** dissolveGeometry, double bufferDistance, int bufferDistanceField )
-{
-  if ( !f.constGeometry() )
-  {
-    return;
-  }
-
-  double currentBufferDistance;
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = 0;
-  QgsGeometry* bufferGeometry = 0;
-
-  //create buffer
-  if ( bufferDistanceField == -1 )
-  {
-    currentBufferDistance = bufferDistance;
-  }
-  else
-  {
-    currentBufferDistance = f.attribute( bufferDistanceField ).toDouble();
-  }
-  bufferGeometry = featureGeometry->buffer( currentBufferDistance, 5 );
-
-  if ( dissolve )
-  {
-    if ( nProcessedFeatures == 0 )
-    {
-      *dissolveGeometry = bufferGeometry;
-    }
-    else
-    {
-      tmpGeometry = *dissolveGeometry;
-      *dissolveGeometry = ( *dissolveGeometry )->combine( bufferGeometry );
-      delete tmpGeometry;
-      delete bufferGeometry;
-    }
-  }
-  else //dissolve
-  {
-    QgsFeature newFeature;
-    newFeature.setGeometry( bufferGeometry );
-    newFeature.setAttributes( f.attributes() );
-
-    //add it to vector file writer
-    if ( vfw )
-    {
-      vfw->addFeature( newFeature );
-    }
-  }
-}
-
 bool QgsGeometryAnalyzer::eventLayer( QgsVectorLayer* lineLayer, QgsVectorLayer* eventLayer, int lineField, int eventField, QgsFeatureIds &unlocatedFeatureIds, const QString& outputLayer,
                                       const QString& outputFormat, int locationField1, int locationField2, int offsetField, double offsetScale,
                                       bool forceSingleGeometry, QgsVectorDataProvider* memoryProvider, QProgressDialog* p )
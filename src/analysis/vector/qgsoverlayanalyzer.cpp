@@ -25,8 +25,65 @@
 #include "qgsvectorfilewriter.h"
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
+#include "qgsfeaturepipeline.h"
+#include <QMutex>
 #include <QProgressDialog>
 
+//! Intersects features with the features of an overlay layer
+class QgsIntersectionPipeline : public QgsFeatureWriterPipeline
+{
+  public:
+    QgsIntersectionPipeline( QgsVectorFileWriter* writer, QProgressDialog* p )
+        : QgsFeatureWriterPipeline( writer, p )
+    {}
+
+    //! Adds a feature of the overlay layer, must be called before run()
+    void addOverlayFeature( const QgsFeature& f )
+    {
+      mIndex.insertFeature( f );
+      mOverlayFeatures.insert( f.id(), f );
+    }
+
+    virtual QgsFeatureList processFeature( const QgsFeature& f ) const override
+    {
+      QgsFeatureList result;
+      const QgsGeometry* featureGeometry = f.constGeometry();
+      if ( !featureGeometry )
+      {
+        return result;
+      }
+
+      QList<QgsFeatureId> intersects;
+      {
+        // queries of the index are not thread safe
+        QMutexLocker locker( &mIndexMutex );
+        intersects = mIndex.intersects( featureGeometry->boundingBox() );
+      }
+
+      QList<QgsFeatureId>::const_iterator it = intersects.constBegin();
+      for ( ; it != intersects.constEnd(); ++it )
+      {
+        QgsFeature overlayFeature = mOverlayFeatures.value( *it );
+        if ( featureGeometry->intersects( overlayFeature.constGeometry() ) )
+        {
+          QgsAttributes attributes = f.attributes();
+          attributes += overlayFeature.attributes();
+
+          QgsFeature outFeature;
+          outFeature.setGeometry( featureGeometry->intersection( overlayFeature.constGeometry() ) );
+          outFeature.setAttributes( attributes );
+          result << outFeature;
+        }
+      }
+      return result;
+    }
+
+  private:
+    QgsSpatialIndex mIndex;
+    mutable QMutex mIndexMutex;
+    QHash<QgsFeatureId, QgsFeature> mOverlayFeatures;
+};
+
 bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
                                        const QString& shapefileName, bool onlySelectedFeatures,
                                        QProgressDialog* p )
@@ -50,135 +107,23 @@ bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* l
   combineFieldLists( fieldsA, fieldsB );
 
   QgsVectorFileWriter vWriter( shapefileName, dpA->encoding(), fieldsA, outputType, &crs );
-  QgsFeature currentFeature;
-  QgsSpatialIndex index;
+  QgsIntersectionPipeline pipeline( &vWriter, p );
 
-  //take only selection
+  // layer B is loaded into memory, worker threads must not access layers
+  QgsFeatureRequest request;
   if ( onlySelectedFeatures )
   {
-    const QgsFeatureIds selectionB = layerB->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selectionB.constBegin();
-    for ( ; it != selectionB.constEnd(); ++it )
-    {
-      if ( !layerB->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      index.insertFeature( currentFeature );
-    }
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selectionA = layerA->selectedFeaturesIds();
-    if ( p )
-    {
-      p->setMaximum( selectionA.size() );
-    }
-    QgsFeature currentFeature;
-    int processedFeatures = 0;
-    it = selectionA.constBegin();
-    for ( ; it != selectionA.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layerA->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
-    }
-
-    if ( p )
-    {
-      p->setValue( selectionA.size() );
-    }
-  }
-  //take all features
-  else
-  {
-    QgsFeatureIterator fit = layerB->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
-    {
-      index.insertFeature( currentFeature );
-    }
-
-    int featureCount = layerA->featureCount();
-    if ( p )
-    {
-      p->setMaximum( featureCount );
-    }
-    int processedFeatures = 0;
-
-    fit = layerA->getFeatures();
-
-    QgsFeature currentFeature;
-    while ( fit.nextFeature( currentFeature ) )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
-    }
-    if ( p )
-    {
-      p->setValue( featureCount );
-    }
+    request.setFilterFids( layerB->selectedFeaturesIds() );
   }
-  return true;
-}
-
-void QgsOverlayAnalyzer::intersectFeature( QgsFeature& f, QgsVectorFileWriter* vfw,
-    QgsVectorLayer* vl, QgsSpatialIndex* index )
-{
-  if ( !f.constGeometry() )
+  QgsFeatureIterator fit = layerB->getFeatures( request );
+  QgsFeature currentFeature;
+  while ( fit.nextFeature( currentFeature ) )
   {
-    return;
+    pipeline.addOverlayFeature( currentFeature );
   }
 
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* intersectGeometry = 0;
-  QgsFeature overlayFeature;
-
-  QList<QgsFeatureId> intersects;
-  intersects = index->intersects( featureGeometry->boundingBox() );
-  QList<QgsFeatureId>::const_iterator it = intersects.constBegin();
-  QgsFeature outFeature;
-  for ( ; it != intersects.constEnd(); ++it )
-  {
-    if ( !vl->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( overlayFeature ) )
-    {
-      continue;
-    }
-
-    if ( featureGeometry->intersects( overlayFeature.constGeometry() ) )
-    {
-      intersectGeometry = featureGeometry->intersection( overlayFeature.constGeometry() );
-
-      outFeature.setGeometry( intersectGeometry );
-      QgsAttributes attributesA = f.attributes();
-      QgsAttributes attributesB = overlayFeature.attributes();
-      combineAttributeMaps( attributesA, attributesB );
-      outFeature.setAttributes( attributesA );
-
-      //add it to vector file writer
-      if ( vfw )
-      {
-        vfw->addFeature( outFeature );
-      }
-    }
-  }
+  pipeline.run( layerA, onlySelectedFeatures );
+  return true;
 }
 
 void QgsOverlayAnalyzer::combineFieldLists( QgsFields& fieldListA, const QgsFields& fieldListB )
@@ -202,8 +147,3 @@ void QgsOverlayAnalyzer::combineFieldLists( QgsFields& fieldListA, const QgsFiel
   }
 }
 
-void QgsOverlayAnalyzer::combineAttributeMaps( QgsAttributes& attributesA, const QgsAttributes& attributesB )
-{
-  attributesA += attributesB;
-}
-
@@ -51,8 +51,6 @@ class ANALYSIS_EXPORT QgsOverlayAnalyzer
   private:
 
     void combineFieldLists( QgsFields& fieldListA, const QgsFields& fieldListB );
-    void intersectFeature( QgsFeature& f, QgsVectorFileWriter* vfw, QgsVectorLayer* dp, QgsSpatialIndex* index );
-    void combineAttributeMaps( QgsAttributes& attributesA, const QgsAttributes& attributesB );
 };
 
 #endif //QGSVECTORANALYZER
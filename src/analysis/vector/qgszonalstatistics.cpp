@@ -24,6 +24,9 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QLineF>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8F(x) (x).toUtf8().constData()
@@ -31,6 +34,222 @@
 #define TO8F(x) QFile::encodeName( x ).constData()
 #endif
 
+//maximum number of cells read from the raster at once
+static const int STRIP_CELLS = 4 * 1024 * 1024;
+
+/** Polygon rings of a zone in pixel coordinates of the raster */
+struct QgsZonalZone
+{
+  int index;
+  QVector< QVector<QPointF> > rings;
+};
+
+/** Run of cells in a row of the raster whose centers are within a zone */
+struct QgsZonalSpan
+{
+  int row;
+  int zone;
+  int startColumn;
+  int endColumn; //inclusive
+};
+
+/** Scanline polygon filling of a zone, restricted to the raster extent */
+class QgsZonalRasterizer
+{
+  public:
+    typedef QVector<QgsZonalSpan> result_type;
+
+    QgsZonalRasterizer( int nCellsX, int nCellsY )
+        : mNCellsX( nCellsX )
+        , mNCellsY( nCellsY )
+    {}
+
+    QVector<QgsZonalSpan> operator()( const QgsZonalZone& zone ) const
+    {
+      //edges ordered by their upper end, horizontal edges never cross a scanline
+      QVector<QLineF> edges;
+      Q_FOREACH ( const QVector<QPointF>& ring, zone.rings )
+      {
+        for ( int i = 1; i < ring.size(); ++i )
+        {
+          if ( ring[i - 1].y() < ring[i].y() )
+            edges << QLineF( ring[i - 1], ring[i] );
+          else if ( ring[i - 1].y() > ring[i].y() )
+            edges << QLineF( ring[i], ring[i - 1] );
+        }
+      }
+      qSort( edges.begin(), edges.end(), edgeLessThan );
+
+      QVector<QgsZonalSpan> spans;
+      if ( edges.isEmpty() )
+        return spans;
+
+      double maxY = edges.first().y2();
+      Q_FOREACH ( const QLineF& edge, edges )
+        maxY = qMax( maxY, edge.y2() );
+
+      //scanlines run through the cell centers (row + 0.5)
+      int firstRow = qMax( 0, ( int ) ceil( edges.first().y1() - 0.5 ) );
+      int lastRow = qMin( mNCellsY - 1, ( int ) floor( maxY - 0.5 ) );
+
+      QList<QLineF> activeEdges;
+      QVector<double> crossings;
+      int nextEdge = 0;
+      for ( int row = firstRow; row <= lastRow; ++row )
+      {
+        double y = row + 0.5;
+        while ( nextEdge < edges.size() && edges[nextEdge].y1() <= y )
+        {
+          activeEdges << edges[nextEdge++];
+        }
+
+        crossings.clear();
+        QList<QLineF>::iterator it = activeEdges.begin();
+        while ( it != activeEdges.end() )
+        {
+          if ( it->y2() <= y )
+          {
+            it = activeEdges.erase( it );
+            continue;
+          }
+          crossings << it->x1() + ( y - it->y1() ) * ( it->x2() - it->x1() ) / ( it->y2() - it->y1() );
+          ++it;
+        }
+        qSort( crossings.begin(), crossings.end() );
+
+        //even-odd rule, cells with the center strictly between two crossings
+        for ( int i = 0; i + 1 < crossings.size(); i += 2 )
+        {
+          QgsZonalSpan span;
+          span.row = row;
+          span.zone = zone.index;
+          span.startColumn = qMax( 0, ( int ) floor( crossings[i] - 0.5 ) + 1 );
+          span.endColumn = qMin( mNCellsX - 1, ( int ) ceil( crossings[i + 1] - 0.5 ) - 1 );
+          if ( span.startColumn <= span.endColumn )
+            spans << span;
+        }
+      }
+      return spans;
+    }
+
+  private:
+    static bool edgeLessThan( const QLineF& e1, const QLineF& e2 ) { return e1.y1() < e2.y1(); }
+
+    int mNCellsX;
+    int mNCellsY;
+};
+
+/** Statistics of all zones in flat arrays */
+class QgsZonalAccumulator
+{
+  public:
+    QgsZonalAccumulator( int nZones, bool storeValues, bool storeValueCounts )
+        : sum( nZones, 0.0 )
+        , count( nZones, 0.0 )
+        , min( nZones, FLT_MAX )
+        , max( nZones, FLT_MIN )
+        , mStoreValues( storeValues )
+        , mStoreValueCounts( storeValueCounts )
+    {
+      if ( storeValues )
+        values.resize( nZones );
+      if ( storeValueCounts )
+        valueCounts.resize( nZones );
+    }
+
+    inline void addValue( int zone, float value )
+    {
+      sum[zone] += value;
+      count[zone] += 1;
+      min[zone] = qMin( min[zone], value );
+      max[zone] = qMax( max[zone], value );
+      if ( mStoreValues )
+        values[zone].append( value );
+      if ( mStoreValueCounts )
+        valueCounts[zone][value] += 1;
+    }
+
+    void merge( const QgsZonalAccumulator& other )
+    {
+      for ( int zone = 0; zone < sum.size(); ++zone )
+      {
+        if ( other.count[zone] == 0 )
+          continue;
+
+        sum[zone] += other.sum[zone];
+        count[zone] += other.count[zone];
+        min[zone] = qMin( min[zone], other.min[zone] );
+        max[zone] = qMax( max[zone], other.max[zone] );
+        if ( mStoreValues )
+          values[zone] += other.values[zone];
+        if ( mStoreValueCounts )
+        {
+          QMap<float, int>::const_iterator it = other.valueCounts[zone].constBegin();
+          for ( ; it != other.valueCounts[zone].constEnd(); ++it )
+            valueCounts[zone][it.key()] += it.value();
+        }
+      }
+    }
+
+    QVector<double> sum;
+    QVector<double> count;
+    QVector<float> min;
+    QVector<float> max;
+    QVector< QList<float> > values;
+    QVector< QMap<float, int> > valueCounts;
+
+  private:
+    bool mStoreValues;
+    bool mStoreValueCounts;
+};
+
+/** Accumulates the values of the cells of a part of a strip of rows into the statistics of a lane */
+class QgsZonalStripFunctor
+{
+  public:
+    typedef void result_type;
+
+    QgsZonalStripFunctor( const QVector<QgsZonalAccumulator*>& lanes, const QVector<QgsZonalSpan>& spans, const QVector<int>& rowStarts,
+                          const float* strip, int startRow, int nRows, int nCellsX, float nodataValue )
+        : mLanes( lanes )
+        , mSpans( spans )
+        , mRowStarts( rowStarts )
+        , mStrip( strip )
+        , mStartRow( startRow )
+        , mNRows( nRows )
+        , mNCellsX( nCellsX )
+        , mNodataValue( nodataValue )
+    {}
+
+    void operator()( int lane )
+    {
+      QgsZonalAccumulator* stats = mLanes[lane];
+      int firstRow = mStartRow + ( qint64 ) mNRows * lane / mLanes.size();
+      int endRow = mStartRow + ( qint64 ) mNRows * ( lane + 1 ) / mLanes.size();
+      for ( int i = mRowStarts[firstRow]; i < mRowStarts[endRow]; ++i )
+      {
+        const QgsZonalSpan& span = mSpans[i];
+        const float* values = mStrip + ( qint64 )( span.row - mStartRow ) * mNCellsX;
+        for ( int column = span.startColumn; column <= span.endColumn; ++column )
+        {
+          float value = values[column];
+          if ( value != mNodataValue && !qIsNaN( value ) )
+            stats->addValue( span.zone, value );
+        }
+      }
+    }
+
+  private:
+    const QVector<QgsZonalAccumulator*>& mLanes;
+    const QVector<QgsZonalSpan>& mSpans;
+    const QVector<int>& mRowStarts;
+    const float* mStrip;
+    int mStartRow;
+    int mNRows;
+    int mNCellsX;
+    float mNodataValue;
+};
+
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer* polygonLayer, const QString& rasterFile, const QString& attributePrefix, int rasterBand, const Statistics& stats )
     : mRasterFilePath( rasterFile )
     , mRasterBand( rasterBand )
@@ -224,6 +443,19 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
     return 8;
   }
 
+  QMap<Statistic, int> fieldIndexes;
+  fieldIndexes.insert( Count, countIndex );
+  fieldIndexes.insert( Sum, sumIndex );
+  fieldIndexes.insert( Mean, meanIndex );
+  fieldIndexes.insert( Median, medianIndex );
+  fieldIndexes.insert( StDev, stdevIndex );
+  fieldIndexes.insert( Min, minIndex );
+  fieldIndexes.insert( Max, maxIndex );
+  fieldIndexes.insert( Range, rangeIndex );
+  fieldIndexes.insert( Minority, minorityIndex );
+  fieldIndexes.insert( Majority, majorityIndex );
+  fieldIndexes.insert( Variety, varietyIndex );
+
   //progress dialog
   long featureCount = vectorProvider->featureCount();
   if ( p )
@@ -231,140 +463,180 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
     p->setMaximum( featureCount );
   }
 
+  bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
+                          ( mStatistics & QgsZonalStatistics::StDev );
+  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
+                              ( mStatistics & QgsZonalStatistics::Majority ) ||
+                              ( mStatistics & QgsZonalStatistics::Variety );
 
-  //iterate over each polygon
+  //collect the polygons intersecting the raster, in pixel coordinates
   QgsFeatureRequest request;
   request.setSubsetOfAttributes( QgsAttributeList() );
   QgsFeatureIterator fi = vectorProvider->getFeatures( request );
   QgsFeature f;
 
-  bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
-                          ( mStatistics & QgsZonalStatistics::StDev );
-  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
-                              ( mStatistics & QgsZonalStatistics::Majority );
-
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
-  int featureCounter = 0;
-
-  QgsChangedAttributesMap changeMap;
+  QList<QgsZonalZone> zones;
+  QVector<QgsFeatureId> zoneIds;
   while ( fi.nextFeature( f ) )
   {
-    if ( p )
-    {
-      p->setValue( featureCounter );
-    }
-
     if ( p && p->wasCanceled() )
     {
       break;
     }
 
-    if ( !f.constGeometry() )
+    const QgsGeometry* featureGeometry = f.constGeometry();
+    if ( !featureGeometry || featureGeometry->boundingBox().intersect( &rasterBBox ).isEmpty() )
     {
-      ++featureCounter;
       continue;
     }
-    const QgsGeometry* featureGeometry = f.constGeometry();
 
-    QgsRectangle featureRect = featureGeometry->boundingBox().intersect( &rasterBBox );
-    if ( featureRect.isEmpty() )
+    QgsZonalZone zone;
+    zone.index = zones.size();
+    QgsMultiPolygon polygons = featureGeometry->isMultipart() ? featureGeometry->asMultiPolygon() : QgsMultiPolygon() << featureGeometry->asPolygon();
+    Q_FOREACH ( const QgsPolygon& polygon, polygons )
     {
-      ++featureCounter;
-      continue;
+      Q_FOREACH ( const QgsPolyline& ring, polygon )
+      {
+        QVector<QPointF> pixelRing( ring.size() );
+        for ( int i = 0; i < ring.size(); ++i )
+        {
+          pixelRing[i] = QPointF(( ring[i].x() - rasterBBox.xMinimum() ) / cellsizeX, ( rasterBBox.yMaximum() - ring[i].y() ) / cellsizeY );
+        }
+        zone.rings << pixelRing;
+      }
     }
+    zones << zone;
+    zoneIds << f.id();
+  }
 
-    int offsetX, offsetY, nCellsX, nCellsY;
-    if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
+  //rasterize all zones into runs of cells (cells with the center in the polygon), sorted by row
+  QVector<QgsZonalSpan> spans;
+  QVector<int> rowStarts( nCellsYGDAL + 1, 0 );
+  if ( !( p && p->wasCanceled() ) )
+  {
+    QList< QVector<QgsZonalSpan> > zoneSpans = QtConcurrent::blockingMapped( zones, QgsZonalRasterizer( nCellsXGDAL, nCellsYGDAL ) );
+    zones.clear();
+
+    Q_FOREACH ( const QVector<QgsZonalSpan>& list, zoneSpans )
     {
-      ++featureCounter;
-      continue;
+      Q_FOREACH ( const QgsZonalSpan& span, list )
+      {
+        ++rowStarts[span.row + 1];
+      }
+    }
+    for ( int row = 0; row < nCellsYGDAL; ++row )
+    {
+      rowStarts[row + 1] += rowStarts[row];
     }
+    spans.resize( rowStarts[nCellsYGDAL] );
+    QVector<int> nextIndex = rowStarts;
+    Q_FOREACH ( const QVector<QgsZonalSpan>& list, zoneSpans )
+    {
+      Q_FOREACH ( const QgsZonalSpan& span, list )
+      {
+        spans[nextIndex[span.row]++] = span;
+      }
+    }
+  }
 
-    //avoid access to cells outside of the raster (may occur because of rounding)
-    if (( offsetX + nCellsX ) > nCellsXGDAL )
+  //stream the raster in strips of rows. The rows of a strip are split between the lanes, every lane
+  //accumulates into its own statistics, which are merged at the end
+  int nLanes = qMax( 1, QThread::idealThreadCount() );
+  QList<int> laneIndexes;
+  QVector<QgsZonalAccumulator*> lanes;
+  for ( int i = 0; i < nLanes; ++i )
+  {
+    laneIndexes << i;
+    lanes << new QgsZonalAccumulator( zoneIds.size(), statsStoreValues, statsStoreValueCount );
+  }
+
+  int stripRows = qBound( 1, STRIP_CELLS / qMax( 1, nCellsXGDAL ), nCellsYGDAL );
+  QVector<float> strip( stripRows * nCellsXGDAL );
+  for ( int startRow = 0; startRow < nCellsYGDAL && !( p && p->wasCanceled() ); startRow += stripRows )
+  {
+    int rows = qMin( stripRows, nCellsYGDAL - startRow );
+    if ( rowStarts[startRow] == rowStarts[startRow + rows] )
     {
-      nCellsX = nCellsXGDAL - offsetX;
+      continue; //no zone in these rows
     }
-    if (( offsetY + nCellsY ) > nCellsYGDAL )
+
+    if ( GDALRasterIO( rasterBand, GF_Read, 0, startRow, nCellsXGDAL, rows, strip.data(), nCellsXGDAL, rows, GDT_Float32, 0, 0 ) != CE_None )
     {
-      nCellsY = nCellsYGDAL - offsetY;
+      continue;
     }
 
-    statisticsFromMiddlePointTest( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                   rasterBBox, featureStats );
+    QtConcurrent::blockingMap( laneIndexes, QgsZonalStripFunctor( lanes, spans, rowStarts, strip.constData(), startRow, rows, nCellsXGDAL, mInputNodataValue ) );
 
-    if ( featureStats.count <= 1 )
+    if ( p )
+    {
+      p->setValue(( int )(( double ) featureCount * ( startRow + rows ) / nCellsYGDAL ) );
+    }
+  }
+
+  QgsZonalAccumulator* zoneStats = lanes.at( 0 );
+  for ( int i = 1; i < nLanes; ++i )
+  {
+    zoneStats->merge( *lanes.at( i ) );
+  }
+
+  QgsChangedAttributesMap changeMap;
+  QgsFeatureIds smallZones;
+  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
+  for ( int zone = 0; zone < zoneIds.size() && !( p && p->wasCanceled() ); ++zone )
+  {
+    if ( zoneStats->count[zone] <= 1 )
     {
       //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                         rasterBBox, featureStats );
+      smallZones << zoneIds[zone];
+      continue;
     }
 
-    //write the statistics value to the vector data provider
-    QgsAttributeMap changeAttributeMap;
-    if ( mStatistics & QgsZonalStatistics::Count )
-      changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
-    if ( mStatistics & QgsZonalStatistics::Sum )
-      changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
-    if ( featureStats.count > 0 )
+    featureStats.reset();
+    featureStats.sum = zoneStats->sum[zone];
+    featureStats.count = zoneStats->count[zone];
+    featureStats.min = zoneStats->min[zone];
+    featureStats.max = zoneStats->max[zone];
+    if ( statsStoreValues )
+      featureStats.values = zoneStats->values[zone];
+    if ( statsStoreValueCount )
+      featureStats.valueCount = zoneStats->valueCounts[zone];
+    changeMap.insert( zoneIds[zone], statisticsAttributes( featureStats, fieldIndexes ) );
+  }
+  qDeleteAll( lanes );
+  lanes.clear();
+
+  if ( !smallZones.isEmpty() && !( p && p->wasCanceled() ) )
+  {
+    QgsFeatureIterator smallIt = vectorProvider->getFeatures( QgsFeatureRequest().setFilterFids( smallZones ).setSubsetOfAttributes( QgsAttributeList() ) );
+    while ( smallIt.nextFeature( f ) )
     {
-      double mean = featureStats.sum / featureStats.count;
-      if ( mStatistics & QgsZonalStatistics::Mean )
-        changeAttributeMap.insert( meanIndex, QVariant( mean ) );
-      if ( mStatistics & QgsZonalStatistics::Median )
+      const QgsGeometry* featureGeometry = f.constGeometry();
+      if ( !featureGeometry )
       {
-        qSort( featureStats.values.begin(), featureStats.values.end() );
-        int size =  featureStats.values.count();
-        bool even = ( size % 2 ) < 1;
-        double medianValue;
-        if ( even )
-        {
-          medianValue = ( featureStats.values[size / 2 - 1] + featureStats.values[size / 2] ) / 2;
-        }
-        else //odd
-        {
-          medianValue = featureStats.values[( size + 1 ) / 2 - 1];
-        }
-        changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
+        continue;
       }
-      if ( mStatistics & QgsZonalStatistics::StDev )
+
+      QgsRectangle featureRect = featureGeometry->boundingBox().intersect( &rasterBBox );
+      int offsetX, offsetY, nCellsX, nCellsY;
+      if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
       {
-        double sumSquared = 0;
-        for ( int i = 0; i < featureStats.values.count(); ++i )
-        {
-          double diff = featureStats.values.at( i ) - mean;
-          sumSquared += diff * diff;
-        }
-        double stdev = qPow( sumSquared / featureStats.values.count(), 0.5 );
-        changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
+        continue;
       }
-      if ( mStatistics & QgsZonalStatistics::Min )
-        changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Max )
-        changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
-      if ( mStatistics & QgsZonalStatistics::Range )
-        changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
+
+      //avoid access to cells outside of the raster (may occur because of rounding)
+      if (( offsetX + nCellsX ) > nCellsXGDAL )
       {
-        QList<int> vals = featureStats.valueCount.values();
-        qSort( vals.begin(), vals.end() );
-        if ( mStatistics & QgsZonalStatistics::Minority )
-        {
-          float minorityKey = featureStats.valueCount.key( vals.first() );
-          changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
-        }
-        if ( mStatistics & QgsZonalStatistics::Majority )
-        {
-          float majKey = featureStats.valueCount.key( vals.last() );
-          changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
-        }
+        nCellsX = nCellsXGDAL - offsetX;
+      }
+      if (( offsetY + nCellsY ) > nCellsYGDAL )
+      {
+        nCellsY = nCellsYGDAL - offsetY;
       }
-      if ( mStatistics & QgsZonalStatistics::Variety )
-        changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
-    }
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+      statisticsFromPreciseIntersection( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
+                                         rasterBBox, featureStats );
+      changeMap.insert( f.id(), statisticsAttributes( featureStats, fieldIndexes ) );
+    }
   }
 
   vectorProvider->changeAttributeValues( changeMap );
@@ -385,6 +657,72 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
   return 0;
 }
 
+QgsAttributeMap QgsZonalStatistics::statisticsAttributes( FeatureStats& featureStats, const QMap<Statistic, int>& fieldIndexes ) const
+{
+  QgsAttributeMap changeAttributeMap;
+  if ( mStatistics & QgsZonalStatistics::Count )
+    changeAttributeMap.insert( fieldIndexes.value( Count ), QVariant( featureStats.count ) );
+  if ( mStatistics & QgsZonalStatistics::Sum )
+    changeAttributeMap.insert( fieldIndexes.value( Sum ), QVariant( featureStats.sum ) );
+  if ( featureStats.count > 0 )
+  {
+    double mean = featureStats.sum / featureStats.count;
+    if ( mStatistics & QgsZonalStatistics::Mean )
+      changeAttributeMap.insert( fieldIndexes.value( Mean ), QVariant( mean ) );
+    if ( mStatistics & QgsZonalStatistics::Median )
+    {
+      qSort( featureStats.values.begin(), featureStats.values.end() );
+      int size =  featureStats.values.count();
+      bool even = ( size % 2 ) < 1;
+      double medianValue;
+      if ( even )
+      {
+        medianValue = ( featureStats.values[size / 2 - 1] + featureStats.values[size / 2] ) / 2;
+      }
+      else //odd
+      {
+        medianValue = featureStats.values[( size + 1 ) / 2 - 1];
+      }
+      changeAttributeMap.insert( fieldIndexes.value( Median ), QVariant( medianValue ) );
+    }
+    if ( mStatistics & QgsZonalStatistics::StDev )
+    {
+      double sumSquared = 0;
+      for ( int i = 0; i < featureStats.values.count(); ++i )
+      {
+        double diff = featureStats.values.at( i ) - mean;
+        sumSquared += diff * diff;
+      }
+      double stdev = qPow( sumSquared / featureStats.values.count(), 0.5 );
+      changeAttributeMap.insert( fieldIndexes.value( StDev ), QVariant( stdev ) );
+    }
+    if ( mStatistics & QgsZonalStatistics::Min )
+      changeAttributeMap.insert( fieldIndexes.value( Min ), QVariant( featureStats.min ) );
+    if ( mStatistics & QgsZonalStatistics::Max )
+      changeAttributeMap.insert( fieldIndexes.value( Max ), QVariant( featureStats.max ) );
+    if ( mStatistics & QgsZonalStatistics::Range )
+      changeAttributeMap.insert( fieldIndexes.value( Range ), QVariant( featureStats.max - featureStats.min ) );
+    if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
+    {
+      QList<int> vals = featureStats.valueCount.values();
+      qSort( vals.begin(), vals.end() );
+      if ( mStatistics & QgsZonalStatistics::Minority )
+      {
+        float minorityKey = featureStats.valueCount.key( vals.first() );
+        changeAttributeMap.insert( fieldIndexes.value( Minority ), QVariant( minorityKey ) );
+      }
+      if ( mStatistics & QgsZonalStatistics::Majority )
+      {
+        float majKey = featureStats.valueCount.key( vals.last() );
+        changeAttributeMap.insert( fieldIndexes.value( Majority ), QVariant( majKey ) );
+      }
+    }
+    if ( mStatistics & QgsZonalStatistics::Variety )
+      changeAttributeMap.insert( fieldIndexes.value( Variety ), QVariant( featureStats.valueCount.count() ) );
+  }
+  return changeAttributeMap;
+}
+
 int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle& rasterBBox, const QgsRectangle& featureBBox, double cellSizeX, double cellSizeY,
     int& offsetX, int& offsetY, int& nCellsX, int& nCellsY ) const
 {
@@ -409,62 +747,6 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle& rasterBBox, const Q
   return 0;
 }
 
-void QgsZonalStatistics::statisticsFromMiddlePointTest( void* band, const QgsGeometry* poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats &stats )
-{
-  double cellCenterX, cellCenterY;
-
-  float* scanLine = ( float * ) CPLMalloc( sizeof( float ) * nCellsX );
-  cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  stats.reset();
-
-  const GEOSGeometry* polyGeos = poly->asGeos();
-  if ( !polyGeos )
-  {
-    return;
-  }
-
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  const GEOSPreparedGeometry* polyGeosPrepared = GEOSPrepare_r( geosctxt, poly->asGeos() );
-  if ( !polyGeosPrepared )
-  {
-    return;
-  }
-
-  GEOSCoordSequence* cellCenterCoords = 0;
-  GEOSGeometry* currentCellCenter = 0;
-
-  for ( int i = 0; i < nCellsY; ++i )
-  {
-    if ( GDALRasterIO( band, GF_Read, pixelOffsetX, pixelOffsetY + i, nCellsX, 1, scanLine, nCellsX, 1, GDT_Float32, 0, 0 )
-         != CPLE_None )
-    {
-      continue;
-    }
-    cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
-    for ( int j = 0; j < nCellsX; ++j )
-    {
-      if ( validPixel( scanLine[j] ) )
-      {
-        GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-        cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
-        GEOSCoordSeq_setX_r( geosctxt, cellCenterCoords, 0, cellCenterX );
-        GEOSCoordSeq_setY_r( geosctxt, cellCenterCoords, 0, cellCenterY );
-        currentCellCenter = GEOSGeom_createPoint_r( geosctxt, cellCenterCoords );
-        if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared, currentCellCenter ) )
-        {
-          stats.addValue( scanLine[j] );
-        }
-      }
-      cellCenterX += cellSizeX;
-    }
-    cellCenterY -= cellSizeY;
-  }
-  GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-  CPLFree( scanLine );
-  GEOSPreparedGeom_destroy_r( geosctxt, polyGeosPrepared );
-}
-
 void QgsZonalStatistics::statisticsFromPreciseIntersection( void* band, const QgsGeometry* poly, int pixelOffsetX,
     int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats &stats )
 {
@@ -18,7 +18,9 @@
 #ifndef QGSZONALSTATISTICS_H
 #define QGSZONALSTATISTICS_H
 
+#include "qgsfeature.h"
 #include "qgsrectangle.h"
+#include <QMap>
 #include <QString>
 
 class QgsGeometry;
@@ -105,14 +107,15 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     int cellInfoForBBox( const QgsRectangle& rasterBBox, const QgsRectangle& featureBBox, double cellSizeX, double cellSizeY,
                          int& offsetX, int& offsetY, int& nCellsX, int& nCellsY ) const;
 
-    /** Returns statistics by considering the pixels where the center point is within the polygon (fast)*/
-    void statisticsFromMiddlePointTest( void* band, const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats& stats );
-
     /** Returns statistics with precise pixel - polygon intersection test (slow) */
     void statisticsFromPreciseIntersection( void* band, const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
                                             double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats& stats );
 
+    /** Converts the statistics of a feature to attribute values
+      @param featureStats statistics of the feature
+      @param fieldIndexes indexes of the fields of the requested statistics*/
+    QgsAttributeMap statisticsAttributes( FeatureStats& featureStats, const QMap<Statistic, int>& fieldIndexes ) const;
+
     /** Tests whether a pixel's value should be included in the result*/
     bool validPixel( float value ) const;
 
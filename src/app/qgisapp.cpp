@@ -2496,6 +2496,8 @@ void QgisApp::createOverview()
 
   mMapCanvas->setParallelRenderingEnabled( mySettings.value( "/qgis/parallel_rendering", false ).toBool() );
 
+  mMapCanvas->setApproximateTransformEnabled( mySettings.value( "/qgis/approximate_transform", false ).toBool() );
+
   mMapCanvas->setMapUpdateInterval( mySettings.value( "/qgis/map_update_interval", 250 ).toInt() );
 }
 
@@ -7928,6 +7930,8 @@ void QgisApp::showOptionsDialog( QWidget *parent, const QString& currentPage )
 
     mMapCanvas->setParallelRenderingEnabled( mySettings.value( "/qgis/parallel_rendering", false ).toBool() );
 
+    mMapCanvas->setApproximateTransformEnabled( mySettings.value( "/qgis/approximate_transform", false ).toBool() );
+
     mMapCanvas->setMapUpdateInterval( mySettings.value( "/qgis/map_update_interval", 250 ).toInt() );
 
     if ( oldCapitalise != mySettings.value( "/qgis/capitaliseLayerName", QVariant( false ) ).toBool() )
@@ -643,7 +643,7 @@ class CORE_EXPORT QgsGeometry
      */
     int vertexNrFromVertexId( const QgsVertexId& i ) const;
 
-    /** Return GEOS context handle
+    /** Return GEOS context handle of the calling thread
      * @note added in 2.6
      * @note not available in Python
      */
@@ -28,6 +28,8 @@ email                : marco.hugentobler at sourcepole dot com
 #include <limits>
 #include <cstdio>
 #include <QtCore/qmath.h>
+#include <QMutex>
+#include <QThreadStorage>
 
 #define DEFAULT_QUADRANT_SEGMENTS 8
 
@@ -79,20 +81,65 @@ static void printGEOSNotice( const char *fmt, ... )
 #endif
 }
 
-class GEOSInit
+/**
+ * GEOS context handles must not be used concurrently, so every thread gets its own one.
+ * Handles of finished threads are handed to new threads instead of being released,
+ * because geometries created with a handle may outlive the thread that created them.
+ */
+class GEOSContextPool
 {
   public:
-    GEOSContextHandle_t ctxt;
+    GEOSContextHandle_t threadContext()
+    {
+      ThreadContext* c = mThreadContexts.localData();
+      if ( !c )
+      {
+        c = new ThreadContext( this, acquire() );
+        mThreadContexts.setLocalData( c );
+      }
+      return c->ctxt;
+    }
 
-    GEOSInit()
+  private:
+    struct ThreadContext
     {
-      ctxt = initGEOS_r( printGEOSNotice, throwGEOSException );
+      ThreadContext( GEOSContextPool* p, GEOSContextHandle_t c ) : pool( p ), ctxt( c ) {}
+      ~ThreadContext() { pool->release( ctxt ); }
+
+      GEOSContextPool* pool;
+      GEOSContextHandle_t ctxt;
+    };
+
+    GEOSContextHandle_t acquire()
+    {
+      QMutexLocker locker( &mMutex );
+      if ( !mFreeContexts.isEmpty() )
+        return mFreeContexts.takeLast();
+
+      return initGEOS_r( printGEOSNotice, throwGEOSException );
     }
 
-    ~GEOSInit()
+    void release( GEOSContextHandle_t ctxt )
     {
-      finishGEOS_r( ctxt );
+      QMutexLocker locker( &mMutex );
+      mFreeContexts.append( ctxt );
     }
+
+    QMutex mMutex;
+    QList<GEOSContextHandle_t> mFreeContexts;
+    QThreadStorage<ThreadContext*> mThreadContexts;
+};
+
+class GEOSInit
+{
+  public:
+    // the pool is never deleted: geometries may still be destroyed during static destruction
+    GEOSInit() : mPool( new GEOSContextPool ) {}
+
+    GEOSContextHandle_t ctxt() { return mPool->threadContext(); }
+
+  private:
+    GEOSContextPool* mPool;
 };
 
 static GEOSInit geosinit;
@@ -101,12 +148,12 @@ class GEOSGeomScopedPtr
 {
   public:
     explicit GEOSGeomScopedPtr( GEOSGeometry* geom = 0 ) : mGeom( geom ) {}
-    ~GEOSGeomScopedPtr() { GEOSGeom_destroy_r( geosinit.ctxt, mGeom ); }
+    ~GEOSGeomScopedPtr() { GEOSGeom_destroy_r( geosinit.ctxt(), mGeom ); }
     GEOSGeometry* get() const { return mGeom; }
     operator bool() const { return mGeom != 0; }
     void reset( GEOSGeometry* geom )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, mGeom );
+      GEOSGeom_destroy_r( geosinit.ctxt(), mGeom );
       mGeom = geom;
     }
 
@@ -129,8 +176,8 @@ QgsGeos::QgsGeos( const QgsAbstractGeometryV2* geometry, int precision ) : QgsGe
 QgsGeos::~QgsGeos()
 {
 #if defined(HAVE_GEOS_CPP) || defined(HAVE_GEOS_CAPI_PRECISION_MODEL)
-  GEOSGeom_destroy_r( geosinit.ctxt, mGeos );
-  GEOSPreparedGeom_destroy_r( geosinit.ctxt, mGeosPrepared );
+  GEOSGeom_destroy_r( geosinit.ctxt(), mGeos );
+  GEOSPreparedGeom_destroy_r( geosinit.ctxt(), mGeosPrepared );
   GEOSGeometryPrecisionReducer_destroy( mPrecisionReducer );
   GEOSPrecisionModel_destroy( mPrecisionModel );
 #endif
@@ -141,7 +188,7 @@ inline GEOSGeometry* QgsGeos::getReducedGeometry( GEOSGeometry* geom ) const
 #if defined(HAVE_GEOS_CPP) || defined(HAVE_GEOS_CAPI_PRECISION_MODEL)
   //reduce precision
   GEOSGeometry* reduced = GEOSGeometryPrecisionReducer_reduce( mPrecisionReducer, geom );
-  GEOSGeom_destroy_r( geosinit.ctxt, geom );
+  GEOSGeom_destroy_r( geosinit.ctxt(), geom );
   return reduced;
 #else
   return geom;
@@ -150,20 +197,20 @@ inline GEOSGeometry* QgsGeos::getReducedGeometry( GEOSGeometry* geom ) const
 
 void QgsGeos::geometryChanged()
 {
-  GEOSGeom_destroy_r( geosinit.ctxt, mGeos );
+  GEOSGeom_destroy_r( geosinit.ctxt(), mGeos );
   mGeos = 0;
-  GEOSPreparedGeom_destroy_r( geosinit.ctxt, mGeosPrepared );
+  GEOSPreparedGeom_destroy_r( geosinit.ctxt(), mGeosPrepared );
   mGeosPrepared = 0;
   cacheGeos();
 }
 
 void QgsGeos::prepareGeometry()
 {
-  GEOSPreparedGeom_destroy_r( geosinit.ctxt, mGeosPrepared );
+  GEOSPreparedGeom_destroy_r( geosinit.ctxt(), mGeosPrepared );
   mGeosPrepared = 0;
   if ( mGeos )
   {
-    mGeosPrepared = GEOSPrepare_r( geosinit.ctxt, mGeos );
+    mGeosPrepared = GEOSPrepare_r( geosinit.ctxt(), mGeos );
   }
 }
 
@@ -179,7 +226,7 @@ void QgsGeos::cacheGeos() const
   if ( g )
   {
     mGeos = GEOSGeometryPrecisionReducer_reduce( mPrecisionReducer, g );
-    GEOSGeom_destroy_r( geosinit.ctxt, g );
+    GEOSGeom_destroy_r( geosinit.ctxt(), g );
   }
 #else
   mGeos = g;
@@ -215,13 +262,13 @@ QgsAbstractGeometryV2* QgsGeos::combine( const QList< const QgsAbstractGeometryV
   try
   {
     GEOSGeometry* geomCollection =  createGeosCollection( GEOS_GEOMETRYCOLLECTION, geosGeometries );
-    geomUnion = GEOSUnaryUnion_r( geosinit.ctxt, geomCollection );
-    GEOSGeom_destroy_r( geosinit.ctxt, geomCollection );
+    geomUnion = GEOSUnaryUnion_r( geosinit.ctxt(), geomCollection );
+    GEOSGeom_destroy_r( geosinit.ctxt(), geomCollection );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 )
 
   QgsAbstractGeometryV2* result = fromGeos( geomUnion );
-  GEOSGeom_destroy_r( geosinit.ctxt, geomUnion );
+  GEOSGeom_destroy_r( geosinit.ctxt(), geomUnion );
   return result;
 }
 
@@ -246,7 +293,7 @@ double QgsGeos::distance( const QgsAbstractGeometryV2& geom, QString* errorMsg )
 
   try
   {
-    GEOSDistance_r( geosinit.ctxt, mGeos, otherGeosGeom, &distance );
+    GEOSDistance_r( geosinit.ctxt(), mGeos, otherGeosGeom, &distance );
   }
   CATCH_GEOS_WITH_ERRMSG( -1.0 )
 
@@ -298,7 +345,7 @@ double QgsGeos::area( QString* errorMsg ) const
 
   try
   {
-    if ( GEOSArea_r( geosinit.ctxt, mGeos, &area ) != 1 )
+    if ( GEOSArea_r( geosinit.ctxt(), mGeos, &area ) != 1 )
       return -1.0;
   }
   CATCH_GEOS_WITH_ERRMSG( -1.0 );
@@ -314,7 +361,7 @@ double QgsGeos::length( QString* errorMsg ) const
   }
   try
   {
-    if ( GEOSLength_r( geosinit.ctxt, mGeos, &length ) != 1 )
+    if ( GEOSLength_r( geosinit.ctxt(), mGeos, &length ) != 1 )
       return -1.0;
   }
   CATCH_GEOS_WITH_ERRMSG( -1.0 )
@@ -340,7 +387,7 @@ int QgsGeos::splitGeometry( const QgsLineStringV2& splitLine,
     return 1; //cannot split points
   }
 
-  if ( !GEOSisValid_r( geosinit.ctxt, mGeos ) )
+  if ( !GEOSisValid_r( geosinit.ctxt(), mGeos ) )
     return 7;
 
   //make sure splitLine is valid
@@ -367,9 +414,9 @@ int QgsGeos::splitGeometry( const QgsLineStringV2& splitLine,
       return 1;
     }
 
-    if ( !GEOSisValid_r( geosinit.ctxt, splitLineGeos ) || !GEOSisSimple_r( geosinit.ctxt, splitLineGeos ) )
+    if ( !GEOSisValid_r( geosinit.ctxt(), splitLineGeos ) || !GEOSisSimple_r( geosinit.ctxt(), splitLineGeos ) )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, splitLineGeos );
+      GEOSGeom_destroy_r( geosinit.ctxt(), splitLineGeos );
       return 1;
     }
 
@@ -384,12 +431,12 @@ int QgsGeos::splitGeometry( const QgsLineStringV2& splitLine,
     if ( mGeometry->dimension() == 1 )
     {
       returnCode = splitLinearGeometry( splitLineGeos, newGeometries );
-      GEOSGeom_destroy_r( geosinit.ctxt, splitLineGeos );
+      GEOSGeom_destroy_r( geosinit.ctxt(), splitLineGeos );
     }
     else if ( mGeometry->dimension() == 2 )
     {
       returnCode = splitPolygonGeometry( splitLineGeos, newGeometries );
-      GEOSGeom_destroy_r( geosinit.ctxt, splitLineGeos );
+      GEOSGeom_destroy_r( geosinit.ctxt(), splitLineGeos );
     }
     else
     {
@@ -417,18 +464,18 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry* splitLine, QList<Qg
   try
   {
     testPoints.clear();
-    GEOSGeometry* intersectionGeom = GEOSIntersection_r( geosinit.ctxt, mGeos, splitLine );
+    GEOSGeometry* intersectionGeom = GEOSIntersection_r( geosinit.ctxt(), mGeos, splitLine );
     if ( !intersectionGeom )
       return 1;
 
     bool simple = false;
     int nIntersectGeoms = 1;
-    if ( GEOSGeomTypeId_r( geosinit.ctxt, intersectionGeom ) == GEOS_LINESTRING
-         || GEOSGeomTypeId_r( geosinit.ctxt, intersectionGeom ) == GEOS_POINT )
+    if ( GEOSGeomTypeId_r( geosinit.ctxt(), intersectionGeom ) == GEOS_LINESTRING
+         || GEOSGeomTypeId_r( geosinit.ctxt(), intersectionGeom ) == GEOS_POINT )
       simple = true;
 
     if ( !simple )
-      nIntersectGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, intersectionGeom );
+      nIntersectGeoms = GEOSGetNumGeometries_r( geosinit.ctxt(), intersectionGeom );
 
     for ( int i = 0; i < nIntersectGeoms; ++i )
     {
@@ -436,18 +483,18 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry* splitLine, QList<Qg
       if ( simple )
         currentIntersectGeom = intersectionGeom;
       else
-        currentIntersectGeom = GEOSGetGeometryN_r( geosinit.ctxt, intersectionGeom, i );
+        currentIntersectGeom = GEOSGetGeometryN_r( geosinit.ctxt(), intersectionGeom, i );
 
-      const GEOSCoordSequence* lineSequence = GEOSGeom_getCoordSeq_r( geosinit.ctxt, currentIntersectGeom );
+      const GEOSCoordSequence* lineSequence = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), currentIntersectGeom );
       unsigned int sequenceSize = 0;
       double x, y;
-      if ( GEOSCoordSeq_getSize_r( geosinit.ctxt, lineSequence, &sequenceSize ) != 0 )
+      if ( GEOSCoordSeq_getSize_r( geosinit.ctxt(), lineSequence, &sequenceSize ) != 0 )
       {
         for ( unsigned int i = 0; i < sequenceSize; ++i )
         {
-          if ( GEOSCoordSeq_getX_r( geosinit.ctxt, lineSequence, i, &x ) != 0 )
+          if ( GEOSCoordSeq_getX_r( geosinit.ctxt(), lineSequence, i, &x ) != 0 )
           {
-            if ( GEOSCoordSeq_getY_r( geosinit.ctxt, lineSequence, i, &y ) != 0 )
+            if ( GEOSCoordSeq_getY_r( geosinit.ctxt(), lineSequence, i, &y ) != 0 )
             {
               testPoints.push_back( QgsPointV2( x, y ) );
             }
@@ -455,7 +502,7 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry* splitLine, QList<Qg
         }
       }
     }
-    GEOSGeom_destroy_r( geosinit.ctxt, intersectionGeom );
+    GEOSGeom_destroy_r( geosinit.ctxt(), intersectionGeom );
   }
   CATCH_GEOS_WITH_ERRMSG( 1 )
 
@@ -464,7 +511,7 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry* splitLine, QList<Qg
 
 GEOSGeometry* QgsGeos::linePointDifference( GEOSGeometry* GEOSsplitPoint ) const
 {
-  int type = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
+  int type = GEOSGeomTypeId_r( geosinit.ctxt(), mGeos );
 
   QgsMultiCurveV2* multiCurve = 0;
   if ( type == GEOS_MULTILINESTRING )
@@ -536,15 +583,15 @@ int QgsGeos::splitLinearGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeom
     return 5;
 
   //first test if linestring intersects geometry. If not, return straight away
-  if ( !GEOSIntersects_r( geosinit.ctxt, splitLine, mGeos ) )
+  if ( !GEOSIntersects_r( geosinit.ctxt(), splitLine, mGeos ) )
     return 1;
 
   //check that split line has no linear intersection
-  int linearIntersect = GEOSRelatePattern_r( geosinit.ctxt, mGeos, splitLine, "1********" );
+  int linearIntersect = GEOSRelatePattern_r( geosinit.ctxt(), mGeos, splitLine, "1********" );
   if ( linearIntersect > 0 )
     return 3;
 
-  int splitGeomType = GEOSGeomTypeId_r( geosinit.ctxt, splitLine );
+  int splitGeomType = GEOSGeomTypeId_r( geosinit.ctxt(), splitLine );
 
   GEOSGeometry* splitGeom;
   if ( splitGeomType == GEOS_POINT )
@@ -553,22 +600,22 @@ int QgsGeos::splitLinearGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeom
   }
   else
   {
-    splitGeom = GEOSDifference_r( geosinit.ctxt, mGeos, splitLine );
+    splitGeom = GEOSDifference_r( geosinit.ctxt(), mGeos, splitLine );
   }
   QVector<GEOSGeometry*> lineGeoms;
 
-  int splitType = GEOSGeomTypeId_r( geosinit.ctxt, splitGeom );
+  int splitType = GEOSGeomTypeId_r( geosinit.ctxt(), splitGeom );
   if ( splitType == GEOS_MULTILINESTRING )
   {
-    int nGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, splitGeom );
+    int nGeoms = GEOSGetNumGeometries_r( geosinit.ctxt(), splitGeom );
     lineGeoms.reserve( nGeoms );
     for ( int i = 0; i < nGeoms; ++i )
-      lineGeoms << GEOSGeom_clone_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, splitGeom, i ) );
+      lineGeoms << GEOSGeom_clone_r( geosinit.ctxt(), GEOSGetGeometryN_r( geosinit.ctxt(), splitGeom, i ) );
 
   }
   else
   {
-    lineGeoms << GEOSGeom_clone_r( geosinit.ctxt, splitGeom );
+    lineGeoms << GEOSGeom_clone_r( geosinit.ctxt(), splitGeom );
   }
 
   mergeGeometriesMultiTypeSplit( lineGeoms );
@@ -578,7 +625,7 @@ int QgsGeos::splitLinearGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeom
     newGeometries << fromGeos( lineGeoms[i] );
   }
 
-  GEOSGeom_destroy_r( geosinit.ctxt, splitGeom );
+  GEOSGeom_destroy_r( geosinit.ctxt(), splitGeom );
   return 0;
 }
 
@@ -591,7 +638,7 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeo
     return 5;
 
   //first test if linestring intersects geometry. If not, return straight away
-  if ( !GEOSIntersects_r( geosinit.ctxt, splitLine, mGeos ) )
+  if ( !GEOSIntersects_r( geosinit.ctxt(), splitLine, mGeos ) )
     return 1;
 
   //first union all the polygon rings together (to get them noded, see JTS developer guide)
@@ -599,18 +646,18 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeo
   if ( !nodedGeometry )
     return 2; //an error occured during noding
 
-  GEOSGeometry *polygons = GEOSPolygonize_r( geosinit.ctxt, &nodedGeometry, 1 );
+  GEOSGeometry *polygons = GEOSPolygonize_r( geosinit.ctxt(), &nodedGeometry, 1 );
   if ( !polygons || numberOfGeometries( polygons ) == 0 )
   {
     if ( polygons )
-      GEOSGeom_destroy_r( geosinit.ctxt, polygons );
+      GEOSGeom_destroy_r( geosinit.ctxt(), polygons );
 
-    GEOSGeom_destroy_r( geosinit.ctxt, nodedGeometry );
+    GEOSGeom_destroy_r( geosinit.ctxt(), nodedGeometry );
 
     return 4;
   }
 
-  GEOSGeom_destroy_r( geosinit.ctxt, nodedGeometry );
+  GEOSGeom_destroy_r( geosinit.ctxt(), nodedGeometry );
 
   //test every polygon if contained in original geometry
   //include in result if yes
@@ -622,8 +669,8 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeo
 
   for ( int i = 0; i < numberOfGeometries( polygons ); i++ )
   {
-    const GEOSGeometry *polygon = GEOSGetGeometryN_r( geosinit.ctxt, polygons, i );
-    intersectGeometry = GEOSIntersection_r( geosinit.ctxt, mGeos, polygon );
+    const GEOSGeometry *polygon = GEOSGetGeometryN_r( geosinit.ctxt(), polygons, i );
+    intersectGeometry = GEOSIntersection_r( geosinit.ctxt(), mGeos, polygon );
     if ( !intersectGeometry )
     {
       QgsDebugMsg( "intersectGeometry is NULL" );
@@ -631,16 +678,16 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeo
     }
 
     double intersectionArea;
-    GEOSArea_r( geosinit.ctxt, intersectGeometry, &intersectionArea );
+    GEOSArea_r( geosinit.ctxt(), intersectGeometry, &intersectionArea );
 
     double polygonArea;
-    GEOSArea_r( geosinit.ctxt, polygon, &polygonArea );
+    GEOSArea_r( geosinit.ctxt(), polygon, &polygonArea );
 
     const double areaRatio = intersectionArea / polygonArea;
     if ( areaRatio > 0.99 && areaRatio < 1.01 )
-      testedGeometries << GEOSGeom_clone_r( geosinit.ctxt, polygon );
+      testedGeometries << GEOSGeom_clone_r( geosinit.ctxt(), polygon );
 
-    GEOSGeom_destroy_r( geosinit.ctxt, intersectGeometry );
+    GEOSGeom_destroy_r( geosinit.ctxt(), intersectGeometry );
   }
 
   bool splitDone = true;
@@ -657,19 +704,19 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeo
   {
     for ( int i = 0; i < testedGeometries.size(); ++i )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, testedGeometries[i] );
+      GEOSGeom_destroy_r( geosinit.ctxt(), testedGeometries[i] );
     }
     return 1;
   }
 
   int i;
-  for ( i = 0; i < testedGeometries.size() && GEOSisValid_r( geosinit.ctxt, testedGeometries[i] ); ++i )
+  for ( i = 0; i < testedGeometries.size() && GEOSisValid_r( geosinit.ctxt(), testedGeometries[i] ); ++i )
     ;
 
   if ( i < testedGeometries.size() )
   {
     for ( i = 0; i < testedGeometries.size(); ++i )
-      GEOSGeom_destroy_r( geosinit.ctxt, testedGeometries[i] );
+      GEOSGeom_destroy_r( geosinit.ctxt(), testedGeometries[i] );
 
     return 3;
   }
@@ -677,7 +724,7 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry* splitLine, QList<QgsAbstractGeo
   for ( i = 0; i < testedGeometries.size(); ++i )
     newGeometries << fromGeos( testedGeometries[i] );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, polygons );
+  GEOSGeom_destroy_r( geosinit.ctxt(), polygons );
   return 0;
 }
 
@@ -687,16 +734,16 @@ GEOSGeometry* QgsGeos::nodeGeometries( const GEOSGeometry *splitLine, const GEOS
     return 0;
 
   GEOSGeometry *geometryBoundary = 0;
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, geom ) == GEOS_POLYGON || GEOSGeomTypeId_r( geosinit.ctxt, geom ) == GEOS_MULTIPOLYGON )
-    geometryBoundary = GEOSBoundary_r( geosinit.ctxt, geom );
+  if ( GEOSGeomTypeId_r( geosinit.ctxt(), geom ) == GEOS_POLYGON || GEOSGeomTypeId_r( geosinit.ctxt(), geom ) == GEOS_MULTIPOLYGON )
+    geometryBoundary = GEOSBoundary_r( geosinit.ctxt(), geom );
   else
-    geometryBoundary = GEOSGeom_clone_r( geosinit.ctxt, geom );
+    geometryBoundary = GEOSGeom_clone_r( geosinit.ctxt(), geom );
 
-  GEOSGeometry *splitLineClone = GEOSGeom_clone_r( geosinit.ctxt, splitLine );
-  GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit.ctxt, splitLineClone, geometryBoundary );
-  GEOSGeom_destroy_r( geosinit.ctxt, splitLineClone );
+  GEOSGeometry *splitLineClone = GEOSGeom_clone_r( geosinit.ctxt(), splitLine );
+  GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit.ctxt(), splitLineClone, geometryBoundary );
+  GEOSGeom_destroy_r( geosinit.ctxt(), splitLineClone );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, geometryBoundary );
+  GEOSGeom_destroy_r( geosinit.ctxt(), geometryBoundary );
   return unionGeometry;
 }
 
@@ -706,7 +753,7 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult
     return 1;
 
   //convert mGeos to geometry collection
-  int type = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
+  int type = GEOSGeomTypeId_r( geosinit.ctxt(), mGeos );
   if ( type != GEOS_GEOMETRYCOLLECTION &&
        type != GEOS_MULTILINESTRING &&
        type != GEOS_MULTIPOLYGON &&
@@ -723,9 +770,9 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult
   {
     //is this geometry a part of the original multitype?
     bool isPart = false;
-    for ( int j = 0; j < GEOSGetNumGeometries_r( geosinit.ctxt, mGeos ); j++ )
+    for ( int j = 0; j < GEOSGetNumGeometries_r( geosinit.ctxt(), mGeos ); j++ )
     {
-      if ( GEOSEquals_r( geosinit.ctxt, copyList[i], GEOSGetGeometryN_r( geosinit.ctxt, mGeos, j ) ) )
+      if ( GEOSEquals_r( geosinit.ctxt(), copyList[i], GEOSGetGeometryN_r( geosinit.ctxt(), mGeos, j ) ) )
       {
         isPart = true;
         break;
@@ -746,7 +793,7 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult
       else if ( type == GEOS_MULTIPOLYGON )
         splitResult << createGeosCollection( GEOS_MULTIPOLYGON, geomVector );
       else
-        GEOSGeom_destroy_r( geosinit.ctxt, copyList[i] );
+        GEOSGeom_destroy_r( geosinit.ctxt(), copyList[i] );
     }
   }
 
@@ -791,7 +838,7 @@ GEOSGeometry* QgsGeos::createGeosCollection( int typeId, const QVector<GEOSGeome
 
   try
   {
-    geom = GEOSGeom_createCollection_r( geosinit.ctxt, typeId, geomarr, nNotNullGeoms );
+    geom = GEOSGeom_createCollection_r( geosinit.ctxt(), typeId, geomarr, nNotNullGeoms );
   }
   catch ( GEOSException &e )
   {
@@ -810,16 +857,16 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     return 0;
   }
 
-  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt, geos );
-  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt, geos );
+  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt(), geos );
+  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt(), geos );
   bool hasZ = ( nCoordDims == 3 );
   bool hasM = (( nDims - nCoordDims ) == 1 );
 
-  switch ( GEOSGeomTypeId_r( geosinit.ctxt, geos ) )
+  switch ( GEOSGeomTypeId_r( geosinit.ctxt(), geos ) )
   {
     case GEOS_POINT:                 // a point
     {
-      const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, geos );
+      const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), geos );
       return ( coordSeqPoint( cs, 0, hasZ, hasM ).clone() );
     }
     case GEOS_LINESTRING:
@@ -833,10 +880,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     case GEOS_MULTIPOINT:
     {
       QgsMultiPointV2* multiPoint = new QgsMultiPointV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt(), geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), GEOSGetGeometryN_r( geosinit.ctxt(), geos, i ) );
         if ( cs )
         {
           multiPoint->addGeometry( coordSeqPoint( cs, 0, hasZ, hasM ).clone() );
@@ -847,10 +894,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     case GEOS_MULTILINESTRING:
     {
       QgsMultiLineStringV2* multiLineString = new QgsMultiLineStringV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt(), geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsLineStringV2* line = sequenceToLinestring( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ), hasZ, hasM );
+        QgsLineStringV2* line = sequenceToLinestring( GEOSGetGeometryN_r( geosinit.ctxt(), geos, i ), hasZ, hasM );
         if ( line )
         {
           multiLineString->addGeometry( line );
@@ -862,10 +909,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     {
       QgsMultiPolygonV2* multiPolygon = new QgsMultiPolygonV2();
 
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt(), geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsPolygonV2* poly = fromGeosPolygon( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        QgsPolygonV2* poly = fromGeosPolygon( GEOSGetGeometryN_r( geosinit.ctxt(), geos, i ) );
         if ( poly )
         {
           multiPolygon->addGeometry( poly );
@@ -876,10 +923,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     case GEOS_GEOMETRYCOLLECTION:
     {
       QgsGeometryCollectionV2* geomCollection = new QgsGeometryCollectionV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt(), geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsAbstractGeometryV2* geom = fromGeos( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        QgsAbstractGeometryV2* geom = fromGeos( GEOSGetGeometryN_r( geosinit.ctxt(), geos, i ) );
         if ( geom )
         {
           geomCollection->addGeometry( geom );
@@ -893,28 +940,28 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
 
 QgsPolygonV2* QgsGeos::fromGeosPolygon( const GEOSGeometry* geos )
 {
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, geos ) != GEOS_POLYGON )
+  if ( GEOSGeomTypeId_r( geosinit.ctxt(), geos ) != GEOS_POLYGON )
   {
     return 0;
   }
 
-  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt, geos );
-  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt, geos );
+  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt(), geos );
+  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt(), geos );
   bool hasZ = ( nCoordDims == 3 );
   bool hasM = (( nDims - nCoordDims ) == 1 );
 
   QgsPolygonV2* polygon = new QgsPolygonV2();
 
-  const GEOSGeometry* ring = GEOSGetExteriorRing_r( geosinit.ctxt, geos );
+  const GEOSGeometry* ring = GEOSGetExteriorRing_r( geosinit.ctxt(), geos );
   if ( ring )
   {
     polygon->setExteriorRing( sequenceToLinestring( ring, hasZ, hasM ) );
   }
 
   QList<QgsCurveV2*> interiorRings;
-  for ( int i = 0; i < GEOSGetNumInteriorRings_r( geosinit.ctxt, geos ); ++i )
+  for ( int i = 0; i < GEOSGetNumInteriorRings_r( geosinit.ctxt(), geos ); ++i )
   {
-    ring = GEOSGetInteriorRingN_r( geosinit.ctxt, geos, i );
+    ring = GEOSGetInteriorRingN_r( geosinit.ctxt(), geos, i );
     if ( ring )
     {
       interiorRings.push_back( sequenceToLinestring( ring, hasZ, hasM ) );
@@ -928,9 +975,9 @@ QgsPolygonV2* QgsGeos::fromGeosPolygon( const GEOSGeometry* geos )
 QgsLineStringV2* QgsGeos::sequenceToLinestring( const GEOSGeometry* geos, bool hasZ, bool hasM )
 {
   QList<QgsPointV2> pts;
-  const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, geos );
+  const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), geos );
   unsigned int nPoints;
-  GEOSCoordSeq_getSize_r( geosinit.ctxt, cs, &nPoints );
+  GEOSCoordSeq_getSize_r( geosinit.ctxt(), cs, &nPoints );
   pts.reserve( nPoints );
   for ( unsigned int i = 0; i < nPoints; ++i )
   {
@@ -946,13 +993,13 @@ int QgsGeos::numberOfGeometries( GEOSGeometry* g )
   if ( !g )
     return 0;
 
-  int geometryType = GEOSGeomTypeId_r( geosinit.ctxt, g );
+  int geometryType = GEOSGeomTypeId_r( geosinit.ctxt(), g );
   if ( geometryType == GEOS_POINT || geometryType == GEOS_LINESTRING || geometryType == GEOS_LINEARRING
        || geometryType == GEOS_POLYGON )
     return 1;
 
   //calling GEOSGetNumGeometries is save for multi types and collections also in geos2
-  return GEOSGetNumGeometries_r( geosinit.ctxt, g );
+  return GEOSGetNumGeometries_r( geosinit.ctxt(), g );
 }
 
 QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ, bool hasM )
@@ -965,15 +1012,15 @@ QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ
   double x, y;
   double z = 0;
   double m = 0;
-  GEOSCoordSeq_getX_r( geosinit.ctxt, cs, i, &x );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, cs, i, &y );
+  GEOSCoordSeq_getX_r( geosinit.ctxt(), cs, i, &x );
+  GEOSCoordSeq_getY_r( geosinit.ctxt(), cs, i, &y );
   if ( hasZ )
   {
-    GEOSCoordSeq_getZ_r( geosinit.ctxt, cs, i, &z );
+    GEOSCoordSeq_getZ_r( geosinit.ctxt(), cs, i, &z );
   }
   if ( hasM )
   {
-    GEOSCoordSeq_getOrdinate_r( geosinit.ctxt, cs, i, 3, &m );
+    GEOSCoordSeq_getOrdinate_r( geosinit.ctxt(), cs, i, 3, &m );
   }
 
   QgsWKBTypes::Type t = QgsWKBTypes::Point;
@@ -1077,21 +1124,21 @@ QgsAbstractGeometryV2* QgsGeos::overlay( const QgsAbstractGeometryV2& geom, Over
     switch ( op )
     {
       case INTERSECTION:
-        opGeom.reset( GEOSIntersection_r( geosinit.ctxt, mGeos, geosGeom.get() ) );
+        opGeom.reset( GEOSIntersection_r( geosinit.ctxt(), mGeos, geosGeom.get() ) );
         break;
       case DIFFERENCE:
-        opGeom.reset( GEOSDifference_r( geosinit.ctxt, mGeos, geosGeom.get() ) );
+        opGeom.reset( GEOSDifference_r( geosinit.ctxt(), mGeos, geosGeom.get() ) );
         break;
       case UNION:
       {
-        GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit.ctxt, mGeos, geosGeom.get() );
+        GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit.ctxt(), mGeos, geosGeom.get() );
 
-        if ( unionGeometry && GEOSGeomTypeId_r( geosinit.ctxt, unionGeometry ) == GEOS_MULTILINESTRING )
+        if ( unionGeometry && GEOSGeomTypeId_r( geosinit.ctxt(), unionGeometry ) == GEOS_MULTILINESTRING )
         {
-          GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit.ctxt, unionGeometry );
+          GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit.ctxt(), unionGeometry );
           if ( mergedLines )
           {
-            GEOSGeom_destroy_r( geosinit.ctxt, unionGeometry );
+            GEOSGeom_destroy_r( geosinit.ctxt(), unionGeometry );
             unionGeometry = mergedLines;
           }
         }
@@ -1100,7 +1147,7 @@ QgsAbstractGeometryV2* QgsGeos::overlay( const QgsAbstractGeometryV2& geom, Over
       }
       break;
       case SYMDIFFERENCE:
-        opGeom.reset( GEOSSymDifference_r( geosinit.ctxt, mGeos, geosGeom.get() ) );
+        opGeom.reset( GEOSSymDifference_r( geosinit.ctxt(), mGeos, geosGeom.get() ) );
         break;
       default:    //unknown op
         return 0;
@@ -1139,25 +1186,25 @@ bool QgsGeos::relation( const QgsAbstractGeometryV2& geom, Relation r, QString*
       switch ( r )
       {
         case INTERSECTS:
-          result = ( GEOSPreparedIntersects_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedIntersects_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case TOUCHES:
-          result = ( GEOSPreparedTouches_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedTouches_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case CROSSES:
-          result = ( GEOSPreparedCrosses_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedCrosses_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case WITHIN:
-          result = ( GEOSPreparedWithin_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedWithin_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case CONTAINS:
-          result = ( GEOSPreparedContains_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedContains_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case DISJOINT:
-          result = ( GEOSPreparedDisjoint_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedDisjoint_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case OVERLAPS:
-          result = ( GEOSPreparedOverlaps_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedOverlaps_r( geosinit.ctxt(), mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         default:
           return false;
@@ -1168,25 +1215,25 @@ bool QgsGeos::relation( const QgsAbstractGeometryV2& geom, Relation r, QString*
     switch ( r )
     {
       case INTERSECTS:
-        result = ( GEOSIntersects_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSIntersects_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       case TOUCHES:
-        result = ( GEOSTouches_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSTouches_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       case CROSSES:
-        result = ( GEOSCrosses_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSCrosses_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       case WITHIN:
-        result = ( GEOSWithin_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSWithin_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       case CONTAINS:
-        result = ( GEOSContains_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSContains_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       case DISJOINT:
-        result = ( GEOSDisjoint_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSDisjoint_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       case OVERLAPS:
-        result = ( GEOSOverlaps_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSOverlaps_r( geosinit.ctxt(), mGeos, geosGeom.get() ) == 1 );
         break;
       default:
         return false;
@@ -1214,7 +1261,7 @@ QgsAbstractGeometryV2* QgsGeos::buffer( double distance, int segments, QString*
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSBuffer_r( geosinit.ctxt, mGeos, distance, segments );
+    geos = GEOSBuffer_r( geosinit.ctxt(), mGeos, distance, segments );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 );
   return fromGeos( geos );
@@ -1233,7 +1280,7 @@ QgsAbstractGeometryV2 *QgsGeos::buffer( double distance, int segments, int endCa
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSBufferWithStyle_r( geosinit.ctxt, mGeos, distance, segments, endCapStyle, joinStyle, mitreLimit );
+    geos = GEOSBufferWithStyle_r( geosinit.ctxt(), mGeos, distance, segments, endCapStyle, joinStyle, mitreLimit );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 );
   return fromGeos( geos );
@@ -1251,7 +1298,7 @@ QgsAbstractGeometryV2* QgsGeos::simplify( double tolerance, QString* errorMsg )
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSTopologyPreserveSimplify_r( geosinit.ctxt, mGeos, tolerance );
+    geos = GEOSTopologyPreserveSimplify_r( geosinit.ctxt(), mGeos, tolerance );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 );
   return fromGeos( geos );
@@ -1266,7 +1313,7 @@ QgsAbstractGeometryV2* QgsGeos::interpolate( double distance, QString* errorMsg
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSInterpolate_r( geosinit.ctxt, mGeos, distance );
+    geos = GEOSInterpolate_r( geosinit.ctxt(), mGeos, distance );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 );
   return fromGeos( geos );
@@ -1282,7 +1329,7 @@ bool QgsGeos::centroid( QgsPointV2& pt, QString* errorMsg ) const
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSGetCentroid_r( geosinit.ctxt,  mGeos );
+    geos = GEOSGetCentroid_r( geosinit.ctxt(),  mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 
@@ -1292,8 +1339,8 @@ bool QgsGeos::centroid( QgsPointV2& pt, QString* errorMsg ) const
   }
 
   double x, y;
-  GEOSGeomGetX_r( geosinit.ctxt, geos, &x );
-  GEOSGeomGetY_r( geosinit.ctxt, geos, &y );
+  GEOSGeomGetX_r( geosinit.ctxt(), geos, &x );
+  GEOSGeomGetY_r( geosinit.ctxt(), geos, &y );
   pt.setX( x ); pt.setY( y );
   return true;
 }
@@ -1307,7 +1354,7 @@ QgsAbstractGeometryV2* QgsGeos::envelope( QString* errorMsg ) const
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSEnvelope_r( geosinit.ctxt, mGeos );
+    geos = GEOSEnvelope_r( geosinit.ctxt(), mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 );
   return fromGeos( geos );
@@ -1323,7 +1370,7 @@ bool QgsGeos::pointOnSurface( QgsPointV2& pt, QString* errorMsg ) const
   GEOSGeometry* geos = 0;
   try
   {
-    geos = GEOSPointOnSurface_r( geosinit.ctxt, mGeos );
+    geos = GEOSPointOnSurface_r( geosinit.ctxt(), mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 
@@ -1333,8 +1380,8 @@ bool QgsGeos::pointOnSurface( QgsPointV2& pt, QString* errorMsg ) const
   }
 
   double x, y;
-  GEOSGeomGetX_r( geosinit.ctxt, geos, &x );
-  GEOSGeomGetY_r( geosinit.ctxt, geos, &y );
+  GEOSGeomGetX_r( geosinit.ctxt(), geos, &x );
+  GEOSGeomGetY_r( geosinit.ctxt(), geos, &y );
 
   pt.setX( x );
   pt.setY( y );
@@ -1351,9 +1398,9 @@ QgsAbstractGeometryV2* QgsGeos::convexHull( QString* errorMsg ) const
 
   try
   {
-    GEOSGeometry* cHull = GEOSConvexHull_r( geosinit.ctxt, mGeos );
+    GEOSGeometry* cHull = GEOSConvexHull_r( geosinit.ctxt(), mGeos );
     QgsAbstractGeometryV2* cHullGeom = fromGeos( cHull );
-    GEOSGeom_destroy_r( geosinit.ctxt, cHull );
+    GEOSGeom_destroy_r( geosinit.ctxt(), cHull );
     return cHullGeom;
   }
   CATCH_GEOS_WITH_ERRMSG( 0 );
@@ -1368,7 +1415,7 @@ bool QgsGeos::isValid( QString* errorMsg ) const
 
   try
   {
-    return GEOSisValid_r( geosinit.ctxt, mGeos );
+    return GEOSisValid_r( geosinit.ctxt(), mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 }
@@ -1387,7 +1434,7 @@ bool QgsGeos::isEqual( const QgsAbstractGeometryV2& geom, QString* errorMsg ) co
     {
       return false;
     }
-    bool equal = GEOSEquals_r( geosinit.ctxt, mGeos, geosGeom.get() );
+    bool equal = GEOSEquals_r( geosinit.ctxt(), mGeos, geosGeom.get() );
     return equal;
   }
   CATCH_GEOS_WITH_ERRMSG( false );
@@ -1402,7 +1449,7 @@ bool QgsGeos::isEmpty( QString* errorMsg ) const
 
   try
   {
-    return GEOSisEmpty_r( geosinit.ctxt, mGeos );
+    return GEOSisEmpty_r( geosinit.ctxt(), mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 }
@@ -1439,19 +1486,19 @@ GEOSCoordSequence* QgsGeos::createCoordinateSequence( const QgsCurveV2* curve )
   GEOSCoordSequence* coordSeq = 0;
   try
   {
-    coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt, numPoints, coordDims );
+    coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt(), numPoints, coordDims );
     for ( int i = 0; i < numPoints; ++i )
     {
       QgsPointV2 pt = line->pointN( i ); //todo: create method to get const point reference
-      GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, i, pt.x() );
-      GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, i, pt.y() );
+      GEOSCoordSeq_setX_r( geosinit.ctxt(), coordSeq, i, pt.x() );
+      GEOSCoordSeq_setY_r( geosinit.ctxt(), coordSeq, i, pt.y() );
       if ( hasZ )
       {
-        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 2, pt.z() );
+        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt(), coordSeq, i, 2, pt.z() );
       }
       if ( hasM )
       {
-        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 3, pt.m() );
+        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt(), coordSeq, i, 3, pt.m() );
       }
     }
   }
@@ -1474,18 +1521,18 @@ GEOSGeometry* QgsGeos::createGeosPoint( const QgsAbstractGeometryV2* point, int
 
   try
   {
-    GEOSCoordSequence* coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt, 1, coordDims );
-    GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, 0, pt->x() );
-    GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, 0, pt->y() );
+    GEOSCoordSequence* coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt(), 1, coordDims );
+    GEOSCoordSeq_setX_r( geosinit.ctxt(), coordSeq, 0, pt->x() );
+    GEOSCoordSeq_setY_r( geosinit.ctxt(), coordSeq, 0, pt->y() );
     if ( pt->is3D() )
     {
-      GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 2, pt->z() );
+      GEOSCoordSeq_setOrdinate_r( geosinit.ctxt(), coordSeq, 0, 2, pt->z() );
     }
     if ( 0 /*pt->isMeasure()*/ ) //disabled until geos supports m-coordinates
     {
-      GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 3, pt->m() );
+      GEOSCoordSeq_setOrdinate_r( geosinit.ctxt(), coordSeq, 0, 3, pt->m() );
     }
-    geosPoint = GEOSGeom_createPoint_r( geosinit.ctxt, coordSeq );
+    geosPoint = GEOSGeom_createPoint_r( geosinit.ctxt(), coordSeq );
   }
   CATCH_GEOS( 0 )
   return geosPoint;
@@ -1504,7 +1551,7 @@ GEOSGeometry* QgsGeos::createGeosLinestring( const QgsAbstractGeometryV2* curve
   GEOSGeometry* geosGeom = 0;
   try
   {
-    geosGeom = GEOSGeom_createLineString_r( geosinit.ctxt, coordSeq );
+    geosGeom = GEOSGeom_createLineString_r( geosinit.ctxt(), coordSeq );
   }
   CATCH_GEOS( 0 )
   return geosGeom;
@@ -1525,7 +1572,7 @@ GEOSGeometry* QgsGeos::createGeosPolygon( const QgsAbstractGeometryV2* poly )
   GEOSGeometry* geosPolygon = 0;
   try
   {
-    GEOSGeometry* exteriorRingGeos = GEOSGeom_createLinearRing_r( geosinit.ctxt, createCoordinateSequence( exteriorRing ) );
+    GEOSGeometry* exteriorRingGeos = GEOSGeom_createLinearRing_r( geosinit.ctxt(), createCoordinateSequence( exteriorRing ) );
 
 
     int nHoles = polygon->numInteriorRings();
@@ -1538,9 +1585,9 @@ GEOSGeometry* QgsGeos::createGeosPolygon( const QgsAbstractGeometryV2* poly )
     for ( int i = 0; i < nHoles; ++i )
     {
       const QgsCurveV2* interiorRing = polygon->interiorRing( i );
-      holes[i] = GEOSGeom_createLinearRing_r( geosinit.ctxt, createCoordinateSequence( interiorRing ) );
+      holes[i] = GEOSGeom_createLinearRing_r( geosinit.ctxt(), createCoordinateSequence( interiorRing ) );
     }
-    geosPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt, exteriorRingGeos, holes, nHoles );
+    geosPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt(), exteriorRingGeos, holes, nHoles );
     delete[] holes;
   }
   CATCH_GEOS( 0 )
@@ -1556,11 +1603,11 @@ QgsAbstractGeometryV2* QgsGeos::offsetCurve( double distance, int segments, int
   GEOSGeometry* offset = 0;
   try
   {
-    offset = GEOSOffsetCurve_r( geosinit.ctxt, mGeos, distance, segments, joinStyle, mitreLimit );
+    offset = GEOSOffsetCurve_r( geosinit.ctxt(), mGeos, distance, segments, joinStyle, mitreLimit );
   }
   CATCH_GEOS_WITH_ERRMSG( 0 )
   QgsAbstractGeometryV2* offsetGeom = fromGeos( offset );
-  GEOSGeom_destroy_r( geosinit.ctxt, offset );
+  GEOSGeom_destroy_r( geosinit.ctxt(), offset );
   return offsetGeom;
 }
 
@@ -1575,7 +1622,7 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
   GEOSGeometry* reshapeLineGeos = createGeosLinestring( &reshapeWithLine );
 
   //single or multi?
-  int numGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, mGeos );
+  int numGeoms = GEOSGetNumGeometries_r( geosinit.ctxt(), mGeos );
   if ( numGeoms == -1 )
   {
     if ( errorCode ) { *errorCode = 1; }
@@ -1583,7 +1630,7 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
   }
 
   bool isMultiGeom = false;
-  int geosTypeId = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
+  int geosTypeId = GEOSGeomTypeId_r( geosinit.ctxt(), mGeos );
   if ( geosTypeId == GEOS_MULTILINESTRING || geosTypeId == GEOS_MULTIPOLYGON )
     isMultiGeom = true;
 
@@ -1603,7 +1650,7 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
 
     if ( errorCode ) { *errorCode = 0; }
     QgsAbstractGeometryV2* reshapeResult = fromGeos( reshapedGeometry );
-    GEOSGeom_destroy_r( geosinit.ctxt, reshapedGeometry );
+    GEOSGeom_destroy_r( geosinit.ctxt(), reshapedGeometry );
     return reshapeResult;
   }
   else
@@ -1619,9 +1666,9 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
       for ( int i = 0; i < numGeoms; ++i )
       {
         if ( isLine )
-          currentReshapeGeometry = reshapeLine( GEOSGetGeometryN_r( geosinit.ctxt, mGeos, i ), reshapeLineGeos );
+          currentReshapeGeometry = reshapeLine( GEOSGetGeometryN_r( geosinit.ctxt(), mGeos, i ), reshapeLineGeos );
         else
-          currentReshapeGeometry = reshapePolygon( GEOSGetGeometryN_r( geosinit.ctxt, mGeos, i ), reshapeLineGeos );
+          currentReshapeGeometry = reshapePolygon( GEOSGetGeometryN_r( geosinit.ctxt(), mGeos, i ), reshapeLineGeos );
 
         if ( currentReshapeGeometry )
         {
@@ -1630,19 +1677,19 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
         }
         else
         {
-          newGeoms[i] = GEOSGeom_clone_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, mGeos, i ) );
+          newGeoms[i] = GEOSGeom_clone_r( geosinit.ctxt(), GEOSGetGeometryN_r( geosinit.ctxt(), mGeos, i ) );
         }
       }
-      GEOSGeom_destroy_r( geosinit.ctxt, reshapeLineGeos );
+      GEOSGeom_destroy_r( geosinit.ctxt(), reshapeLineGeos );
 
       GEOSGeometry* newMultiGeom = 0;
       if ( isLine )
       {
-        newMultiGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTILINESTRING, newGeoms, numGeoms );
+        newMultiGeom = GEOSGeom_createCollection_r( geosinit.ctxt(), GEOS_MULTILINESTRING, newGeoms, numGeoms );
       }
       else //multipolygon
       {
-        newMultiGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTIPOLYGON, newGeoms, numGeoms );
+        newMultiGeom = GEOSGeom_createCollection_r( geosinit.ctxt(), GEOS_MULTIPOLYGON, newGeoms, numGeoms );
       }
 
       delete[] newGeoms;
@@ -1656,12 +1703,12 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
       {
         if ( errorCode ) { *errorCode = 0; }
         QgsAbstractGeometryV2* reshapedMultiGeom = fromGeos( newMultiGeom );
-        GEOSGeom_destroy_r( geosinit.ctxt, newMultiGeom );
+        GEOSGeom_destroy_r( geosinit.ctxt(), newMultiGeom );
         return reshapedMultiGeom;
       }
       else
       {
-        GEOSGeom_destroy_r( geosinit.ctxt, newMultiGeom );
+        GEOSGeom_destroy_r( geosinit.ctxt(), newMultiGeom );
         if ( errorCode ) { *errorCode = 1; }
         return 0;
       }
@@ -1680,12 +1727,12 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
   try
   {
     //make sure there are at least two intersection between line and reshape geometry
-    GEOSGeometry* intersectGeom = GEOSIntersection_r( geosinit.ctxt, line, reshapeLineGeos );
+    GEOSGeometry* intersectGeom = GEOSIntersection_r( geosinit.ctxt(), line, reshapeLineGeos );
     if ( intersectGeom )
     {
-      atLeastTwoIntersections = ( GEOSGeomTypeId_r( geosinit.ctxt, intersectGeom ) == GEOS_MULTIPOINT
-                                  && GEOSGetNumGeometries_r( geosinit.ctxt, intersectGeom ) > 1 );
-      GEOSGeom_destroy_r( geosinit.ctxt, intersectGeom );
+      atLeastTwoIntersections = ( GEOSGeomTypeId_r( geosinit.ctxt(), intersectGeom ) == GEOS_MULTIPOINT
+                                  && GEOSGetNumGeometries_r( geosinit.ctxt(), intersectGeom ) > 1 );
+      GEOSGeom_destroy_r( geosinit.ctxt(), intersectGeom );
     }
   }
   catch ( GEOSException &e )
@@ -1698,12 +1745,12 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
     return 0;
 
   //begin and end point of original line
-  const GEOSCoordSequence* lineCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, line );
+  const GEOSCoordSequence* lineCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), line );
   if ( !lineCoordSeq )
     return 0;
 
   unsigned int lineCoordSeqSize;
-  if ( GEOSCoordSeq_getSize_r( geosinit.ctxt, lineCoordSeq, &lineCoordSeqSize ) == 0 )
+  if ( GEOSCoordSeq_getSize_r( geosinit.ctxt(), lineCoordSeq, &lineCoordSeqSize ) == 0 )
     return 0;
 
   if ( lineCoordSeqSize < 2 )
@@ -1711,46 +1758,46 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
 
   //first and last vertex of line
   double x1, y1, x2, y2;
-  GEOSCoordSeq_getX_r( geosinit.ctxt, lineCoordSeq, 0, &x1 );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, lineCoordSeq, 0, &y1 );
-  GEOSCoordSeq_getX_r( geosinit.ctxt, lineCoordSeq, lineCoordSeqSize - 1, &x2 );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, lineCoordSeq, lineCoordSeqSize - 1, &y2 );
+  GEOSCoordSeq_getX_r( geosinit.ctxt(), lineCoordSeq, 0, &x1 );
+  GEOSCoordSeq_getY_r( geosinit.ctxt(), lineCoordSeq, 0, &y1 );
+  GEOSCoordSeq_getX_r( geosinit.ctxt(), lineCoordSeq, lineCoordSeqSize - 1, &x2 );
+  GEOSCoordSeq_getY_r( geosinit.ctxt(), lineCoordSeq, lineCoordSeqSize - 1, &y2 );
   QgsPointV2 beginPoint( x1, y1 );
   GEOSGeometry* beginLineVertex = createGeosPoint( &beginPoint, 2 );
   QgsPointV2 endPoint( x2, y2 );
   GEOSGeometry* endLineVertex = createGeosPoint( &endPoint, 2 );
 
   bool isRing = false;
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, line ) == GEOS_LINEARRING
-       || GEOSEquals_r( geosinit.ctxt, beginLineVertex, endLineVertex ) == 1 )
+  if ( GEOSGeomTypeId_r( geosinit.ctxt(), line ) == GEOS_LINEARRING
+       || GEOSEquals_r( geosinit.ctxt(), beginLineVertex, endLineVertex ) == 1 )
     isRing = true;
 
   //node line and reshape line
   GEOSGeometry* nodedGeometry = nodeGeometries( reshapeLineGeos, line );
   if ( !nodedGeometry )
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), beginLineVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), endLineVertex );
     return 0;
   }
 
   //and merge them together
-  GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit.ctxt, nodedGeometry );
-  GEOSGeom_destroy_r( geosinit.ctxt, nodedGeometry );
+  GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit.ctxt(), nodedGeometry );
+  GEOSGeom_destroy_r( geosinit.ctxt(), nodedGeometry );
   if ( !mergedLines )
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), beginLineVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), endLineVertex );
     return 0;
   }
 
-  int numMergedLines = GEOSGetNumGeometries_r( geosinit.ctxt, mergedLines );
+  int numMergedLines = GEOSGetNumGeometries_r( geosinit.ctxt(), mergedLines );
   if ( numMergedLines < 2 ) //some special cases. Normally it is >2
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), beginLineVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), endLineVertex );
     if ( numMergedLines == 1 ) //reshape line is from begin to endpoint. So we keep the reshapeline
-      return GEOSGeom_clone_r( geosinit.ctxt, reshapeLineGeos );
+      return GEOSGeom_clone_r( geosinit.ctxt(), reshapeLineGeos );
     else
       return 0;
   }
@@ -1762,19 +1809,19 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
   {
     const GEOSGeometry* currentGeom;
 
-    currentGeom = GEOSGetGeometryN_r( geosinit.ctxt, mergedLines, i );
-    const GEOSCoordSequence* currentCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, currentGeom );
+    currentGeom = GEOSGetGeometryN_r( geosinit.ctxt(), mergedLines, i );
+    const GEOSCoordSequence* currentCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), currentGeom );
     unsigned int currentCoordSeqSize;
-    GEOSCoordSeq_getSize_r( geosinit.ctxt, currentCoordSeq, &currentCoordSeqSize );
+    GEOSCoordSeq_getSize_r( geosinit.ctxt(), currentCoordSeq, &currentCoordSeqSize );
     if ( currentCoordSeqSize < 2 )
       continue;
 
     //get the two endpoints of the current line merge result
     double xBegin, xEnd, yBegin, yEnd;
-    GEOSCoordSeq_getX_r( geosinit.ctxt, currentCoordSeq, 0, &xBegin );
-    GEOSCoordSeq_getY_r( geosinit.ctxt, currentCoordSeq, 0, &yBegin );
-    GEOSCoordSeq_getX_r( geosinit.ctxt, currentCoordSeq, currentCoordSeqSize - 1, &xEnd );
-    GEOSCoordSeq_getY_r( geosinit.ctxt, currentCoordSeq, currentCoordSeqSize - 1, &yEnd );
+    GEOSCoordSeq_getX_r( geosinit.ctxt(), currentCoordSeq, 0, &xBegin );
+    GEOSCoordSeq_getY_r( geosinit.ctxt(), currentCoordSeq, 0, &yBegin );
+    GEOSCoordSeq_getX_r( geosinit.ctxt(), currentCoordSeq, currentCoordSeqSize - 1, &xEnd );
+    GEOSCoordSeq_getY_r( geosinit.ctxt(), currentCoordSeq, currentCoordSeqSize - 1, &yEnd );
     QgsPointV2 beginPoint( xBegin, yBegin );
     GEOSGeometry* beginCurrentGeomVertex = createGeosPoint( &beginPoint, 2 );
     QgsPointV2 endPoint( xEnd, yEnd );
@@ -1790,12 +1837,12 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
 
     //check how many endpoints equal the endpoints of the original line
     int nEndpointsSameAsOriginalLine = 0;
-    if ( GEOSEquals_r( geosinit.ctxt, beginCurrentGeomVertex, beginLineVertex ) == 1
-         || GEOSEquals_r( geosinit.ctxt, beginCurrentGeomVertex, endLineVertex ) == 1 )
+    if ( GEOSEquals_r( geosinit.ctxt(), beginCurrentGeomVertex, beginLineVertex ) == 1
+         || GEOSEquals_r( geosinit.ctxt(), beginCurrentGeomVertex, endLineVertex ) == 1 )
       nEndpointsSameAsOriginalLine += 1;
 
-    if ( GEOSEquals_r( geosinit.ctxt, endCurrentGeomVertex, beginLineVertex ) == 1
-         || GEOSEquals_r( geosinit.ctxt, endCurrentGeomVertex, endLineVertex ) == 1 )
+    if ( GEOSEquals_r( geosinit.ctxt(), endCurrentGeomVertex, beginLineVertex ) == 1
+         || GEOSEquals_r( geosinit.ctxt(), endCurrentGeomVertex, endLineVertex ) == 1 )
       nEndpointsSameAsOriginalLine += 1;
 
     //check if the current geometry overlaps the original geometry (GEOSOverlap does not seem to work with linestrings)
@@ -1810,28 +1857,28 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
     //logic to decide if this part belongs to the result
     if ( nEndpointsSameAsOriginalLine == 1 && nEndpointsOnOriginalLine == 2 && currentGeomOverlapsOriginalGeom )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt(), currentGeom ) );
     }
     //for closed rings, we take one segment from the candidate list
     else if ( isRing && nEndpointsOnOriginalLine == 2 && currentGeomOverlapsOriginalGeom )
     {
-      probableParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      probableParts.push_back( GEOSGeom_clone_r( geosinit.ctxt(), currentGeom ) );
     }
     else if ( nEndpointsOnOriginalLine == 2 && !currentGeomOverlapsOriginalGeom )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt(), currentGeom ) );
     }
     else if ( nEndpointsSameAsOriginalLine == 2 && !currentGeomOverlapsOriginalGeom )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt(), currentGeom ) );
     }
     else if ( currentGeomOverlapsOriginalGeom && currentGeomOverlapsReshapeLine )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt(), currentGeom ) );
     }
 
-    GEOSGeom_destroy_r( geosinit.ctxt, beginCurrentGeomVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endCurrentGeomVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), beginCurrentGeomVertex );
+    GEOSGeom_destroy_r( geosinit.ctxt(), endCurrentGeomVertex );
   }
 
   //add the longest segment from the probable list for rings (only used for polygon rings)
@@ -1844,24 +1891,24 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
     for ( int i = 0; i < probableParts.size(); ++i )
     {
       currentGeom = probableParts.at( i );
-      GEOSLength_r( geosinit.ctxt, currentGeom, &currentLength );
+      GEOSLength_r( geosinit.ctxt(), currentGeom, &currentLength );
       if ( currentLength > maxLength )
       {
         maxLength = currentLength;
-        GEOSGeom_destroy_r( geosinit.ctxt, maxGeom );
+        GEOSGeom_destroy_r( geosinit.ctxt(), maxGeom );
         maxGeom = currentGeom;
       }
       else
       {
-        GEOSGeom_destroy_r( geosinit.ctxt, currentGeom );
+        GEOSGeom_destroy_r( geosinit.ctxt(), currentGeom );
       }
     }
     resultLineParts.push_back( maxGeom );
   }
 
-  GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-  GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
-  GEOSGeom_destroy_r( geosinit.ctxt, mergedLines );
+  GEOSGeom_destroy_r( geosinit.ctxt(), beginLineVertex );
+  GEOSGeom_destroy_r( geosinit.ctxt(), endLineVertex );
+  GEOSGeom_destroy_r( geosinit.ctxt(), mergedLines );
 
   GEOSGeometry* result = 0;
   if ( resultLineParts.size() < 1 )
@@ -1880,18 +1927,18 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
     }
 
     //create multiline from resultLineParts
-    GEOSGeometry* multiLineGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTILINESTRING, lineArray, resultLineParts.size() );
+    GEOSGeometry* multiLineGeom = GEOSGeom_createCollection_r( geosinit.ctxt(), GEOS_MULTILINESTRING, lineArray, resultLineParts.size() );
     delete [] lineArray;
 
     //then do a linemerge with the newly combined partstrings
-    result = GEOSLineMerge_r( geosinit.ctxt, multiLineGeom );
-    GEOSGeom_destroy_r( geosinit.ctxt, multiLineGeom );
+    result = GEOSLineMerge_r( geosinit.ctxt(), multiLineGeom );
+    GEOSGeom_destroy_r( geosinit.ctxt(), multiLineGeom );
   }
 
   //now test if the result is a linestring. Otherwise something went wrong
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, result ) != GEOS_LINESTRING )
+  if ( GEOSGeomTypeId_r( geosinit.ctxt(), result ) != GEOS_LINESTRING )
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, result );
+    GEOSGeom_destroy_r( geosinit.ctxt(), result );
     return 0;
   }
 
@@ -1905,13 +1952,13 @@ GEOSGeometry* QgsGeos::reshapePolygon( const GEOSGeometry* polygon, const GEOSGe
   int lastIntersectingRing = -2;
   const GEOSGeometry* lastIntersectingGeom = 0;
 
-  int nRings = GEOSGetNumInteriorRings_r( geosinit.ctxt, polygon );
+  int nRings = GEOSGetNumInteriorRings_r( geosinit.ctxt(), polygon );
   if ( nRings < 0 )
     return 0;
 
   //does outer ring intersect?
-  const GEOSGeometry* outerRing = GEOSGetExteriorRing_r( geosinit.ctxt, polygon );
-  if ( GEOSIntersects_r( geosinit.ctxt, outerRing, reshapeLineGeos ) == 1 )
+  const GEOSGeometry* outerRing = GEOSGetExteriorRing_r( geosinit.ctxt(), polygon );
+  if ( GEOSIntersects_r( geosinit.ctxt(), outerRing, reshapeLineGeos ) == 1 )
   {
     ++nIntersections;
     lastIntersectingRing = -1;
@@ -1925,8 +1972,8 @@ GEOSGeometry* QgsGeos::reshapePolygon( const GEOSGeometry* polygon, const GEOSGe
   {
     for ( int i = 0; i < nRings; ++i )
     {
-      innerRings[i] = GEOSGetInteriorRingN_r( geosinit.ctxt, polygon, i );
-      if ( GEOSIntersects_r( geosinit.ctxt, innerRings[i], reshapeLineGeos ) == 1 )
+      innerRings[i] = GEOSGetInteriorRingN_r( geosinit.ctxt(), polygon, i );
+      if ( GEOSIntersects_r( geosinit.ctxt(), innerRings[i], reshapeLineGeos ) == 1 )
       {
         ++nIntersections;
         lastIntersectingRing = i;
@@ -1956,12 +2003,12 @@ GEOSGeometry* QgsGeos::reshapePolygon( const GEOSGeometry* polygon, const GEOSGe
 
   //if reshaping took place, we need to reassemble the polygon and its rings
   GEOSGeometry* newRing = 0;
-  const GEOSCoordSequence* reshapeSequence = GEOSGeom_getCoordSeq_r( geosinit.ctxt, reshapeResult );
-  GEOSCoordSequence* newCoordSequence = GEOSCoordSeq_clone_r( geosinit.ctxt, reshapeSequence );
+  const GEOSCoordSequence* reshapeSequence = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), reshapeResult );
+  GEOSCoordSequence* newCoordSequence = GEOSCoordSeq_clone_r( geosinit.ctxt(), reshapeSequence );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, reshapeResult );
+  GEOSGeom_destroy_r( geosinit.ctxt(), reshapeResult );
 
-  newRing = GEOSGeom_createLinearRing_r( geosinit.ctxt, newCoordSequence );
+  newRing = GEOSGeom_createLinearRing_r( geosinit.ctxt(), newCoordSequence );
   if ( !newRing )
   {
     delete [] innerRings;
@@ -1972,13 +2019,13 @@ GEOSGeometry* QgsGeos::reshapePolygon( const GEOSGeometry* polygon, const GEOSGe
   if ( lastIntersectingRing == -1 )
     newOuterRing = newRing;
   else
-    newOuterRing = GEOSGeom_clone_r( geosinit.ctxt, outerRing );
+    newOuterRing = GEOSGeom_clone_r( geosinit.ctxt(), outerRing );
 
   //check if all the rings are still inside the outer boundary
   QList<GEOSGeometry*> ringList;
   if ( nRings > 0 )
   {
-    GEOSGeometry* outerRingPoly = GEOSGeom_createPolygon_r( geosinit.ctxt, GEOSGeom_clone_r( geosinit.ctxt, newOuterRing ), 0, 0 );
+    GEOSGeometry* outerRingPoly = GEOSGeom_createPolygon_r( geosinit.ctxt(), GEOSGeom_clone_r( geosinit.ctxt(), newOuterRing ), 0, 0 );
     if ( outerRingPoly )
     {
       GEOSGeometry* currentRing = 0;
@@ -1987,16 +2034,16 @@ GEOSGeometry* QgsGeos::reshapePolygon( const GEOSGeometry* polygon, const GEOSGe
         if ( lastIntersectingRing == i )
           currentRing = newRing;
         else
-          currentRing = GEOSGeom_clone_r( geosinit.ctxt, innerRings[i] );
+          currentRing = GEOSGeom_clone_r( geosinit.ctxt(), innerRings[i] );
 
         //possibly a ring is no longer contained in the result polygon after reshape
-        if ( GEOSContains_r( geosinit.ctxt, outerRingPoly, currentRing ) == 1 )
+        if ( GEOSContains_r( geosinit.ctxt(), outerRingPoly, currentRing ) == 1 )
           ringList.push_back( currentRing );
         else
-          GEOSGeom_destroy_r( geosinit.ctxt, currentRing );
+          GEOSGeom_destroy_r( geosinit.ctxt(), currentRing );
       }
     }
-    GEOSGeom_destroy_r( geosinit.ctxt, outerRingPoly );
+    GEOSGeom_destroy_r( geosinit.ctxt(), outerRingPoly );
   }
 
   GEOSGeometry** newInnerRings = new GEOSGeometry*[ringList.size()];
@@ -2005,7 +2052,7 @@ GEOSGeometry* QgsGeos::reshapePolygon( const GEOSGeometry* polygon, const GEOSGe
 
   delete [] innerRings;
 
-  GEOSGeometry* reshapedPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt, newOuterRing, newInnerRings, ringList.size() );
+  GEOSGeometry* reshapedPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt(), newOuterRing, newInnerRings, ringList.size() );
   delete[] newInnerRings;
 
   return reshapedPolygon;
@@ -2020,21 +2067,21 @@ int QgsGeos::lineContainedInLine( const GEOSGeometry* line1, const GEOSGeometry*
 
   double bufferDistance = pow( 10.0L, geomDigits( line2 ) - 11 );
 
-  GEOSGeometry* bufferGeom = GEOSBuffer_r( geosinit.ctxt, line2, bufferDistance, DEFAULT_QUADRANT_SEGMENTS );
+  GEOSGeometry* bufferGeom = GEOSBuffer_r( geosinit.ctxt(), line2, bufferDistance, DEFAULT_QUADRANT_SEGMENTS );
   if ( !bufferGeom )
     return -2;
 
-  GEOSGeometry* intersectionGeom = GEOSIntersection_r( geosinit.ctxt, bufferGeom, line1 );
+  GEOSGeometry* intersectionGeom = GEOSIntersection_r( geosinit.ctxt(), bufferGeom, line1 );
 
   //compare ratio between line1Length and intersectGeomLength (usually close to 1 if line1 is contained in line2)
   double intersectGeomLength;
   double line1Length;
 
-  GEOSLength_r( geosinit.ctxt, intersectionGeom, &intersectGeomLength );
-  GEOSLength_r( geosinit.ctxt, line1, &line1Length );
+  GEOSLength_r( geosinit.ctxt(), intersectionGeom, &intersectGeomLength );
+  GEOSLength_r( geosinit.ctxt(), line1, &line1Length );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, bufferGeom );
-  GEOSGeom_destroy_r( geosinit.ctxt, intersectionGeom );
+  GEOSGeom_destroy_r( geosinit.ctxt(), bufferGeom );
+  GEOSGeom_destroy_r( geosinit.ctxt(), intersectionGeom );
 
   double intersectRatio = line1Length / intersectGeomLength;
   if ( intersectRatio > 0.9 && intersectRatio < 1.1 )
@@ -2050,49 +2097,49 @@ int QgsGeos::pointContainedInLine( const GEOSGeometry* point, const GEOSGeometry
 
   double bufferDistance = pow( 10.0L, geomDigits( line ) - 11 );
 
-  GEOSGeometry* lineBuffer = GEOSBuffer_r( geosinit.ctxt, line, bufferDistance, 8 );
+  GEOSGeometry* lineBuffer = GEOSBuffer_r( geosinit.ctxt(), line, bufferDistance, 8 );
   if ( !lineBuffer )
     return -2;
 
   bool contained = false;
-  if ( GEOSContains_r( geosinit.ctxt, lineBuffer, point ) == 1 )
+  if ( GEOSContains_r( geosinit.ctxt(), lineBuffer, point ) == 1 )
     contained = true;
 
-  GEOSGeom_destroy_r( geosinit.ctxt, lineBuffer );
+  GEOSGeom_destroy_r( geosinit.ctxt(), lineBuffer );
   return contained;
 }
 
 int QgsGeos::geomDigits( const GEOSGeometry* geom )
 {
-  GEOSGeometry* bbox = GEOSEnvelope_r( geosinit.ctxt, geom );
+  GEOSGeometry* bbox = GEOSEnvelope_r( geosinit.ctxt(), geom );
   if ( !bbox )
     return -1;
 
-  const GEOSGeometry* bBoxRing = GEOSGetExteriorRing_r( geosinit.ctxt, bbox );
+  const GEOSGeometry* bBoxRing = GEOSGetExteriorRing_r( geosinit.ctxt(), bbox );
   if ( !bBoxRing )
     return -1;
 
-  const GEOSCoordSequence* bBoxCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, bBoxRing );
+  const GEOSCoordSequence* bBoxCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt(), bBoxRing );
 
   if ( !bBoxCoordSeq )
     return -1;
 
   unsigned int nCoords = 0;
-  if ( !GEOSCoordSeq_getSize_r( geosinit.ctxt, bBoxCoordSeq, &nCoords ) )
+  if ( !GEOSCoordSeq_getSize_r( geosinit.ctxt(), bBoxCoordSeq, &nCoords ) )
     return -1;
 
   int maxDigits = -1;
   for ( unsigned int i = 0; i < nCoords - 1; ++i )
   {
     double t;
-    GEOSCoordSeq_getX_r( geosinit.ctxt, bBoxCoordSeq, i, &t );
+    GEOSCoordSeq_getX_r( geosinit.ctxt(), bBoxCoordSeq, i, &t );
 
     int digits;
     digits = ceil( log10( fabs( t ) ) );
     if ( digits > maxDigits )
       maxDigits = digits;
 
-    GEOSCoordSeq_getY_r( geosinit.ctxt, bBoxCoordSeq, i, &t );
+    GEOSCoordSeq_getY_r( geosinit.ctxt(), bBoxCoordSeq, i, &t );
     digits = ceil( log10( fabs( t ) ) );
     if ( digits > maxDigits )
       maxDigits = digits;
@@ -2103,5 +2150,5 @@ int QgsGeos::geomDigits( const GEOSGeometry* geom )
 
 GEOSContextHandle_t QgsGeos::getGEOSHandler()
 {
-  return geosinit.ctxt;
+  return geosinit.ctxt();
 }
@@ -46,6 +46,8 @@
 #include "qgsgeos.h"
 #include "qgsmessagelog.h"
 #include "costcalculator.h"
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QLinkedList>
 #include <cmath>
 #include <cfloat>
@@ -1217,13 +1219,12 @@ namespace pal
                                 double bbox_min[2], double bbox_max[2],
                                 PointSet *mapShape, RTree<LabelPosition*, double, 2, double> *candidates )
   {
-    double bbox[4];
-
-    bbox[0] = bbox_min[0];
-    bbox[1] = bbox_min[1];
-    bbox[2] = bbox_max[0];
-    bbox[3] = bbox_max[1];
+    createCandidates( lPos, mapShape );
+    return filterCandidates( lPos, bbox_min, bbox_max, candidates );
+  }
 
+  void FeaturePart::createCandidates( QList< LabelPosition*>& lPos, PointSet *mapShape )
+  {
     double angle = mLF->hasFixedAngle() ? mLF->fixedAngle() : 0.0;
 
     if ( mLF->hasFixedPosition() )
@@ -1268,6 +1269,18 @@ namespace pal
           }
       }
     }
+  }
+
+  int FeaturePart::filterCandidates( QList< LabelPosition*>& lPos,
+                                     double bbox_min[2], double bbox_max[2],
+                                     RTree<LabelPosition*, double, 2, double> *candidates )
+  {
+    double bbox[4];
+
+    bbox[0] = bbox_min[0];
+    bbox[1] = bbox_min[1];
+    bbox[2] = bbox_max[0];
+    bbox[3] = bbox_max[1];
 
     // purge candidates that are outside the bbox
 
@@ -1285,7 +1298,7 @@ namespace pal
         i.remove();
         delete pos;
       }
-      else   // this one is OK
+      else if ( candidates )  // this one is OK
       {
         pos->insertIntoIndex( candidates );
       }
@@ -1295,6 +1308,35 @@ namespace pal
     return lPos.count();
   }
 
+  QByteArray FeaturePart::candidatesHash() const
+  {
+    QByteArray data;
+    QDataStream stream( &data, QIODevice::WriteOnly );
+    stream << type << nbPoints;
+    for ( int i = 0; i < nbPoints; i++ )
+      stream << x[i] << y[i];
+
+    // holes are used to find a centroid inside of polygons
+    stream << mHoles.count();
+    Q_FOREACH ( FeaturePart* hole, mHoles )
+    {
+      stream << hole->nbPoints;
+      for ( int i = 0; i < hole->nbPoints; i++ )
+        stream << hole->x[i] << hole->y[i];
+    }
+
+    stream << mLF->size() << mLF->distLabel() << mLF->labelText()
+    << mLF->hasFixedPosition() << mLF->fixedPosition().x() << mLF->fixedPosition().y()
+    << mLF->hasFixedAngle() << mLF->fixedAngle() << mLF->hasFixedQuadrant() << mLF->quadOffset()
+    << mLF->positionOffset().x() << mLF->positionOffset().y();
+
+    Layer* layer = mLF->layer();
+    stream << ( int ) layer->arrangement() << ( int ) layer->arrangementFlags() << layer->centroidInside()
+    << layer->fitInPolygonOnly() << ( int ) layer->upsidedownLabels();
+
+    return QCryptographicHash::hash( data, QCryptographicHash::Md5 );
+  }
+
   void FeaturePart::addSizePenalty( int nbp, QList< LabelPosition* >& lPos, double bbx[4], double bby[4] )
   {
     if ( !mGeos )
@@ -149,11 +149,36 @@ namespace pal
        * \param bbox_min min values of the map extent
        * \param bbox_max max values of the map extent
        * \param mapShape generate candidates for this spatial entity
-       * \param candidates index for candidates
+       * \param candidates index for candidates, or NULL if the candidates should not be indexed
        * \return the number of candidates in *lPos
        */
       int setPosition( QList<LabelPosition *> &lPos, double bbox_min[2], double bbox_max[2], PointSet *mapShape, RTree<LabelPosition*, double, 2, double>*candidates );
 
+      /** Generates all candidates, also outside of the map extent. setPosition() is createCandidates()
+       * followed by filterCandidates().
+       * \param lPos list of candidates, will be filled by generated candidates
+       * \param mapShape generate candidates for this spatial entity
+       * \note added in QGIS 2.12
+       */
+      void createCandidates( QList<LabelPosition *> &lPos, PointSet *mapShape );
+
+      /** Removes the candidates outside of the map extent and sorts the others by cost.
+       * \param lPos list of candidates
+       * \param bbox_min min values of the map extent
+       * \param bbox_max max values of the map extent
+       * \param candidates index for candidates, or NULL if the candidates should not be indexed
+       * \return the number of candidates in lPos
+       * \note added in QGIS 2.12
+       */
+      int filterCandidates( QList<LabelPosition *> &lPos, double bbox_min[2], double bbox_max[2], RTree<LabelPosition*, double, 2, double>*candidates );
+
+      /** Returns a hash of the geometry of the part and of the label properties the candidates
+       * are created from. Parts with the same hash get the same candidates from createCandidates()
+       * as long as the settings of the layer and the engine are the same.
+       * \note added in QGIS 2.12
+       */
+      QByteArray candidatesHash() const;
+
       /** Returns the unique ID of the feature.
        */
       QgsFeatureId featureId() const;
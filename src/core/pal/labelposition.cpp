@@ -361,6 +361,13 @@ namespace pal
     return feature;
   }
 
+  void LabelPosition::setFeaturePart( FeaturePart* featurePart )
+  {
+    feature = featurePart;
+    if ( nextPart )
+      nextPart->setFeaturePart( featurePart );
+  }
+
   void LabelPosition::getBoundingBox( double amin[2], double amax[2] ) const
   {
     if ( nextPart )
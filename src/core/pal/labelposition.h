@@ -152,6 +152,12 @@ namespace pal
        */
       FeaturePart * getFeaturePart();
 
+      /** Sets the feature of the label position and of its next parts, e.g. for a copy
+       * of a candidate created for the same feature in a previous labeling run.
+       * @note added in QGIS 2.12
+       */
+      void setFeaturePart( FeaturePart* featurePart );
+
       double getNumOverlaps() const { return nbOverlap; }
       void resetNumOverlaps() { nbOverlap = 0; } // called from problem.cpp, pal.cpp
 
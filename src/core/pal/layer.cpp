@@ -48,6 +48,7 @@ namespace pal
   Layer::Layer( QgsAbstractLabelProvider* provider, const QString& name, Arrangement arrangement, double defaultPriority, bool active, bool toLabel, Pal *pal, bool displayAll )
       : mProvider( provider )
       , mName( name )
+      , mCacheIndex( -1 )
       , pal( pal )
       , mObstacleType( PolygonInterior )
       , mActive( active )
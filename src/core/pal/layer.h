@@ -63,6 +63,7 @@ namespace pal
 
       friend class LabelPosition;
       friend bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx );
+      friend void extractLayerFeatures( void *ctx );
 
     public:
       enum LabelMode { LabelPerFeature, LabelPerFeaturePart };
@@ -84,6 +85,18 @@ namespace pal
       /** Returns pointer to the associated provider */
       QgsAbstractLabelProvider* provider() const { return mProvider; }
 
+      /** Sets the index of the provider among the providers of its map layer, used as key in the labeling cache.
+       * @see cacheIndex
+       * @note added in QGIS 2.12
+       */
+      void setCacheIndex( int index ) { mCacheIndex = index; }
+
+      /** Returns the index of the provider among the providers of its map layer, -1 if the features are not cached.
+       * @see setCacheIndex
+       * @note added in QGIS 2.12
+       */
+      int cacheIndex() const { return mCacheIndex; }
+
       /** Returns the layer's name.
        */
       QString name() const { return mName; }
@@ -247,6 +260,7 @@ namespace pal
     protected:
       QgsAbstractLabelProvider* mProvider; // not owned
       QString mName;
+      int mCacheIndex;
 
       /** List of feature parts */
       QLinkedList<FeaturePart*> mFeatureParts;
@@ -32,6 +32,7 @@
 #define _CRT_SECURE_NO_DEPRECATE
 
 #include "qgsgeometry.h"
+#include "qgslabelingcache.h"
 #include "pal.h"
 #include "layer.h"
 #include "palexception.h"
@@ -46,6 +47,7 @@
 #include "internalexception.h"
 #include "util.h"
 #include <QTime>
+#include <QtConcurrentRun>
 #include <cstdarg>
 #include <iostream>
 #include <fstream>
@@ -66,6 +68,7 @@ namespace pal
 
     fnIsCancelled = 0;
     fnIsCancelledContext = 0;
+    mLabelingCache = 0;
 
     ejChainDeg = 50;
     tenure = 10;
@@ -131,12 +134,15 @@ namespace pal
     return layer;
   }
 
+  /*
+   * Features with candidates and obstacles of a layer. Layers are extracted in parallel,
+   * the results are added to the problem in the order of the layers.
+   */
   typedef struct _featCbackCtx
   {
     Layer *layer;
-    QLinkedList<Feats*>* fFeats;
-    RTree<FeaturePart*, double, 2, double> *obstacles;
-    RTree<LabelPosition*, double, 2, double> *candidates;
+    QLinkedList<Feats*> fFeats;
+    QList<FeaturePart*> obstacles;
     double bbox_min[2];
     double bbox_max[2];
   } FeatCallBackCtx;
@@ -150,8 +156,6 @@ namespace pal
    */
   bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
   {
-    double amin[2], amax[2];
-
     FeatCallBackCtx *context = ( FeatCallBackCtx* ) ctx;
 
 #ifdef _DEBUG_FULL_
@@ -161,8 +165,7 @@ namespace pal
     // all feature which are obstacle will be inserted into obstacles
     if ( ft_ptr->isObstacle() )
     {
-      ft_ptr->getBoundingBox( amin, amax );
-      context->obstacles->Insert( amin, amax, ft_ptr );
+      context->obstacles.append( ft_ptr );
     }
 
     // first do some checks whether to extract candidates or not
@@ -180,8 +183,7 @@ namespace pal
     // Holes of the feature are obstacles
     for ( int i = 0; i < ft_ptr->getNumSelfObstacles(); i++ )
     {
-      ft_ptr->getSelfObstacle( i )->getBoundingBox( amin, amax );
-      context->obstacles->Insert( amin, amax, ft_ptr->getSelfObstacle( i ) );
+      context->obstacles.append( ft_ptr->getSelfObstacle( i ) );
 
       if ( !ft_ptr->getSelfObstacle( i )->getHoleOf() )
       {
@@ -189,9 +191,34 @@ namespace pal
       }
     }
 
-    // generate candidates for the feature part
+    // generate candidates for the feature part, they are indexed when the layers are merged
     QList< LabelPosition* > lPos;
-    if ( ft_ptr->setPosition( lPos, context->bbox_min, context->bbox_max, ft_ptr, context->candidates ) )
+    int nbp;
+    QgsLabelingCache *cache = context->layer->cacheIndex() >= 0 ? context->layer->pal->labelingCache() : NULL;
+    QString layerId = cache ? context->layer->provider()->layerId() : QString();
+    if ( cache && !layerId.isEmpty() )
+    {
+      // candidates do not depend on the map extent, they are only limited to it
+      QgsLabelingCache::CandidatesKey key( QgsLabelingCache::FeatureKey( context->layer->cacheIndex(), ft_ptr->featureId() ),
+                                           ft_ptr->candidatesHash() );
+      if ( cache->candidates( layerId, key, lPos ) )
+      {
+        Q_FOREACH ( LabelPosition* pos, lPos )
+          pos->setFeaturePart( ft_ptr );
+      }
+      else
+      {
+        ft_ptr->createCandidates( lPos, ft_ptr );
+        cache->setCandidates( layerId, key, lPos );
+      }
+      nbp = ft_ptr->filterCandidates( lPos, context->bbox_min, context->bbox_max, NULL );
+    }
+    else
+    {
+      nbp = ft_ptr->setPosition( lPos, context->bbox_min, context->bbox_max, ft_ptr, NULL );
+    }
+
+    if ( nbp )
     {
       // valid features are added to fFeats
       Feats *ft = new Feats();
@@ -199,7 +226,7 @@ namespace pal
       ft->shape = NULL;
       ft->lPos = lPos;
       ft->priority = ft_ptr->calculatePriority();
-      context->fFeats->append( ft );
+      context->fFeats.append( ft );
     }
     else
     {
@@ -210,6 +237,26 @@ namespace pal
     return true;
   }
 
+  /*
+   * Extracts features and candidates of a layer, run in a worker thread
+   */
+  void extractLayerFeatures( void *ctx )
+  {
+    FeatCallBackCtx *context = ( FeatCallBackCtx* ) ctx;
+    Layer *layer = context->layer;
+
+    // check for connected features with the same label text and join them
+    if ( layer->mergeConnectedLines() )
+      layer->joinConnectedFeatures();
+
+    layer->chopFeaturesAtRepeatDistance();
+
+    // find features within bounding box and generate candidates list
+    layer->mMutex.lock();
+    layer->rtree->Search( context->bbox_min, context->bbox_max, extractFeatCallback, ctx );
+    layer->mMutex.unlock();
+  }
+
 
 
 
@@ -267,24 +314,13 @@ namespace pal
 
     QLinkedList<Feats*> *fFeats = new QLinkedList<Feats*>;
 
-    FeatCallBackCtx *context = new FeatCallBackCtx();
-    context->fFeats = fFeats;
-    context->obstacles = obstacles;
-    context->candidates = prob->candidates;
-
-    context->bbox_min[0] = amin[0];
-    context->bbox_min[1] = amin[1];
-
-    context->bbox_max[0] = amax[0];
-    context->bbox_max[1] = amax[1];
-
-    // first step : extract features from layers
-
-    int previousFeatureCount = 0;
+    // first step : extract features from layers, each layer in its own thread
 
     QStringList layersWithFeaturesInBBox;
 
     mMutex.lock();
+    QList<FeatCallBackCtx*> contexts;
+    QList< QFuture<void> > futures;
     Q_FOREACH ( Layer* layer, mLayers.values() )
     {
       if ( !layer )
@@ -297,25 +333,41 @@ namespace pal
       if ( !layer->active() )
         continue;
 
-      // check for connected features with the same label text and join them
-      if ( layer->mergeConnectedLines() )
-        layer->joinConnectedFeatures();
+      FeatCallBackCtx *context = new FeatCallBackCtx();
+      context->layer = layer;
+      context->bbox_min[0] = amin[0];
+      context->bbox_min[1] = amin[1];
+      context->bbox_max[0] = amax[0];
+      context->bbox_max[1] = amax[1];
+      contexts << context;
+      futures << QtConcurrent::run( extractLayerFeatures, ( void* ) context );
+    }
 
-      layer->chopFeaturesAtRepeatDistance();
+    for ( int i = 0; i < futures.count(); i++ )
+      futures[i].waitForFinished();
 
-      // find features within bounding box and generate candidates list
-      context->layer = layer;
-      context->layer->mMutex.lock();
-      context->layer->rtree->Search( amin, amax, extractFeatCallback, ( void* ) context );
-      context->layer->mMutex.unlock();
+    // merge the layers in their order, so that the problem does not depend on the threads
+    Q_FOREACH ( FeatCallBackCtx* context, contexts )
+    {
+      Q_FOREACH ( FeaturePart* obstacle, context->obstacles )
+      {
+        obstacle->getBoundingBox( amin, amax );
+        obstacles->Insert( amin, amax, obstacle );
+      }
 
-      if ( context->fFeats->size() - previousFeatureCount > 0 )
+      Q_FOREACH ( Feats* ft, context->fFeats )
       {
-        layersWithFeaturesInBBox << layer->name();
+        Q_FOREACH ( LabelPosition* lp, ft->lPos )
+          lp->insertIntoIndex( prob->candidates );
+        fFeats->append( ft );
       }
-      previousFeatureCount = context->fFeats->size();
+
+      if ( !context->fFeats.isEmpty() )
+      {
+        layersWithFeaturesInBBox << context->layer->name();
+      }
+      delete context;
     }
-    delete context;
     mMutex.unlock();
 
     prob->nbLabelledLayers = layersWithFeaturesInBBox.size();
@@ -533,12 +585,7 @@ namespace pal
 #endif
 
     // search a solution
-    if ( searchMethod == FALP )
-      prob->init_sol_falp();
-    else if ( searchMethod == CHAIN )
-      prob->chain_search();
-    else
-      prob->popmusic();
+    prob->solveComponents();
 
     std::cout << "PAL SEARCH (" << searchMethod << "): " << t.elapsed() / 1000.0 << " s" << std::endl;
     t.restart();
@@ -589,12 +636,7 @@ namespace pal
 
     try
     {
-      if ( searchMethod == FALP )
-        prob->init_sol_falp();
-      else if ( searchMethod == CHAIN )
-        prob->chain_search();
-      else
-        prob->popmusic();
+      prob->solveComponents();
     }
     catch ( InternalException::Empty )
     {
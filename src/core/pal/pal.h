@@ -40,6 +40,7 @@
 // TODO ${MAJOR} ${MINOR} etc instead of 0.2
 
 class QgsAbstractLabelProvider;
+class QgsLabelingCache;
 
 /**
  *
@@ -174,6 +175,16 @@ namespace pal
 
       std::list<LabelPosition*>* solveProblem( Problem* prob, bool displayAll );
 
+      /** Sets the cache used to reuse placements of previous runs (not owned by pal, may be null)
+       * @note added in QGIS 2.12
+       */
+      void setLabelingCache( QgsLabelingCache* cache ) { mLabelingCache = cache; }
+
+      /** Returns the cache used to reuse placements of previous runs
+       * @note added in QGIS 2.12
+       */
+      QgsLabelingCache* labelingCache() const { return mLabelingCache; }
+
       /**
        *\brief Set flag show partial label
        *
@@ -289,6 +300,9 @@ namespace pal
       /** Application-specific context for the cancellation check function */
       void* fnIsCancelledContext;
 
+      /** Placements of previous runs (not owned) */
+      QgsLabelingCache* mLabelingCache;
+
       /**
        * \brief Problem factory
        * Extract features to label and generates candidates for them,
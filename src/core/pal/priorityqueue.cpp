@@ -45,6 +45,14 @@ namespace pal
     return l < r;
   }
 
+  bool PriorityQueue::isWorse( int i, int j ) const
+  {
+    // elements with the same priority are ordered by key, so the order does not depend on the heap layout
+    if ( p[i] == p[j] )
+      return heap[i] > heap[j];
+    return greater( p[i], p[j] );
+  }
+
 // O (size log size)
   PriorityQueue::PriorityQueue( int n, int maxId, bool min ) : size( 0 ), maxsize( n ), maxId( maxId )
   {
@@ -162,7 +170,10 @@ namespace pal
       heap[i] = heap[size];
       p[i]    = p[size];
 
+      // the moved element may be better than the parent of the removed one
+      int moved = heap[i];
       downheap( i );
+      upheap( moved );
     }
   }
 
@@ -199,7 +210,7 @@ namespace pal
     {
       while ( i > 0 )
       {
-        if ( greater( p[PARENT( i )], p[i] ) )
+        if ( isWorse( PARENT( i ), i ) )
         {
           i2 = PARENT( i );
 
@@ -236,7 +247,7 @@ namespace pal
       {
         if ( RIGHT( id ) < size )
         {
-          min_child = greater( p[RIGHT( id )], p[LEFT( id )] ) ? LEFT( id ) : RIGHT( id );
+          min_child = isWorse( RIGHT( id ), LEFT( id ) ) ? LEFT( id ) : RIGHT( id );
         }
         else
           min_child = LEFT( id );
@@ -244,7 +255,7 @@ namespace pal
       else // leaf
         break;
 
-      if ( greater( p[id], p[min_child] ) )
+      if ( isWorse( id, min_child ) )
       {
         pos[heap[id]] = min_child;
         pos[heap[min_child]] = id;
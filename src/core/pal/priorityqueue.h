@@ -86,6 +86,9 @@ namespace pal
       int *pos;
 
       bool ( *greater )( double l, double r );
+
+      /** Returns true if the element at heap position i comes after the element at position j */
+      bool isWorse( int i, int j ) const;
   };
 
 } // namespace
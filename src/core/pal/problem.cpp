@@ -40,12 +40,15 @@
 #include "util.h"
 #include "priorityqueue.h"
 #include "internalexception.h"
+#include "qgslabelingcache.h"
+#include "qgslabelingenginev2.h"
 #include <iostream>
 #include <fstream>
 #include <cfloat>
 #include <ctime>
 #include <list>
 #include <limits.h> //for INT_MAX
+#include <QtConcurrentMap>
 
 namespace pal
 {
@@ -217,6 +220,308 @@ namespace pal
     delete[] ok;
   }
 
+  void Problem::solve()
+  {
+    if ( pal->searchMethod == FALP )
+      init_sol_falp();
+    else if ( pal->searchMethod == CHAIN )
+      chain_search();
+    else
+      popmusic();
+  }
+
+  typedef struct
+  {
+    LabelPosition *lp;
+    int *component;
+  } ComponentContext;
+
+  static int findComponent( int *component, int i )
+  {
+    while ( component[i] != i )
+    {
+      component[i] = component[component[i]];
+      i = component[i];
+    }
+    return i;
+  }
+
+  bool componentCallback( LabelPosition *lp, void *ctx )
+  {
+    LabelPosition *lp2 = (( ComponentContext* ) ctx )->lp;
+    int *component = (( ComponentContext* ) ctx )->component;
+
+    if ( lp2->isInConflict( lp ) )
+    {
+      int c1 = findComponent( component, lp->getProblemFeatureId() );
+      int c2 = findComponent( component, lp2->getProblemFeatureId() );
+      // the smallest feature id is the root, which keeps the components in feature order
+      if ( c1 < c2 )
+        component[c2] = c1;
+      else if ( c2 < c1 )
+        component[c1] = c2;
+    }
+    return true;
+  }
+
+  /* Features of a group solved as a sub problem */
+  typedef struct
+  {
+    Problem *problem;
+    QVector<int> features;
+  } ComponentJob;
+
+  static void solveComponentStatic( ComponentJob& job )
+  {
+    try
+    {
+      job.problem->solve();
+    }
+    catch ( InternalException::Empty )
+    {
+      // features of the group stay unlabeled
+    }
+  }
+
+  int Problem::isolatedFeatureCandidate( int feat ) const
+  {
+    // FALP takes candidates with the same number of overlaps in id order, so all candidates
+    // of a feature without conflicts are tied and the first one is chosen
+    int best = featStartId[feat];
+    if ( pal->searchMethod == FALP )
+      return best;
+
+    // the local searches move the label to the candidate with the lowest cost (the first one if tied)
+    for ( int j = 1; j < featNbLp[feat]; j++ )
+    {
+      if ( mLabelPositions.at( featStartId[feat] + j )->cost() < mLabelPositions.at( best )->cost() )
+        best = featStartId[feat] + j;
+    }
+    return best;
+  }
+
+  void Problem::solveComponents()
+  {
+    int i, j, k;
+    double amin[2];
+    double amax[2];
+
+    // group features whose candidates conflict
+    int *component = new int[nbft];
+    for ( i = 0; i < nbft; i++ )
+      component[i] = i;
+
+    ComponentContext context;
+    context.component = component;
+    for ( i = 0; i < nbft; i++ )
+    {
+      for ( j = 0; j < featNbLp[i]; j++ )
+      {
+        LabelPosition *lp = mLabelPositions.at( featStartId[i] + j );
+        if ( lp->getNumOverlaps() == 0 )
+          continue;
+
+        context.lp = lp;
+        lp->getBoundingBox( amin, amax );
+        candidates->Search( amin, amax, componentCallback, ( void* ) &context );
+      }
+    }
+
+    // the root of a group is its first feature, so groups are created in feature order
+    QList<ComponentJob> jobs;
+    int *jobOf = new int[nbft];
+    for ( i = 0; i < nbft; i++ )
+    {
+      int root = findComponent( component, i );
+      if ( root == i )
+      {
+        jobOf[i] = jobs.count();
+        ComponentJob job;
+        job.problem = 0;
+        jobs.append( job );
+      }
+      jobs[jobOf[root]].features.append( i );
+    }
+    delete[] jobOf;
+    delete[] component;
+
+    QgsLabelingCache *cache = pal->labelingCache();
+    if ( jobs.count() < 2 && !cache )
+    {
+      solve();
+      return;
+    }
+
+    // keys of the features in the labeling cache, features sharing a key (e.g. parts of a feature) are not cached
+    QVector<QString> cacheLayers;
+    QVector<QgsLabelingCache::FeatureKey> cacheKeys;
+    QVector<bool> cacheable;
+    if ( cache )
+    {
+      cacheLayers.resize( nbft );
+      cacheKeys.resize( nbft );
+      cacheable.fill( false, nbft );
+      QHash< QPair<QString, QgsLabelingCache::FeatureKey>, int > featureOfKey;
+      for ( i = 0; i < nbft; i++ )
+      {
+        if ( featNbLp[i] == 0 )
+          continue;
+
+        FeaturePart *part = mLabelPositions.at( featStartId[i] )->getFeaturePart();
+        Layer *layer = part->layer();
+        if ( layer->cacheIndex() < 0 || layer->provider()->layerId().isEmpty() )
+          continue;
+
+        cacheLayers[i] = layer->provider()->layerId();
+        cacheKeys[i] = QgsLabelingCache::FeatureKey( layer->cacheIndex(), part->featureId() );
+        QPair<QString, QgsLabelingCache::FeatureKey> key( cacheLayers.at( i ), cacheKeys.at( i ) );
+        if ( featureOfKey.contains( key ) )
+        {
+          cacheable[featureOfKey.value( key )] = false;
+          continue;
+        }
+        featureOfKey.insert( key, i );
+        cacheable[i] = true;
+      }
+    }
+
+    // isolated features get their best candidate, groups found in the cache get their previous
+    // solution and other groups are solved as sub problems
+    init_sol_empty();
+    QList<ComponentJob> subJobs;
+    for ( k = 0; k < jobs.count(); k++ )
+    {
+      const QVector<int>& features = jobs.at( k ).features;
+      if ( features.count() == 1 )
+      {
+        i = features.at( 0 );
+        if ( featNbLp[i] > 0 )
+          sol->s[i] = isolatedFeatureCandidate( i );
+        continue;
+      }
+
+      if ( cache )
+      {
+        bool cached = true;
+        int group = -1;
+        QVector<int> cachedCandidates( features.count() );
+        for ( i = 0; i < features.count() && cached; i++ )
+        {
+          int feat = features.at( i );
+          QgsLabelingCache::FeatureSolution solution;
+          cached = cacheable.at( feat )
+                   && cache->solution( cacheLayers.at( feat ), cacheKeys.at( feat ), solution )
+                   && ( i == 0 || solution.group == group )
+                   && solution.groupSize == features.count()
+                   && solution.index == i
+                   && solution.candidates == candidatesSignature( feat );
+          group = solution.group;
+          cachedCandidates[i] = solution.candidate;
+        }
+
+        if ( cached )
+        {
+          for ( i = 0; i < features.count(); i++ )
+          {
+            if ( cachedCandidates.at( i ) >= 0 )
+              sol->s[features.at( i )] = featStartId[features.at( i )] + cachedCandidates.at( i );
+          }
+          cache->addReusedSolutions( features.count() );
+          continue;
+        }
+      }
+
+      Problem *sub = new Problem();
+      sub->pal = pal;
+      sub->displayAll = displayAll;
+      for ( i = 0; i < 4; i++ )
+        sub->bbox[i] = bbox[i];
+      sub->nbft = features.count();
+      sub->featStartId = new int[sub->nbft];
+      sub->featNbLp = new int[sub->nbft];
+      sub->inactiveCost = new double[sub->nbft];
+
+      int idlp = 0;
+      for ( i = 0; i < sub->nbft; i++ )
+      {
+        int feat = features.at( i );
+        sub->featStartId[i] = idlp;
+        sub->featNbLp[i] = featNbLp[feat];
+        sub->inactiveCost[i] = inactiveCost[feat];
+        for ( j = 0; j < featNbLp[feat]; j++, idlp++ )
+        {
+          LabelPosition *lp = mLabelPositions.at( featStartId[feat] + j );
+          lp->setProblemIds( i, idlp );
+          sub->mLabelPositions.append( lp );
+          lp->insertIntoIndex( sub->candidates );
+          sub->nbOverlap += lp->getNumOverlaps();
+        }
+      }
+      sub->nblp = sub->all_nblp = idlp;
+      sub->nbOverlap /= 2;
+
+      ComponentJob job = jobs.at( k );
+      job.problem = sub;
+      subJobs.append( job );
+    }
+
+    QtConcurrent::blockingMap( subJobs, solveComponentStatic );
+
+    // solutions of a cancelled run are incomplete and must not be cached
+    bool cancelled = pal->isCancelled();
+
+    // copy the solutions and give the candidates back to this problem
+    Q_FOREACH ( const ComponentJob& job, subJobs )
+    {
+      Problem *sub = job.problem;
+
+      bool store = cache && sub->sol && !cancelled;
+      for ( i = 0; i < sub->nbft && store; i++ )
+        store = cacheable.at( job.features.at( i ) );
+      int group = store ? cache->nextGroup() : -1;
+
+      for ( i = 0; i < sub->nbft; i++ )
+      {
+        int feat = job.features.at( i );
+        int candidate = sub->sol && sub->sol->s[i] != -1 ? sub->sol->s[i] - sub->featStartId[i] : -1;
+        if ( candidate >= 0 )
+          sol->s[feat] = featStartId[feat] + candidate;
+
+        for ( j = 0; j < featNbLp[feat]; j++ )
+          mLabelPositions.at( featStartId[feat] + j )->setProblemIds( feat, featStartId[feat] + j );
+
+        if ( store )
+        {
+          QgsLabelingCache::FeatureSolution solution;
+          solution.candidates = candidatesSignature( feat );
+          solution.group = group;
+          solution.groupSize = sub->nbft;
+          solution.index = i;
+          solution.candidate = candidate;
+          cache->setSolution( cacheLayers.at( feat ), cacheKeys.at( feat ), solution );
+        }
+      }
+      sub->mLabelPositions.clear();
+      delete sub;
+    }
+  }
+
+  QVector<double> Problem::candidatesSignature( int feat ) const
+  {
+    QVector<double> signature;
+    signature << inactiveCost[feat];
+    for ( int j = 0; j < featNbLp[feat]; j++ )
+    {
+      LabelPosition *lp = mLabelPositions.at( featStartId[feat] + j );
+      signature << lp->cost();
+      for ( LabelPosition *part = lp; part; part = part->getNextPart() )
+      {
+        signature << part->getX() << part->getY() << part->getWidth() << part->getHeight() << part->getAlpha();
+      }
+    }
+    return signature;
+  }
+
   void Problem::init_sol_empty()
   {
     int i;
@@ -34,6 +34,7 @@
 #include "rtree.hpp"
 #include <list>
 #include <QList>
+#include <QVector>
 
 namespace pal
 {
@@ -120,6 +121,25 @@ namespace pal
 
       void reduce();
 
+      /**
+       * \brief Searches a solution with the search method of pal
+       * @note added in QGIS 2.12
+       */
+      void solve();
+
+      /**
+       * \brief Searches a solution for each group of features whose candidates conflict
+       * with each other. Groups are solved in parallel, the solution does not depend on
+       * the number of threads.
+       *
+       * With FALP the solution is the same as the one of solve(). The local searches (CHAIN and
+       * POPMUSIC) only move labels within their group, so they may end in a different local optimum
+       * than a search of the whole problem. Features without conflicts get the candidate the search
+       * of the whole problem would give them.
+       * @note added in QGIS 2.12
+       */
+      void solveComponents();
+
       /**
        * \brief popmusic framework
        */
@@ -162,12 +182,24 @@ namespace pal
        * \brief Basic initial solution : every feature to -1
        */
       void init_sol_empty();
+
+      /**
+       * \brief Greedy initial solution (FALP), also the starting point of the other search methods.
+       * Candidates with the same number of overlaps are taken in the order of their ids.
+       * @note since QGIS 2.12 ties are broken by candidate id instead of the layout of the
+       * priority queue, which changes the placement of some labels compared to earlier versions.
+       */
       void init_sol_falp();
 
       static bool compareLabelArea( pal::LabelPosition* l1, pal::LabelPosition* l2 );
 
     private:
 
+      /**
+       * Returns the candidate of a feature whose candidates are not in conflict with other features
+       */
+      int isolatedFeatureCandidate( int feat ) const;
+
       /**
        * How many layers are labelled ?
        */
@@ -230,6 +262,9 @@ namespace pal
 
       Pal *pal;
 
+      //! Geometry and cost of the candidates of a feature, used to compare them with cached ones
+      QVector<double> candidatesSignature( int feat ) const;
+
       void solution_cost();
       void check_solution();
   };
@@ -412,24 +412,84 @@ void QgsCoordinateTransform::transformPolygon( QPolygonF& poly, TransformDirecti
     return;
   }
 
-  //create x, y arrays
   int nVertices = poly.size();
+  if ( nVertices == 0 )
+    return;
+
+  try
+  {
+    if ( sizeof( qreal ) == sizeof( double ) )
+    {
+      // QPolygonF stores interleaved x/y pairs: transform them without splitting them into
+      // separate arrays. A copy is transformed so that the polygon is unchanged if proj4 fails.
+      QPolygonF transformed( poly );
+      double* data = reinterpret_cast<double*>( transformed.data() );
+      transformCoords( nVertices, 2, data, data + 1, 0, direction );
+      poly = transformed;
+      return;
+    }
+
+    //create x, y arrays
+    QVector<double> x( nVertices );
+    QVector<double> y( nVertices );
+
+    for ( int i = 0; i < nVertices; ++i )
+    {
+      const QPointF& pt = poly.at( i );
+      x[i] = pt.x();
+      y[i] = pt.y();
+    }
+
+    transformCoords( nVertices, 1, x.data(), y.data(), 0, direction );
+
+    for ( int i = 0; i < nVertices; ++i )
+    {
+      QPointF& pt = poly[i];
+      pt.rx() = x[i];
+      pt.ry() = y[i];
+    }
+  }
+  catch ( const QgsCsException & )
+  {
+    // rethrow the exception
+    QgsDebugMsg( "rethrowing exception" );
+    throw;
+  }
+}
 
-  QVector<double> x( nVertices );
-  QVector<double> y( nVertices );
-  QVector<double> z( nVertices );
+void QgsCoordinateTransform::transformPolygons( QList<QPolygonF>& polygons, TransformDirection direction ) const
+{
+  if ( mShortCircuit || !mInitialisedFlag )
+    return;
 
-  for ( int i = 0; i < nVertices; ++i )
+  if ( polygons.size() == 1 )
   {
-    const QPointF& pt = poly.at( i );
-    x[i] = pt.x();
-    y[i] = pt.y();
-    z[i] = 0;
+    transformPolygon( polygons[0], direction );
+    return;
+  }
+
+  int nVertices = 0;
+  for ( int i = 0; i < polygons.size(); ++i )
+    nVertices += polygons.at( i ).size();
+  if ( nVertices == 0 )
+    return;
+
+  // gather the vertices of all polygons into one interleaved x/y array
+  QVector<double> xy( nVertices * 2 );
+  double* ptr = xy.data();
+  for ( int i = 0; i < polygons.size(); ++i )
+  {
+    const QPolygonF& poly = polygons.at( i );
+    for ( int j = 0; j < poly.size(); ++j )
+    {
+      *ptr++ = poly.at( j ).x();
+      *ptr++ = poly.at( j ).y();
+    }
   }
 
   try
   {
-    transformCoords( nVertices, x.data(), y.data(), z.data(), direction );
+    transformCoords( nVertices, 2, xy.data(), xy.data() + 1, 0, direction );
   }
   catch ( const QgsCsException & )
   {
@@ -438,11 +498,16 @@ void QgsCoordinateTransform::transformPolygon( QPolygonF& poly, TransformDirecti
     throw;
   }
 
-  for ( int i = 0; i < nVertices; ++i )
+  ptr = xy.data();
+  for ( int i = 0; i < polygons.size(); ++i )
   {
-    QPointF& pt = poly[i];
-    pt.rx() = x[i];
-    pt.ry() = y[i];
+    QPolygonF& poly = polygons[i];
+    QPointF* pt = poly.data();
+    for ( int j = 0; j < poly.size(); ++j, ++pt )
+    {
+      pt->rx() = *ptr++;
+      pt->ry() = *ptr++;
+    }
   }
 }
 
@@ -626,6 +691,11 @@ QgsRectangle QgsCoordinateTransform::transformBoundingBox( const QgsRectangle &r
 }
 
 void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, double *y, double *z, TransformDirection direction ) const
+{
+  transformCoords( numPoints, 1, x, y, z, direction );
+}
+
+void QgsCoordinateTransform::transformCoords( int numPoints, int pointOffset, double *x, double *y, double *z, TransformDirection direction ) const
 {
   // Refuse to transform the points if the srs's are invalid
   if ( !mSourceCRS.isValid() )
@@ -655,24 +725,25 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
   if (( pj_is_latlong( mDestinationProjection ) && ( direction == ReverseTransform ) )
       || ( pj_is_latlong( mSourceProjection ) && ( direction == ForwardTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= DEG_TO_RAD;
       y[i] *= DEG_TO_RAD;
-      z[i] *= DEG_TO_RAD;
+      if ( z )
+        z[i] *= DEG_TO_RAD;
     }
 
   }
   int projResult;
   if ( direction == ReverseTransform )
   {
-    projResult = pj_transform( mDestinationProjection, mSourceProjection, numPoints, 0, x, y, z );
+    projResult = pj_transform( mDestinationProjection, mSourceProjection, numPoints, pointOffset, x, y, z );
   }
   else
   {
     Q_ASSERT( mSourceProjection != 0 );
     Q_ASSERT( mDestinationProjection != 0 );
-    projResult = pj_transform( mSourceProjection, mDestinationProjection, numPoints, 0, x, y, z );
+    projResult = pj_transform( mSourceProjection, mDestinationProjection, numPoints, pointOffset, x, y, z );
   }
 
   if ( projResult != 0 )
@@ -680,7 +751,7 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
     //something bad happened....
     QString points;
 
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       if ( direction == ForwardTransform )
       {
@@ -723,11 +794,12 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
   if (( pj_is_latlong( mDestinationProjection ) && ( direction == ForwardTransform ) )
       || ( pj_is_latlong( mSourceProjection ) && ( direction == ReverseTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= RAD_TO_DEG;
       y[i] *= RAD_TO_DEG;
-      z[i] *= RAD_TO_DEG;
+      if ( z )
+        z[i] *= RAD_TO_DEG;
     }
   }
 #ifdef COORDINATE_TRANSFORM_VERBOSE
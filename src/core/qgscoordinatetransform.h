@@ -18,6 +18,7 @@
 #define QGSCOORDINATETRANSFORM_H
 
 //qt includes
+#include <QList>
 #include <QObject>
 
 //qgis includes
@@ -171,6 +172,16 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
 
     void transformPolygon( QPolygonF& poly, TransformDirection direction = ForwardTransform ) const;
 
+    /** Transforms a list of polygons (e.g. the rings of a polygon) in a single batch.
+     * The vertices of all polygons are passed to proj4 as one array, which is much faster
+     * than transforming the polygons one by one.
+     * @param polygons polygons to transform in place
+     * @param direction TransformDirection (defaults to ForwardTransform)
+     * @note added in QGIS 2.12
+     * @note not available in python bindings
+     */
+    void transformPolygons( QList<QPolygonF>& polygons, TransformDirection direction = ForwardTransform ) const;
+
     /** Transform a QgsRectangle to the dest Coordinate system
      * If the direction is ForwardTransform then coordinates are transformed from layer CS --> map canvas CS,
      * otherwise points are transformed from map canvas CS to layerCS.
@@ -186,7 +197,7 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
      * @param numPoint number of coordinates in arrays
      * @param x array of x coordinates to transform
      * @param y array of y coordinates to transform
-     * @param z array of z coordinates to transform
+     * @param z array of z coordinates to transform (may be null since QGIS 2.12)
      * @param direction TransformDirection (defaults to ForwardTransform)
      * @return QgsRectangle in Destination Coordinate System
      */
@@ -285,6 +296,11 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
     int mSourceDatumTransform;
     int mDestinationDatumTransform;
 
+    /** Transforms coordinates stored with a stride of pointOffset values (e.g. interleaved x/y pairs)
+     * @note z may be null
+     */
+    void transformCoords( int numPoints, int pointOffset, double *x, double *y, double *z, TransformDirection direction ) const;
+
     /*!
      * Finder for PROJ grid files.
      */
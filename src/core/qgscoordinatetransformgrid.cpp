@@ -0,0 +1,258 @@
+/***************************************************************************
+  qgscoordinatetransformgrid.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscoordinatetransformgrid.h"
+
+#include "qgscoordinatetransform.h"
+#include "qgslogger.h"
+
+//! number of grid points in each direction the refinement starts with
+static const int INITIAL_GRID_SIZE = 3;
+
+QgsCoordinateTransformGrid::QgsCoordinateTransformGrid( const QgsCoordinateTransform* ct, const QgsRectangle& extent, double tolerance, int maxSize )
+    : mCt( ct )
+    , mExtent( extent )
+    , mValid( false )
+    , mRows( 0 )
+    , mCols( 0 )
+    , mCellWidth( 0 )
+    , mCellHeight( 0 )
+{
+  if ( !mCt || !mCt->isInitialised() || mExtent.isEmpty() || tolerance <= 0 )
+    return;
+
+  if ( !qIsFinite( mExtent.width() ) || !qIsFinite( mExtent.height() ) )
+    return;
+
+  int rows = INITIAL_GRID_SIZE;
+  int cols = INITIAL_GRID_SIZE;
+  while ( rows <= maxSize && cols <= maxSize )
+  {
+    if ( !calculateGrid( rows, cols ) )
+      return;
+
+    double colsError, rowsError, centerError;
+    if ( !calculateError( colsError, rowsError, centerError ) )
+      return;
+
+    bool refineCols = colsError > tolerance;
+    bool refineRows = rowsError > tolerance;
+    if ( !refineCols && !refineRows )
+    {
+      if ( centerError <= tolerance )
+      {
+        mValid = true;
+        QgsDebugMsgLevel( QString( "transform grid %1 x %2" ).arg( mCols ).arg( mRows ), 4 );
+        return;
+      }
+      refineCols = refineRows = true;
+    }
+
+    // halve the cells in the directions that are not precise enough
+    if ( refineCols )
+      cols = 2 * cols - 1;
+    if ( refineRows )
+      rows = 2 * rows - 1;
+  }
+
+  QgsDebugMsgLevel( "transform can not be approximated by a grid with the requested tolerance", 4 );
+}
+
+bool QgsCoordinateTransformGrid::calculateGrid( int rows, int cols )
+{
+  mRows = rows;
+  mCols = cols;
+  mCellWidth = mExtent.width() / ( cols - 1 );
+  mCellHeight = mExtent.height() / ( rows - 1 );
+
+  int count = rows * cols;
+  mX.resize( count );
+  mY.resize( count );
+  for ( int r = 0; r < rows; ++r )
+  {
+    for ( int c = 0; c < cols; ++c )
+    {
+      mX[r * cols + c] = mExtent.xMinimum() + c * mCellWidth;
+      mY[r * cols + c] = mExtent.yMinimum() + r * mCellHeight;
+    }
+  }
+
+  try
+  {
+    mCt->transformCoords( count, mX.data(), mY.data(), 0 );
+  }
+  catch ( QgsCsException & )
+  {
+    return false;
+  }
+
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( !qIsFinite( mX[i] ) || !qIsFinite( mY[i] ) )
+      return false;
+  }
+  return true;
+}
+
+bool QgsCoordinateTransformGrid::calculateError( double& colsError, double& rowsError, double& centerError ) const
+{
+  // midpoints of horizontal edges, then vertical edges, then cell centers
+  int nHorizontal = mRows * ( mCols - 1 );
+  int nVertical = ( mRows - 1 ) * mCols;
+  int nCenter = ( mRows - 1 ) * ( mCols - 1 );
+  int count = nHorizontal + nVertical + nCenter;
+
+  QVector<double> x( count ), y( count );
+  int i = 0;
+  for ( int r = 0; r < mRows; ++r )
+  {
+    for ( int c = 0; c < mCols - 1; ++c, ++i )
+    {
+      x[i] = mExtent.xMinimum() + ( c + 0.5 ) * mCellWidth;
+      y[i] = mExtent.yMinimum() + r * mCellHeight;
+    }
+  }
+  for ( int r = 0; r < mRows - 1; ++r )
+  {
+    for ( int c = 0; c < mCols; ++c, ++i )
+    {
+      x[i] = mExtent.xMinimum() + c * mCellWidth;
+      y[i] = mExtent.yMinimum() + ( r + 0.5 ) * mCellHeight;
+    }
+  }
+  for ( int r = 0; r < mRows - 1; ++r )
+  {
+    for ( int c = 0; c < mCols - 1; ++c, ++i )
+    {
+      x[i] = mExtent.xMinimum() + ( c + 0.5 ) * mCellWidth;
+      y[i] = mExtent.yMinimum() + ( r + 0.5 ) * mCellHeight;
+    }
+  }
+
+  QVector<double> exactX = x, exactY = y;
+  try
+  {
+    mCt->transformCoords( count, exactX.data(), exactY.data(), 0 );
+  }
+  catch ( QgsCsException & )
+  {
+    return false;
+  }
+
+  colsError = rowsError = centerError = 0;
+  for ( i = 0; i < count; ++i )
+  {
+    if ( !qIsFinite( exactX[i] ) || !qIsFinite( exactY[i] ) )
+      return false;
+
+    interpolate( x[i], y[i] );
+    double error = qMax( qAbs( x[i] - exactX[i] ), qAbs( y[i] - exactY[i] ) );
+    double& maxError = i < nHorizontal ? colsError : ( i < nHorizontal + nVertical ? rowsError : centerError );
+    maxError = qMax( maxError, error );
+  }
+  return true;
+}
+
+inline void QgsCoordinateTransformGrid::interpolate( double& x, double& y ) const
+{
+  double fx = ( x - mExtent.xMinimum() ) / mCellWidth;
+  double fy = ( y - mExtent.yMinimum() ) / mCellHeight;
+  int c = qBound( 0, ( int ) fx, mCols - 2 );
+  int r = qBound( 0, ( int ) fy, mRows - 2 );
+  fx -= c;
+  fy -= r;
+
+  int i = r * mCols + c;
+  const double* gx = mX.constData();
+  const double* gy = mY.constData();
+  x = ( gx[i] * ( 1 - fx ) + gx[i + 1] * fx ) * ( 1 - fy ) + ( gx[i + mCols] * ( 1 - fx ) + gx[i + mCols + 1] * fx ) * fy;
+  y = ( gy[i] * ( 1 - fx ) + gy[i + 1] * fx ) * ( 1 - fy ) + ( gy[i + mCols] * ( 1 - fx ) + gy[i + mCols + 1] * fx ) * fy;
+}
+
+void QgsCoordinateTransformGrid::interpolatePoints( QPointF* points, int count, QVector<QPointF*>& outside ) const
+{
+  double xMin = mExtent.xMinimum(), xMax = mExtent.xMaximum();
+  double yMin = mExtent.yMinimum(), yMax = mExtent.yMaximum();
+  for ( int i = 0; i < count; ++i, ++points )
+  {
+    double x = points->x();
+    double y = points->y();
+    if ( x < xMin || x > xMax || y < yMin || y > yMax )
+    {
+      outside.append( points );
+      continue;
+    }
+    interpolate( x, y );
+    points->rx() = x;
+    points->ry() = y;
+  }
+}
+
+void QgsCoordinateTransformGrid::transformExact( const QVector<QPointF*>& outside ) const
+{
+  int count = outside.size();
+  if ( count == 0 )
+    return;
+
+  QVector<double> x( count ), y( count );
+  for ( int i = 0; i < count; ++i )
+  {
+    x[i] = outside[i]->x();
+    y[i] = outside[i]->y();
+  }
+
+  mCt->transformCoords( count, x.data(), y.data(), 0 );
+
+  for ( int i = 0; i < count; ++i )
+  {
+    outside[i]->rx() = x[i];
+    outside[i]->ry() = y[i];
+  }
+}
+
+void QgsCoordinateTransformGrid::transformInPlace( double& x, double& y ) const
+{
+  if ( mExtent.contains( QgsPoint( x, y ) ) )
+  {
+    interpolate( x, y );
+    return;
+  }
+
+  double z = 0;
+  mCt->transformInPlace( x, y, z );
+}
+
+void QgsCoordinateTransformGrid::transformPolygon( QPolygonF& poly ) const
+{
+  // work on a copy, so that the polygon is unchanged if the exact transform fails
+  QPolygonF transformed( poly );
+  QVector<QPointF*> outside;
+  interpolatePoints( transformed.data(), transformed.size(), outside );
+  transformExact( outside );
+  poly = transformed;
+}
+
+void QgsCoordinateTransformGrid::transformPolygons( QList<QPolygonF>& polygons ) const
+{
+  QList<QPolygonF> transformed( polygons );
+  QVector<QPointF*> outside;
+  for ( int i = 0; i < transformed.size(); ++i )
+  {
+    QPolygonF& poly = transformed[i];
+    interpolatePoints( poly.data(), poly.size(), outside );
+  }
+  transformExact( outside );
+  polygons = transformed;
+}
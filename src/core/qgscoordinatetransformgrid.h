@@ -0,0 +1,111 @@
+/***************************************************************************
+  qgscoordinatetransformgrid.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCOORDINATETRANSFORMGRID_H
+#define QGSCOORDINATETRANSFORMGRID_H
+
+#include <QPolygonF>
+#include <QVector>
+
+#include "qgsrectangle.h"
+
+class QgsCoordinateTransform;
+
+/**
+ * Approximates a forward coordinate transform within an extent by bilinear interpolation
+ * in a regular grid of exactly transformed points.
+ *
+ * The grid is refined (similarly to QgsRasterProjector) until the interpolation error at the
+ * midpoints of the grid cells is below the given tolerance (in destination units, usually
+ * a fraction of a map pixel). Points outside the extent of the grid are transformed exactly.
+ * If the required precision can not be reached with the maximum grid size (e.g. because
+ * the extent crosses a discontinuity of the destination projection), the grid is not valid
+ * and must not be used.
+ *
+ * Once constructed, the grid is read only and may be used from several threads at once.
+ *
+ * @note added in QGIS 2.12
+ */
+class CORE_EXPORT QgsCoordinateTransformGrid
+{
+  public:
+    /** Constructor
+     * @param ct coordinate transform to approximate. Must exist as long as the grid is used
+     * @param extent extent of the grid in source coordinates
+     * @param tolerance maximum interpolation error in destination units
+     * @param maxSize maximum number of grid points in each direction
+     */
+    QgsCoordinateTransformGrid( const QgsCoordinateTransform* ct, const QgsRectangle& extent, double tolerance, int maxSize = 129 );
+
+    //! Returns whether the grid approximates the transform with the requested tolerance
+    bool isValid() const { return mValid; }
+
+    //! Returns the transform approximated by the grid
+    const QgsCoordinateTransform* coordinateTransform() const { return mCt; }
+
+    //! Returns the extent of the grid in source coordinates
+    QgsRectangle extent() const { return mExtent; }
+
+    //! Returns the number of grid points in vertical direction
+    int rows() const { return mRows; }
+
+    //! Returns the number of grid points in horizontal direction
+    int cols() const { return mCols; }
+
+    /** Transforms a point. Throws QgsCsException if an exact transform is needed and fails */
+    void transformInPlace( double& x, double& y ) const;
+
+    /** Transforms vertices of a polygon in place.
+     * Vertices outside the grid are transformed exactly in a single batch.
+     * Throws QgsCsException if the exact transform fails.
+     */
+    void transformPolygon( QPolygonF& poly ) const;
+
+    /** Transforms a list of polygons (e.g. rings of a polygon) in place.
+     * Throws QgsCsException if the exact transform fails.
+     */
+    void transformPolygons( QList<QPolygonF>& polygons ) const;
+
+  private:
+    //! Calculates the grid points with the given number of rows and columns, returns false on failure
+    bool calculateGrid( int rows, int cols );
+
+    /** Returns the largest interpolation error at midpoints of horizontal cell edges (colsError),
+     * vertical cell edges (rowsError) and cell centers (centerError). Returns false on failure
+     */
+    bool calculateError( double& colsError, double& rowsError, double& centerError ) const;
+
+    //! Interpolates a point, which must be inside the extent
+    inline void interpolate( double& x, double& y ) const;
+
+    //! Interpolates points inside the extent and appends the other ones to outside
+    void interpolatePoints( QPointF* points, int count, QVector<QPointF*>& outside ) const;
+
+    //! Transforms points outside of the grid exactly in a single batch
+    void transformExact( const QVector<QPointF*>& outside ) const;
+
+    const QgsCoordinateTransform* mCt;
+    QgsRectangle mExtent;
+    bool mValid;
+    int mRows;
+    int mCols;
+    double mCellWidth;
+    double mCellHeight;
+    //! transformed grid points, stored row by row starting at the bottom left corner
+    QVector<double> mX;
+    QVector<double> mY;
+};
+
+#endif // QGSCOORDINATETRANSFORMGRID_H
@@ -36,6 +36,7 @@
 #include "qgsvectorcolorrampv2.h"
 #include "qgsstylev2.h"
 #include "qgsexpressioncontext.h"
+#include "qgsexpressionprogram.h"
 #include "qgsproject.h"
 #include "qgsstringutils.h"
 #include "qgsgeometrycollectionv2.h"
@@ -2470,6 +2471,8 @@ QgsExpression::QgsExpression( const QString& expr )
     , mScale( 0 )
     , mExp( expr )
     , mCalc( 0 )
+    , mProgram( 0 )
+    , mCompilationEnabled( true )
 {
   mRootNode = ::parseExpression( expr, mParserErrorString );
 
@@ -2479,6 +2482,7 @@ QgsExpression::QgsExpression( const QString& expr )
 
 QgsExpression::~QgsExpression()
 {
+  delete mProgram;
   delete mCalc;
   delete mRootNode;
 }
@@ -2553,7 +2557,23 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
     return false;
   }
 
-  return mRootNode->prepare( this, context );
+  delete mProgram;
+  mProgram = 0;
+
+  bool res = mRootNode->prepare( this, context );
+  if ( res && mCompilationEnabled )
+    mProgram = QgsExpressionProgram::compile( this, mRootNode );
+  return res;
+}
+
+void QgsExpression::setCompilationEnabled( bool enabled )
+{
+  mCompilationEnabled = enabled;
+  if ( !enabled )
+  {
+    delete mProgram;
+    mProgram = 0;
+  }
 }
 
 QVariant QgsExpression::evaluate( const QgsFeature* f )
@@ -2566,6 +2586,8 @@ QVariant QgsExpression::evaluate( const QgsFeature* f )
   }
 
   QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f ? *f : QgsFeature(), QgsFields() );
+  if ( mProgram )
+    return mProgram->run( this, &context );
   return mRootNode->eval( this, &context );
 }
 
@@ -2604,6 +2626,8 @@ QVariant QgsExpression::evaluate()
     return QVariant();
   }
 
+  if ( mProgram )
+    return mProgram->run( this, 0 );
   return mRootNode->eval( this, ( QgsExpressionContext* )0 );
 }
 
@@ -2616,6 +2640,8 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
     return QVariant();
   }
 
+  if ( mProgram )
+    return mProgram->run( this, context );
   return mRootNode->eval( this, context );
 }
 
@@ -2765,6 +2791,11 @@ QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression *parent, const Qg
   QVariant val = mOperand->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperand( parent, val );
+}
+
+QVariant QgsExpression::NodeUnaryOperator::evalOperand( QgsExpression *parent, const QVariant& val )
+{
   switch ( mOp )
   {
     case uoNot:
@@ -2807,6 +2838,11 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression *parent, const Q
   QVariant vR = mOpRight->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperands( parent, vL, vR );
+}
+
+QVariant QgsExpression::NodeBinaryOperator::evalOperands( QgsExpression *parent, const QVariant& vL, const QVariant& vR )
+{
   switch ( mOp )
   {
     case boPlus:
@@ -35,6 +35,7 @@ class QgsFields;
 class QgsDistanceArea;
 class QDomElement;
 class QgsExpressionContext;
+class QgsExpressionProgram;
 
 /**
 Class for parsing and evaluation of expressions (formerly called "search strings").
@@ -115,6 +116,28 @@ class CORE_EXPORT QgsExpression
      */
     bool prepare( const QgsExpressionContext *context );
 
+    /** Sets whether prepare() should compile the expression into a flat instruction stream.
+     * The compiled program is then used by evaluate() instead of walking the expression tree,
+     * which is considerably faster for numeric and logical expressions. Compilation is enabled by default.
+     * @see compilationEnabled()
+     * @see isCompiled()
+     * @note added in QGIS 2.12
+     */
+    void setCompilationEnabled( bool enabled );
+
+    /** Returns whether prepare() compiles the expression.
+     * @see setCompilationEnabled()
+     * @note added in QGIS 2.12
+     */
+    bool compilationEnabled() const { return mCompilationEnabled; }
+
+    /** Returns true if the expression has been compiled by the last call to prepare()
+     * and evaluation uses the compiled program.
+     * @see setCompilationEnabled()
+     * @note added in QGIS 2.12
+     */
+    bool isCompiled() const { return mProgram != 0; }
+
     /**
      * Get list of columns referenced by the expression.
      * @note if the returned list contains the QgsFeatureRequest::AllAttributes constant then
@@ -713,8 +736,13 @@ class CORE_EXPORT QgsExpression
         virtual void accept( Visitor& v ) const override { v.visit( *this ); }
 
       protected:
+        //! applies the operator on already evaluated operand
+        QVariant evalOperand( QgsExpression* parent, const QVariant& val );
+
         UnaryOperator mOp;
         Node* mOperand;
+
+        friend class QgsExpressionProgram;
     };
 
     class CORE_EXPORT NodeBinaryOperator : public Node
@@ -740,6 +768,9 @@ class CORE_EXPORT QgsExpression
         bool leftAssociative() const;
 
       protected:
+        //! applies the operator on already evaluated operands
+        QVariant evalOperands( QgsExpression* parent, const QVariant& vL, const QVariant& vR );
+
         bool compare( double diff );
         int computeInt( int x, int y );
         double computeDouble( double x, double y );
@@ -748,6 +779,8 @@ class CORE_EXPORT QgsExpression
         BinaryOperator mOp;
         Node* mOpLeft;
         Node* mOpRight;
+
+        friend class QgsExpressionProgram;
     };
 
     class CORE_EXPORT NodeInOperator : public Node
@@ -844,6 +877,8 @@ class CORE_EXPORT QgsExpression
       protected:
         QString mName;
         int mIndex;
+
+        friend class QgsExpressionProgram;
     };
 
     class CORE_EXPORT WhenThen
@@ -922,7 +957,7 @@ class CORE_EXPORT QgsExpression
     /**
      * Used by QgsOgcUtils to create an empty
      */
-    QgsExpression() : mRootNode( 0 ), mRowNumber( 0 ), mScale( 0.0 ), mCalc( 0 ) {}
+    QgsExpression() : mRootNode( 0 ), mRowNumber( 0 ), mScale( 0.0 ), mCalc( 0 ), mProgram( 0 ), mCompilationEnabled( true ) {}
 
     void initGeomCalculator();
 
@@ -937,6 +972,10 @@ class CORE_EXPORT QgsExpression
 
     QgsDistanceArea *mCalc;
 
+    //! compiled form of the expression (may be null)
+    QgsExpressionProgram* mProgram;
+    bool mCompilationEnabled;
+
     static QMap<QString, QVariant> gmSpecialColumns;
     static QMap<QString, QString> gmSpecialColumnGroups;
 
@@ -0,0 +1,423 @@
+/***************************************************************************
+  qgsexpressionprogram.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionprogram.h"
+
+#include "qgsexpressioncontext.h"
+#include "qgsfeature.h"
+#include "qgslogger.h"
+
+#include <qmath.h>
+#include <math.h>
+
+
+void QgsExpressionProgram::Value::setDouble( double x )
+{
+  // the tree walker refuses to convert NaN / infinity - let it handle them
+  if ( qIsFinite( x ) && !qIsNaN( x ) )
+  {
+    type = Double;
+    d = x;
+  }
+  else
+  {
+    type = Variant;
+    v = QVariant( x );
+  }
+}
+
+void QgsExpressionProgram::Value::setVariant( const QVariant& x )
+{
+  if ( !x.isNull() )
+  {
+    if ( x.type() == QVariant::Int )
+    {
+      setInt( x.toInt() );
+      return;
+    }
+    else if ( x.type() == QVariant::Double )
+    {
+      double val = x.toDouble();
+      if ( qIsFinite( val ) && !qIsNaN( val ) )
+      {
+        type = Double;
+        d = val;
+        return;
+      }
+    }
+  }
+  type = Variant;
+  v = x;
+}
+
+QVariant QgsExpressionProgram::Value::toVariant() const
+{
+  switch ( type )
+  {
+    case Int: return QVariant( i );
+    case Double: return QVariant( d );
+    case Variant:
+    default:
+      return v;
+  }
+}
+
+
+QgsExpressionProgram* QgsExpressionProgram::compile( QgsExpression* parent, QgsExpression::Node* rootNode )
+{
+  if ( !rootNode )
+    return 0;
+
+  QgsExpressionProgram* program = new QgsExpressionProgram();
+  if ( !program->compileNode( parent, rootNode, 0 ) )
+  {
+    delete program;
+    return 0;
+  }
+
+  QgsDebugMsgLevel( "Compiled expression " + rootNode->dump() + ":\n" + program->dump(), 4 );
+  return program;
+}
+
+bool QgsExpressionProgram::isConstant( const QgsExpression::Node* node )
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+      return true;
+
+    case QgsExpression::ntUnaryOperator:
+      return isConstant( static_cast<const QgsExpression::NodeUnaryOperator*>( node )->operand() );
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      const QgsExpression::NodeBinaryOperator* n = static_cast<const QgsExpression::NodeBinaryOperator*>( node );
+      return isConstant( n->opLeft() ) && isConstant( n->opRight() );
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      const QgsExpression::NodeInOperator* n = static_cast<const QgsExpression::NodeInOperator*>( node );
+      if ( !isConstant( n->node() ) )
+        return false;
+      Q_FOREACH ( QgsExpression::Node* item, n->list()->list() )
+      {
+        if ( !isConstant( item ) )
+          return false;
+      }
+      return true;
+    }
+
+    // functions may depend on context or be non-deterministic (rand, now, ...)
+    case QgsExpression::ntFunction:
+    case QgsExpression::ntColumnRef:
+    case QgsExpression::ntCondition:
+    default:
+      return false;
+  }
+}
+
+void QgsExpressionProgram::addConstant( const QVariant& value )
+{
+  Value c;
+  c.setVariant( value );
+  mConstants.append( c );
+  mCode.append( Instruction( OpConstant, mConstants.count() - 1 ) );
+}
+
+bool QgsExpressionProgram::compileNode( QgsExpression* parent, QgsExpression::Node* node, int depth )
+{
+  if ( !node )
+    return false;
+
+  if ( mStack.count() <= depth )
+    mStack.resize( depth + 1 );
+
+  // constant folding - evaluate the subtree once now
+  if ( node->nodeType() != QgsExpression::ntLiteral && !parent->hasEvalError() && isConstant( node ) )
+  {
+    QVariant value = node->eval( parent, ( QgsExpressionContext* ) 0 );
+    if ( !parent->hasEvalError() )
+    {
+      addConstant( value );
+      return true;
+    }
+    // leave the error to be reported on evaluation
+    parent->setEvalErrorString( QString() );
+  }
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+      addConstant( static_cast<QgsExpression::NodeLiteral*>( node )->value() );
+      return true;
+
+    case QgsExpression::ntColumnRef:
+      mUsesFeature = true;
+      mCode.append( Instruction( OpColumn, static_cast<QgsExpression::NodeColumnRef*>( node )->mIndex, node ) );
+      return true;
+
+    case QgsExpression::ntUnaryOperator:
+    {
+      QgsExpression::NodeUnaryOperator* n = static_cast<QgsExpression::NodeUnaryOperator*>( node );
+      if ( !compileNode( parent, n->operand(), depth ) )
+        return false;
+      mCode.append( Instruction( OpUnary, n->op(), node ) );
+      return true;
+    }
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      QgsExpression::NodeBinaryOperator* n = static_cast<QgsExpression::NodeBinaryOperator*>( node );
+      if ( !compileNode( parent, n->opLeft(), depth ) || !compileNode( parent, n->opRight(), depth + 1 ) )
+        return false;
+      mCode.append( Instruction( OpBinary, n->op(), node ) );
+      return true;
+    }
+
+    case QgsExpression::ntInOperator:
+    case QgsExpression::ntFunction:
+    case QgsExpression::ntCondition:
+    default:
+      mCode.append( Instruction( OpEvalNode, 0, node ) );
+      return true;
+  }
+}
+
+
+QVariant QgsExpressionProgram::run( QgsExpression* parent, const QgsExpressionContext* context )
+{
+  QgsFeature feature;
+  bool hasFeature = false;
+  if ( mUsesFeature && context && context->hasVariable( QgsExpressionContext::EXPR_FEATURE ) )
+  {
+    feature = context->feature();
+    hasFeature = true;
+  }
+
+  Value* stack = mStack.data();
+  int top = -1;
+
+  const Instruction* ins = mCode.constData();
+  const Instruction* end = ins + mCode.count();
+  for ( ; ins != end; ++ins )
+  {
+    switch ( ins->op )
+    {
+      case OpConstant:
+      {
+        const Value& c = mConstants.at( ins->arg );
+        Value& val = stack[++top];
+        val.type = c.type;
+        if ( c.type == Value::Int )
+          val.i = c.i;
+        else if ( c.type == Value::Double )
+          val.d = c.d;
+        else
+          val.v = c.v;
+        break;
+      }
+
+      case OpColumn:
+      {
+        if ( !hasFeature )
+          stack[++top].setVariant( QVariant( "[" + static_cast<QgsExpression::NodeColumnRef*>( ins->node )->name() + "]" ) );
+        else if ( ins->arg >= 0 )
+          stack[++top].setVariant( feature.attribute( ins->arg ) );
+        else
+          stack[++top].setVariant( feature.attribute( static_cast<QgsExpression::NodeColumnRef*>( ins->node )->name() ) );
+        break;
+      }
+
+      case OpEvalNode:
+      {
+        QVariant res = ins->node->eval( parent, context );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        stack[++top].setVariant( res );
+        break;
+      }
+
+      case OpUnary:
+        if ( !evalUnary( parent, *ins, stack[top] ) )
+          return QVariant();
+        break;
+
+      case OpBinary:
+        --top;
+        if ( !evalBinary( parent, *ins, stack[top], stack[top + 1] ) )
+          return QVariant();
+        break;
+    }
+  }
+
+  Q_ASSERT( top == 0 );
+  return stack[0].toVariant();
+}
+
+
+bool QgsExpressionProgram::evalUnary( QgsExpression* parent, const Instruction& ins, Value& val )
+{
+  if ( val.type != Value::Variant )
+  {
+    switch ( ins.arg )
+    {
+      case QgsExpression::uoNot:
+      {
+        bool truth = val.type == Value::Int ? val.i != 0 : val.d != 0;
+        val.setInt( truth ? 0 : 1 );
+        return true;
+      }
+
+      case QgsExpression::uoMinus:
+        if ( val.type == Value::Int )
+          val.i = -val.i;
+        else
+          val.d = -val.d;
+        return true;
+
+      default:
+        break;
+    }
+  }
+
+  val.setVariant( static_cast<QgsExpression::NodeUnaryOperator*>( ins.node )->evalOperand( parent, val.toVariant() ) );
+  return !parent->hasEvalError();
+}
+
+
+bool QgsExpressionProgram::evalBinary( QgsExpression* parent, const Instruction& ins, Value& vL, const Value& vR )
+{
+  if ( vL.type != Value::Variant && vR.type != Value::Variant )
+  {
+    bool bothInt = vL.type == Value::Int && vR.type == Value::Int;
+    double fL = vL.type == Value::Int ? vL.i : vL.d;
+    double fR = vR.type == Value::Int ? vR.i : vR.d;
+
+    switch ( ins.arg )
+    {
+      case QgsExpression::boPlus:
+      case QgsExpression::boMinus:
+      case QgsExpression::boMul:
+      case QgsExpression::boDiv:
+      case QgsExpression::boMod:
+        if ( ins.arg != QgsExpression::boDiv && bothInt )
+        {
+          // both are integers - let's use integer arithmetics
+          int iL = vL.i, iR = vR.i;
+          switch ( ins.arg )
+          {
+            case QgsExpression::boPlus: vL.setInt( iL + iR ); break;
+            case QgsExpression::boMinus: vL.setInt( iL - iR ); break;
+            case QgsExpression::boMul: vL.setInt( iL * iR ); break;
+            default:
+              if ( iR == 0 )
+                vL.setVariant( QVariant() );
+              else
+                vL.setInt( iL % iR );
+              break;
+          }
+        }
+        else if (( ins.arg == QgsExpression::boDiv || ins.arg == QgsExpression::boMod ) && fR == 0. )
+        {
+          vL.setVariant( QVariant() ); // silently handle division by zero and return NULL
+        }
+        else
+        {
+          switch ( ins.arg )
+          {
+            case QgsExpression::boPlus: vL.setDouble( fL + fR ); break;
+            case QgsExpression::boMinus: vL.setDouble( fL - fR ); break;
+            case QgsExpression::boMul: vL.setDouble( fL * fR ); break;
+            case QgsExpression::boDiv: vL.setDouble( fL / fR ); break;
+            default: vL.setDouble( fmod( fL, fR ) ); break;
+          }
+        }
+        return true;
+
+      case QgsExpression::boIntDiv:
+        if ( fR == 0. )
+          vL.setVariant( QVariant() );
+        else
+          vL.setInt( qFloor( fL / fR ) );
+        return true;
+
+      case QgsExpression::boPow:
+        vL.setDouble( pow( fL, fR ) );
+        return true;
+
+      case QgsExpression::boAnd:
+        vL.setInt( fL != 0 && fR != 0 ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boOr:
+        vL.setInt( fL != 0 || fR != 0 ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boEQ:
+      case QgsExpression::boNE:
+      case QgsExpression::boLT:
+      case QgsExpression::boGT:
+      case QgsExpression::boLE:
+      case QgsExpression::boGE:
+        vL.setInt( static_cast<QgsExpression::NodeBinaryOperator*>( ins.node )->compare( fL - fR ) ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boIs:
+        vL.setInt( fL == fR ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boIsNot:
+        vL.setInt( fL == fR ? 0 : 1 );
+        return true;
+
+      default:
+        // string operators
+        break;
+    }
+  }
+
+  vL.setVariant( static_cast<QgsExpression::NodeBinaryOperator*>( ins.node )->evalOperands( parent, vL.toVariant(), vR.toVariant() ) );
+  return !parent->hasEvalError();
+}
+
+
+QString QgsExpressionProgram::dump() const
+{
+  QString msg;
+  for ( int i = 0; i < mCode.count(); ++i )
+  {
+    const Instruction& ins = mCode.at( i );
+    switch ( ins.op )
+    {
+      case OpConstant:
+        msg += QString( "%1: CONST %2\n" ).arg( i ).arg( mConstants.at( ins.arg ).toVariant().toString() );
+        break;
+      case OpColumn:
+        msg += QString( "%1: COLUMN %2\n" ).arg( i ).arg( ins.arg );
+        break;
+      case OpEvalNode:
+        msg += QString( "%1: EVAL %2\n" ).arg( i ).arg( ins.node->dump() );
+        break;
+      case OpUnary:
+        msg += QString( "%1: UNARY %2\n" ).arg( i ).arg( QgsExpression::UnaryOperatorText[ins.arg] );
+        break;
+      case OpBinary:
+        msg += QString( "%1: BINARY %2\n" ).arg( i ).arg( QgsExpression::BinaryOperatorText[ins.arg] );
+        break;
+    }
+  }
+  return msg;
+}
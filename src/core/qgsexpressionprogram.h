@@ -0,0 +1,120 @@
+/***************************************************************************
+  qgsexpressionprogram.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONPROGRAM_H
+#define QGSEXPRESSIONPROGRAM_H
+
+#include <QVariant>
+#include <QVector>
+
+#include "qgsexpression.h"
+
+class QgsExpressionContext;
+
+/**
+ * Flat instruction stream compiled from a prepared QgsExpression tree.
+ *
+ * The program is a stack machine. Integer and double values are kept unboxed on the
+ * stack, so arithmetic, comparisons and logical operators on numbers do not create
+ * QVariant temporaries. Any other value (strings, dates, NULLs, ...) is kept as
+ * QVariant and handled by the operator implementation of the tree nodes, so results
+ * are identical to evaluation of the tree.
+ *
+ * Compilation does:
+ * - constant folding of subtrees that consist only of literals and operators
+ * - resolution of column references to attribute indexes (fetched once per feature)
+ * - fallback to tree evaluation for function calls, IN, CASE, LIKE and concatenation
+ *
+ * @note not part of public API
+ * @note added in QGIS 2.12
+ */
+class CORE_EXPORT QgsExpressionProgram
+{
+  public:
+
+    /** Compiles expression tree. The tree must have been prepared already.
+     * Returns null if the tree can not be compiled.
+     * The program keeps pointers to nodes of the tree, so it must not outlive the expression.
+     */
+    static QgsExpressionProgram* compile( QgsExpression* parent, QgsExpression::Node* rootNode );
+
+    /** Evaluates the program. Errors are reported to the parent expression. */
+    QVariant run( QgsExpression* parent, const QgsExpressionContext* context );
+
+    //! Returns number of instructions of the program
+    int instructionCount() const { return mCode.count(); }
+
+    //! Returns a textual listing of the program (for debugging)
+    QString dump() const;
+
+  private:
+
+    QgsExpressionProgram() : mUsesFeature( false ) {}
+
+    enum OpCode
+    {
+      OpConstant,      //!< push constant with index arg
+      OpColumn,        //!< push attribute with index arg of the current feature
+      OpEvalNode,      //!< evaluate node with tree walker and push the result
+      OpUnary,         //!< unary operator arg applied on top of stack
+      OpBinary,        //!< binary operator arg applied on two values on top of stack
+    };
+
+    struct Instruction
+    {
+      Instruction( OpCode o = OpConstant, int a = 0, QgsExpression::Node* n = 0 ) : op( o ), arg( a ), node( n ) {}
+
+      OpCode op;
+      int arg;
+      QgsExpression::Node* node;
+    };
+
+    //! Stack value - numbers are unboxed, everything else lives in a QVariant
+    struct Value
+    {
+      enum Type { Int, Double, Variant };
+
+      Value() : type( Variant ), i( 0 ) {}
+
+      Type type;
+      union
+      {
+        int i;
+        double d;
+      };
+      QVariant v;
+
+      void setInt( int x ) { type = Int; i = x; }
+      void setDouble( double x );
+      void setVariant( const QVariant& x );
+      QVariant toVariant() const;
+    };
+
+    bool compileNode( QgsExpression* parent, QgsExpression::Node* node, int depth );
+    static bool isConstant( const QgsExpression::Node* node );
+    void addConstant( const QVariant& value );
+
+    bool evalUnary( QgsExpression* parent, const Instruction& ins, Value& val );
+    bool evalBinary( QgsExpression* parent, const Instruction& ins, Value& vL, const Value& vR );
+
+    QVector<Instruction> mCode;
+    QVector<Value> mConstants;
+    //! evaluation stack, sized by the compiler
+    QVector<Value> mStack;
+    //! whether the program contains column references
+    bool mUsesFeature;
+};
+
+#endif // QGSEXPRESSIONPROGRAM_H
@@ -62,6 +62,60 @@ bool QgsAbstractFeatureIterator::nextFeature( QgsFeature& f )
   return dataOk;
 }
 
+int QgsAbstractFeatureIterator::nextFeatures( QgsFeatureList& features, int maxCount )
+{
+  int count = 0;
+
+  switch ( mRequest.filterType() )
+  {
+    case QgsFeatureRequest::FilterNone:
+    case QgsFeatureRequest::FilterRect:
+      count = fetchFeatures( features, maxCount );
+      break;
+
+    default:
+    {
+      // filtered requests go through the per-feature path
+      QgsFeature f;
+      while ( count < maxCount && nextFeature( f ) )
+      {
+        features.append( f );
+        ++count;
+      }
+      return count;
+    }
+  }
+
+  // simplify the geometries using the simplifier configured
+  if ( mLocalSimplification )
+  {
+    for ( int i = features.count() - count; i < features.count(); ++i )
+    {
+      QgsFeature& f = features[i];
+      if ( f.constGeometry() )
+        simplify( f );
+    }
+  }
+  return count;
+}
+
+int QgsAbstractFeatureIterator::fetchFeatures( QgsFeatureList& features, int maxCount )
+{
+  int count = 0;
+  while ( count < maxCount )
+  {
+    // fetch directly into the list to avoid detaching a temporary feature
+    features.append( QgsFeature() );
+    if ( !fetchFeature( features.last() ) )
+    {
+      features.removeLast();
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
 bool QgsAbstractFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
 {
   while ( fetchFeature( f ) )
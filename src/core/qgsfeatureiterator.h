@@ -35,6 +35,16 @@ class CORE_EXPORT QgsAbstractFeatureIterator
     //! fetch next feature, return true on success
     virtual bool nextFeature( QgsFeature& f );
 
+    /** Fetches up to maxCount next features and appends them to the list.
+     * Fetching features in blocks amortises the per-feature overhead of the
+     * iterator (provider round trips, virtual calls, copies of features).
+     * @param features list where the fetched features are appended
+     * @param maxCount maximum number of features to fetch
+     * @return number of appended features, zero once the iteration has finished
+     * @note added in QGIS 2.12
+     */
+    virtual int nextFeatures( QgsFeatureList& features, int maxCount );
+
     //! reset the iterator to the starting position
     virtual bool rewind() = 0;
     //! end of iterating: free the resources / lock
@@ -50,6 +60,19 @@ class CORE_EXPORT QgsAbstractFeatureIterator
      */
     virtual bool fetchFeature( QgsFeature& f ) = 0;
 
+    /**
+     * Fetches up to maxCount features and appends them to the list. It is used by
+     * nextFeatures() for requests without attribute or feature id filter.
+     * The default implementation calls fetchFeature() repeatedly. Reimplement it
+     * if your provider can read features in blocks.
+     *
+     * @param features list where the fetched features are appended
+     * @param maxCount maximum number of features to fetch
+     * @return number of appended features
+     * @note added in QGIS 2.12
+     */
+    virtual int fetchFeatures( QgsFeatureList& features, int maxCount );
+
     /**
      * By default, the iterator will fetch all features and check if the feature
      * matches the expression.
@@ -151,6 +174,13 @@ class CORE_EXPORT QgsFeatureIterator
     QgsFeatureIterator& operator=( const QgsFeatureIterator& other );
 
     bool nextFeature( QgsFeature& f );
+
+    /** Fetches up to maxCount next features and appends them to the list.
+     * @return number of appended features, zero once the iteration has finished
+     * @note added in QGIS 2.12
+     */
+    int nextFeatures( QgsFeatureList& features, int maxCount );
+
     bool rewind();
     bool close();
 
@@ -196,6 +226,11 @@ inline bool QgsFeatureIterator::nextFeature( QgsFeature& f )
   return mIter ? mIter->nextFeature( f ) : false;
 }
 
+inline int QgsFeatureIterator::nextFeatures( QgsFeatureList& features, int maxCount )
+{
+  return mIter ? mIter->nextFeatures( features, maxCount ) : 0;
+}
+
 inline bool QgsFeatureIterator::rewind()
 {
   return mIter ? mIter->rewind() : false;
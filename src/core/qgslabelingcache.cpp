@@ -0,0 +1,225 @@
+/***************************************************************************
+  qgslabelingcache.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslabelingcache.h"
+
+#include "pal/labelposition.h"
+
+QgsLabelingCache::QgsLabelingCache()
+    : mNextGroup( 0 )
+    , mRun( 0 )
+    , mReusedSolutions( 0 )
+    , mReusedCandidates( 0 )
+{
+}
+
+QgsLabelingCache::~QgsLabelingCache()
+{
+  clearCandidates();
+}
+
+void QgsLabelingCache::clear()
+{
+  QMutexLocker lock( &mMutex );
+  mParameters.clear();
+  mSolutions.clear();
+  clearCandidates();
+}
+
+void QgsLabelingCache::clearCandidates()
+{
+  QHash<QString, QHash<CandidatesKey, CachedCandidates> >::iterator layerIt = mCandidates.begin();
+  for ( ; layerIt != mCandidates.end(); ++layerIt )
+  {
+    QHash<CandidatesKey, CachedCandidates>::iterator it = layerIt->begin();
+    for ( ; it != layerIt->end(); ++it )
+      qDeleteAll( it->candidates );
+  }
+  mCandidates.clear();
+}
+
+bool QgsLabelingCache::init( const QString& parameters )
+{
+  QMutexLocker lock( &mMutex );
+
+  mReusedSolutions = 0;
+  mReusedCandidates = 0;
+  if ( parameters == mParameters )
+  {
+    removeUnusedSolutions();
+    ++mRun;
+    return true;
+  }
+
+  mSolutions.clear();
+  clearCandidates();
+  mParameters = parameters;
+  ++mRun;
+  return false;
+}
+
+void QgsLabelingCache::removeUnusedSolutions()
+{
+  QHash<QString, QHash<FeatureKey, CachedSolution> >::iterator layerIt = mSolutions.begin();
+  while ( layerIt != mSolutions.end() )
+  {
+    QHash<FeatureKey, CachedSolution>::iterator it = layerIt->begin();
+    while ( it != layerIt->end() )
+    {
+      if ( it->run != mRun )
+        it = layerIt->erase( it );
+      else
+        ++it;
+    }
+
+    if ( layerIt->isEmpty() )
+      layerIt = mSolutions.erase( layerIt );
+    else
+      ++layerIt;
+  }
+
+  QHash<QString, QHash<CandidatesKey, CachedCandidates> >::iterator candidatesLayerIt = mCandidates.begin();
+  while ( candidatesLayerIt != mCandidates.end() )
+  {
+    QHash<CandidatesKey, CachedCandidates>::iterator it = candidatesLayerIt->begin();
+    while ( it != candidatesLayerIt->end() )
+    {
+      if ( it->run != mRun )
+      {
+        qDeleteAll( it->candidates );
+        it = candidatesLayerIt->erase( it );
+      }
+      else
+        ++it;
+    }
+
+    if ( candidatesLayerIt->isEmpty() )
+      candidatesLayerIt = mCandidates.erase( candidatesLayerIt );
+    else
+      ++candidatesLayerIt;
+  }
+}
+
+void QgsLabelingCache::clearLayer( const QString& layerId )
+{
+  QMutexLocker lock( &mMutex );
+  mSolutions.remove( layerId );
+
+  QHash<CandidatesKey, CachedCandidates> layerCandidates = mCandidates.take( layerId );
+  QHash<CandidatesKey, CachedCandidates>::iterator it = layerCandidates.begin();
+  for ( ; it != layerCandidates.end(); ++it )
+    qDeleteAll( it->candidates );
+}
+
+int QgsLabelingCache::nextGroup()
+{
+  QMutexLocker lock( &mMutex );
+  return mNextGroup++;
+}
+
+bool QgsLabelingCache::solution( const QString& layerId, const FeatureKey& key, FeatureSolution& solution )
+{
+  QMutexLocker lock( &mMutex );
+
+  QHash<QString, QHash<FeatureKey, CachedSolution> >::iterator layerIt = mSolutions.find( layerId );
+  if ( layerIt == mSolutions.end() )
+    return false;
+
+  QHash<FeatureKey, CachedSolution>::iterator it = layerIt->find( key );
+  if ( it == layerIt->end() )
+    return false;
+
+  it->run = mRun;
+  solution = it->solution;
+  return true;
+}
+
+void QgsLabelingCache::setSolution( const QString& layerId, const FeatureKey& key, const FeatureSolution& solution )
+{
+  QMutexLocker lock( &mMutex );
+  CachedSolution cached;
+  cached.solution = solution;
+  cached.run = mRun;
+  mSolutions[layerId].insert( key, cached );
+}
+
+bool QgsLabelingCache::candidates( const QString& layerId, const CandidatesKey& key, QList<pal::LabelPosition*>& candidates )
+{
+  QMutexLocker lock( &mMutex );
+
+  QHash<QString, QHash<CandidatesKey, CachedCandidates> >::iterator layerIt = mCandidates.find( layerId );
+  if ( layerIt == mCandidates.end() )
+    return false;
+
+  QHash<CandidatesKey, CachedCandidates>::iterator it = layerIt->find( key );
+  if ( it == layerIt->end() )
+    return false;
+
+  it->run = mRun;
+  Q_FOREACH ( pal::LabelPosition* candidate, it->candidates )
+    candidates.append( new pal::LabelPosition( *candidate ) );
+  ++mReusedCandidates;
+  return true;
+}
+
+void QgsLabelingCache::setCandidates( const QString& layerId, const CandidatesKey& key, const QList<pal::LabelPosition*>& candidates )
+{
+  CachedCandidates cached;
+  Q_FOREACH ( pal::LabelPosition* candidate, candidates )
+    cached.candidates.append( new pal::LabelPosition( *candidate ) );
+
+  QMutexLocker lock( &mMutex );
+  cached.run = mRun;
+  QHash<CandidatesKey, CachedCandidates>& layerCandidates = mCandidates[layerId];
+  QHash<CandidatesKey, CachedCandidates>::iterator it = layerCandidates.find( key );
+  if ( it != layerCandidates.end() )
+  {
+    // parts of a feature with the same geometry (e.g. a repeated line label) share their candidates
+    qDeleteAll( it->candidates );
+    *it = cached;
+  }
+  else
+  {
+    layerCandidates.insert( key, cached );
+  }
+}
+
+int QgsLabelingCache::reusedCandidates() const
+{
+  QMutexLocker lock( &mMutex );
+  return mReusedCandidates;
+}
+
+void QgsLabelingCache::addReusedSolutions( int count )
+{
+  QMutexLocker lock( &mMutex );
+  mReusedSolutions += count;
+}
+
+int QgsLabelingCache::reusedSolutions() const
+{
+  QMutexLocker lock( &mMutex );
+  return mReusedSolutions;
+}
+
+int QgsLabelingCache::size() const
+{
+  QMutexLocker lock( &mMutex );
+  int count = 0;
+  QHash<QString, QHash<FeatureKey, CachedSolution> >::const_iterator layerIt = mSolutions.constBegin();
+  for ( ; layerIt != mSolutions.constEnd(); ++layerIt )
+    count += layerIt->count();
+  return count;
+}
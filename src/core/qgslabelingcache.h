@@ -0,0 +1,175 @@
+/***************************************************************************
+  qgslabelingcache.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLABELINGCACHE_H
+#define QGSLABELINGCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include "qgsfeature.h"
+
+namespace pal
+{
+  class LabelPosition;
+}
+
+/**
+ * Keeps the label placement of previous labeling runs, so that a run with unchanged
+ * parameters (e.g. panning of the map) does not have to place labels again where the
+ * candidates did not change.
+ *
+ * PAL solves each group of features whose label candidates conflict with each other
+ * independently. For every feature of a solved group, the cache stores the candidates
+ * (geometry and cost) and the selected candidate. If all features of a group are found
+ * with the same candidates at the same place within the group, the previous solution
+ * of the group is reused.
+ *
+ * The cache also keeps the candidates generated for each feature part before they are
+ * limited to the map extent. Label geometries are clipped to the map extent, so parts
+ * which are completely inside of the previous and the current map extent (e.g. while
+ * panning) have the same geometry and label properties, and get copies of the previous
+ * candidates instead of generating them again. Label geometries are always transformed
+ * exactly, also if the map settings allow an approximated transform of the rendered
+ * geometries, so panning does not change them.
+ *
+ * Features are identified by the layer ID, the index of the label provider within
+ * the layer and the feature ID. The cache is emptied if the parameters of the labeling
+ * change (map scale, rotation or engine settings). Entries of a layer are removed with
+ * clearLayer() when the layer is edited or its style changes. Entries which were neither
+ * read nor stored in the previous run (e.g. features panned out of the map) are removed
+ * when the next run starts, so the cache only holds the placements of about one map view.
+ *
+ * The class is thread-safe (multiple classes can access the same instance safely).
+ *
+ * @note added in QGIS 2.12
+ */
+class CORE_EXPORT QgsLabelingCache
+{
+  public:
+
+    //! Index of the label provider within the layer and feature ID
+    typedef QPair<int, QgsFeatureId> FeatureKey;
+
+    /** Key of the candidates of a feature part: index of the label provider within the layer,
+     * feature ID and the hash of the part (pal::FeaturePart::candidatesHash())
+     */
+    typedef QPair<FeatureKey, QByteArray> CandidatesKey;
+
+    //! Cached placement of a feature
+    struct FeatureSolution
+    {
+      FeatureSolution() : group( -1 ), groupSize( 0 ), index( -1 ), candidate( -1 ) {}
+
+      //! Geometry and cost of the candidates
+      QVector<double> candidates;
+      //! Group of conflicting features the feature belonged to
+      int group;
+      //! Number of features in the group
+      int groupSize;
+      //! Index of the feature in the group
+      int index;
+      //! Index of the selected candidate, -1 if the feature was not labeled
+      int candidate;
+    };
+
+    QgsLabelingCache();
+    ~QgsLabelingCache();
+
+    //! Removes all cached placements
+    void clear();
+
+    /** Initializes the cache for a labeling run and removes all cached placements if the parameters have changed
+     * @param parameters map scale, rotation and settings of the labeling engine written as a string
+     * @return whether the parameters are the same as last time
+     */
+    bool init( const QString& parameters );
+
+    //! Removes the cached placements of the features of a layer
+    void clearLayer( const QString& layerId );
+
+    //! Returns a new identifier for a group of features
+    int nextGroup();
+
+    /** Returns true and sets the solution if the placement of the feature is cached.
+     * The placement is kept for the next run.
+     */
+    bool solution( const QString& layerId, const FeatureKey& key, FeatureSolution& solution );
+
+    //! Stores the placement of a feature
+    void setSolution( const QString& layerId, const FeatureKey& key, const FeatureSolution& solution );
+
+    /** Returns true and appends copies of the candidates of a feature part to candidates if they are cached.
+     * The caller takes ownership of the copies, which still refer to the feature part they were created for.
+     * The candidates are kept for the next run.
+     * @note not available in python bindings
+     */
+    bool candidates( const QString& layerId, const CandidatesKey& key, QList<pal::LabelPosition*>& candidates );
+
+    /** Stores copies of the candidates of a feature part, before they are limited to the map extent
+     * @note not available in python bindings
+     */
+    void setCandidates( const QString& layerId, const CandidatesKey& key, const QList<pal::LabelPosition*>& candidates );
+
+    //! Returns the number of feature parts whose candidates were reused since the last call to init()
+    int reusedCandidates() const;
+
+    //! Counts placements of features which were reused in the current run
+    void addReusedSolutions( int count );
+
+    //! Returns the number of placements of features which were reused since the last call to init()
+    int reusedSolutions() const;
+
+    //! Returns the number of cached placements
+    int size() const;
+
+  protected:
+    //! Placement of a feature with the last run which used it
+    struct CachedSolution
+    {
+      FeatureSolution solution;
+      int run;
+    };
+
+    //! Candidates of a feature part with the last run which used them
+    struct CachedCandidates
+    {
+      QList<pal::LabelPosition*> candidates;
+      int run;
+    };
+
+    //! Removes the placements and candidates not used in the previous run
+    void removeUnusedSolutions();
+
+    //! Removes all cached candidates
+    void clearCandidates();
+
+    mutable QMutex mMutex;
+    QString mParameters;
+    int mNextGroup;
+    //! Number of the current labeling run
+    int mRun;
+    int mReusedSolutions;
+    int mReusedCandidates;
+    QHash<QString, QHash<FeatureKey, CachedSolution> > mSolutions;
+    QHash<QString, QHash<CandidatesKey, CachedCandidates> > mCandidates;
+};
+
+#endif // QGSLABELINGCACHE_H
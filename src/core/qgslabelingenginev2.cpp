@@ -15,6 +15,7 @@
 
 #include "qgslabelingenginev2.h"
 
+#include "qgslabelingcache.h"
 #include "qgslogger.h"
 #include "qgsproject.h"
 
@@ -40,6 +41,7 @@ QgsLabelingEngineV2::QgsLabelingEngineV2()
     , mCandLine( 8 )
     , mCandPolygon( 8 )
     , mResults( 0 )
+    , mLabelingCache( 0 )
 {
   mResults = new QgsLabelingResults;
 }
@@ -95,6 +97,12 @@ void QgsLabelingEngineV2::processProvider( QgsAbstractLabelProvider* provider, Q
   // extra flags for placement of labels for linestrings
   l->setArrangementFlags(( pal::LineArrangementFlags ) provider->linePlacementFlags() );
 
+  // providers of a layer are processed in the same order in every run, so their index identifies them in the cache
+  if ( mLabelingCache && !provider->layerId().isEmpty() )
+  {
+    l->setCacheIndex( mLayerProviderCount[provider->layerId()]++ );
+  }
+
   // set label mode (label per feature is the default)
   l->setLabelMode( flags.testFlag( QgsAbstractLabelProvider::LabelPerFeaturePart ) ? pal::Layer::LabelPerFeaturePart : pal::Layer::LabelPerFeature );
 
@@ -178,6 +186,23 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
 
   p.setShowPartial( mFlags.testFlag( UsePartialCandidates ) );
 
+  mLayerProviderCount.clear();
+  if ( mLabelingCache )
+  {
+    // placements are only reused if the map scale, rotation and engine settings are the same
+    mLabelingCache->init( QString( "%1 %2 %3 %4 %5 %6 %7 %8 %9" )
+                          .arg( mMapSettings.mapUnitsPerPixel(), 0, 'g', 17 )
+                          .arg( mMapSettings.rotation(), 0, 'g', 17 )
+                          .arg( mMapSettings.outputDpi(), 0, 'g', 17 )
+                          .arg( mMapSettings.destinationCrs().authid() )
+                          .arg(( int ) mFlags )
+                          .arg( mSearchMethod )
+                          .arg( mCandPoint )
+                          .arg( mCandLine )
+                          .arg( mCandPolygon ) );
+    p.setLabelingCache( mLabelingCache );
+  }
+
 
   // for each provider: get labels and register them in PAL
   foreach ( QgsAbstractLabelProvider* provider, mProviders )
@@ -378,8 +403,9 @@ QgsAbstractLabelProvider*QgsLabelFeature::provider() const
 
 }
 
-QgsAbstractLabelProvider::QgsAbstractLabelProvider()
+QgsAbstractLabelProvider::QgsAbstractLabelProvider( const QString& layerId )
     : mEngine( 0 )
+    , mLayerId( layerId )
     , mFlags( DrawLabels )
     , mPlacement( QgsPalLayerSettings::AroundPoint )
     , mLinePlacementFlags( 0 )
@@ -23,8 +23,10 @@
 #include "qgspallabeling.h"
 
 #include <QFlags>
+#include <QHash>
 
 class QgsAbstractLabelProvider;
+class QgsLabelingCache;
 class QgsRenderContext;
 class QgsGeometry;
 
@@ -248,7 +250,8 @@ class CORE_EXPORT QgsAbstractLabelProvider
 
   public:
     //! Construct the provider with default values
-    QgsAbstractLabelProvider();
+    //! @param layerId ID of the map layer of the labels, empty if the labels do not belong to a layer
+    QgsAbstractLabelProvider( const QString& layerId = QString() );
     //! Vritual destructor
     virtual ~QgsAbstractLabelProvider() {}
 
@@ -278,6 +281,9 @@ class CORE_EXPORT QgsAbstractLabelProvider
     //! Name of the layer (for statistics, debugging etc.) - does not need to be unique
     QString name() const { return mName; }
 
+    //! ID of the map layer of the labels, empty if the labels do not belong to a layer
+    QString layerId() const { return mLayerId; }
+
     //! Flags associated with the provider
     Flags flags() const { return mFlags; }
 
@@ -302,6 +308,8 @@ class CORE_EXPORT QgsAbstractLabelProvider
 
     //! Name of the layer
     QString mName;
+    //! Associated layer's ID, if applicable
+    QString mLayerId;
     //! Flags altering drawing and registration of features
     Flags mFlags;
     //! Placement strategy
@@ -402,6 +410,13 @@ class CORE_EXPORT QgsLabelingEngineV2
     //! Which search method to use for removal collisions between labels
     QgsPalLabeling::Search searchMethod() const { return mSearchMethod; }
 
+    /** Set the cache of label placements of previous runs (not owned by the engine, may be null).
+     * Placements of groups of labels whose candidates did not change since the previous run are reused.
+     */
+    void setLabelingCache( QgsLabelingCache* cache ) { mLabelingCache = cache; }
+    //! Cache of label placements of previous runs (may be null)
+    QgsLabelingCache* labelingCache() const { return mLabelingCache; }
+
     //! Read configuration of the labeling engine from the current project file
     void readSettingsFromProject();
     //! Write configuration of the labeling engine to the current project file
@@ -425,6 +440,11 @@ class CORE_EXPORT QgsLabelingEngineV2
 
     //! Resulting labeling layout
     QgsLabelingResults* mResults;
+
+    //! Cache of label placements of previous runs (not owned)
+    QgsLabelingCache* mLabelingCache;
+    //! Number of providers of each layer processed in the current run
+    QHash<QString, int> mLayerProviderCount;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsLabelingEngineV2::Flags )
@@ -43,7 +43,7 @@
 class CORE_EXPORT QgsMapLayerRenderer
 {
   public:
-    QgsMapLayerRenderer( const QString& layerID ) : mLayerID( layerID ) {}
+    QgsMapLayerRenderer( const QString& layerID ) : mLayerID( layerID ), mFetchedFeatureCount( -1 ) {}
     virtual ~QgsMapLayerRenderer() {}
 
     //! Do the rendering (based on data stored in the class)
@@ -55,9 +55,16 @@ class CORE_EXPORT QgsMapLayerRenderer
     //! Get access to the ID of the layer rendered by this class
     QString layerID() const { return mLayerID; }
 
+    /** Returns the number of features fetched from the data source by render(), or -1 if the
+     * renderer does not fetch features
+     * @note added in QGIS 2.12
+     */
+    int fetchedFeatureCount() const { return mFetchedFeatureCount; }
+
   protected:
     QStringList mErrors;
     QString mLayerID;
+    int mFetchedFeatureCount;
 };
 
 #endif // QGSMAPLAYERRENDERER_H
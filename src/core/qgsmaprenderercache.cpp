@@ -27,6 +27,7 @@ void QgsMapRendererCache::clear()
 {
   QMutexLocker lock( &mMutex );
   clearInternal();
+  mLabelingCache.clear();
 }
 
 void QgsMapRendererCache::clearInternal()
@@ -95,6 +96,7 @@ void QgsMapRendererCache::clearCacheImage( const QString& layerId )
   QMutexLocker lock( &mMutex );
 
   mCachedImages.remove( layerId );
+  mLabelingCache.clearLayer( layerId );
 
   QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
   if ( layer )
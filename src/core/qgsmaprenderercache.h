@@ -20,6 +20,7 @@
 #include <QImage>
 #include <QMutex>
 
+#include "qgslabelingcache.h"
 #include "qgsrectangle.h"
 
 
@@ -54,9 +55,14 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     //! get cached image for the specified layer ID. Returns null image if it is not cached.
     QImage cacheImage( const QString& layerId );
 
-    //! remove layer from the cache
+    //! remove layer from the cache (together with its cached label placements)
     void clearCacheImage( const QString& layerId );
 
+    /** Cache of label placements. Unlike layer images, placements are kept when the extent changes.
+     * @note added in QGIS 2.12
+     */
+    QgsLabelingCache* labelingCache() { return &mLabelingCache; }
+
   protected slots:
     //! remove layer (that emitted the signal) from the cache
     void layerRequestedRepaint();
@@ -70,6 +76,7 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     QgsRectangle mExtent;
     double mScale;
     QMap<QString, QImage> mCachedImages;
+    QgsLabelingCache mLabelingCache;
 };
 
 
@@ -16,6 +16,7 @@
 #include "qgsmaprenderercustompainterjob.h"
 
 #include "qgslabelingenginev2.h"
+#include "qgsmaprenderercache.h"
 #include "qgslogger.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaplayerrenderer.h"
@@ -59,6 +60,9 @@ void QgsMapRendererCustomPainterJob::start()
   mActive = true;
 
   mErrors.clear();
+  mPerLayerRenderingTime.clear();
+  mPerLayerFeatureCount.clear();
+  mLabelingTime = 0;
 
   QgsDebugMsg( "QPAINTER run!" );
 
@@ -88,9 +92,11 @@ void QgsMapRendererCustomPainterJob::start()
     mLabelingEngineV2 = new QgsLabelingEngineV2();
     mLabelingEngineV2->readSettingsFromProject();
     mLabelingEngineV2->setMapSettings( mSettings );
+    if ( mCache )
+      mLabelingEngineV2->setLabelingCache( mCache->labelingCache() );
 #else
     mLabelingEngine = new QgsPalLabeling;
-    mLabelingEngine->loadEngineSettings();
+    loadLabelingEngineSettings( mLabelingEngine );
     mLabelingEngine->init( mSettings );
 #endif
   }
@@ -248,7 +254,12 @@ void QgsMapRendererCustomPainterJob::doRender()
     }
 
     if ( !job.cached )
+    {
+      QTime layerTime;
+      layerTime.start();
       job.renderer->render();
+      job.renderingTime = layerTime.elapsed();
+    }
 
     if ( job.img )
     {
@@ -261,7 +272,12 @@ void QgsMapRendererCustomPainterJob::doRender()
   QgsDebugMsg( "Done rendering map layers" );
 
   if ( mSettings.testFlag( QgsMapSettings::DrawLabeling ) && !mLabelingRenderContext.renderingStopped() )
+  {
+    QTime labelingTime;
+    labelingTime.start();
     drawLabeling( mSettings, mLabelingRenderContext, mLabelingEngine, mLabelingEngineV2, mPainter );
+    mLabelingTime = labelingTime.elapsed();
+  }
 
   QgsDebugMsg( "Rendering completed in (seconds): " + QString( "%1" ).arg( renderTime.elapsed() / 1000.0 ) );
 }
@@ -37,6 +37,8 @@ QgsMapRendererJob::QgsMapRendererJob( const QgsMapSettings& settings )
     : mSettings( settings )
     , mCache( 0 )
     , mRenderingTime( 0 )
+    , mLabelingTime( 0 )
+    , mLabelingEngineSettings( 0 )
 {
 }
 
@@ -135,6 +137,26 @@ bool QgsMapRendererJob::reprojectToLayerExtent( const QgsCoordinateTransform* ct
 
 
 
+void QgsMapRendererJob::loadLabelingEngineSettings( QgsPalLabeling* labelingEngine ) const
+{
+  if ( !mLabelingEngineSettings )
+  {
+    labelingEngine->loadEngineSettings();
+    return;
+  }
+
+  int candPoint, candLine, candPolygon;
+  mLabelingEngineSettings->numCandidatePositions( candPoint, candLine, candPolygon );
+  labelingEngine->setNumCandidatePositions( candPoint, candLine, candPolygon );
+  labelingEngine->setSearchMethod( mLabelingEngineSettings->searchMethod() );
+  labelingEngine->setShowingCandidates( mLabelingEngineSettings->isShowingCandidates() );
+  labelingEngine->setDrawLabelRectOnly( mLabelingEngineSettings->drawLabelRectOnly() );
+  labelingEngine->setShowingShadowRectangles( mLabelingEngineSettings->isShowingShadowRectangles() );
+  labelingEngine->setShowingAllLabels( mLabelingEngineSettings->isShowingAllLabels() );
+  labelingEngine->setShowingPartialsLabels( mLabelingEngineSettings->isShowingPartialsLabels() );
+  labelingEngine->setDrawingOutlineLabels( mLabelingEngineSettings->isDrawingOutlineLabels() );
+}
+
 LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabeling* labelingEngine, QgsLabelingEngineV2* labelingEngine2 )
 {
   LayerRenderJobs layerJobs;
@@ -213,6 +235,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
     job.img = 0;
     job.blendMode = ml->blendMode();
     job.layerId = ml->id();
+    job.renderingTime = -1;
 
     job.context = QgsRenderContext::fromMapSettings( mSettings );
     job.context.setPainter( painter );
@@ -299,11 +322,17 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
       job.img = 0;
     }
 
+    if ( job.renderingTime >= 0 )
+      mPerLayerRenderingTime.insert( job.layerId, job.renderingTime );
+
     if ( job.renderer )
     {
       Q_FOREACH ( const QString& message, job.renderer->errors() )
         mErrors.append( Error( job.renderer->layerID(), message ) );
 
+      if ( job.renderer->fetchedFeatureCount() >= 0 )
+        mPerLayerFeatureCount.insert( job.layerId, job.renderer->fetchedFeatureCount() );
+
       delete job.renderer;
       job.renderer = 0;
     }
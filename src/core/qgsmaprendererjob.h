@@ -47,6 +47,7 @@ struct LayerRenderJob
   QPainter::CompositionMode blendMode;
   bool cached; // if true, img already contains cached image from previous rendering
   QString layerId;
+  int renderingTime; // time spent in the layer's renderer (in milliseconds), -1 if not rendered
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -127,6 +128,32 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! Find out how log it took to finish the job (in miliseconds)
     int renderingTime() const { return mRenderingTime; }
 
+    /** Returns how long rendering of each layer took (in milliseconds), keyed by layer ID.
+     * Layers drawn from the cache are not included. Available when the rendering has been finished.
+     * @note added in QGIS 2.12
+     */
+    QMap<QString, int> perLayerRenderingTime() const { return mPerLayerRenderingTime; }
+
+    /** Returns the number of features fetched for each vector layer, keyed by layer ID.
+     * Available when the rendering has been finished.
+     * @note added in QGIS 2.12
+     */
+    QMap<QString, int> perLayerFeatureCount() const { return mPerLayerFeatureCount; }
+
+    /** Returns how long drawing of labels and diagrams took (in milliseconds).
+     * Available when the rendering has been finished.
+     * @note added in QGIS 2.12
+     */
+    int labelingTime() const { return mLabelingTime; }
+
+    /** Sets a labeling engine whose engine settings (search method, number of candidates and
+     * drawing flags) are used by the labeling engine of the job instead of the settings stored
+     * in the project. The engine must exist until the job has finished, ownership is not transferred.
+     * @note added in QGIS 2.12
+     * @note not available in python bindings
+     */
+    void setLabelingEngineSettings( QgsPalLabeling* engine ) { mLabelingEngineSettings = engine; }
+
     /**
      * Return map settings with which this job was started.
      * @return A QgsMapSettings instance with render settings
@@ -155,6 +182,10 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! @note not available in python bindings
     void cleanupJobs( LayerRenderJobs& jobs );
 
+    //! Sets up the engine settings of the labeling engine created by the job
+    //! @note not available in python bindings
+    void loadLabelingEngineSettings( QgsPalLabeling* labelingEngine ) const;
+
     static QImage composeImage( const QgsMapSettings& settings, const LayerRenderJobs& jobs );
 
     bool needTemporaryImage( QgsMapLayer* ml );
@@ -178,6 +209,13 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     QTime mRenderingStart;
     int mRenderingTime;
+
+    QMap<QString, int> mPerLayerRenderingTime;
+    QMap<QString, int> mPerLayerFeatureCount;
+    int mLabelingTime;
+
+    //! engine whose settings are used instead of the project's, not owned
+    QgsPalLabeling* mLabelingEngineSettings;
 };
 
 
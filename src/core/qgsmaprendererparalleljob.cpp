@@ -16,6 +16,7 @@
 #include "qgsmaprendererparalleljob.h"
 
 #include "qgslabelingenginev2.h"
+#include "qgsmaprenderercache.h"
 #include "qgslogger.h"
 #include "qgsmaplayerrenderer.h"
 #include "qgspallabeling.h"
@@ -55,6 +56,10 @@ void QgsMapRendererParallelJob::start()
 
   mStatus = RenderingLayers;
 
+  mPerLayerRenderingTime.clear();
+  mPerLayerFeatureCount.clear();
+  mLabelingTime = 0;
+
   delete mLabelingEngine;
   mLabelingEngine = 0;
 
@@ -67,9 +72,11 @@ void QgsMapRendererParallelJob::start()
     mLabelingEngineV2 = new QgsLabelingEngineV2();
     mLabelingEngineV2->readSettingsFromProject();
     mLabelingEngineV2->setMapSettings( mSettings );
+    if ( mCache )
+      mLabelingEngineV2->setLabelingCache( mCache->labelingCache() );
 #else
     mLabelingEngine = new QgsPalLabeling;
-    mLabelingEngine->loadEngineSettings();
+    loadLabelingEngineSettings( mLabelingEngine );
     mLabelingEngine->init( mSettings );
 #endif
   }
@@ -246,9 +253,8 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob& job )
     QgsDebugMsg( "Caught unhandled unknown exception" );
   }
 
-  int tt = t.elapsed();
-  QgsDebugMsg( QString( "job %1 end [%2 ms]" ).arg(( ulong ) &job, 0, 16 ).arg( tt ) );
-  Q_UNUSED( tt );
+  job.renderingTime = t.elapsed();
+  QgsDebugMsg( QString( "job %1 end [%2 ms]" ).arg(( ulong ) &job, 0, 16 ).arg( job.renderingTime ) );
 }
 
 
@@ -256,6 +262,9 @@ void QgsMapRendererParallelJob::renderLabelsStatic( QgsMapRendererParallelJob* s
 {
   QPainter painter( &self->mFinalImage );
 
+  QTime t;
+  t.start();
+
   try
   {
     drawLabeling( self->mSettings, self->mLabelingRenderContext, self->mLabelingEngine, self->mLabelingEngineV2, &painter );
@@ -273,6 +282,8 @@ void QgsMapRendererParallelJob::renderLabelsStatic( QgsMapRendererParallelJob* s
     QgsDebugMsg( "Caught unhandled unknown exception" );
   }
 
+  self->mLabelingTime = t.elapsed();
+
   painter.end();
 }
 
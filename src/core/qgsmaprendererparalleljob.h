@@ -23,6 +23,10 @@
  * The resulting map image can be retrieved with renderedImage() function.
  * It is safe to call that function while rendering is active to see preview of the map.
  *
+ * Layers are rendered concurrently, one thread per layer. With QgsMapSettings::RenderLayersInTiles
+ * flag enabled, large vector layers are additionally split into horizontal tiles that are
+ * rendered by multiple threads and composited back into the layer's image.
+ *
  * @note added in 2.4
  */
 class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
@@ -67,6 +67,7 @@ void QgsMapRendererSequentialJob::start()
 
   mInternalJob = new QgsMapRendererCustomPainterJob( mSettings, mPainter );
   mInternalJob->setCache( mCache );
+  mInternalJob->setLabelingEngineSettings( mLabelingEngineSettings );
 
   connect( mInternalJob, SIGNAL( finished() ), SLOT( internalFinished() ) );
 
@@ -127,6 +128,9 @@ void QgsMapRendererSequentialJob::internalFinished()
   mLabelingResults = mInternalJob->takeLabelingResults();
 
   mErrors = mInternalJob->errors();
+  mPerLayerRenderingTime = mInternalJob->perLayerRenderingTime();
+  mPerLayerFeatureCount = mInternalJob->perLayerFeatureCount();
+  mLabelingTime = mInternalJob->labelingTime();
 
   // now we are in a slot called from mInternalJob - do not delete it immediately
   // so the class is still valid when the execution returns to the class
@@ -135,6 +135,8 @@ class CORE_EXPORT QgsMapSettings
       DrawLabeling       = 0x10,  //!< Enable drawing of labels on top of the map
       UseRenderingOptimization = 0x20, //!< Enable vector simplification and other rendering optimizations
       DrawSelection      = 0x40,  //!< Whether vector selections should be shown in the rendered map
+      RenderLayersInTiles = 0x80, //!< Allow large vector layers to be split into spatial tiles rendered by multiple threads (since QGIS 2.12)
+      ApproximateTransform = 0x100, //!< Allow reprojection of vector layers to be approximated by interpolation within the rendered extent (since QGIS 2.12)
       // TODO: ignore scale-based visibility (overview)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
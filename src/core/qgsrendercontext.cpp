@@ -20,6 +20,8 @@
 
 #include "qgsmapsettings.h"
 
+#include <QThreadPool>
+
 QgsRenderContext::QgsRenderContext()
     : mPainter( 0 )
     , mCoordTransform( 0 )
@@ -35,6 +37,9 @@ QgsRenderContext::QgsRenderContext()
     , mShowSelection( true )
     , mUseRenderingOptimization( true )
     , mGeometry( 0 )
+    , mRenderingTileCount( 1 )
+    , mApproximateTransform( false )
+    , mCoordTransformGrid( 0 )
 {
   mVectorSimplifyMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
 }
@@ -59,6 +64,9 @@ QgsRenderContext QgsRenderContext::fromMapSettings( const QgsMapSettings& mapSet
   ctx.setScaleFactor( mapSettings.outputDpi() / 25.4 ); // = pixels per mm
   ctx.setRendererScale( mapSettings.scale() );
   ctx.setExpressionContext( mapSettings.expressionContext() );
+  if ( mapSettings.testFlag( QgsMapSettings::RenderLayersInTiles ) )
+    ctx.setRenderingTileCount( qMax( 1, QThreadPool::globalInstance()->maxThreadCount() ) );
+  ctx.setApproximateTransform( mapSettings.testFlag( QgsMapSettings::ApproximateTransform ) );
 
   //this flag is only for stopping during the current rendering progress,
   //so must be false at every new render operation
@@ -70,4 +78,5 @@ QgsRenderContext QgsRenderContext::fromMapSettings( const QgsMapSettings& mapSet
 void QgsRenderContext::setCoordinateTransform( const QgsCoordinateTransform* t )
 {
   mCoordTransform = t;
+  mCoordTransformGrid = 0;
 }
@@ -29,6 +29,7 @@
 class QPainter;
 
 class QgsAbstractGeometryV2;
+class QgsCoordinateTransformGrid;
 class QgsLabelingEngineInterface;
 class QgsLabelingEngineV2;
 class QgsMapSettings;
@@ -152,6 +153,48 @@ class CORE_EXPORT QgsRenderContext
     /** Sets pointer to original (unsegmentized) geometry*/
     void setGeometry( const QgsAbstractGeometryV2* geometry ) { mGeometry = geometry; }
 
+    /** Returns the maximum number of spatial tiles a layer renderer may split its work into.
+     * A value of 1 (the default) means that layers are rendered in one piece by a single thread.
+     * @see setRenderingTileCount()
+     * @note added in QGIS 2.12
+     */
+    int renderingTileCount() const { return mRenderingTileCount; }
+
+    /** Sets the maximum number of spatial tiles a layer renderer may split its work into.
+     * Tiles are rendered concurrently, so the count is usually the number of available threads.
+     * @see renderingTileCount()
+     * @note added in QGIS 2.12
+     */
+    void setRenderingTileCount( int count ) { mRenderingTileCount = count; }
+
+    /** Returns true if layer renderers may approximate the coordinate transform with an interpolation grid.
+     * @see setApproximateTransform()
+     * @note added in QGIS 2.12
+     */
+    bool approximateTransform() const { return mApproximateTransform; }
+
+    /** Sets whether layer renderers may approximate the coordinate transform with an interpolation grid.
+     * @see approximateTransform()
+     * @note added in QGIS 2.12
+     */
+    void setApproximateTransform( bool approximate ) { mApproximateTransform = approximate; }
+
+    /** Returns the grid approximating the coordinate transform within the rendered extent,
+     * or null if coordinates are transformed exactly.
+     * @see setCoordinateTransformGrid()
+     * @note added in QGIS 2.12
+     * @note not available in python bindings
+     */
+    const QgsCoordinateTransformGrid* coordinateTransformGrid() const { return mCoordTransformGrid; }
+
+    /** Sets the grid approximating the coordinate transform. The grid is not owned by the context
+     * and is reset when the coordinate transform changes.
+     * @see coordinateTransformGrid()
+     * @note added in QGIS 2.12
+     * @note not available in python bindings
+     */
+    void setCoordinateTransformGrid( const QgsCoordinateTransformGrid* grid ) { mCoordTransformGrid = grid; }
+
   private:
 
     /** Painter for rendering operations*/
@@ -208,6 +251,15 @@ class CORE_EXPORT QgsRenderContext
 
     /** Pointer to the (unsegmentized) geometry*/
     const QgsAbstractGeometryV2* mGeometry;
+
+    /** Maximum number of spatial tiles for multi-threaded rendering of a single layer */
+    int mRenderingTileCount;
+
+    /** Whether the coordinate transform may be approximated by interpolation */
+    bool mApproximateTransform;
+
+    /** Grid approximating the coordinate transform (can be NULL) */
+    const QgsCoordinateTransformGrid* mCoordTransformGrid;
 };
 
 #endif
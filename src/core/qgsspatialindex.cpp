@@ -20,11 +20,38 @@
 #include "qgsfeatureiterator.h"
 #include "qgsrectangle.h"
 #include "qgslogger.h"
+#include "qgsapplication.h"
 
 #include "SpatialIndex.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QVector>
+
+#include <cstring>
+
 using namespace SpatialIndex;
 
+// R-tree parameters
+static const double FILL_FACTOR = 0.7;
+// trees written to files are not expected to change much, so their nodes are filled
+// as much as possible (libspatialindex requires a fill factor below 1)
+static const double PACKED_FILL_FACTOR = 0.9;
+static const unsigned long INDEX_CAPACITY = 10;
+static const unsigned long LEAF_CAPACITY = 10;
+static const unsigned long DIMENSION = 2;
+
+// "QSIX" - header of index files
+static const quint32 INDEX_FILE_MAGIC = 0x51534958;
+static const quint32 INDEX_FILE_VERSION = 2;
+// bytes read at the start and at the end of a data source file for its stamp
+static const qint64 SOURCE_STAMP_BYTES = 64 * 1024;
+
 
 
 // custom visitor that adds found features to list
@@ -74,6 +101,255 @@ class QgsSpatialIndexCopyVisitor : public SpatialIndex::IVisitor
 };
 
 
+/** Utility class for collecting all entries of an R-tree and bulk loading them again. Not a part of public API. */
+class QgsSpatialIndexEntriesStream : public IDataStream, public IVisitor
+{
+  public:
+    explicit QgsSpatialIndexEntriesStream( SpatialIndex::ISpatialIndex* tree )
+        : mNext( 0 )
+    {
+      double low[]  = { -DBL_MAX, -DBL_MAX };
+      double high[] = { DBL_MAX, DBL_MAX };
+      SpatialIndex::Region query( low, high, 2 );
+      tree->intersectsWithQuery( query, *this );
+    }
+
+    void visitNode( const INode& n ) override
+      { Q_UNUSED( n ); }
+
+    void visitData( const IData& d ) override
+    {
+      SpatialIndex::IShape* shape;
+      d.getShape( &shape );
+      SpatialIndex::Region r;
+      shape->getMBR( r );
+      delete shape;
+
+      mRegions.append( r );
+      mIds.append( d.getIdentifier() );
+    }
+
+    void visitData( std::vector<const IData*>& v ) override
+      { Q_UNUSED( v ); }
+
+    virtual IData* getNext() override
+    {
+      RTree::Data* data = new RTree::Data( 0, 0, mRegions[mNext], mIds[mNext] );
+      ++mNext;
+      return data;
+    }
+
+    virtual bool hasNext() override { return mNext < mIds.count(); }
+
+    virtual uint32_t size() override { return mIds.count(); }
+
+    virtual void rewind() override { mNext = 0; }
+
+  private:
+    QVector<SpatialIndex::Region> mRegions;
+    QVector<id_type> mIds;
+    int mNext;
+};
+
+
+/**
+ * Storage manager for R-trees written to files. Not a part of public API.
+ *
+ * The pages of a file opened with open() are read from a memory mapping of the file.
+ * Pages stored afterwards (and all pages of a new storage) are kept in memory, the
+ * file itself is never changed. write() writes the pages kept in memory to a file.
+ */
+class QgsSpatialIndexFileStorage : public IStorageManager
+{
+  public:
+    QgsSpatialIndexFileStorage()
+        : mMappedData( 0 )
+        , mNextPage( 0 )
+    {}
+
+    //! Maps an index file, returns false if it is not valid for the source
+    bool open( const QString& path, const QFileInfo& source, id_type& indexId );
+
+    //! Writes the pages kept in memory to a file
+    bool write( const QString& path, const QFileInfo& source, id_type indexId ) const;
+
+    virtual void loadByteArray( const id_type page, uint32_t& len, uint8_t** data ) override
+    {
+      QHash<qint64, QByteArray>::const_iterator it = mPages.constFind( page );
+      if ( it != mPages.constEnd() )
+      {
+        len = it->size();
+        *data = new uint8_t[len];
+        memcpy( *data, it->constData(), len );
+        return;
+      }
+
+      QHash<qint64, MappedPage>::const_iterator mappedIt = mMappedPages.constFind( page );
+      if ( mappedIt == mMappedPages.constEnd() )
+        throw StorageManager::InvalidPageException( page );
+
+      len = mappedIt->length;
+      *data = new uint8_t[len];
+      memcpy( *data, mMappedData + mappedIt->offset, len );
+    }
+
+    virtual void storeByteArray( id_type& page, const uint32_t len, const uint8_t* const data ) override
+    {
+      if ( page == StorageManager::NewPage )
+        page = mNextPage++;
+      else if ( !mPages.contains( page ) && !mMappedPages.contains( page ) )
+        throw StorageManager::InvalidPageException( page );
+
+      mMappedPages.remove( page );
+      mPages.insert( page, QByteArray( reinterpret_cast<const char*>( data ), len ) );
+    }
+
+    virtual void deleteByteArray( const id_type page ) override
+    {
+      if ( mPages.remove( page ) + mMappedPages.remove( page ) == 0 )
+        throw StorageManager::InvalidPageException( page );
+    }
+
+    // not a part of IStorageManager in all versions of libspatialindex
+    virtual void flush() {}
+
+  private:
+    struct MappedPage
+    {
+      MappedPage( qint64 o = 0, quint32 l = 0 ) : offset( o ), length( l ) {}
+
+      qint64 offset;
+      quint32 length;
+    };
+
+    QFile mFile;
+    uchar* mMappedData;
+    QHash<qint64, MappedPage> mMappedPages;
+    QHash<qint64, QByteArray> mPages;
+    qint64 mNextPage;
+};
+
+bool QgsSpatialIndexFileStorage::open( const QString& path, const QFileInfo& source, id_type& indexId )
+{
+  mFile.setFileName( path );
+  if ( !source.exists() || !mFile.open( QIODevice::ReadOnly ) )
+    return false;
+
+  qint64 fileSize = mFile.size();
+  mMappedData = mFile.map( 0, fileSize );
+  if ( !mMappedData )
+    return false;
+
+  QByteArray data = QByteArray::fromRawData( reinterpret_cast<const char*>( mMappedData ), fileSize );
+  QDataStream stream( data );
+
+  quint32 magic, version, pageCount;
+  QByteArray sourceStamp;
+  qint64 id;
+  stream >> magic >> version >> sourceStamp >> id >> mNextPage >> pageCount;
+  if ( stream.status() != QDataStream::Ok || magic != INDEX_FILE_MAGIC || version != INDEX_FILE_VERSION )
+  {
+    QgsDebugMsg( QString( "%1 is not a spatial index file" ).arg( path ) );
+    return false;
+  }
+
+  if ( sourceStamp != QgsSpatialIndex::sourceFileStamp( source.absoluteFilePath() ) )
+  {
+    QgsDebugMsg( QString( "spatial index %1 is outdated" ).arg( path ) );
+    return false;
+  }
+
+  for ( quint32 i = 0; i < pageCount && stream.status() == QDataStream::Ok; ++i )
+  {
+    qint64 page, offset;
+    quint32 length;
+    stream >> page >> offset >> length;
+    mMappedPages.insert( page, MappedPage( offset, length ) );
+  }
+  if ( stream.status() != QDataStream::Ok )
+    return false;
+
+  // offsets in the file are relative to the end of the page table
+  qint64 dataStart = stream.device()->pos();
+  QHash<qint64, MappedPage>::iterator it = mMappedPages.begin();
+  for ( ; it != mMappedPages.end(); ++it )
+  {
+    it->offset += dataStart;
+    if ( it->offset < dataStart || it->offset + it->length > fileSize )
+    {
+      QgsDebugMsg( QString( "spatial index %1 is truncated" ).arg( path ) );
+      return false;
+    }
+  }
+
+  indexId = id;
+  return true;
+}
+
+bool QgsSpatialIndexFileStorage::write( const QString& path, const QFileInfo& source, id_type indexId ) const
+{
+  QFileInfo indexInfo( path );
+  if ( !QDir().mkpath( indexInfo.absolutePath() ) )
+    return false;
+
+  // write to a temporary file first, so that readers never see a partially written index
+  QString tmpPath = path + ".tmp";
+  QFile file( tmpPath );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    return false;
+
+  QList<qint64> pages = mPages.keys();
+  qSort( pages );
+
+  QDataStream stream( &file );
+  stream << INDEX_FILE_MAGIC << INDEX_FILE_VERSION
+  << QgsSpatialIndex::sourceFileStamp( source.absoluteFilePath() )
+  << qint64( indexId ) << mNextPage << quint32( pages.count() );
+
+  qint64 offset = 0;
+  Q_FOREACH ( qint64 page, pages )
+  {
+    quint32 length = mPages[page].size();
+    stream << page << offset << length;
+    offset += length;
+  }
+
+  Q_FOREACH ( qint64 page, pages )
+  {
+    const QByteArray& pageData = mPages[page];
+    stream.writeRawData( pageData.constData(), pageData.size() );
+  }
+
+  file.close();
+  bool ok = stream.status() == QDataStream::Ok && file.error() == QFile::NoError;
+  if ( ok )
+  {
+    QFile::remove( path );
+    ok = QFile::rename( tmpPath, path );
+  }
+  if ( !ok )
+  {
+    QgsDebugMsg( QString( "writing spatial index %1 failed" ).arg( path ) );
+    QFile::remove( tmpPath );
+  }
+  return ok;
+}
+
+
+//! Creates a new R-tree, bulk loaded from the stream if there is one
+static SpatialIndex::ISpatialIndex* createTree( IStorageManager& storage, IDataStream* inputStream, double fillFactor, id_type& indexId )
+{
+  RTree::RTreeVariant variant = RTree::RV_RSTAR;
+
+  if ( inputStream )
+    return RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, *inputStream, storage, fillFactor, INDEX_CAPACITY,
+           LEAF_CAPACITY, DIMENSION, variant, indexId );
+  else
+    return RTree::createNewRTree( storage, fillFactor, INDEX_CAPACITY,
+                                  LEAF_CAPACITY, DIMENSION, variant, indexId );
+}
+
+
 /** Utility class for bulk loading of R-trees. Not a part of public API. */
 class QgsFeatureIteratorDataStream : public IDataStream
 {
@@ -146,13 +422,20 @@ class QgsSpatialIndexData : public QSharedData
       initTree( &fids );
     }
 
+    //! takes ownership of storage and tree
+    QgsSpatialIndexData( SpatialIndex::IStorageManager* storage, SpatialIndex::ISpatialIndex* tree )
+        : mStorage( storage )
+        , mRTree( tree )
+    {
+    }
+
     QgsSpatialIndexData( const QgsSpatialIndexData& other )
         : QSharedData( other )
     {
       initTree();
 
       // copy R-tree data one by one (is there a faster way??)
-      double low[]  = { DBL_MIN, DBL_MIN };
+      double low[]  = { -DBL_MAX, -DBL_MAX };
       double high[] = { DBL_MAX, DBL_MAX };
       SpatialIndex::Region query( low, high, 2 );
       QgsSpatialIndexCopyVisitor visitor( mRTree );
@@ -167,25 +450,11 @@ class QgsSpatialIndexData : public QSharedData
 
     void initTree( IDataStream* inputStream = 0 )
     {
-      // for now only memory manager
       mStorage = StorageManager::createNewMemoryStorageManager();
 
-      // R-Tree parameters
-      double fillFactor = 0.7;
-      unsigned long indexCapacity = 10;
-      unsigned long leafCapacity = 10;
-      unsigned long dimension = 2;
-      RTree::RTreeVariant variant = RTree::RV_RSTAR;
-
       // create R-tree
       SpatialIndex::id_type indexId;
-
-      if ( inputStream )
-        mRTree = RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, *inputStream, *mStorage, fillFactor, indexCapacity,
-                 leafCapacity, dimension, variant, indexId );
-      else
-        mRTree = RTree::createNewRTree( *mStorage, fillFactor, indexCapacity,
-                                        leafCapacity, dimension, variant, indexId );
+      mRTree = createTree( *mStorage, inputStream, FILL_FACTOR, indexId );
     }
 
     /** Storage manager */
@@ -316,6 +585,107 @@ QList<QgsFeatureId> QgsSpatialIndex::nearestNeighbor( const QgsPoint& point, int
   return list;
 }
 
+bool QgsSpatialIndex::writeToFile( const QString& indexPath, const QString& sourcePath ) const
+{
+  QFileInfo source( sourcePath );
+  if ( !source.exists() )
+    return false;
+
+  try
+  {
+    // repack the entries into a tree kept by a file storage
+    QgsSpatialIndexEntriesStream entries( d->mRTree );
+    QgsSpatialIndexFileStorage storage;
+    SpatialIndex::id_type indexId;
+    SpatialIndex::ISpatialIndex* tree = createTree( storage, entries.hasNext() ? &entries : 0, PACKED_FILL_FACTOR, indexId );
+    // the header of the tree is stored when it is destroyed
+    delete tree;
+
+    return storage.write( indexPath, source, indexId );
+  }
+  catch ( Tools::Exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+  }
+  catch ( const std::exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "std::exception caught: %1" ).arg( e.what() ) );
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( "unknown spatial index exception caught" );
+  }
+
+  return false;
+}
+
+bool QgsSpatialIndex::readFromFile( const QString& indexPath, const QString& sourcePath )
+{
+  QgsSpatialIndexFileStorage* storage = new QgsSpatialIndexFileStorage;
+  SpatialIndex::id_type indexId;
+  if ( !storage->open( indexPath, QFileInfo( sourcePath ), indexId ) )
+  {
+    delete storage;
+    return false;
+  }
+
+  try
+  {
+    SpatialIndex::ISpatialIndex* tree = RTree::loadRTree( *storage, indexId );
+    d = new QgsSpatialIndexData( storage, tree );
+    return true;
+  }
+  catch ( Tools::Exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+  }
+  catch ( const std::exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "std::exception caught: %1" ).arg( e.what() ) );
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( "unknown spatial index exception caught" );
+  }
+
+  delete storage;
+  return false;
+}
+
+QString QgsSpatialIndex::cacheFilePath( const QString& sourcePath, const QString& key )
+{
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  hash.addData( QFileInfo( sourcePath ).absoluteFilePath().toUtf8() );
+  hash.addData( key.toUtf8() );
+  return QgsApplication::qgisSettingsDirPath() + "spatialindex/" + QString::fromAscii( hash.result().toHex() ) + ".qsix";
+}
+
+QByteArray QgsSpatialIndex::sourceFileStamp( const QString& sourcePath )
+{
+  QFileInfo info( sourcePath );
+  QFile file( sourcePath );
+  if ( !info.exists() || !file.open( QIODevice::ReadOnly ) )
+    return QByteArray();
+
+  // the modification time has a resolution of one second, so also hash the content
+  // at both ends of the file (where appended or rewritten records usually are)
+  QCryptographicHash hash( QCryptographicHash::Md5 );
+  QByteArray header;
+  QDataStream( &header, QIODevice::WriteOnly ) << qint64( info.size() ) << qint64( info.lastModified().toMSecsSinceEpoch() );
+  hash.addData( header );
+  hash.addData( file.read( SOURCE_STAMP_BYTES ) );
+  if ( file.size() > SOURCE_STAMP_BYTES )
+  {
+    file.seek( qMax( SOURCE_STAMP_BYTES, file.size() - SOURCE_STAMP_BYTES ) );
+    hash.addData( file.read( SOURCE_STAMP_BYTES ) );
+  }
+  return hash.result();
+}
+
 QAtomicInt QgsSpatialIndex::refs() const
 {
   return d->ref;
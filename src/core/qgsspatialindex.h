@@ -36,6 +36,7 @@ class QgsPoint;
 
 #include <QList>
 #include <QSharedDataPointer>
+#include <QString>
 
 #include "qgsfeature.h"
 
@@ -85,6 +86,48 @@ class CORE_EXPORT QgsSpatialIndex
     /** Returns nearest neighbors (their count is specified by second parameter) */
     QList<QgsFeatureId> nearestNeighbor( const QgsPoint& point, int neighbors ) const;
 
+    /* persistence */
+
+    /** Writes the index to a file so that it can be opened later with readFromFile().
+     * The entries are bulk loaded into a packed tree. The sourceFileStamp() of the data
+     * source file is stored with the index, so that the index is not used anymore
+     * once the data source has changed.
+     * @param indexPath file to write, missing directories are created
+     * @param sourcePath file of the indexed data source
+     * @returns true on success
+     * @note added in QGIS 2.12
+     */
+    bool writeToFile( const QString& indexPath, const QString& sourcePath ) const;
+
+    /** Replaces the content of the index by an index written with writeToFile().
+     * The file is memory mapped and its pages are only read when a query visits them,
+     * so opening even a large index is cheap. Features inserted or deleted afterwards
+     * only change the index in memory, the file is never modified.
+     * @param indexPath file written by writeToFile()
+     * @param sourcePath file of the indexed data source
+     * @returns false if the file does not exist, is not a valid index or if the data
+     * source has been modified since the index was written. The index is unchanged then.
+     * @note added in QGIS 2.12
+     */
+    bool readFromFile( const QString& indexPath, const QString& sourcePath );
+
+    /** Returns the path of the file used to cache the index of a data source. Cached
+     * indexes are kept in the spatialindex directory of the QGIS settings directory.
+     * @param sourcePath file of the indexed data source
+     * @param key distinguishes different indexes of the same file, e.g. built with
+     * different layer definitions
+     * @note added in QGIS 2.12
+     */
+    static QString cacheFilePath( const QString& sourcePath, const QString& key = QString() );
+
+    /** Returns a stamp identifying the content of a data source file: a hash of its size,
+     * modification time and of the data at its start and end. Unlike the modification time
+     * alone, it also changes when a file is rewritten with the same size within a second.
+     * Returns an empty array if the file cannot be read.
+     * @note added in QGIS 2.12
+     */
+    static QByteArray sourceFileStamp( const QString& sourcePath );
+
     /* debugging */
 
     //! get reference count - just for debugging!
@@ -0,0 +1,367 @@
+/***************************************************************************
+  qgssqlexpressioncompiler.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgssqlexpressioncompiler.h"
+
+#include <QSettings>
+
+QgsSqlExpressionCompiler::QgsSqlExpressionCompiler( const QgsFields& fields, const Flags& flags )
+    : mFields( fields )
+    , mFlags( flags )
+{
+}
+
+QgsSqlExpressionCompiler::~QgsSqlExpressionCompiler()
+{
+
+}
+
+bool QgsSqlExpressionCompiler::isEnabled()
+{
+  QSettings settings;
+  return settings.value( "/qgis/compileExpressions", false ).toBool()
+         || settings.value( "/qgis/postgres/compileExpressions", false ).toBool();
+}
+
+QgsSqlExpressionCompiler::Result QgsSqlExpressionCompiler::compile( const QgsExpression* exp )
+{
+  if ( exp->rootNode() )
+    return compileNode( exp->rootNode(), mResult );
+  else
+    return Fail;
+}
+
+QString QgsSqlExpressionCompiler::quotedIdentifier( const QString& identifier )
+{
+  QString quoted = identifier;
+  quoted.replace( '"', "\"\"" );
+  quoted = quoted.prepend( '\"' ).append( '\"' );
+  return quoted;
+}
+
+QString QgsSqlExpressionCompiler::quotedValue( const QVariant& value )
+{
+  if ( value.isNull() )
+    return "NULL";
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::LongLong:
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+      return value.toString();
+
+    case QVariant::Double:
+      return qgsDoubleToString( value.toDouble() );
+
+    case QVariant::Bool:
+      return value.toBool() ? "1" : "0";
+
+    case QVariant::String:
+    {
+      QString v = value.toString();
+      v.replace( '\'', "''" );
+      return v.prepend( '\'' ).append( '\'' );
+    }
+
+    default:
+      return QString();
+  }
+}
+
+QString QgsSqlExpressionCompiler::sqlOperator( QgsExpression::BinaryOperator op )
+{
+  switch ( op )
+  {
+    case QgsExpression::boEQ: return "=";
+    case QgsExpression::boNE: return "<>";
+    case QgsExpression::boGE: return ">=";
+    case QgsExpression::boGT: return ">";
+    case QgsExpression::boLE: return "<=";
+    case QgsExpression::boLT: return "<";
+    case QgsExpression::boLike: return "LIKE";
+    case QgsExpression::boNotLike: return "NOT LIKE";
+    case QgsExpression::boMul: return "*";
+    case QgsExpression::boPlus: return "+";
+    case QgsExpression::boMinus: return "-";
+    case QgsExpression::boMod: return "%";
+    case QgsExpression::boConcat: return "||";
+
+    // results differ between providers (integer division, case sensitivity, regexp flavours)
+    case QgsExpression::boDiv:
+    case QgsExpression::boIntDiv:
+    case QgsExpression::boPow:
+    case QgsExpression::boILike:
+    case QgsExpression::boNotILike:
+    case QgsExpression::boRegexp:
+    default:
+      return QString();
+  }
+}
+
+bool QgsSqlExpressionCompiler::isStringNode( const QgsExpression::Node* node ) const
+{
+  if ( node->nodeType() == QgsExpression::ntLiteral )
+    return static_cast<const QgsExpression::NodeLiteral*>( node )->value().type() == QVariant::String;
+
+  if ( node->nodeType() == QgsExpression::ntColumnRef )
+  {
+    int idx = mFields.indexFromName( static_cast<const QgsExpression::NodeColumnRef*>( node )->name() );
+    return idx >= 0 && mFields[idx].type() == QVariant::String;
+  }
+
+  if ( node->nodeType() == QgsExpression::ntBinaryOperator )
+    return static_cast<const QgsExpression::NodeBinaryOperator*>( node )->op() == QgsExpression::boConcat;
+
+  return false;
+}
+
+bool QgsSqlExpressionCompiler::isNumericNode( const QgsExpression::Node* node ) const
+{
+  QVariant::Type type = QVariant::Invalid;
+  if ( node->nodeType() == QgsExpression::ntLiteral )
+  {
+    type = static_cast<const QgsExpression::NodeLiteral*>( node )->value().type();
+  }
+  else if ( node->nodeType() == QgsExpression::ntColumnRef )
+  {
+    int idx = mFields.indexFromName( static_cast<const QgsExpression::NodeColumnRef*>( node )->name() );
+    if ( idx >= 0 )
+      type = mFields[idx].type();
+  }
+
+  switch ( type )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+QgsSqlExpressionCompiler::Result QgsSqlExpressionCompiler::compileNode( const QgsExpression::Node* node, QString& result )
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntUnaryOperator:
+    {
+      const QgsExpression::NodeUnaryOperator* n = static_cast<const QgsExpression::NodeUnaryOperator*>( node );
+
+      QString operand;
+      // negation of a superset is not a superset
+      if ( compileNode( n->operand(), operand ) != Complete )
+        return Fail;
+
+      switch ( n->op() )
+      {
+        case QgsExpression::uoNot:
+          result = QString( "(NOT %1)" ).arg( operand );
+          return Complete;
+
+        case QgsExpression::uoMinus:
+          result = QString( "(-%1)" ).arg( operand );
+          return Complete;
+      }
+
+      break;
+    }
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      const QgsExpression::NodeBinaryOperator* n = static_cast<const QgsExpression::NodeBinaryOperator*>( node );
+
+      QString left;
+      QString right;
+
+      switch ( n->op() )
+      {
+        case QgsExpression::boAnd:
+        case QgsExpression::boOr:
+        {
+          Result lr = compileNode( n->opLeft(), left );
+          Result rr = compileNode( n->opRight(), right );
+
+          if ( n->op() == QgsExpression::boAnd )
+          {
+            // dropping one side of an AND selects a superset of the features
+            if ( lr == Fail && rr == Fail )
+              return Fail;
+            if ( lr == Fail )
+            {
+              result = right;
+              return Partial;
+            }
+            if ( rr == Fail )
+            {
+              result = left;
+              return Partial;
+            }
+          }
+          else if ( lr == Fail || rr == Fail )
+          {
+            return Fail;
+          }
+
+          result = QString( "(%1 %2 %3)" ).arg( left, n->op() == QgsExpression::boAnd ? "AND" : "OR", right );
+          return lr == Complete && rr == Complete ? Complete : Partial;
+        }
+
+        case QgsExpression::boIs:
+        case QgsExpression::boIsNot:
+        {
+          // only "IS NULL" is portable SQL
+          if ( n->opRight()->nodeType() != QgsExpression::ntLiteral
+               || !static_cast<const QgsExpression::NodeLiteral*>( n->opRight() )->value().isNull() )
+            return Fail;
+
+          if ( compileNode( n->opLeft(), left ) != Complete )
+            return Fail;
+
+          result = QString( "(%1 %2 NULL)" ).arg( left, n->op() == QgsExpression::boIs ? "IS" : "IS NOT" );
+          return Complete;
+        }
+
+        default:
+          break;
+      }
+
+      QString op = sqlOperator( n->op() );
+      if ( op.isNull() )
+        return Fail;
+
+      bool stringOperands = isStringNode( n->opLeft() ) || isStringNode( n->opRight() );
+      bool mixedOperands = ( isStringNode( n->opLeft() ) && isNumericNode( n->opRight() ) )
+                           || ( isNumericNode( n->opLeft() ) && isStringNode( n->opRight() ) );
+      bool partial = false;
+      switch ( n->op() )
+      {
+        case QgsExpression::boPlus:
+          // QGIS concatenates strings with +
+          if ( stringOperands )
+            return Fail;
+          break;
+
+        case QgsExpression::boLike:
+          if ( mFlags & ( LikeIsCaseInsensitive | CaseInsensitiveStringMatch ) )
+            partial = true;
+          break;
+
+        case QgsExpression::boNotLike:
+          if ( mFlags & ( LikeIsCaseInsensitive | CaseInsensitiveStringMatch ) )
+            return Fail;
+          break;
+
+        case QgsExpression::boEQ:
+        case QgsExpression::boNE:
+        case QgsExpression::boGE:
+        case QgsExpression::boGT:
+        case QgsExpression::boLE:
+        case QgsExpression::boLT:
+          // the provider may not even return a superset of the matching features, so the
+          // comparison is left out - within an AND the result is then partial
+          if ( mixedOperands && mFlags & MixedTypeComparisonsDiffer )
+            return Fail;
+          if ( stringOperands && mFlags & CaseInsensitiveStringMatch )
+          {
+            if ( n->op() != QgsExpression::boEQ )
+              return Fail;
+            partial = true;
+          }
+          break;
+
+        default:
+          break;
+      }
+
+      if ( compileNode( n->opLeft(), left ) != Complete || compileNode( n->opRight(), right ) != Complete )
+        return Fail;
+
+      result = QString( "(%1 %2 %3)" ).arg( left, op, right );
+      return partial ? Partial : Complete;
+    }
+
+    case QgsExpression::ntLiteral:
+    {
+      const QgsExpression::NodeLiteral* n = static_cast<const QgsExpression::NodeLiteral*>( node );
+      result = quotedValue( n->value() );
+      return result.isNull() ? Fail : Complete;
+    }
+
+    case QgsExpression::ntColumnRef:
+    {
+      const QgsExpression::NodeColumnRef* n = static_cast<const QgsExpression::NodeColumnRef*>( node );
+
+      if ( mFields.indexFromName( n->name() ) == -1 )
+        // Not a provider field
+        return Fail;
+
+      result = quotedIdentifier( n->name() );
+
+      return Complete;
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      const QgsExpression::NodeInOperator* n = static_cast<const QgsExpression::NodeInOperator*>( node );
+
+      bool partial = false;
+      if ( mFlags & MixedTypeComparisonsDiffer )
+      {
+        bool stringNode = isStringNode( n->node() );
+        bool numericNode = isNumericNode( n->node() );
+        Q_FOREACH ( const QgsExpression::Node* ln, n->list()->list() )
+        {
+          if (( stringNode && isNumericNode( ln ) ) || ( numericNode && isStringNode( ln ) ) )
+            return Fail;
+        }
+      }
+
+      if ( mFlags & CaseInsensitiveStringMatch && isStringNode( n->node() ) )
+      {
+        if ( n->isNotIn() )
+          return Fail;
+        partial = true;
+      }
+
+      QStringList list;
+      Q_FOREACH ( const QgsExpression::Node* ln, n->list()->list() )
+      {
+        QString s;
+        if ( compileNode( ln, s ) != Complete )
+          return Fail;
+        list << s;
+      }
+
+      QString nd;
+      if ( compileNode( n->node(), nd ) != Complete )
+        return Fail;
+
+      result = QString( "(%1 %2IN (%3))" ).arg( nd, n->isNotIn() ? "NOT " : "", list.join( "," ) );
+      return partial ? Partial : Complete;
+    }
+
+    case QgsExpression::ntFunction:
+    case QgsExpression::ntCondition:
+      break;
+  }
+
+  return Fail;
+}
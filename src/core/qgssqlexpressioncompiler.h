@@ -0,0 +1,122 @@
+/***************************************************************************
+  qgssqlexpressioncompiler.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSQLEXPRESSIONCOMPILER_H
+#define QGSSQLEXPRESSIONCOMPILER_H
+
+#include "qgsexpression.h"
+#include "qgsfield.h"
+
+/** \ingroup core
+ * \class QgsSqlExpressionCompiler
+ * Generic expression compiler for translation to provider specific SQL WHERE clauses.
+ *
+ * The default implementation translates to a portable subset of SQL. Providers can
+ * subclass it to adjust quoting of identifiers and values or to enable additional operators.
+ *
+ * A compiled result may be partial: the WHERE clause then selects a superset of the
+ * features matched by the expression (e.g. because a part of an AND could not be
+ * translated or because LIKE is case insensitive on the server), so the expression
+ * still has to be evaluated locally on the returned features.
+ *
+ * @note added in QGIS 2.12
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsSqlExpressionCompiler
+{
+  public:
+
+    /** Possible results from expression compilation */
+    enum Result
+    {
+      None, //!< No expression
+      Complete, //!< Expression was successfully compiled and can be completely delegated to provider
+      Partial, //!< Expression was compiled, but the provider will return a superset of matching features. Local filtering is still required.
+      Fail //!< Provider cannot handle expression
+    };
+
+    /** Enumeration of flags for how provider handles SQL clauses
+     */
+    enum Flag
+    {
+      LikeIsCaseInsensitive = 1, //!< Provider performs case-insensitive LIKE matching
+      CaseInsensitiveStringMatch = 1 << 1, //!< Provider performs all string comparisons case-insensitively
+      MixedTypeComparisonsDiffer = 1 << 2, //!< Provider compares strings to numbers differently from QgsExpression
+    };
+    Q_DECLARE_FLAGS( Flags, Flag )
+
+    /** Constructor for expression compiler.
+     * @param fields fields from provider
+     * @param flags flags which control how expression is compiled
+     */
+    explicit QgsSqlExpressionCompiler( const QgsFields& fields, const Flags& flags = Flags() );
+    virtual ~QgsSqlExpressionCompiler();
+
+    /** Returns true if expressions should be compiled for the providers. The setting used to
+     * apply to the postgres provider only, so it is still read as a fallback.
+     */
+    static bool isEnabled();
+
+    /** Compiles an expression and returns the result of the compilation.
+     */
+    virtual Result compile( const QgsExpression* exp );
+
+    /** Returns the compiled expression string for use by the provider.
+     */
+    virtual QString result() const { return mResult; }
+
+  protected:
+
+    /** Returns a quoted column identifier, in the format expected by the provider.
+     * @see quotedValue()
+     */
+    virtual QString quotedIdentifier( const QString& identifier );
+
+    /** Returns a quoted attribute value, in the format expected by the provider.
+     * Returns a null string if the value can not be represented.
+     * @see quotedIdentifier()
+     */
+    virtual QString quotedValue( const QVariant& value );
+
+    /** Returns the SQL operator for a binary expression operator, or a null string
+     * if the operator is not supported by the provider. AND, OR, IS and IS NOT
+     * are handled separately.
+     */
+    virtual QString sqlOperator( QgsExpression::BinaryOperator op );
+
+    /** Compiles an expression node and returns the result of the compilation.
+     * @param node expression node to compile
+     * @param str string representing compiled node should be stored in this parameter
+     * @returns result of node compilation
+     */
+    virtual Result compileNode( const QgsExpression::Node* node, QString& str );
+
+    /** Returns true if the node evaluates to a string (string literal or string field) */
+    bool isStringNode( const QgsExpression::Node* node ) const;
+
+    /** Returns true if the node evaluates to a number (numeric literal or numeric field) */
+    bool isNumericNode( const QgsExpression::Node* node ) const;
+
+    QString mResult;
+    QgsFields mFields;
+
+  private:
+
+    Flags mFlags;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS( QgsSqlExpressionCompiler::Flags )
+
+#endif // QGSSQLEXPRESSIONCOMPILER_H
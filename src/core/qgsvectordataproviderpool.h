@@ -0,0 +1,51 @@
+/***************************************************************************
+  qgsvectordataproviderpool.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSVECTORDATAPROVIDERPOOL_H
+#define QGSVECTORDATAPROVIDERPOOL_H
+
+#include <QString>
+
+class QgsVectorDataProvider;
+
+/**
+ * Interface of a pool of data providers shared by vector layers with the same data source.
+ *
+ * If a pool is set with QgsVectorLayer::setDataProviderPool(), vector layers ask it for a
+ * provider before they create their own one and hand the provider back to the pool instead
+ * of deleting it. A layer changing the subset string or the encoding of a shared provider
+ * switches to a provider of its own first, so shared providers are used read-only.
+ *
+ * The pool must outlive all layers using its providers.
+ *
+ * @note added in QGIS 2.12
+ */
+class CORE_EXPORT QgsVectorDataProviderPool
+{
+  public:
+    virtual ~QgsVectorDataProviderPool() {}
+
+    /** Returns a valid provider for a data source or null if the layer should create its own provider.
+     * @param providerKey provider key (e.g. "postgres" or "ogr")
+     * @param dataSource data source URI
+     * @param encoding text encoding of the layer, empty for the default encoding of the provider
+     */
+    virtual QgsVectorDataProvider* acquireProvider( const QString& providerKey, const QString& dataSource, const QString& encoding ) = 0;
+
+    //! Called when a layer does not use a provider returned by acquireProvider() any more
+    virtual void releaseProvider( QgsVectorDataProvider* provider ) = 0;
+};
+
+#endif // QGSVECTORDATAPROVIDERPOOL_H
@@ -54,6 +54,9 @@
 #define TO8F(x)  QFile::encodeName( x ).constData()
 #endif
 
+//! number of features fetched from the layer at once when writing
+static const int FEATURE_BATCH_SIZE = 2000;
+
 
 QgsVectorFileWriter::QgsVectorFileWriter(
   const QString &theVectorFileName,
@@ -1965,7 +1968,6 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
   }
 
   QgsAttributeList allAttr = skipAttributeCreation ? QgsAttributeList() : layer->attributeList();
-  QgsFeature fet;
 
   //add possible attributes needed by renderer
   writer->addRendererAttributes( layer, allAttr );
@@ -2018,68 +2020,77 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
     transactionsEnabled = false;
   }
 
-  // write all features
-  while ( fit.nextFeature( fet ) )
+  // write all features, fetched in blocks
+  QgsFeatureList batch;
+  bool stop = false;
+  while ( !stop && fit.nextFeatures( batch, FEATURE_BATCH_SIZE ) )
   {
-    if ( onlySelected && !ids.contains( fet.id() ) )
-      continue;
-
-    if ( shallTransform )
+    for ( QgsFeatureList::iterator it = batch.begin(); it != batch.end(); ++it )
     {
-      try
+      QgsFeature& fet = *it;
+
+      if ( onlySelected && !ids.contains( fet.id() ) )
+        continue;
+
+      if ( shallTransform )
       {
-        if ( fet.geometry() )
+        try
         {
-          fet.geometry()->transform( *ct );
+          if ( fet.geometry() )
+          {
+            fet.geometry()->transform( *ct );
+          }
         }
-      }
-      catch ( QgsCsException &e )
-      {
-        delete writer;
+        catch ( QgsCsException &e )
+        {
+          delete writer;
 
-        QString msg = QObject::tr( "Failed to transform a point while drawing a feature with ID '%1'. Writing stopped. (Exception: %2)" )
-                      .arg( fet.id() ).arg( e.what() );
-        QgsLogger::warning( msg );
-        if ( errorMessage )
-          *errorMessage = msg;
+          QString msg = QObject::tr( "Failed to transform a point while drawing a feature with ID '%1'. Writing stopped. (Exception: %2)" )
+                        .arg( fet.id() ).arg( e.what() );
+          QgsLogger::warning( msg );
+          if ( errorMessage )
+            *errorMessage = msg;
 
-        return ErrProjection;
+          return ErrProjection;
+        }
       }
-    }
 
-    if ( fet.constGeometry() && filterExtent && !fet.constGeometry()->intersects( *filterExtent ) )
-      continue;
-
-    if ( allAttr.size() < 1 && skipAttributeCreation )
-    {
-      fet.initAttributes( 0 );
-    }
+      if ( fet.constGeometry() && filterExtent && !fet.constGeometry()->intersects( *filterExtent ) )
+        continue;
 
-    if ( !writer->addFeature( fet, layer->rendererV2(), mapUnits ) )
-    {
-      WriterError err = writer->hasError();
-      if ( err != NoError && errorMessage )
+      if ( allAttr.size() < 1 && skipAttributeCreation )
       {
-        if ( errorMessage->isEmpty() )
-        {
-          *errorMessage = QObject::tr( "Feature write errors:" );
-        }
-        *errorMessage += "\n" + writer->errorMessage();
+        fet.initAttributes( 0 );
       }
-      errors++;
 
-      if ( errors > 1000 )
+      if ( !writer->addFeature( fet, layer->rendererV2(), mapUnits ) )
       {
-        if ( errorMessage )
+        WriterError err = writer->hasError();
+        if ( err != NoError && errorMessage )
         {
-          *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( errors );
+          if ( errorMessage->isEmpty() )
+          {
+            *errorMessage = QObject::tr( "Feature write errors:" );
+          }
+          *errorMessage += "\n" + writer->errorMessage();
         }
+        errors++;
 
-        n = -1;
-        break;
+        if ( errors > 1000 )
+        {
+          if ( errorMessage )
+          {
+            *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( errors );
+          }
+
+          n = -1;
+          stop = true;
+          break;
+        }
       }
+      n++;
     }
-    n++;
+    batch.clear();
   }
 
   if ( transactionsEnabled )
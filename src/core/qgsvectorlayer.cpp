@@ -64,6 +64,7 @@
 #include "qgsrelationmanager.h"
 #include "qgsrendercontext.h"
 #include "qgsvectordataprovider.h"
+#include "qgsvectordataproviderpool.h"
 #include "qgsvectorlayereditbuffer.h"
 #include "qgsvectorlayereditpassthrough.h"
 #include "qgsvectorlayereditutils.h"
@@ -120,12 +121,15 @@ typedef QString getStyleById_t(
   QString& errCause
 );
 
+QgsVectorDataProviderPool *QgsVectorLayer::sDataProviderPool = 0;
+
 QgsVectorLayer::QgsVectorLayer( const QString& vectorLayerPath,
                                 const QString& baseName,
                                 const QString& providerKey,
                                 bool loadDefaultStyleFlag )
     : QgsMapLayer( VectorLayer, baseName, vectorLayerPath )
     , mDataProvider( NULL )
+    , mDataProviderPool( NULL )
     , mProviderKey( providerKey )
     , mReadOnly( false )
     , mWkbType( QGis::WKBUnknown )
@@ -181,7 +185,7 @@ QgsVectorLayer::~QgsVectorLayer()
 
   mValid = false;
 
-  delete mDataProvider;
+  releaseDataProvider();
   delete mEditBuffer;
   delete mJoinBuffer;
   delete mExpressionFieldBuffer;
@@ -559,7 +563,7 @@ const QgsVectorDataProvider* QgsVectorLayer::dataProvider() const
 
 void QgsVectorLayer::setProviderEncoding( const QString& encoding )
 {
-  if ( mDataProvider && mDataProvider->encoding() != encoding )
+  if ( mDataProvider && mDataProvider->encoding() != encoding && detachDataProvider() )
   {
     mDataProvider->setEncoding( encoding );
     updateFields();
@@ -889,6 +893,11 @@ bool QgsVectorLayer::setSubsetString( const QString& subset )
     return false;
   }
 
+  if ( subset != mDataProvider->subsetString() && !detachDataProvider() )
+  {
+    return false;
+  }
+
   bool res = mDataProvider->setSubsetString( subset );
 
   // get the updated data source string from the provider
@@ -1349,19 +1358,16 @@ bool QgsVectorLayer::readXml( const QDomNode& layer_node )
     mProviderKey = "ogr";
   }
 
-  if ( ! setDataProvider( mProviderKey ) )
+  QString encodingString;
+  QDomElement pkeyElem = pkeyNode.toElement();
+  if ( !pkeyElem.isNull() )
   {
-    return false;
+    encodingString = pkeyElem.attribute( "encoding" );
   }
 
-  QDomElement pkeyElem = pkeyNode.toElement();
-  if ( !pkeyElem.isNull() )
+  if ( ! setDataProvider( mProviderKey, encodingString ) )
   {
-    QString encodingString = pkeyElem.attribute( "encoding" );
-    if ( !encodingString.isEmpty() )
-    {
-      mDataProvider->setEncoding( encodingString );
-    }
+    return false;
   }
 
   //load vector joins
@@ -1448,16 +1454,32 @@ void QgsVectorLayer::setDataSource( const QString& dataSource, const QString& ba
 }
 
 
-bool QgsVectorLayer::setDataProvider( QString const & provider )
+bool QgsVectorLayer::setDataProvider( QString const & provider, const QString& encoding )
 {
   mProviderKey = provider;     // XXX is this necessary?  Usually already set
   // XXX when execution gets here.
 
-  //XXX - This was a dynamic cast but that kills the Windows
-  //      version big-time with an abnormal termination error
-  delete mDataProvider;
-  mDataProvider =
-    ( QgsVectorDataProvider* )( QgsProviderRegistry::instance()->provider( provider, mDataSource ) );
+  releaseDataProvider();
+  if ( sDataProviderPool )
+  {
+    mDataProvider = sDataProviderPool->acquireProvider( provider, mDataSource, encoding );
+    if ( mDataProvider )
+    {
+      mDataProviderPool = sDataProviderPool;
+    }
+  }
+
+  if ( !mDataProvider )
+  {
+    //XXX - This was a dynamic cast but that kills the Windows
+    //      version big-time with an abnormal termination error
+    mDataProvider =
+      ( QgsVectorDataProvider* )( QgsProviderRegistry::instance()->provider( provider, mDataSource ) );
+    if ( mDataProvider && !encoding.isEmpty() )
+    {
+      mDataProvider->setEncoding( encoding );
+    }
+  }
 
   if ( mDataProvider )
   {
@@ -1547,6 +1569,60 @@ bool QgsVectorLayer::setDataProvider( QString const & provider )
 
 } // QgsVectorLayer:: setDataProvider
 
+void QgsVectorLayer::releaseDataProvider()
+{
+  if ( !mDataProvider )
+  {
+    return;
+  }
+
+  disconnect( mDataProvider, 0, this, 0 );
+  if ( mDataProviderPool )
+  {
+    mDataProviderPool->releaseProvider( mDataProvider );
+  }
+  else
+  {
+    delete mDataProvider;
+  }
+  mDataProvider = 0;
+  mDataProviderPool = 0;
+}
+
+bool QgsVectorLayer::detachDataProvider()
+{
+  if ( !mDataProviderPool )
+  {
+    return true;
+  }
+
+  QgsVectorDataProvider* provider = ( QgsVectorDataProvider* )( QgsProviderRegistry::instance()->provider( mProviderKey, mDataSource ) );
+  if ( !provider || !provider->isValid() )
+  {
+    QgsDebugMsg( "Could not create a data provider replacing the shared provider" );
+    delete provider;
+    return false;
+  }
+  provider->setEncoding( mDataProvider->encoding() );
+
+  releaseDataProvider();
+  mDataProvider = provider;
+  connect( mDataProvider, SIGNAL( fullExtentCalculated() ), this, SLOT( updateExtents() ) );
+  connect( mDataProvider, SIGNAL( dataChanged() ), this, SIGNAL( dataChanged() ) );
+  connect( mDataProvider, SIGNAL( dataChanged() ), this, SLOT( removeSelection() ) );
+  return true;
+}
+
+void QgsVectorLayer::setDataProviderPool( QgsVectorDataProviderPool* pool )
+{
+  sDataProviderPool = pool;
+}
+
+QgsVectorDataProviderPool* QgsVectorLayer::dataProviderPool()
+{
+  return sDataProviderPool;
+}
+
 
 
 
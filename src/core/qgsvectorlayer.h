@@ -34,6 +34,7 @@
 #include "qgssnapper.h"
 #include "qgsrelation.h"
 #include "qgsvectorsimplifymethod.h"
+#include "qgsvectorlayerjoincache.h"
 
 class QPainter;
 class QImage;
@@ -61,6 +62,7 @@ class QgsRelationManager;
 class QgsSingleSymbolRendererV2;
 class QgsSymbolV2;
 class QgsVectorDataProvider;
+class QgsVectorDataProviderPool;
 class QgsVectorLayerEditBuffer;
 class QgsVectorLayerJoinBuffer;
 class QgsAbstractVectorLayerLabeling;
@@ -324,10 +326,12 @@ struct CORE_EXPORT QgsVectorJoinInfo
   QString joinFieldName;
   /** True if the join is cached in virtual memory*/
   bool memoryCache;
-  /** Cache for joined attributes to provide fast lookup (size is 0 if no memory caching)
+  /** Cache for joined attributes to provide fast lookup (null if no memory caching).
+    The cache is shared by copies of the join info and loaded when it is first used.
     @note not available in python bindings
+    @note added in QGIS 2.12, replaces cachedAttributes
     */
-  QHash< QString, QgsAttributes> cachedAttributes;
+  QSharedPointer<QgsVectorLayerJoinCache> cache;
 
   /** Join field index in the target layer. For backward compatibility with 1.x (x>=7)*/
   int targetFieldIndex;
@@ -790,6 +794,23 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** Sets the textencoding of the data provider */
     void setProviderEncoding( const QString& encoding );
 
+    /** Returns true if the data provider of the layer comes from a QgsVectorDataProviderPool
+     * and may be used by other layers
+     * @note added in QGIS 2.12
+     */
+    bool hasSharedDataProvider() const { return mDataProviderPool != 0; }
+
+    /** Sets the pool asked for shared data providers by layers creating their data provider.
+     * Does not take ownership, null disables sharing of data providers.
+     * @note added in QGIS 2.12
+     */
+    static void setDataProviderPool( QgsVectorDataProviderPool* pool );
+
+    /** Returns the pool asked for shared data providers or null
+     * @note added in QGIS 2.12
+     */
+    static QgsVectorDataProviderPool* dataProviderPool();
+
     /** Setup the coordinate system transformation for the layer */
     void setCoordinateSystem();
 
@@ -2025,7 +2046,15 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
        @param provider should be "postgres", "ogr", or ??
        @todo XXX should this return bool?  Throw exceptions?
     */
-    bool setDataProvider( QString const & provider );
+    bool setDataProvider( QString const & provider, const QString& encoding = QString() );
+
+    /** Deletes the data provider or hands it back to the provider pool */
+    void releaseDataProvider();
+
+    /** Replaces a shared data provider by a provider of this layer (before changing the subset or encoding)
+     * @return false if the provider could not be created
+     */
+    bool detachDataProvider();
 
     /** Goes through all features and finds a free id (e.g. to give it temporarily to a not-commited feature) */
     QgsFeatureId findFreeId();
@@ -2058,6 +2087,12 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** Pointer to data provider derived from the abastract base class QgsDataProvider */
     QgsVectorDataProvider *mDataProvider;
 
+    /** Pool of a shared data provider, null if the layer owns its data provider */
+    QgsVectorDataProviderPool *mDataProviderPool;
+
+    /** Pool asked for shared data providers */
+    static QgsVectorDataProviderPool *sDataProviderPool;
+
     /** Index of the primary label field */
     QString mDisplayField;
 
@@ -2180,6 +2215,7 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     QgsFeatureIds mDeletedFids;
 
     friend class QgsVectorLayerFeatureSource;
+    friend class QgsVectorLayerJoinBuffer;
 };
 
 #endif
@@ -105,8 +105,6 @@ class CORE_EXPORT QgsVectorLayerDiagramProvider : public QgsAbstractLabelProvide
     QgsDiagramLayerSettings mSettings;
     //! Diagram renderer instance (owned by mSettings)
     QgsDiagramRendererV2* mDiagRenderer;
-    //! ID of the layer
-    QString mLayerId;
 
     // these are needed only if using own renderer loop
 
@@ -72,6 +72,22 @@ QgsVectorLayerFeatureSource::QgsVectorLayerFeatureSource( QgsVectorLayer *layer
   }
 }
 
+QgsVectorLayerFeatureSource::QgsVectorLayerFeatureSource( const QgsVectorLayerFeatureSource& other, QgsAbstractFeatureSource* providerFeatureSource )
+    : mProviderFeatureSource( providerFeatureSource )
+    , mJoinBuffer( other.mJoinBuffer->clone() )
+    , mExpressionFieldBuffer( new QgsExpressionFieldBuffer( *other.mExpressionFieldBuffer ) )
+    , mFields( other.mFields )
+    , mHasEditBuffer( other.mHasEditBuffer )
+    , mCanBeSimplified( other.mCanBeSimplified )
+    , mAddedFeatures( other.mAddedFeatures )
+    , mChangedGeometries( other.mChangedGeometries )
+    , mDeletedFeatureIds( other.mDeletedFeatureIds )
+    , mAddedAttributes( other.mAddedAttributes )
+    , mChangedAttributeValues( other.mChangedAttributeValues )
+    , mDeletedAttributeIds( other.mDeletedAttributeIds )
+{
+}
+
 QgsVectorLayerFeatureSource::~QgsVectorLayerFeatureSource()
 {
   delete mJoinBuffer;
@@ -251,6 +267,38 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature& f )
 
 
 
+int QgsVectorLayerFeatureIterator::fetchFeatures( QgsFeatureList& features, int maxCount )
+{
+  // features from the edit buffer need to be merged one by one
+  if ( mSource->mHasEditBuffer || mRequest.filterType() == QgsFeatureRequest::FilterFid )
+    return QgsAbstractFeatureIterator::fetchFeatures( features, maxCount );
+
+  if ( mClosed )
+    return 0;
+
+  if ( mProviderIterator.isClosed() )
+  {
+    mChangedFeaturesIterator.close();
+    mProviderIterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+  }
+
+  int count = mProviderIterator.nextFeatures( features, maxCount );
+  int first = features.count() - count;
+  for ( int i = first; i < features.count(); ++i )
+  {
+    features[i].setFields( mSource->mFields );
+  }
+
+  if ( mHasVirtualAttributes )
+    addVirtualAttributes( features, first );
+
+  // the provider iterator has finished
+  if ( count < maxCount )
+    close();
+  return count;
+}
+
+
 bool QgsVectorLayerFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -494,6 +542,22 @@ void QgsVectorLayerFeatureIterator::prepareJoins()
 
     // store field source index - we'll need it when fetching from provider
     mFetchJoinInfo[ joinInfo ].attributes.push_back( sourceLayerIndex );
+    mFetchJoinInfo[ joinInfo ].targetAttributes.push_back( *attIt );
+  }
+
+  // load the memory caches with the attributes we need
+  for ( QMap<const QgsVectorJoinInfo*, FetchJoinInfo>::iterator it = mFetchJoinInfo.begin(); it != mFetchJoinInfo.end(); ++it )
+  {
+    FetchJoinInfo& info = it.value();
+    if ( !info.joinInfo->memoryCache || !info.joinInfo->cache )
+      continue;
+
+    info.cacheTable = info.joinInfo->cache->table( info.joinLayer, info.joinField, info.attributes );
+    if ( !info.cacheTable )
+      continue; // too big to be held in memory, joined features are fetched in batches
+
+    for ( int i = 0; i < info.attributes.count(); ++i )
+      info.cacheIndices << info.cacheTable->attributes().indexOf( info.attributes.at( i ) );
   }
 
   // add sourceJoinFields if we're using a subset
@@ -555,11 +619,48 @@ void QgsVectorLayerFeatureIterator::addJoinedAttributes( QgsFeature &f )
     if ( !targetFieldValue.isValid() )
       continue;
 
-    const QHash< QString, QgsAttributes>& memoryCache = info.joinInfo->cachedAttributes;
-    if ( memoryCache.isEmpty() )
-      info.addJoinedAttributesDirect( f, targetFieldValue );
-    else
+    if ( info.cacheTable )
       info.addJoinedAttributesCached( f, targetFieldValue );
+    else
+      info.addJoinedAttributesDirect( f, targetFieldValue );
+  }
+}
+
+void QgsVectorLayerFeatureIterator::addJoinedAttributes( QgsFeatureList& features, int first )
+{
+  QMap<const QgsVectorJoinInfo*, FetchJoinInfo>::const_iterator joinIt = mFetchJoinInfo.constBegin();
+  for ( ; joinIt != mFetchJoinInfo.constEnd(); ++joinIt )
+  {
+    const FetchJoinInfo& info = joinIt.value();
+    Q_ASSERT( joinIt.key() );
+
+    if ( !info.cacheTable )
+    {
+      info.addJoinedAttributesDirect( features, first );
+      continue;
+    }
+
+    for ( int i = first; i < features.count(); ++i )
+    {
+      QgsFeature& f = features[i];
+      QVariant targetFieldValue = f.attribute( info.targetField );
+      if ( targetFieldValue.isValid() )
+        info.addJoinedAttributesCached( f, targetFieldValue );
+    }
+  }
+}
+
+void QgsVectorLayerFeatureIterator::addExpressionAttributes( QgsFeature& f )
+{
+  QMap<int, QgsExpression*>::ConstIterator it = mExpressionFieldInfo.constBegin();
+
+  for ( ; it != mExpressionFieldInfo.constEnd(); ++it )
+  {
+    QgsExpression* exp = it.value();
+    mExpressionContext->setFeature( f );
+    QVariant val = exp->evaluate( mExpressionContext.data() );
+    mSource->mFields.at( it.key() ).convertCompatible( val );
+    f.setAttribute( it.key(), val );
   }
 }
 
@@ -574,17 +675,26 @@ void QgsVectorLayerFeatureIterator::addVirtualAttributes( QgsFeature& f )
     addJoinedAttributes( f );
 
   if ( !mExpressionFieldInfo.isEmpty() )
+    addExpressionAttributes( f );
+}
+
+void QgsVectorLayerFeatureIterator::addVirtualAttributes( QgsFeatureList& features, int first )
+{
+  for ( int i = first; i < features.count(); ++i )
   {
-    QMap<int, QgsExpression*>::ConstIterator it = mExpressionFieldInfo.constBegin();
+    QgsFeature& f = features[i];
+    QgsAttributes attr = f.attributes();
+    attr.resize( mSource->mFields.count() );
+    f.setAttributes( attr );
+  }
 
-    for ( ; it != mExpressionFieldInfo.constEnd(); ++it )
-    {
-      QgsExpression* exp = it.value();
-      mExpressionContext->setFeature( f );
-      QVariant val = exp->evaluate( mExpressionContext.data() );
-      mSource->mFields.at( it.key() ).convertCompatible( val );
-      f.setAttribute( it.key(), val );
-    }
+  if ( !mFetchJoinInfo.isEmpty() )
+    addJoinedAttributes( features, first );
+
+  if ( !mExpressionFieldInfo.isEmpty() )
+  {
+    for ( int i = first; i < features.count(); ++i )
+      addExpressionAttributes( features[i] );
   }
 }
 
@@ -629,21 +739,53 @@ bool QgsVectorLayerFeatureIterator::providerCanSimplify( QgsSimplifyMethod::Meth
 
 void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesCached( QgsFeature& f, const QVariant& joinValue ) const
 {
-  const QHash<QString, QgsAttributes>& memoryCache = joinInfo->cachedAttributes;
-  QHash<QString, QgsAttributes>::const_iterator it = memoryCache.find( joinValue.toString() );
-  if ( it == memoryCache.constEnd() )
+  const QgsAttributes* values = cacheTable->find( joinValue );
+  if ( !values )
     return; // joined value not found -> leaving the attributes empty (null)
 
-  int index = indexOffset;
+  setJoinedAttributes( f, *values, cacheIndices );
+}
 
-  const QgsAttributes& featureAttributes = it.value();
-  for ( int i = 0; i < featureAttributes.count(); ++i )
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::setJoinedAttributes( QgsFeature& f, const QgsAttributes& values, const QVector<int>& indices ) const
+{
+  for ( int i = 0; i < targetAttributes.count(); ++i )
   {
-    f.setAttribute( index++, featureAttributes[i] );
+    int index = indices.at( i );
+    if ( index >= 0 )
+      f.setAttribute( targetAttributes.at( i ), values.at( index ) );
   }
 }
 
+QString QgsVectorLayerFeatureIterator::FetchJoinInfo::joinFieldName() const
+{
+  if ( joinInfo->joinFieldName.isEmpty() && joinInfo->joinFieldIndex >= 0 && joinInfo->joinFieldIndex < joinLayer->fields().count() )
+    return joinLayer->fields().field( joinInfo->joinFieldIndex ).name();   // for compatibility with 1.x
+  else
+    return joinInfo->joinFieldName;
+}
 
+//! Returns the join value as literal for the subset string of the joined layer
+static QString _joinValueLiteral( const QVariant& joinValue )
+{
+  QString v = joinValue.toString();
+  switch ( joinValue.type() )
+  {
+    case QVariant::Int:
+    case QVariant::LongLong:
+    case QVariant::Double:
+      break;
+
+    default:
+    case QVariant::String:
+      v.replace( "'", "''" );
+      v.prepend( "'" ).append( "'" );
+      break;
+  }
+  return v;
+}
+
+//! maximum number of join values in the IN list of a subset string
+static const int JOIN_BATCH_SIZE = 1000;
 
 void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const
 {
@@ -655,13 +797,7 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( Qg
     subsetString.prepend( "(" ).append( ") AND " );
   }
 
-  QString joinFieldName;
-  if ( joinInfo->joinFieldName.isEmpty() && joinInfo->joinFieldIndex >= 0 && joinInfo->joinFieldIndex < joinLayer->fields().count() )
-    joinFieldName = joinLayer->fields().field( joinInfo->joinFieldIndex ).name();   // for compatibility with 1.x
-  else
-    joinFieldName = joinInfo->joinFieldName;
-
-  subsetString.append( QString( "\"%1\"" ).arg( joinFieldName ) );
+  subsetString.append( QString( "\"%1\"" ).arg( joinFieldName() ) );
 
   if ( joinValue.isNull() )
   {
@@ -669,21 +805,7 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( Qg
   }
   else
   {
-    QString v = joinValue.toString();
-    switch ( joinValue.type() )
-    {
-      case QVariant::Int:
-      case QVariant::LongLong:
-      case QVariant::Double:
-        break;
-
-      default:
-      case QVariant::String:
-        v.replace( "'", "''" );
-        v.prepend( "'" ).append( "'" );
-        break;
-    }
-    subsetString += "=" + v;
+    subsetString += "=" + _joinValueLiteral( joinValue );
   }
 
   joinLayer->dataProvider()->setSubsetString( subsetString, false );
@@ -732,6 +854,109 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( Qg
   joinLayer->dataProvider()->setSubsetString( bkSubsetString, false );
 }
 
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( QgsFeatureList& features, int first ) const
+{
+  // distinct join values of the block
+  QStringList literals;
+  QSet<QString> seen;
+  QgsVectorLayerJoinCache::Table requested;
+  bool hasNull = false;
+  for ( int i = first; i < features.count(); ++i )
+  {
+    QVariant joinValue = features.at( i ).attribute( targetField );
+    if ( !joinValue.isValid() )
+      continue;
+
+    if ( joinValue.isNull() )
+    {
+      hasNull = true;
+      continue;
+    }
+
+    QString literal = _joinValueLiteral( joinValue );
+    if ( !seen.contains( literal ) )
+    {
+      seen.insert( literal );
+      literals << literal;
+      requested.insert( joinValue, QgsAttributes() );
+    }
+  }
+
+  if ( literals.isEmpty() && !hasNull )
+    return;
+
+  QString bkSubsetString = joinLayer->dataProvider()->subsetString(); // provider might already have a subset string
+  QString fieldName = QString( "\"%1\"" ).arg( joinFieldName() );
+
+  QgsAttributeList requestAttributes = attributes;
+  if ( !requestAttributes.contains( joinField ) )
+    requestAttributes << joinField;
+
+  QgsFeatureRequest request;
+  request.setFlags( QgsFeatureRequest::NoGeometry );
+  request.setSubsetOfAttributes( requestAttributes );
+
+  // query the joined features for a batch of join values at once
+  QgsVectorLayerJoinCache::Table joined( attributes );
+  bool looseMatches = false;
+  for ( int start = 0; start < literals.count() || ( start == 0 && hasNull ); start += JOIN_BATCH_SIZE )
+  {
+    QStringList conditions;
+    QStringList batch = literals.mid( start, JOIN_BATCH_SIZE );
+    if ( !batch.isEmpty() )
+      conditions << QString( "%1 IN (%2)" ).arg( fieldName, batch.join( "," ) );
+    if ( start == 0 && hasNull )
+      conditions << QString( "%1 IS NULL" ).arg( fieldName );
+
+    QString subsetString = conditions.join( " OR " );
+    if ( !bkSubsetString.isEmpty() )
+      subsetString = QString( "(%1) AND (%2)" ).arg( bkSubsetString, subsetString );
+
+    joinLayer->dataProvider()->setSubsetString( subsetString, false );
+
+    QgsFeatureIterator fi = joinLayer->getFeatures( request );
+    QgsFeatureList joinFeatures;
+    while ( fi.nextFeatures( joinFeatures, JOIN_BATCH_SIZE ) > 0 )
+    {
+      Q_FOREACH ( const QgsFeature& joinFeature, joinFeatures )
+      {
+        const QgsAttributes& attrs = joinFeature.attributes();
+        QgsAttributes values( attributes.count() );
+        for ( int i = 0; i < attributes.count(); ++i )
+          values[i] = attrs.value( attributes.at( i ) );
+        QVariant joinValue = attrs.value( joinField );
+        joined.insert( joinValue, values );
+
+        // the provider matched a value which is not equal to any of the requested ones (e.g. 'ABC' to 'abc' or '05' to 5)
+        if ( !joinValue.isNull() && !requested.find( joinValue ) )
+          looseMatches = true;
+      }
+      joinFeatures.clear();
+    }
+  }
+
+  joinLayer->dataProvider()->setSubsetString( bkSubsetString, false );
+
+  QVector<int> indices( attributes.count() );
+  for ( int i = 0; i < indices.count(); ++i )
+    indices[i] = i;
+
+  for ( int i = first; i < features.count(); ++i )
+  {
+    QgsFeature& f = features[i];
+    QVariant joinValue = f.attribute( targetField );
+    if ( !joinValue.isValid() )
+      continue;
+
+    const QgsAttributes* values = joined.find( joinValue );
+    if ( values )
+      setJoinedAttributes( f, *values, indices );
+    else if ( looseMatches && !joinValue.isNull() )
+      addJoinedAttributesDirect( f, joinValue ); // match the value with the comparison of the provider
+    // no suitable join feature found, keeping empty (null) attributes
+  }
+}
+
 
 
 
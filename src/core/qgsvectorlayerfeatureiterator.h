@@ -16,6 +16,7 @@
 #define QGSVECTORLAYERFEATUREITERATOR_H
 
 #include "qgsfeatureiterator.h"
+#include "qgsvectorlayerjoincache.h"
 
 #include <QSet>
 
@@ -35,6 +36,11 @@ class QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
 {
   public:
     explicit QgsVectorLayerFeatureSource( QgsVectorLayer* layer );
+    /** Creates a copy of another source reading from the given provider feature source (takes ownership).
+     * The layer is not accessed, so the copy may be created in a worker thread.
+     * @note added in QGIS 2.12
+     */
+    QgsVectorLayerFeatureSource( const QgsVectorLayerFeatureSource& other, QgsAbstractFeatureSource* providerFeatureSource );
     ~QgsVectorLayerFeatureSource();
 
     virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request ) override;
@@ -84,6 +90,9 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     //! fetch next feature, return true on success
     virtual bool fetchFeature( QgsFeature& feature ) override;
 
+    //! fetch features from the provider in blocks if there are no uncommitted changes
+    virtual int fetchFeatures( QgsFeatureList& features, int maxCount ) override;
+
     //! Overrides default method as we only need to filter features in the edit buffer
     //! while for others filtering is left to the provider implementation.
     inline virtual bool nextFeatureFilterExpression( QgsFeature &f ) override { return fetchFeature( f ); }
@@ -115,6 +124,10 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     void useChangedAttributeFeature( QgsFeatureId fid, const QgsGeometry& geom, QgsFeature& f );
     bool nextFeatureFid( QgsFeature& f );
     void addJoinedAttributes( QgsFeature &f );
+    //! adds joined attributes to the features of a block starting at index first
+    void addJoinedAttributes( QgsFeatureList& features, int first );
+    //! evaluates the expression fields of a feature
+    void addExpressionAttributes( QgsFeature& f );
     /**
      * Adds attributes that don't source from the provider but are added inside QGIS
      * Includes
@@ -125,6 +138,11 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
      */
     void addVirtualAttributes( QgsFeature &f );
 
+    /** Adds virtual attributes to the features of a block starting at index first.
+     * Joined attributes not held in memory are fetched for the whole block at once.
+     */
+    void addVirtualAttributes( QgsFeatureList& features, int first );
+
     /** Update feature with uncommited attribute updates */
     void updateChangedAttributes( QgsFeature& f );
 
@@ -142,9 +160,22 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
       QgsVectorLayer* joinLayer;        //!< resolved pointer to the joined layer
       int targetField;                  //!< index of field (of this layer) that drives the join
       int joinField;                    //!< index of field (of the joined layer) must have equal value
+      QgsAttributeList targetAttributes; //!< indices of the fetched attributes in this layer (in the order of attributes)
+      QSharedPointer<const QgsVectorLayerJoinCache::Table> cacheTable; //!< values of the joined layer held in memory (null if not cached)
+      QVector<int> cacheIndices;        //!< positions of the fetched attributes in the values of cacheTable
 
       void addJoinedAttributesCached( QgsFeature& f, const QVariant& joinValue ) const;
       void addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const;
+      /** fetches the joined features of a block of features with one query per batch of join values.
+       * Values are matched as in the memory cache. Values without an equal value in the joined layer
+       * are queried one by one if the provider compares values differently (e.g. case insensitive),
+       * so that they get the same joined feature as without batching.
+       */
+      void addJoinedAttributesDirect( QgsFeatureList& features, int first ) const;
+      //! sets the joined attributes of a feature, values are taken from the given positions
+      void setJoinedAttributes( QgsFeature& f, const QgsAttributes& values, const QVector<int>& indices ) const;
+      //! name of the join field in the joined layer
+      QString joinFieldName() const;
     };
 
     /** Information about joins used in the current select() statement.
@@ -85,7 +85,10 @@ bool QgsVectorLayerJoinBuffer::addJoin( const QgsVectorJoinInfo& joinInfo )
   // but then QgsProject makes sure to call createJoinCaches() which will do the connection.
   // Unique connection makes sure we do not respond to one layer's update more times (in case of multiple join)
   if ( QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinInfo.joinLayerId ) ) )
+  {
     connect( vl, SIGNAL( updatedFields() ), this, SLOT( joinedLayerUpdatedFields() ), Qt::UniqueConnection );
+    detachJoinLayer( vl );
+  }
 
   emit joinedFieldsChanged();
   return true;
@@ -108,67 +111,26 @@ void QgsVectorLayerJoinBuffer::removeJoin( const QString& joinLayerId )
   emit joinedFieldsChanged();
 }
 
+void QgsVectorLayerJoinBuffer::detachJoinLayer( QgsVectorLayer* joinLayer )
+{
+  // joined attributes are queried by setting the subset string of the join layer's provider,
+  // which must therefore not be shared with other layers (see QgsVectorDataProviderPool)
+  if ( joinLayer->hasSharedDataProvider() && !joinLayer->detachDataProvider() )
+  {
+    QgsDebugMsg( "Join layer " + joinLayer->id() + " still uses a shared data provider" );
+  }
+}
+
 void QgsVectorLayerJoinBuffer::cacheJoinLayer( QgsVectorJoinInfo& joinInfo )
 {
   //memory cache not required or already done
-  if ( !joinInfo.memoryCache || joinInfo.cachedAttributes.size() > 0 )
+  if ( !joinInfo.memoryCache || joinInfo.cache )
   {
     return;
   }
 
-  QgsVectorLayer* cacheLayer = dynamic_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinInfo.joinLayerId ) );
-  if ( cacheLayer )
-  {
-    int joinFieldIndex;
-    if ( joinInfo.joinFieldName.isEmpty() )
-      joinFieldIndex = joinInfo.joinFieldIndex;   //for compatibility with 1.x
-    else
-      joinFieldIndex = cacheLayer->fields().indexFromName( joinInfo.joinFieldName );
-
-    if ( joinFieldIndex < 0 || joinFieldIndex >= cacheLayer->fields().count() )
-      return;
-
-    joinInfo.cachedAttributes.clear();
-
-    QgsFeatureRequest request;
-    request.setFlags( QgsFeatureRequest::NoGeometry );
-
-    // maybe user requested just a subset of layer's attributes
-    // so we do not have to cache everything
-    bool hasSubset = joinInfo.joinFieldNamesSubset();
-    QVector<int> subsetIndices;
-    if ( hasSubset )
-    {
-      subsetIndices = joinSubsetIndices( cacheLayer, *joinInfo.joinFieldNamesSubset() );
-
-      // we need just subset of attributes - but make sure to include join field name
-      QgsAttributeList cacheLayerAttrs = subsetIndices.toList();
-      if ( !cacheLayerAttrs.contains( joinFieldIndex ) )
-        cacheLayerAttrs.append( joinFieldIndex );
-      request.setSubsetOfAttributes( cacheLayerAttrs );
-    }
-
-    QgsFeatureIterator fit = cacheLayer->getFeatures( request );
-    QgsFeature f;
-    while ( fit.nextFeature( f ) )
-    {
-      QgsAttributes attrs = f.attributes();
-      QString key = attrs[joinFieldIndex].toString();
-      if ( hasSubset )
-      {
-        QgsAttributes subsetAttrs( subsetIndices.count() );
-        for ( int i = 0; i < subsetIndices.count(); ++i )
-          subsetAttrs[i] = attrs[ subsetIndices[i] ];
-        joinInfo.cachedAttributes.insert( key, subsetAttrs );
-      }
-      else
-      {
-        QgsAttributes attrs2 = attrs;
-        attrs2.remove( joinFieldIndex );  // skip the join field to avoid double field names (fields often have the same name)
-        joinInfo.cachedAttributes.insert( key, attrs2 );
-      }
-    }
-  }
+  // the cache is loaded by feature iterators on first use, with just the attributes they need
+  joinInfo.cache = QSharedPointer<QgsVectorLayerJoinCache>( new QgsVectorLayerJoinCache() );
 }
 
 
@@ -257,7 +219,10 @@ void QgsVectorLayerJoinBuffer::createJoinCaches()
 
     // make sure we are connected to the joined layer
     if ( QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinIt->joinLayerId ) ) )
+    {
       connect( vl, SIGNAL( updatedFields() ), this, SLOT( joinedLayerUpdatedFields() ), Qt::UniqueConnection );
+      detachJoinLayer( vl );
+    }
   }
 }
 
@@ -398,7 +363,8 @@ void QgsVectorLayerJoinBuffer::joinedLayerUpdatedFields()
   {
     if ( joinedLayer->id() == it->joinLayerId )
     {
-      it->cachedAttributes.clear();
+      if ( it->cache )
+        it->cache->clear();
       cacheJoinLayer( *it );
     }
   }
@@ -96,8 +96,15 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer : public QObject
     /** Joined vector layers*/
     QgsVectorJoinList mVectorJoins;
 
-    /** Caches attributes of join layer in memory if QgsVectorJoinInfo.memoryCache is true (and the cache is not already there)*/
+    /** Creates the memory cache of the join layer if QgsVectorJoinInfo.memoryCache is true (and the cache is not already there).
+     * The cache is filled by feature iterators when it is first used.
+     */
     void cacheJoinLayer( QgsVectorJoinInfo& joinInfo );
+
+    /** Replaces a data provider of the join layer shared with other layers by a provider of its own,
+     * as the join changes the subset string of the provider when it fetches joined attributes
+     */
+    static void detachJoinLayer( QgsVectorLayer* joinLayer );
 };
 
 #endif // QGSVECTORLAYERJOINBUFFER_H
@@ -0,0 +1,216 @@
+/***************************************************************************
+  qgsvectorlayerjoincache.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsvectorlayerjoincache.h"
+
+#include "qgslogger.h"
+#include "qgsvectorlayer.h"
+
+#include <QSettings>
+
+#include <cmath>
+#include <limits>
+
+//! number of features fetched from the joined layer at once while loading the cache
+static const int LOAD_BATCH_SIZE = 2000;
+
+//! default memory limit of a join cache in megabytes
+static const int DEFAULT_MAX_MEGABYTES = 256;
+
+//! largest absolute double value whose string representation has no exponent
+static const double MAX_INTEGRAL_DOUBLE = 1e15;
+
+/** Returns true if the join value is an integer, i.e. if its string representation
+ * is the one of an integer. Other values are hashed by their string representation.
+ */
+static bool _integerKey( const QVariant& value, qint64& key )
+{
+  if ( value.isNull() )
+    return false;
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+      key = value.toLongLong();
+      return true;
+
+    case QVariant::ULongLong:
+      if ( value.toULongLong() > ( quint64 ) std::numeric_limits<qint64>::max() )
+        return false;
+      key = value.toLongLong();
+      return true;
+
+    case QVariant::Double:
+    {
+      double d = value.toDouble();
+      if ( d != floor( d ) || qAbs( d ) >= MAX_INTEGRAL_DOUBLE )
+        return false;
+      key = ( qint64 ) d;
+      return true;
+    }
+
+    case QVariant::String:
+    {
+      QString str = value.toString();
+      bool ok;
+      key = str.toLongLong( &ok );
+      // reject representations like "05" or "+5" that would not match as strings
+      return ok && QString::number( key ) == str;
+    }
+
+    default:
+      return false;
+  }
+}
+
+//! Returns the estimated memory taken by a value
+static qint64 _valueBytes( const QVariant& value )
+{
+  qint64 bytes = sizeof( QVariant );
+  if ( value.type() == QVariant::String )
+    bytes += 24 + 2 * value.toString().length();
+  return bytes;
+}
+
+void QgsVectorLayerJoinCache::Table::insert( const QVariant& joinValue, const QgsAttributes& values )
+{
+  // hash node and array header
+  qint64 bytes = 48;
+  for ( int i = 0; i < values.count(); ++i )
+    bytes += _valueBytes( values.at( i ) );
+
+  qint64 intKey;
+  if ( _integerKey( joinValue, intKey ) )
+  {
+    if ( mIntValues.contains( intKey ) )
+      return;
+    mIntValues.insert( intKey, values );
+  }
+  else
+  {
+    QString key = joinValue.toString();
+    if ( mStringValues.contains( key ) )
+      return;
+    mStringValues.insert( key, values );
+    bytes += _valueBytes( key );
+  }
+
+  mBytes += bytes;
+}
+
+const QgsAttributes* QgsVectorLayerJoinCache::Table::find( const QVariant& joinValue ) const
+{
+  qint64 intKey;
+  if ( _integerKey( joinValue, intKey ) )
+  {
+    QHash<qint64, QgsAttributes>::const_iterator it = mIntValues.constFind( intKey );
+    return it != mIntValues.constEnd() ? &it.value() : 0;
+  }
+
+  QHash<QString, QgsAttributes>::const_iterator it = mStringValues.constFind( joinValue.toString() );
+  return it != mStringValues.constEnd() ? &it.value() : 0;
+}
+
+
+//! Returns true if all items of the second list are in the first one
+static bool _containsAll( const QgsAttributeList& list, const QgsAttributeList& items )
+{
+  Q_FOREACH ( int item, items )
+  {
+    if ( !list.contains( item ) )
+      return false;
+  }
+  return true;
+}
+
+QgsVectorLayerJoinCache::QgsVectorLayerJoinCache( qint64 maxBytes )
+    : mMaxBytes( maxBytes < 0 ? defaultMaxBytes() : maxBytes )
+{
+}
+
+qint64 QgsVectorLayerJoinCache::defaultMaxBytes()
+{
+  bool ok = false;
+  int megabytes = qgetenv( "QGIS_JOIN_CACHE_MAX_MB" ).toInt( &ok );
+  if ( !ok || megabytes < 0 )
+    megabytes = QSettings().value( "/qgis/joinCacheMaxMegabytes", DEFAULT_MAX_MEGABYTES ).toInt();
+  return qint64( megabytes ) * 1024 * 1024;
+}
+
+QSharedPointer<const QgsVectorLayerJoinCache::Table> QgsVectorLayerJoinCache::table( QgsVectorLayer* joinLayer, int joinField, const QgsAttributeList& attributes )
+{
+  QMutexLocker locker( &mMutex );
+
+  if ( mTable && _containsAll( mTable->attributes(), attributes ) )
+    return mTable;
+
+  if ( !joinLayer || joinField < 0 || joinField >= joinLayer->fields().count() )
+    return QSharedPointer<const Table>();
+
+  // extend the cached attributes, so that iterators requesting different attributes do not reload the layer in turn
+  QgsAttributeList cacheAttributes = mTable ? mTable->attributes() : QgsAttributeList();
+  Q_FOREACH ( int attr, attributes )
+  {
+    if ( !cacheAttributes.contains( attr ) )
+      cacheAttributes << attr;
+  }
+
+  // do not try again what did not fit before
+  if ( !mOverLimitAttributes.isEmpty() && _containsAll( cacheAttributes, mOverLimitAttributes ) )
+    return QSharedPointer<const Table>();
+
+  QgsAttributeList requestAttributes = cacheAttributes;
+  if ( !requestAttributes.contains( joinField ) )
+    requestAttributes << joinField;
+
+  QgsFeatureRequest request;
+  request.setFlags( QgsFeatureRequest::NoGeometry );
+  request.setSubsetOfAttributes( requestAttributes );
+
+  QSharedPointer<Table> table( new Table( cacheAttributes ) );
+  QgsFeatureIterator fit = joinLayer->getFeatures( request );
+  QgsFeatureList features;
+  while ( fit.nextFeatures( features, LOAD_BATCH_SIZE ) > 0 )
+  {
+    Q_FOREACH ( const QgsFeature& f, features )
+    {
+      const QgsAttributes& attrs = f.attributes();
+      QgsAttributes values( cacheAttributes.count() );
+      for ( int i = 0; i < cacheAttributes.count(); ++i )
+        values[i] = attrs.value( cacheAttributes.at( i ) );
+      table->insert( attrs.value( joinField ), values );
+    }
+    features.clear();
+
+    if ( table->bytes() > mMaxBytes )
+    {
+      QgsDebugMsg( QString( "joined layer %1 exceeds the cache memory limit" ).arg( joinLayer->id() ) );
+      mOverLimitAttributes = cacheAttributes;
+      return QSharedPointer<const Table>();
+    }
+  }
+
+  mTable = table;
+  return mTable;
+}
+
+void QgsVectorLayerJoinCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mTable.clear();
+  mOverLimitAttributes.clear();
+}
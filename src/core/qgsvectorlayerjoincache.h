@@ -0,0 +1,118 @@
+/***************************************************************************
+  qgsvectorlayerjoincache.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSVECTORLAYERJOINCACHE_H
+#define QGSVECTORLAYERJOINCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include "qgsfeature.h"
+
+class QgsVectorLayer;
+
+typedef QList<int> QgsAttributeList;
+
+/** \ingroup core
+ * In-memory cache of the features of a joined layer, indexed by the value of the join field.
+ *
+ * The cache is loaded when it is first used and holds only the attributes that were requested
+ * so far. If loading the layer would take more memory than the limit, the cache is not used
+ * and the joined attributes are fetched from the layer in batches instead. The default limit
+ * is read from the setting "/qgis/joinCacheMaxMegabytes" (256 MB if not set), it can be
+ * overridden with the QGIS_JOIN_CACHE_MAX_MB environment variable (e.g. for QGIS server).
+ *
+ * Join values are hashed typed: values that are integers (also when stored as doubles or
+ * strings) are hashed as numbers, other values by their string representation. Values match
+ * if their string representations are equal, as with the string keyed cache used before.
+ *
+ * The class is thread-safe. Tables returned by table() are read only and remain valid
+ * after the cache is cleared.
+ *
+ * @note added in QGIS 2.12
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsVectorLayerJoinCache
+{
+  public:
+
+    /** Values of a set of attributes of the joined layer, indexed by join value */
+    class CORE_EXPORT Table
+    {
+      public:
+        //! Creates a table for the given attributes of the joined layer
+        explicit Table( const QgsAttributeList& attributes = QgsAttributeList() ) : mAttributes( attributes ), mBytes( 0 ) {}
+
+        //! Returns the attributes of the joined layer held by the table
+        const QgsAttributeList& attributes() const { return mAttributes; }
+
+        /** Adds the values of a feature. Values must be in the order of attributes().
+         * If there is already a feature with the same join value, the first one is kept.
+         */
+        void insert( const QVariant& joinValue, const QgsAttributes& values );
+
+        //! Returns the values of the feature with the join value or null if there is none
+        const QgsAttributes* find( const QVariant& joinValue ) const;
+
+        //! Returns the number of features in the table
+        int count() const { return mIntValues.count() + mStringValues.count(); }
+
+        //! Returns the estimated memory used by the table in bytes
+        qint64 bytes() const { return mBytes; }
+
+      private:
+        QgsAttributeList mAttributes;
+        QHash<qint64, QgsAttributes> mIntValues;
+        QHash<QString, QgsAttributes> mStringValues;
+        qint64 mBytes;
+    };
+
+    /** Constructor
+     * @param maxBytes maximum memory the cache is allowed to take (in bytes),
+     * -1 to use defaultMaxBytes()
+     */
+    explicit QgsVectorLayerJoinCache( qint64 maxBytes = -1 );
+
+    /** Returns the default memory limit of join caches (in bytes). It is read from the
+     * QGIS_JOIN_CACHE_MAX_MB environment variable if set, otherwise from the setting
+     * "/qgis/joinCacheMaxMegabytes" (256 MB by default).
+     */
+    static qint64 defaultMaxBytes();
+
+    /** Returns a table with the given attributes of the joined layer. The layer is read when
+     * the attributes are not cached yet. Returns a null pointer if the table would exceed
+     * the memory limit.
+     * @param joinLayer joined layer
+     * @param joinField index of the join field in the joined layer
+     * @param attributes indices of the requested attributes in the joined layer
+     */
+    QSharedPointer<const Table> table( QgsVectorLayer* joinLayer, int joinField, const QgsAttributeList& attributes );
+
+    //! Removes the cached values, e.g. when the fields of the joined layer changed
+    void clear();
+
+    //! Returns the maximum memory the cache is allowed to take (in bytes)
+    qint64 maxBytes() const { return mMaxBytes; }
+
+  private:
+    QMutex mMutex;
+    qint64 mMaxBytes;
+    QSharedPointer<const Table> mTable;
+    //! attributes of a table that could not be loaded within the memory limit
+    QgsAttributeList mOverLimitAttributes;
+};
+
+#endif // QGSVECTORLAYERJOINCACHE_H
@@ -18,6 +18,7 @@
 //#include "qgsfeatureiterator.h"
 #include "diagram/qgsdiagram.h"
 #include "qgsdiagramrendererv2.h"
+#include "qgscoordinatetransformgrid.h"
 #include "qgsgeometrycache.h"
 #include "qgsmessagelog.h"
 #include "qgspallabeling.h"
@@ -26,19 +27,32 @@
 #include "qgssinglesymbolrendererv2.h"
 #include "qgssymbollayerv2.h"
 #include "qgssymbolv2.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qgsvectorlayerdiagramprovider.h"
 #include "qgsvectorlayerfeatureiterator.h"
 #include "qgsvectorlayerlabeling.h"
 #include "qgsvectorlayerlabelprovider.h"
 #include "qgspainteffect.h"
+#include "qgssymbollayerv2utils.h"
 
 #include <QSettings>
 #include <QPicture>
+#include <QScopedPointer>
+#include <QtConcurrentMap>
 
 // TODO:
 // - passing of cache to QgsVectorLayer
 
+//! minimal number of features in a layer to make rendering in parallel tiles worthwhile
+static const long TILED_RENDERING_MIN_FEATURES = 20000;
+
+//! number of features fetched from the layer at once
+static const int FEATURE_BATCH_SIZE = 2000;
+
+//! maximum error (in output pixels) of approximated coordinate transforms
+static const double TRANSFORM_GRID_TOLERANCE = 0.25;
+
 
 QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRenderContext& context )
     : QgsMapLayerRenderer( layer->id() )
@@ -51,6 +65,8 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
     , mLabelProvider( 0 )
     , mDiagramProvider( 0 )
     , mLayerTransparency( 0 )
+    , mRenderingTiles( false )
+    , mFetchedFeatures( 0 )
 {
   mSource = new QgsVectorLayerFeatureSource( layer );
 
@@ -105,11 +121,20 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
   prepareLabeling( layer, mAttrNames );
   prepareDiagrams( layer, mAttrNames );
 
+  // feature sources are not thread safe - each tile needs its own copy. Only the provider
+  // sources need the layer, the rest is copied from mSource if the layer is really rendered in tiles
+  if ( canRenderTiled() && layer->featureCount() >= TILED_RENDERING_MIN_FEATURES )
+  {
+    for ( int i = 0; i < mContext.renderingTileCount(); ++i )
+      mTileProviderSources << layer->dataProvider()->featureSource();
+  }
 }
 
 
 QgsVectorLayerRenderer::~QgsVectorLayerRenderer()
 {
+  qDeleteAll( mTileSources );
+  qDeleteAll( mTileProviderSources );
   delete mRendererV2;
   delete mSource;
 }
@@ -133,6 +158,10 @@ bool QgsVectorLayerRenderer::render()
     mRendererV2->paintEffect()->begin( mContext );
   }
 
+  // tiles are composited as images, so the painter must draw to an image
+  // (paint effects replace the painter with one drawing to a picture)
+  bool tiled = !mTileProviderSources.isEmpty() && !usingEffect && mContext.painter()->device()->devType() == QInternal::Image;
+
   // Per feature blending mode
   if ( mContext.useAdvancedEffects() && mFeatureBlendMode != QPainter::CompositionMode_SourceOver )
   {
@@ -232,12 +261,35 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
-  QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
+  // approximate the reprojection of geometries within the rendered extent by interpolation
+  QScopedPointer<QgsCoordinateTransformGrid> transformGrid;
+  const QgsCoordinateTransform* ct = mContext.coordinateTransform();
+  if ( mContext.approximateTransform() && ct && !const_cast<QgsCoordinateTransform*>( ct )->isShortCircuited() )
+  {
+    // geometries are clipped to the extent enlarged by 10% on each side before they are transformed
+    QgsRectangle gridExtent = mContext.extent();
+    gridExtent.scale( 1.2 );
+    transformGrid.reset( new QgsCoordinateTransformGrid( ct, gridExtent, TRANSFORM_GRID_TOLERANCE * mContext.mapToPixel().mapUnitsPerPixel() ) );
+    if ( transformGrid->isValid() )
+      mContext.setCoordinateTransformGrid( transformGrid.data() );
+  }
 
-  if (( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && mRendererV2->usingSymbolLevels() )
-    drawRendererV2Levels( fit );
+  if ( tiled )
+  {
+    renderTiled( featureRequest );
+  }
   else
-    drawRendererV2( fit );
+  {
+    QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
+
+    if (( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && mRendererV2->usingSymbolLevels() )
+      drawRendererV2Levels( fit, mContext, mRendererV2 );
+    else
+      drawRendererV2( fit, mContext, mRendererV2 );
+  }
+
+  mContext.setCoordinateTransformGrid( 0 );
+  mFetchedFeatureCount = mFetchedFeatures;
 
   if ( usingEffect )
   {
@@ -272,74 +324,53 @@ void QgsVectorLayerRenderer::setGeometryCachePointer( QgsGeometryCache* cache )
 
 
 
-void QgsVectorLayerRenderer::drawRendererV2( QgsFeatureIterator& fit )
+void QgsVectorLayerRenderer::drawRendererV2( QgsFeatureIterator& fit, QgsRenderContext& context, QgsFeatureRendererV2* renderer )
 {
-  QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  QgsFeatureList batch;
+  bool cancelled = false;
+  while ( !cancelled && fit.nextFeatures( batch, FEATURE_BATCH_SIZE ) )
   {
-    try
+    mFetchedFeatures.fetchAndAddRelaxed( batch.count() );
+    for ( QgsFeatureList::iterator it = batch.begin(); it != batch.end(); ++it )
     {
-      if ( !fet.constGeometry() )
-        continue; // skip features without geometry
-
-      if ( mContext.renderingStopped() )
+      QgsFeature& fet = *it;
+      try
       {
-        QgsDebugMsg( QString( "Drawing of vector layer %1 cancelled." ).arg( layerID() ) );
-        break;
-      }
+        if ( !fet.constGeometry() )
+          continue; // skip features without geometry
 
-      mContext.expressionContext().setFeature( fet );
+        // tile contexts are copies, cancellation is only signalled in the layer's context
+        if ( context.renderingStopped() || mContext.renderingStopped() )
+        {
+          QgsDebugMsg( QString( "Drawing of vector layer %1 cancelled." ).arg( layerID() ) );
+          cancelled = true;
+          break;
+        }
 
-      bool sel = mContext.showSelection() && mSelectedFeatureIds.contains( fet.id() );
-      bool drawMarker = ( mDrawVertexMarkers && mContext.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
+        context.expressionContext().setFeature( fet );
 
-      if ( mCache )
-      {
-        // Cache this for the use of (e.g.) modifying the feature's uncommitted geometry.
-        mCache->cacheGeometry( fet.id(), *fet.constGeometry() );
-      }
+        bool sel = context.showSelection() && mSelectedFeatureIds.contains( fet.id() );
+        bool drawMarker = ( mDrawVertexMarkers && context.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
 
-      // render feature
-      bool rendered = mRendererV2->renderFeature( fet, mContext, -1, sel, drawMarker );
+        // render feature
+        bool rendered = renderer->renderFeature( fet, context, -1, sel, drawMarker );
 
-      // labeling - register feature
-      Q_UNUSED( rendered );
-      if ( rendered && mContext.labelingEngine() )
-      {
-        if ( mLabeling )
-        {
-          mContext.labelingEngine()->registerFeature( mLayerID, fet, mContext );
-        }
-        if ( mDiagrams )
-        {
-          mContext.labelingEngine()->registerDiagramFeature( mLayerID, fet, mContext );
-        }
+        registerFeature( fet, context, rendered );
       }
-      // new labeling engine
-      if ( rendered && mContext.labelingEngineV2() )
+      catch ( const QgsCsException &cse )
       {
-        if ( mLabelProvider )
-        {
-          mLabelProvider->registerFeature( fet, mContext );
-        }
-        if ( mDiagramProvider )
-        {
-          mDiagramProvider->registerFeature( fet, mContext );
-        }
+        Q_UNUSED( cse );
+        QgsDebugMsg( QString( "Failed to transform a point while drawing a feature with ID '%1'. Ignoring this feature. %2" )
+                     .arg( fet.id() ).arg( cse.what() ) );
       }
     }
-    catch ( const QgsCsException &cse )
-    {
-      Q_UNUSED( cse );
-      QgsDebugMsg( QString( "Failed to transform a point while drawing a feature with ID '%1'. Ignoring this feature. %2" )
-                   .arg( fet.id() ).arg( cse.what() ) );
-    }
+    batch.clear();
   }
 
-  stopRendererV2( NULL );
+  stopRendererV2( context, renderer, NULL );
 }
 
-void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
+void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit, QgsRenderContext& context, QgsFeatureRendererV2* renderer )
 {
   QHash< QgsSymbolV2*, QList<QgsFeature> > features; // key = symbol, value = array of features
 
@@ -347,73 +378,50 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
   if ( !mSelectedFeatureIds.isEmpty() )
   {
     selRenderer = new QgsSingleSymbolRendererV2( QgsSymbolV2::defaultSymbol( mGeometryType ) );
-    selRenderer->symbol()->setColor( mContext.selectionColor() );
+    selRenderer->symbol()->setColor( context.selectionColor() );
     selRenderer->setVertexMarkerAppearance( mVertexMarkerStyle, mVertexMarkerSize );
-    selRenderer->startRender( mContext, mFields );
+    selRenderer->startRender( context, mFields );
   }
 
   // 1. fetch features
-  QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  QgsFeatureList batch;
+  while ( fit.nextFeatures( batch, FEATURE_BATCH_SIZE ) )
   {
-    if ( !fet.constGeometry() )
-      continue; // skip features without geometry
-
-    if ( mContext.renderingStopped() )
-    {
-      qDebug( "rendering stop!" );
-      stopRendererV2( selRenderer );
-      return;
-    }
-
-    mContext.expressionContext().setFeature( fet );
-    QgsSymbolV2* sym = mRendererV2->symbolForFeature( fet, mContext );
-    if ( !sym )
-    {
-      continue;
-    }
-
-    if ( !features.contains( sym ) )
+    mFetchedFeatures.fetchAndAddRelaxed( batch.count() );
+    for ( QgsFeatureList::iterator it = batch.begin(); it != batch.end(); ++it )
     {
-      features.insert( sym, QList<QgsFeature>() );
-    }
-    features[sym].append( fet );
-
-    if ( mCache )
-    {
-      // Cache this for the use of (e.g.) modifying the feature's uncommitted geometry.
-      mCache->cacheGeometry( fet.id(), *fet.constGeometry() );
-    }
+      QgsFeature& fet = *it;
+      if ( !fet.constGeometry() )
+        continue; // skip features without geometry
 
-    if ( mContext.labelingEngine() )
-    {
-      mContext.expressionContext().setFeature( fet );
-      if ( mLabeling )
-      {
-        mContext.labelingEngine()->registerFeature( mLayerID, fet, mContext );
-      }
-      if ( mDiagrams )
+      if ( context.renderingStopped() || mContext.renderingStopped() )
       {
-        mContext.labelingEngine()->registerDiagramFeature( mLayerID, fet, mContext );
+        qDebug( "rendering stop!" );
+        stopRendererV2( context, renderer, selRenderer );
+        return;
       }
-    }
-    // new labeling engine
-    if ( mContext.labelingEngineV2() )
-    {
-      if ( mLabelProvider )
+
+      context.expressionContext().setFeature( fet );
+      QgsSymbolV2* sym = renderer->symbolForFeature( fet, context );
+      if ( !sym )
       {
-        mLabelProvider->registerFeature( fet, mContext );
+        continue;
       }
-      if ( mDiagramProvider )
+
+      if ( !features.contains( sym ) )
       {
-        mDiagramProvider->registerFeature( fet, mContext );
+        features.insert( sym, QList<QgsFeature>() );
       }
+      features[sym].append( fet );
+
+      registerFeature( fet, context, true );
     }
+    batch.clear();
   }
 
   // find out the order
   QgsSymbolV2LevelOrder levels;
-  QgsSymbolV2List symbols = mRendererV2->symbols( mContext );
+  QgsSymbolV2List symbols = renderer->symbols( context );
   for ( int i = 0; i < symbols.count(); i++ )
   {
     QgsSymbolV2* sym = symbols[i];
@@ -446,21 +454,21 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
       QList<QgsFeature>::iterator fit;
       for ( fit = lst.begin(); fit != lst.end(); ++fit )
       {
-        if ( mContext.renderingStopped() )
+        if ( context.renderingStopped() || mContext.renderingStopped() )
         {
-          stopRendererV2( selRenderer );
+          stopRendererV2( context, renderer, selRenderer );
           return;
         }
 
         bool sel = mSelectedFeatureIds.contains( fit->id() );
         // maybe vertex markers should be drawn only during the last pass...
-        bool drawMarker = ( mDrawVertexMarkers && mContext.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
+        bool drawMarker = ( mDrawVertexMarkers && context.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
 
-        mContext.expressionContext().setFeature( *fit );
+        context.expressionContext().setFeature( *fit );
 
         try
         {
-          mRendererV2->renderFeature( *fit, mContext, layer, sel, drawMarker );
+          renderer->renderFeature( *fit, context, layer, sel, drawMarker );
         }
         catch ( const QgsCsException &cse )
         {
@@ -472,21 +480,223 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
     }
   }
 
-  stopRendererV2( selRenderer );
+  stopRendererV2( context, renderer, selRenderer );
 }
 
 
-void QgsVectorLayerRenderer::stopRendererV2( QgsSingleSymbolRendererV2* selRenderer )
+void QgsVectorLayerRenderer::stopRendererV2( QgsRenderContext& context, QgsFeatureRendererV2* renderer, QgsSingleSymbolRendererV2* selRenderer )
 {
-  mRendererV2->stopRender( mContext );
+  renderer->stopRender( context );
   if ( selRenderer )
   {
-    selRenderer->stopRender( mContext );
+    selRenderer->stopRender( context );
     delete selRenderer;
   }
 }
 
 
+void QgsVectorLayerRenderer::registerFeature( QgsFeature& fet, QgsRenderContext& context, bool rendered )
+{
+  if ( !mCache && !context.labelingEngine() && !context.labelingEngineV2() )
+    return;
+
+  QMutexLocker locker( mRenderingTiles ? &mTileMutex : 0 );
+  if ( mRenderingTiles )
+  {
+    // features crossing tile borders are rendered by several tiles
+    if ( mTileRegisteredIds.contains( fet.id() ) )
+      return;
+    mTileRegisteredIds.insert( fet.id() );
+  }
+
+  if ( mCache )
+  {
+    // Cache this for the use of (e.g.) modifying the feature's uncommitted geometry.
+    mCache->cacheGeometry( fet.id(), *fet.constGeometry() );
+  }
+
+  if ( !rendered )
+    return;
+
+  // labeling - register feature
+  if ( context.labelingEngine() )
+  {
+    if ( mLabeling )
+    {
+      context.labelingEngine()->registerFeature( mLayerID, fet, context );
+    }
+    if ( mDiagrams )
+    {
+      context.labelingEngine()->registerDiagramFeature( mLayerID, fet, context );
+    }
+  }
+  // new labeling engine
+  if ( context.labelingEngineV2() )
+  {
+    if ( mLabelProvider )
+    {
+      mLabelProvider->registerFeature( fet, context );
+    }
+    if ( mDiagramProvider )
+    {
+      mDiagramProvider->registerFeature( fet, context );
+    }
+  }
+}
+
+
+bool QgsVectorLayerRenderer::canRenderTiled() const
+{
+  if ( mContext.renderingTileCount() < 2 || !mRendererV2 || mContext.forceVectorOutput() )
+    return false;
+
+  // tiles are composited with the default composition mode
+  if ( mFeatureBlendMode != QPainter::CompositionMode_SourceOver )
+    return false;
+
+  // other renderers (heatmap, point displacement, inverted polygons) need to see all features at once
+  QString type = mRendererV2->type();
+  return type == "singleSymbol" || type == "categorizedSymbol" || type == "graduatedSymbol" || type == "RuleRenderer";
+}
+
+
+double QgsVectorLayerRenderer::estimateSymbolBleed() const
+{
+  double maxBleed = 0;
+  QgsRenderContext& context = mContext;
+  Q_FOREACH ( QgsSymbolV2* symbol, mRendererV2->symbols( context ) )
+  {
+    double bleed = QgsSymbolLayerV2Utils::estimateMaxSymbolBleed( symbol );
+    if ( symbol->type() == QgsSymbolV2::Marker )
+      bleed = qMax( bleed, static_cast<QgsMarkerSymbolV2*>( symbol )->size() );
+    bleed = QgsSymbolLayerV2Utils::convertToPainterUnits( context, bleed, symbol->outputUnit(), symbol->mapUnitScale() );
+    maxBleed = qMax( maxBleed, bleed );
+  }
+  // allow for antialiasing and rounding
+  return maxBleed + 2;
+}
+
+
+void QgsVectorLayerRenderer::renderTiled( const QgsFeatureRequest& featureRequest )
+{
+  while ( !mTileProviderSources.isEmpty() )
+    mTileSources << new QgsVectorLayerFeatureSource( *mSource, mTileProviderSources.takeFirst() );
+
+  // the layer's renderer has been started already - use clones for the tiles
+  QPaintDevice* device = mContext.painter()->device();
+  int tileCount = mTileSources.count();
+  int tileHeight = ( device->height() + tileCount - 1 ) / tileCount;
+  double bleed = estimateSymbolBleed();
+
+  const QgsMapToPixel& mtp = mContext.mapToPixel();
+  const QgsCoordinateTransform* ct = mContext.coordinateTransform();
+
+  QList<TileJob> tiles;
+  for ( int i = 0; i < tileCount; ++i )
+  {
+    QRect rect( 0, i * tileHeight, device->width(), qMin( tileHeight, device->height() - i * tileHeight ) );
+    if ( rect.height() <= 0 )
+      break;
+
+    // features are fetched from an area enlarged by symbol bleed, the tile painter clips the output
+    QRectF fetchRect = QRectF( rect ).adjusted( -bleed, -bleed, bleed, bleed );
+    // with map rotation the tile covers a rotated rectangle in map coordinates - use its bounding box
+    QgsRectangle tileExtent( mtp.toMapCoordinatesF( fetchRect.left(), fetchRect.top() ), mtp.toMapCoordinatesF( fetchRect.right(), fetchRect.bottom() ) );
+    QgsPoint topRight = mtp.toMapCoordinatesF( fetchRect.right(), fetchRect.top() );
+    QgsPoint bottomLeft = mtp.toMapCoordinatesF( fetchRect.left(), fetchRect.bottom() );
+    tileExtent.combineExtentWith( topRight.x(), topRight.y() );
+    tileExtent.combineExtentWith( bottomLeft.x(), bottomLeft.y() );
+
+    QgsRectangle requestExtent = featureRequest.filterRect();
+    if ( ct && !ct->sourceCrs().geographicFlag() )
+    {
+      try
+      {
+        tileExtent = ct->transformBoundingBox( tileExtent, QgsCoordinateTransform::ReverseTransform );
+        requestExtent = requestExtent.intersect( &tileExtent );
+      }
+      catch ( QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        QgsDebugMsg( "Transform error caught - using full extent for tile" );
+      }
+    }
+    else if ( !ct )
+    {
+      requestExtent = requestExtent.intersect( &tileExtent );
+    }
+    // with geographic layers the tile extent could wrap around the antimeridian - use the layer's extent
+
+    if ( requestExtent.isEmpty() )
+      continue;
+
+    QImage* img = new QImage( rect.size(), QImage::Format_ARGB32_Premultiplied );
+    if ( img->isNull() )
+    {
+      mErrors.append( QObject::tr( "Insufficient memory for tile image %1x%2" ).arg( rect.width() ).arg( rect.height() ) );
+      delete img;
+      continue;
+    }
+    img->fill( 0 );
+
+    tiles.append( TileJob() );
+    TileJob& tile = tiles.last();
+    tile.parent = this;
+    tile.source = mTileSources.at( i );
+    tile.renderer = mRendererV2->clone();
+    if ( mDrawVertexMarkers )
+      tile.renderer->setVertexMarkerAppearance( mVertexMarkerStyle, mVertexMarkerSize );
+    tile.context = mContext;
+    tile.context.setPainter( 0 );
+    tile.request = QgsFeatureRequest( featureRequest ).setFilterRect( requestExtent );
+    tile.rect = rect;
+    tile.img = img;
+    tile.renderHints = mContext.painter()->renderHints();
+  }
+
+  mRenderingTiles = true;
+  QtConcurrent::blockingMap( tiles, renderTileStatic );
+  mRenderingTiles = false;
+  mTileRegisteredIds.clear();
+
+  mRendererV2->stopRender( mContext );
+
+  // composite the tiles in order
+  Q_FOREACH ( const TileJob& tile, tiles )
+  {
+    if ( !mContext.renderingStopped() )
+      mContext.painter()->drawImage( tile.rect.topLeft(), *tile.img );
+
+    delete tile.renderer;
+    delete tile.img;
+  }
+}
+
+
+void QgsVectorLayerRenderer::renderTileStatic( TileJob& tile )
+{
+  QgsVectorLayerRenderer* self = tile.parent;
+  if ( self->mContext.renderingStopped() )
+    return;
+
+  QPainter painter( tile.img );
+  painter.setRenderHints( tile.renderHints );
+  painter.translate( -tile.rect.topLeft() );
+  painter.setClipRect( tile.rect );
+  tile.context.setPainter( &painter );
+
+  tile.renderer->startRender( tile.context, self->mFields );
+
+  QgsFeatureIterator fit = tile.source->getFeatures( tile.request );
+
+  if (( tile.renderer->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && tile.renderer->usingSymbolLevels() )
+    self->drawRendererV2Levels( fit, tile.context, tile.renderer );
+  else
+    self->drawRendererV2( fit, tile.context, tile.renderer );
+
+  painter.end();
+  tile.context.setPainter( 0 );
+}
 
 
 void QgsVectorLayerRenderer::prepareLabeling( QgsVectorLayer* layer, QStringList& attributeNames )
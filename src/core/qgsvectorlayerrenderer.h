@@ -28,7 +28,9 @@ class QgsGeometryCache;
 class QgsFeatureIterator;
 class QgsSingleSymbolRendererV2;
 
+#include <QAtomicInt>
 #include <QList>
+#include <QMutex>
 #include <QPainter>
 
 typedef QList<int> QgsAttributeList;
@@ -37,6 +39,7 @@ typedef QList<int> QgsAttributeList;
 #include "qgsfield.h"  // QgsFields
 #include "qgsfeature.h"  // QgsFeatureIds
 #include "qgsfeatureiterator.h"
+#include "qgsrendercontext.h"
 #include "qgsvectorsimplifymethod.h"
 
 #include "qgsmaplayerrenderer.h"
@@ -63,6 +66,19 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
   private:
 
+    /** Part of the layer's output image rendered by one worker thread in tiled rendering mode */
+    struct TileJob
+    {
+      QgsVectorLayerRenderer* parent;
+      QgsVectorLayerFeatureSource* source;
+      QgsFeatureRendererV2* renderer; // must be deleted
+      QgsRenderContext context;
+      QgsFeatureRequest request;
+      QRect rect; // in output image pixels
+      QImage* img; // must be deleted
+      QPainter::RenderHints renderHints;
+    };
+
     /** Registers label and diagram layer
       @param layer diagram layer
       @param attributeNames attributes needed for labeling and diagrams will be added to the list
@@ -72,15 +88,30 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     /** Draw layer with renderer V2. QgsFeatureRenderer::startRender() needs to be called before using this method
      */
-    void drawRendererV2( QgsFeatureIterator& fit );
+    void drawRendererV2( QgsFeatureIterator& fit, QgsRenderContext& context, QgsFeatureRendererV2* renderer );
 
     /** Draw layer with renderer V2 using symbol levels. QgsFeatureRenderer::startRender() needs to be called before using this method
      */
-    void drawRendererV2Levels( QgsFeatureIterator& fit );
+    void drawRendererV2Levels( QgsFeatureIterator& fit, QgsRenderContext& context, QgsFeatureRendererV2* renderer );
 
     /** Stop version 2 renderer and selected renderer (if required) */
-    void stopRendererV2( QgsSingleSymbolRendererV2* selRenderer );
+    void stopRendererV2( QgsRenderContext& context, QgsFeatureRendererV2* renderer, QgsSingleSymbolRendererV2* selRenderer );
+
+    /** Adds a feature to the geometry cache and registers it with labeling engines if it has been rendered.
+     * In tiled mode, features crossing tile borders are registered only once.
+     */
+    void registerFeature( QgsFeature& fet, QgsRenderContext& context, bool rendered );
+
+    /** Returns true if the layer can be split into tiles rendered by separate threads */
+    bool canRenderTiled() const;
 
+    /** Estimates how far (in output pixels) the symbols of the renderer may extend beyond feature geometries */
+    double estimateSymbolBleed() const;
+
+    /** Renders the layer as a set of horizontal tiles in parallel and composites them onto the layer's painter */
+    void renderTiled( const QgsFeatureRequest& featureRequest );
+
+    static void renderTileStatic( TileJob& tile );
 
   protected:
 
@@ -121,6 +152,19 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     QgsVectorSimplifyMethod mSimplifyMethod;
     bool mSimplifyGeometry;
+
+    //! provider feature sources for worker threads in tiled rendering mode (empty if tiling is not used)
+    QList<QgsAbstractFeatureSource*> mTileProviderSources;
+    //! feature sources of the tiles, created from mSource and the provider sources when tiles are rendered
+    QList<QgsVectorLayerFeatureSource*> mTileSources;
+    //! true while tiles are being rendered
+    bool mRenderingTiles;
+    //! serializes registration of features with labeling engines and geometry cache in tiled mode
+    QMutex mTileMutex;
+    //! features already registered for labeling in tiled mode
+    QgsFeatureIds mTileRegisteredIds;
+    //! number of features fetched so far (incremented by the tiles in parallel)
+    QAtomicInt mFetchedFeatures;
 };
 
 
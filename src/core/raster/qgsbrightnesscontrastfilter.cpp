@@ -137,7 +137,13 @@ QgsRasterBlock * QgsBrightnessContrastFilter::block( int bandNo, QgsRectangle  c
     return inputBlock;
   }
 
-  if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
+  if ( inputBlock->dataType() == QGis::ARGB32_Premultiplied )
+  {
+    // each pixel is read before it is written, so the rendered block is adjusted in place
+    delete outputBlock;
+    outputBlock = inputBlock;
+  }
+  else if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
   {
     delete inputBlock;
     return outputBlock;
@@ -168,7 +174,10 @@ QgsRasterBlock * QgsBrightnessContrastFilter::block( int bandNo, QgsRectangle  c
     outputBlock->setColor( i, qRgba( r, g, b, alpha ) );
   }
 
-  delete inputBlock;
+  if ( inputBlock != outputBlock )
+  {
+    delete inputBlock;
+  }
   return outputBlock;
 }
 
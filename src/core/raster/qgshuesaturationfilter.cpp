@@ -146,7 +146,13 @@ QgsRasterBlock * QgsHueSaturationFilter::block( int bandNo, QgsRectangle  const
     return inputBlock;
   }
 
-  if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
+  if ( inputBlock->dataType() == QGis::ARGB32_Premultiplied )
+  {
+    // each pixel is read before it is written, so the rendered block is adjusted in place
+    delete outputBlock;
+    outputBlock = inputBlock;
+  }
+  else if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
   {
     delete inputBlock;
     return outputBlock;
@@ -220,7 +226,10 @@ QgsRasterBlock * QgsHueSaturationFilter::block( int bandNo, QgsRectangle  const
     outputBlock->setColor( i, qRgba( r, g, b, alpha ) );
   }
 
-  delete inputBlock;
+  if ( inputBlock != outputBlock )
+  {
+    delete inputBlock;
+  }
   return outputBlock;
 }
 
@@ -17,8 +17,10 @@
 
 #include <limits>
 
+#include <QAtomicInt>
 #include <QByteArray>
 #include <QColor>
+#include <QThreadStorage>
 
 #include "qgslogger.h"
 #include "qgsrasterblock.h"
@@ -26,6 +28,149 @@
 // See #9101 before any change of NODATA_COLOR!
 const QRgb QgsRasterBlock::mNoDataColor = qRgba( 0, 0, 0, 0 );
 
+//! maximum number of released buffers (data or images) kept for reuse by a thread
+static const int POOL_MAX_BUFFERS = 8;
+
+//! maximum total size in bytes of the released buffers kept for reuse by a thread
+static const qgssize POOL_MAX_BYTES = 16 * 1024 * 1024;
+
+//! maximum total size in bytes of the released buffers kept for reuse by all threads together
+static const int POOL_MAX_TOTAL_BYTES = 64 * 1024 * 1024;
+
+//! size of the released buffers kept by the pools of all threads
+static QAtomicInt sPooledBytes;
+
+/** Memory of deleted or reset blocks, kept for the next blocks allocated in the same thread.
+ * Raster pipes request blocks of the same size part after part (QgsRasterIterator), so
+ * most blocks of a render or export are served from the pool instead of the heap.
+ * The pools of all threads share a global budget, so that many rendering threads do not
+ * keep a lot of memory.
+ */
+struct QgsRasterBlockPool
+{
+  QgsRasterBlockPool() : bytes( 0 ) {}
+  ~QgsRasterBlockPool()
+  {
+    for ( int i = 0; i < data.size(); ++i )
+      qgsFree( data[i].second );
+    sPooledBytes.fetchAndAddOrdered( -( int )bytes );
+  }
+
+  //! reserves size bytes of the global budget for a released buffer, returns false if it is exhausted
+  bool reserve( qgssize size )
+  {
+    if ( size > POOL_MAX_BYTES / 2 )
+      return false;
+    if ( sPooledBytes.fetchAndAddOrdered(( int )size ) + ( int )size > POOL_MAX_TOTAL_BYTES )
+    {
+      sPooledBytes.fetchAndAddOrdered( -( int )size );
+      return false;
+    }
+    bytes += size;
+    return true;
+  }
+
+  //! gives back the budget of a buffer taken out of the pool
+  void release( qgssize size )
+  {
+    bytes -= size;
+    sPooledBytes.fetchAndAddOrdered( -( int )size );
+  }
+
+  //! removes the least recently released buffers until the limits are met
+  void trim()
+  {
+    while ( !data.isEmpty() && ( data.size() + images.size() > POOL_MAX_BUFFERS || bytes > POOL_MAX_BYTES ) )
+    {
+      QPair<qgssize, void*> buffer = data.takeLast();
+      release( buffer.first );
+      qgsFree( buffer.second );
+    }
+    while ( !images.isEmpty() && ( data.size() + images.size() > POOL_MAX_BUFFERS || bytes > POOL_MAX_BYTES ) )
+    {
+      release( images.takeLast().byteCount() );
+    }
+  }
+
+  QList< QPair<qgssize, void*> > data; // most recently released first
+  QList<QImage> images; // most recently released first
+  qgssize bytes;
+};
+
+static QThreadStorage<QgsRasterBlockPool*> sBlockPools;
+
+static QgsRasterBlockPool* _blockPool()
+{
+  if ( !sBlockPools.hasLocalData() )
+  {
+    sBlockPools.setLocalData( new QgsRasterBlockPool() );
+  }
+  return sBlockPools.localData();
+}
+
+static void* _allocateData( qgssize size )
+{
+  QgsRasterBlockPool* pool = _blockPool();
+  for ( int i = 0; i < pool->data.size(); ++i )
+  {
+    if ( pool->data.at( i ).first == size )
+    {
+      pool->release( size );
+      return pool->data.takeAt( i ).second;
+    }
+  }
+  return qgsMalloc( size );
+}
+
+static void _releaseData( void* data, qgssize size )
+{
+  if ( !data )
+    return;
+
+  QgsRasterBlockPool* pool = _blockPool();
+  if ( !pool->reserve( size ) )
+  {
+    qgsFree( data );
+    return;
+  }
+
+  pool->data.prepend( qMakePair( size, data ) );
+  pool->trim();
+}
+
+static QImage* _allocateImage( int width, int height, QImage::Format format )
+{
+  QgsRasterBlockPool* pool = _blockPool();
+  for ( int i = 0; i < pool->images.size(); ++i )
+  {
+    const QImage& image = pool->images.at( i );
+    // images still shared with a copy returned by QgsRasterBlock::image() would be detached when written
+    if ( image.width() == width && image.height() == height && image.format() == format && image.isDetached() )
+    {
+      pool->release( image.byteCount() );
+      return new QImage( pool->images.takeAt( i ) );
+    }
+  }
+  return new QImage( width, height, format );
+}
+
+static void _releaseImage( QImage* image )
+{
+  if ( !image )
+    return;
+
+  if ( !image->isNull() )
+  {
+    QgsRasterBlockPool* pool = _blockPool();
+    if ( pool->reserve( image->byteCount() ) )
+    {
+      pool->images.prepend( *image );
+      pool->trim();
+    }
+  }
+  delete image;
+}
+
 QgsRasterBlock::QgsRasterBlock()
     : mValid( true )
     , mDataType( QGis::UnknownDataType )
@@ -79,8 +224,8 @@ QgsRasterBlock::QgsRasterBlock( QGis::DataType theDataType, int theWidth, int th
 QgsRasterBlock::~QgsRasterBlock()
 {
   QgsDebugMsg( QString( "mData = %1" ).arg(( ulong )mData ) );
-  qgsFree( mData );
-  delete mImage;
+  _releaseData( mData, ( qgssize )mTypeSize * mWidth * mHeight );
+  _releaseImage( mImage );
   qgsFree( mNoDataBitmap );
 }
 
@@ -100,9 +245,9 @@ bool QgsRasterBlock::reset( QGis::DataType theDataType, int theWidth, int theHei
 {
   QgsDebugMsg( QString( "theWidth= %1 theHeight = %2 theDataType = %3 theNoDataValue = %4" ).arg( theWidth ).arg( theHeight ).arg( theDataType ).arg( theNoDataValue ) );
 
-  qgsFree( mData );
+  _releaseData( mData, ( qgssize )mTypeSize * mWidth * mHeight );
   mData = 0;
-  delete mImage;
+  _releaseImage( mImage );
   mImage = 0;
   qgsFree( mNoDataBitmap );
   mNoDataBitmap = 0;
@@ -119,7 +264,7 @@ bool QgsRasterBlock::reset( QGis::DataType theDataType, int theWidth, int theHei
     QgsDebugMsg( "Numeric type" );
     qgssize tSize = typeSize( theDataType );
     QgsDebugMsg( QString( "allocate %1 bytes" ).arg( tSize * theWidth * theHeight ) );
-    mData = qgsMalloc( tSize * theWidth * theHeight );
+    mData = _allocateData( tSize * theWidth * theHeight );
     if ( mData == 0 )
     {
       QgsDebugMsg( QString( "Couldn't allocate data memory of %1 bytes" ).arg( tSize * theWidth * theHeight ) );
@@ -130,7 +275,7 @@ bool QgsRasterBlock::reset( QGis::DataType theDataType, int theWidth, int theHei
   {
     QgsDebugMsg( "Color type" );
     QImage::Format format = imageFormat( theDataType );
-    mImage = new QImage( theWidth, theHeight, format );
+    mImage = _allocateImage( theWidth, theHeight, format );
   }
   else
   {
@@ -713,7 +858,7 @@ bool QgsRasterBlock::convert( QGis::DataType destDataType )
       QgsDebugMsg( "Cannot convert raster block" );
       return false;
     }
-    qgsFree( mData );
+    _releaseData( mData, ( qgssize )mTypeSize * mWidth * mHeight );
     mData = data;
     mDataType = destDataType;
     mTypeSize = typeSize( mDataType );
@@ -778,9 +923,9 @@ QImage QgsRasterBlock::image() const
 
 bool QgsRasterBlock::setImage( const QImage * image )
 {
-  qgsFree( mData );
+  _releaseData( mData, ( qgssize )mTypeSize * mWidth * mHeight );
   mData = 0;
-  delete mImage;
+  _releaseImage( mImage );
   mImage = 0;
   mImage = new QImage( *image );
   mWidth = mImage->width();
@@ -833,7 +978,7 @@ QString QgsRasterBlock::printValue( double value )
 void * QgsRasterBlock::convert( void *srcData, QGis::DataType srcDataType, QGis::DataType destDataType, qgssize size )
 {
   int destDataTypeSize = typeSize( destDataType );
-  void *destData = qgsMalloc( destDataTypeSize * size );
+  void *destData = _allocateData( destDataTypeSize * size );
   for ( qgssize i = 0; i < size; i++ )
   {
     double value = readValue( srcData, srcDataType, i );
@@ -28,6 +28,9 @@
 
 /** \ingroup core
  * Raster data container.
+ *
+ * Data and image memory of deleted blocks is kept by the thread which deleted them
+ * and reused for blocks of the same size allocated later in that thread.
  */
 class CORE_EXPORT QgsRasterBlock
 {
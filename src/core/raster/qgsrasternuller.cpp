@@ -89,26 +89,30 @@ QgsRasterBlock * QgsRasterNuller::block( int bandNo, QgsRectangle  const & exten
     return inputBlock;
   }
 
-  QgsRasterBlock *outputBlock = 0;
-
-  if ( mHasOutputNoData.value( bandNo - 1 ) || inputBlock->hasNoDataValue() )
+  if ( !mHasOutputNoData.value( bandNo - 1 ) )
   {
-    double noDataValue;
-    if ( mHasOutputNoData.value( bandNo - 1 ) )
+    // the no data value is not changed, values in the ranges are set to no data in place
+    QgsRasterRangeList noData = mNoData.value( bandNo - 1 );
+    if ( noData.isEmpty() )
     {
-      noDataValue = mOutputNoData.value( bandNo - 1 );
+      return inputBlock;
     }
-    else
+
+    for ( int i = 0; i < height; i++ )
     {
-      noDataValue = inputBlock->noDataValue();
+      for ( int j = 0; j < width; j++ )
+      {
+        if ( !inputBlock->isNoData( i, j ) && QgsRasterRange::contains( inputBlock->value( i, j ), noData ) )
+        {
+          inputBlock->setIsNoData( i, j );
+        }
+      }
     }
-    outputBlock = new QgsRasterBlock( inputBlock->dataType(), width, height, noDataValue );
-  }
-  else
-  {
-    outputBlock = new QgsRasterBlock( inputBlock->dataType(), width, height );
+    return inputBlock;
   }
 
+  QgsRasterBlock *outputBlock = new QgsRasterBlock( inputBlock->dataType(), width, height, mOutputNoData.value( bandNo - 1 ) );
+
   for ( int i = 0; i < height; i++ )
   {
     for ( int j = 0; j < width; j++ )
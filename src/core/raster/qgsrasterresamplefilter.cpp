@@ -189,13 +189,7 @@ QgsRasterBlock * QgsRasterResampleFilter::block( int bandNo, QgsRectangle  const
     return outputBlock;
   }
 
-  if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
-  {
-    delete inputBlock;
-    return outputBlock;
-  }
-
-  //resample image
+  //resample image, the output block takes the resampled image in setImage()
   QImage img = inputBlock->image();
 
   QImage dstImg = QImage( width, height, QImage::Format_ARGB32_Premultiplied );
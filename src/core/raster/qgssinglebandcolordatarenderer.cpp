@@ -81,25 +81,20 @@ QgsRasterBlock* QgsSingleBandColorDataRenderer::block( int bandNo, QgsRectangle
     return inputBlock;
   }
 
-  if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
-  {
-    delete inputBlock;
-    return outputBlock;
-  }
+  delete outputBlock;
 
   // make sure input is also premultiplied!
   inputBlock->convert( QGis::ARGB32_Premultiplied );
 
-  QRgb* inputBits = ( QRgb* )inputBlock->bits();
-  QRgb* outputBits = ( QRgb* )outputBlock->bits();
+  // opacity is applied in place
+  QRgb* bits = ( QRgb* )inputBlock->bits();
   for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
   {
-    QRgb c = inputBits[i];
-    outputBits[i] = qRgba( mOpacity * qRed( c ), mOpacity * qGreen( c ), mOpacity * qBlue( c ), mOpacity * qAlpha( c ) );
+    QRgb c = bits[i];
+    bits[i] = qRgba( mOpacity * qRed( c ), mOpacity * qGreen( c ), mOpacity * qBlue( c ), mOpacity * qAlpha( c ) );
   }
 
-  delete inputBlock;
-  return outputBlock;
+  return inputBlock;
 }
 
 void QgsSingleBandColorDataRenderer::writeXML( QDomDocument& doc, QDomElement& parentElem ) const
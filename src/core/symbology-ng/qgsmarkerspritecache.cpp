@@ -0,0 +1,70 @@
+/***************************************************************************
+  qgsmarkerspritecache.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmarkerspritecache.h"
+
+#include <cmath>
+
+//! rotation step of cached sprites in degrees. Corners of a 20 pixel marker move by less than 0.2 pixels
+static const double ROTATION_STEP = 1.0;
+
+QgsMarkerSpriteCache::QgsMarkerSpriteCache( int maxBytes )
+{
+  for ( int i = 0; i < PARTS; ++i )
+    mParts[i].images.setMaxCost( qMax( 1, maxBytes / PARTS / 1024 ) );
+}
+
+QgsMarkerSpriteCache* QgsMarkerSpriteCache::instance()
+{
+  static QgsMarkerSpriteCache mInstance;
+  return &mInstance;
+}
+
+QImage QgsMarkerSpriteCache::sprite( const QString& key ) const
+{
+  const Part& p = part( key );
+  QMutexLocker locker( &p.mutex );
+  const QImage* image = p.images.object( key );
+  return image ? *image : QImage();
+}
+
+bool QgsMarkerSpriteCache::insert( const QString& key, const QImage& image )
+{
+  if ( image.isNull() )
+    return false;
+
+  Part& p = part( key );
+  QMutexLocker locker( &p.mutex );
+  // QCache deletes the image if it is too large
+  return p.images.insert( key, new QImage( image ), qMax( 1, image.byteCount() / 1024 ) );
+}
+
+void QgsMarkerSpriteCache::clear()
+{
+  for ( int i = 0; i < PARTS; ++i )
+  {
+    QMutexLocker locker( &mParts[i].mutex );
+    mParts[i].images.clear();
+  }
+}
+
+double QgsMarkerSpriteCache::rotationBucket( double angle )
+{
+  double bucket = floor( angle / ROTATION_STEP + 0.5 ) * ROTATION_STEP;
+  bucket = fmod( bucket, 360.0 );
+  if ( bucket < 0 )
+    bucket += 360.0;
+  return bucket;
+}
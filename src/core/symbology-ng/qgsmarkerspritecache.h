@@ -0,0 +1,85 @@
+/***************************************************************************
+  qgsmarkerspritecache.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMARKERSPRITECACHE_H
+#define QGSMARKERSPRITECACHE_H
+
+#include <QCache>
+#include <QColor>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/** \ingroup core
+ * Cache of rendered marker images (sprites) shared by all marker symbol layers and render threads.
+ *
+ * Sprites are identified by a key built by the symbol layer from all parameters that affect
+ * the rendered image: shape, size in pixels, colors, outline, rotation and raster scale factor.
+ * Rotations are rounded to rotationBucket() so that markers with data defined rotation can
+ * also be drawn from the cache.
+ *
+ * The cache is split into several independently locked parts selected by the hash of the key,
+ * so that threads drawing different markers do not wait for each other. Returned images are
+ * implicitly shared copies and may be drawn without holding any lock.
+ *
+ * @note added in QGIS 2.12
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsMarkerSpriteCache
+{
+  public:
+    /** Constructor
+     * @param maxBytes maximum memory taken by the cached images (in bytes)
+     */
+    explicit QgsMarkerSpriteCache( int maxBytes = 32 * 1024 * 1024 );
+
+    //! Returns the cache shared by all symbol layers
+    static QgsMarkerSpriteCache* instance();
+
+    //! Returns the sprite with the given key or a null image if it is not cached
+    QImage sprite( const QString& key ) const;
+
+    /** Adds a sprite to the cache. Sprites larger than a part of the cache are not added.
+     * @returns true if the sprite was added
+     */
+    bool insert( const QString& key, const QImage& image );
+
+    //! Removes all sprites
+    void clear();
+
+    //! Returns the angle rounded to the rotation step of cached sprites (in degrees)
+    static double rotationBucket( double angle );
+
+    //! Returns the key part for a color, including its alpha
+    static QString colorKey( const QColor& color ) { return QString::number( color.rgba(), 16 ); }
+
+  private:
+    //! number of independently locked parts of the cache
+    static const int PARTS = 16;
+
+    //! part of the cache, image costs are in kilobytes
+    struct Part
+    {
+      mutable QMutex mutex;
+      QCache<QString, QImage> images;
+    };
+
+    Part mParts[PARTS];
+
+    const Part& part( const QString& key ) const { return mParts[ qHash( key ) % PARTS ]; }
+    Part& part( const QString& key ) { return mParts[ qHash( key ) % PARTS ]; }
+};
+
+#endif // QGSMARKERSPRITECACHE_H
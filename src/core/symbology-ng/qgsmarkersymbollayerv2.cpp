@@ -22,6 +22,7 @@
 #include "qgsrendercontext.h"
 #include "qgslogger.h"
 #include "qgssvgcache.h"
+#include "qgsmarkerspritecache.h"
 
 #include <QPainter>
 #include <QSvgRenderer>
@@ -185,9 +186,10 @@ void QgsSimpleMarkerSymbolLayerV2::startRender( QgsSymbolV2RenderContext& contex
   bool hasDataDefinedSize = context.renderHints() & QgsSymbolV2::DataDefinedSizeScale || hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_SIZE );
 
   // use caching only when:
-  // - size, rotation, shape, color, border color is not data-defined
+  // - size, shape, color, border color is not data-defined
   // - drawing to screen (not printer)
-  mUsingCache = !hasDataDefinedRotation && !hasDataDefinedSize && !context.renderContext().forceVectorOutput()
+  // data defined rotations are drawn from cached sprites rotated to the nearest rotation bucket
+  mUsingCache = !hasDataDefinedSize && !context.renderContext().forceVectorOutput()
                 && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_NAME ) && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_COLOR ) && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_COLOR_BORDER )
                 && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_OUTLINE_WIDTH ) && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_OUTLINE_STYLE ) &&
                 !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_SIZE );
@@ -224,7 +226,8 @@ void QgsSimpleMarkerSymbolLayerV2::startRender( QgsSymbolV2RenderContext& contex
   }
 
   // rotate if the rotation is not going to be changed during the rendering
-  if ( !hasDataDefinedRotation && mAngle != 0 )
+  // (cached sprites are rotated when they are drawn)
+  if ( !hasDataDefinedRotation && !mUsingCache && mAngle != 0 )
   {
     transform.rotate( mAngle );
   }
@@ -239,6 +242,16 @@ void QgsSimpleMarkerSymbolLayerV2::startRender( QgsSymbolV2RenderContext& contex
     if ( !prepareCache( context ) )
     {
       mUsingCache = false;
+
+      if ( !hasDataDefinedRotation && mAngle != 0 )
+      {
+        QMatrix rotation;
+        rotation.rotate( mAngle );
+        if ( !mPolygon.isEmpty() )
+          mPolygon = rotation.map( mPolygon );
+        else
+          mPath = rotation.map( mPath );
+      }
     }
   }
   else
@@ -255,42 +268,63 @@ void QgsSimpleMarkerSymbolLayerV2::startRender( QgsSymbolV2RenderContext& contex
 
 bool QgsSimpleMarkerSymbolLayerV2::prepareCache( QgsSymbolV2RenderContext& context )
 {
-  double scaledSize = QgsSymbolLayerV2Utils::convertToPainterUnits( context.renderContext(), mSize, mSizeUnit, mSizeMapUnitScale );
+  mCache = sprite( context, mAngle, false );
+  if ( mCache.isNull() )
+  {
+    mSelCache = QImage();
+    return false;
+  }
+
+  mSelCache = sprite( context, mAngle, true );
+  return true;
+}
 
-  // calculate necessary image size for the cache
+QImage QgsSimpleMarkerSymbolLayerV2::sprite( QgsSymbolV2RenderContext& context, double angle, bool selected )
+{
+  const QgsRenderContext& rc = context.renderContext();
+  double scaledSize = QgsSymbolLayerV2Utils::convertToPainterUnits( rc, mSize, mSizeUnit, mSizeMapUnitScale ) * rc.rasterScaleFactor();
+
+  // everything that affects the rendered image, the DPI is covered by the sizes in pixels
+  QString key = QString( "simple|%1|%2|%3|%4|%5|%6|%7|%8" )
+                .arg( mName, QString::number( scaledSize ) ).arg( rc.rasterScaleFactor() ).arg( angle )
+                .arg( mPen.widthF() ).arg( mOutlineStyle )
+                .arg( QgsMarkerSpriteCache::colorKey( mBrush.color() ), QgsMarkerSpriteCache::colorKey( mPen.color() ) );
+  if ( selected )
+  {
+    key += QString( "|sel|%1|%2|%3" ).arg( QgsMarkerSpriteCache::colorKey( mSelBrush.color() ),
+                                           QgsMarkerSpriteCache::colorKey( mSelPen.color() ),
+                                           QgsMarkerSpriteCache::colorKey( rc.selectionColor() ) );
+  }
+
+  QgsMarkerSpriteCache* cache = QgsMarkerSpriteCache::instance();
+  QImage image = cache->sprite( key );
+  if ( !image.isNull() )
+    return image;
+
+  // calculate necessary image size for the rotated shape
+  QMatrix rotation;
+  rotation.rotate( angle );
+  QRectF bounds = rotation.mapRect( mPolygon.isEmpty() ? mPath.boundingRect() : mPolygon.boundingRect() );
+  double extent = qMax( qMax( qAbs( bounds.left() ), qAbs( bounds.right() ) ), qMax( qAbs( bounds.top() ), qAbs( bounds.bottom() ) ) );
   double pw = (( mPen.widthF() == 0 ? 1 : mPen.widthF() ) + 1 ) / 2 * 2; // make even (round up); handle cosmetic pen
-  int imageSize = (( int ) scaledSize + pw ) / 2 * 2 + 1; //  make image width, height odd; account for pen width
+  int imageSize = (( int )( 2 * extent ) + pw ) / 2 * 2 + 1; //  make image width, height odd; account for pen width
   double center = imageSize / 2.0;
 
   if ( imageSize > mMaximumCacheWidth )
   {
-    return false;
+    return QImage();
   }
 
-  mCache = QImage( QSize( imageSize, imageSize ), QImage::Format_ARGB32_Premultiplied );
-  mCache.fill( 0 );
+  image = QImage( QSize( imageSize, imageSize ), QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
 
   QPainter p;
-  p.begin( &mCache );
-  p.setRenderHint( QPainter::Antialiasing );
-  p.setBrush( mBrush );
-  p.setPen( mPen );
-  p.translate( QPointF( center, center ) );
-  drawMarker( &p, context );
-  p.end();
-
-  // Construct the selected version of the Cache
-
-  QColor selColor = context.renderContext().selectionColor();
-
-  mSelCache = QImage( QSize( imageSize, imageSize ), QImage::Format_ARGB32_Premultiplied );
-  mSelCache.fill( 0 );
-
-  p.begin( &mSelCache );
+  p.begin( &image );
   p.setRenderHint( QPainter::Antialiasing );
-  p.setBrush( mSelBrush );
-  p.setPen( mSelPen );
+  p.setBrush( selected ? mSelBrush : mBrush );
+  p.setPen( selected ? mSelPen : mPen );
   p.translate( QPointF( center, center ) );
+  p.rotate( angle );
   drawMarker( &p, context );
   p.end();
 
@@ -298,19 +332,21 @@ bool QgsSimpleMarkerSymbolLayerV2::prepareCache( QgsSymbolV2RenderContext& conte
   // filling the background with the selection color and using the normal
   // colors for the symbol .. could be ugly!
 
-  if ( mSelCache == mCache )
+  if ( selected && image == sprite( context, angle, false ) )
   {
-    p.begin( &mSelCache );
+    p.begin( &image );
     p.setRenderHint( QPainter::Antialiasing );
-    p.fillRect( 0, 0, imageSize, imageSize, selColor );
+    p.fillRect( 0, 0, imageSize, imageSize, rc.selectionColor() );
     p.setBrush( mBrush );
     p.setPen( mPen );
     p.translate( QPointF( center, center ) );
+    p.rotate( angle );
     drawMarker( &p, context );
     p.end();
   }
 
-  return true;
+  cache->insert( key, image );
+  return image;
 }
 
 void QgsSimpleMarkerSymbolLayerV2::stopRender( QgsSymbolV2RenderContext& context )
@@ -544,11 +580,18 @@ void QgsSimpleMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV
     }
   }
 
+  QImage img;
   if ( mUsingCache )
+  {
+    img = context.selected() ? mSelCache : mCache;
+    if ( hasDataDefinedRotation )
+      img = sprite( context, QgsMarkerSpriteCache::rotationBucket( angle ), context.selected() ); // null if the rotated marker is too large
+  }
+
+  if ( !img.isNull() )
   {
     //QgsDebugMsg( QString("XXX using cache") );
     // we will use cached image
-    QImage &img = context.selected() ? mSelCache : mCache;
     double s = img.width() / context.renderContext().rasterScaleFactor();
     p->drawImage( QRectF( point.x() - s / 2.0 + off.x(),
                           point.y() - s / 2.0 + off.y(),
@@ -1197,6 +1240,78 @@ void QgsSvgMarkerSymbolLayerV2::stopRender( QgsSymbolV2RenderContext& context )
   Q_UNUSED( context );
 }
 
+//! maximum width and height of cached font marker images
+static const int MAXIMUM_FONT_SPRITE_SIZE = 3000;
+
+/** Returns the SVG marker rendered with the given rotation and the opacity of the context from
+ * the shared sprite cache. Rotated sprites are rendered from the SVG, not from the unrotated image.
+ * fitsInCache is set to false if the marker is too large for QgsSvgCache.
+ */
+static QImage _svgSprite( const QString& path, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                          QgsSymbolV2RenderContext& context, double angle, bool& fitsInCache )
+{
+  const QgsRenderContext& rc = context.renderContext();
+  QString prefix = QString( "svg|%1|%2|%3|%4|%5|%6|%7" ).arg( size )
+                   .arg( QgsMarkerSpriteCache::colorKey( fill ), QgsMarkerSpriteCache::colorKey( outline ) )
+                   .arg( outlineWidth ).arg( rc.scaleFactor() ).arg( rc.rasterScaleFactor() ).arg( context.alpha() );
+  QString key = prefix + "|0|" + path;
+  QString spriteKey = prefix + QString( "|%1|" ).arg( angle ) + path;
+
+  QgsMarkerSpriteCache* cache = QgsMarkerSpriteCache::instance();
+  QImage sprite = cache->sprite( spriteKey );
+  if ( !sprite.isNull() )
+    return sprite;
+
+  QImage image = cache->sprite( key );
+  if ( image.isNull() )
+  {
+    image = QgsSvgCache::instance()->svgAsImage( path, size, fill, outline, outlineWidth, rc.scaleFactor(), rc.rasterScaleFactor(), fitsInCache );
+    if ( !fitsInCache || image.width() <= 1 )
+      return image;
+
+    //consider transparency
+    if ( !qgsDoubleNear( context.alpha(), 1.0 ) )
+    {
+      image = image.copy();
+      QgsSymbolLayerV2Utils::multiplyImageOpacity( &image, context.alpha() );
+    }
+    cache->insert( key, image );
+  }
+
+  if ( spriteKey == key )
+    return image;
+
+  // render the SVG rotated around its center (rotating the rasterized marker would blur it)
+  QSvgRenderer r( QgsSvgCache::instance()->svgContent( path, size, fill, outline, outlineWidth, rc.scaleFactor(), rc.rasterScaleFactor() ) );
+  QRectF rect( -image.width() / 2.0, -image.height() / 2.0, image.width(), image.height() );
+  if ( r.viewBoxF().width() != r.viewBoxF().height() )
+  {
+    QSizeF s( r.viewBoxF().size() );
+    s.scale( image.width(), image.height(), Qt::KeepAspectRatio );
+    rect = QRectF( -s.width() / 2.0, -s.height() / 2.0, s.width(), s.height() );
+  }
+
+  QMatrix rotation;
+  rotation.rotate( angle );
+  QRectF bounds = rotation.mapRect( QRectF( -image.width() / 2.0, -image.height() / 2.0, image.width(), image.height() ) );
+  int width = ( int )ceil( bounds.width() ) / 2 * 2 + 1;
+  int height = ( int )ceil( bounds.height() ) / 2 * 2 + 1;
+
+  sprite = QImage( width, height, QImage::Format_ARGB32_Premultiplied );
+  sprite.fill( 0 );
+
+  QPainter p( &sprite );
+  p.setRenderHint( QPainter::Antialiasing );
+  p.setOpacity( context.alpha() );
+  p.translate( width / 2.0, height / 2.0 );
+  p.rotate( angle );
+  r.render( &p, rect );
+  p.end();
+
+  cache->insert( spriteKey, sprite );
+  return sprite;
+}
+
 void QgsSvgMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV2RenderContext& context )
 {
   QPainter *p = context.renderContext().painter();
@@ -1274,8 +1389,6 @@ void QgsSvgMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV2Re
   p->translate( point + outputOffset );
 
   bool rotated = !qgsDoubleNear( angle, 0 );
-  if ( rotated )
-    p->rotate( angle );
 
   QString path = mPath;
   if ( hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_NAME ) )
@@ -1312,29 +1425,27 @@ void QgsSvgMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV2Re
   bool fitsInCache = true;
   bool usePict = true;
   double hwRatio = 1.0;
-  if ( !context.renderContext().forceVectorOutput() && !rotated )
+  if ( !context.renderContext().forceVectorOutput() )
   {
     usePict = false;
-    const QImage& img = QgsSvgCache::instance()->svgAsImage( path, size, fillColor, outlineColor, outlineWidth,
-                        context.renderContext().scaleFactor(), context.renderContext().rasterScaleFactor(), fitsInCache );
+    double spriteAngle = rotated ? QgsMarkerSpriteCache::rotationBucket( angle ) : 0;
+    QImage img = _svgSprite( path, size, fillColor, outlineColor, outlineWidth, context, spriteAngle, fitsInCache );
     if ( fitsInCache && img.width() > 1 )
     {
-      //consider transparency
-      if ( !qgsDoubleNear( context.alpha(), 1.0 ) )
-      {
-        QImage transparentImage = img.copy();
-        QgsSymbolLayerV2Utils::multiplyImageOpacity( &transparentImage, context.alpha() );
-        p->drawImage( -transparentImage.width() / 2.0, -transparentImage.height() / 2.0, transparentImage );
-        hwRatio = ( double )transparentImage.height() / ( double )transparentImage.width();
-      }
-      else
+      p->drawImage( -img.width() / 2.0, -img.height() / 2.0, img );
+
+      if ( context.selected() )
       {
-        p->drawImage( -img.width() / 2.0, -img.height() / 2.0, img );
-        hwRatio = ( double )img.height() / ( double )img.width();
+        // the selection frame is aligned with the unrotated marker
+        QImage unrotated = rotated ? _svgSprite( path, size, fillColor, outlineColor, outlineWidth, context, 0, fitsInCache ) : img;
+        hwRatio = ( double )unrotated.height() / ( double )unrotated.width();
       }
     }
   }
 
+  if ( rotated )
+    p->rotate( angle );
+
   if ( usePict || !fitsInCache )
   {
     p->setOpacity( context.alpha() );
@@ -1650,6 +1761,7 @@ bool QgsSvgMarkerSymbolLayerV2::writeDxf( QgsDxfExport& e, double mmMapUnitScale
 
 QgsFontMarkerSymbolLayerV2::QgsFontMarkerSymbolLayerV2( const QString& fontFamily, QChar chr, double pointSize, const QColor& color, double angle )
     : mFontMetrics( 0 )
+    , mUsingCache( false )
 {
   mFontFamily = fontFamily;
   mChr = chr;
@@ -1724,6 +1836,15 @@ void QgsFontMarkerSymbolLayerV2::startRender( QgsSymbolV2RenderContext& context
   mFontMetrics = new QFontMetrics( mFont );
   mChrOffset = QPointF( mFontMetrics->width( mChr ) / 2.0, -mFontMetrics->ascent() / 2.0 );
   mOrigSize = mSize; // save in case the size would be data defined
+
+  // use the sprite cache only when:
+  // - size, color and character are not data-defined
+  // - drawing to screen (not printer)
+  // data defined rotations are drawn from cached sprites rotated to the nearest rotation bucket
+  bool hasDataDefinedSize = context.renderHints() & QgsSymbolV2::DataDefinedSizeScale || hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_SIZE );
+  mUsingCache = !hasDataDefinedSize && !context.renderContext().forceVectorOutput()
+                && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_COLOR ) && !hasDataDefinedProperty( QgsSymbolLayerV2::EXPR_CHAR );
+
   prepareExpressions( context );
 }
 
@@ -1827,20 +1948,72 @@ void QgsFontMarkerSymbolLayerV2::renderPoint( const QPointF& point, QgsSymbolV2R
     outputOffset = _rotatedOffset( outputOffset, angle );
   p->translate( point + outputOffset );
 
-  if ( !qgsDoubleNear( scaledSize, mOrigSize ) )
+  double scale = qgsDoubleNear( scaledSize, mOrigSize ) ? 1.0 : scaledSize / mOrigSize;
+
+  QImage img;
+  if ( mUsingCache )
+    img = sprite( charToRender, chrOffset, penColor, scale, QgsMarkerSpriteCache::rotationBucket( angle ) );
+
+  if ( !img.isNull() )
   {
-    double s = scaledSize / mOrigSize;
-    p->scale( s, s );
+    p->drawImage( -img.width() / 2.0, -img.height() / 2.0, img );
   }
+  else
+  {
+    if ( !qgsDoubleNear( scale, 1.0 ) )
+      p->scale( scale, scale );
 
-  bool rotated = !qgsDoubleNear( angle, 0 );
-  if ( rotated )
-    p->rotate( angle );
+    bool rotated = !qgsDoubleNear( angle, 0 );
+    if ( rotated )
+      p->rotate( angle );
 
-  p->drawText( -chrOffset, charToRender );
+    p->drawText( -chrOffset, charToRender );
+  }
   p->restore();
 }
 
+QImage QgsFontMarkerSymbolLayerV2::sprite( const QString& chr, const QPointF& chrOffset, const QColor& color, double scale, double angle ) const
+{
+  // the pixel size of the font is in painter units, so is the sprite
+  QString key = QString( "font|%1|%2|%3|" ).arg( QgsMarkerSpriteCache::colorKey( color ), QString::number( scale ), QString::number( angle ) )
+                + mFont.key() + "|" + chr;
+
+  QgsMarkerSpriteCache* cache = QgsMarkerSpriteCache::instance();
+  QImage image = cache->sprite( key );
+  if ( !image.isNull() )
+    return image;
+
+  QMatrix transform;
+  transform.scale( scale, scale );
+  transform.rotate( angle );
+  QRectF bounds = transform.mapRect( QRectF( mFontMetrics->boundingRect( chr ) ).translated( -chrOffset ) );
+
+  // keep the character centered at the marker position, with a margin for antialiasing
+  double extentX = qMax( qAbs( bounds.left() ), qAbs( bounds.right() ) ) + 2;
+  double extentY = qMax( qAbs( bounds.top() ), qAbs( bounds.bottom() ) ) + 2;
+  int width = ( int )ceil( 2 * extentX ) / 2 * 2 + 1;
+  int height = ( int )ceil( 2 * extentY ) / 2 * 2 + 1;
+  if ( width > MAXIMUM_FONT_SPRITE_SIZE || height > MAXIMUM_FONT_SPRITE_SIZE )
+    return QImage();
+
+  image = QImage( width, height, QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+
+  QPainter p( &image );
+  p.setRenderHint( QPainter::Antialiasing );
+  p.setRenderHint( QPainter::TextAntialiasing );
+  p.setPen( color );
+  p.setFont( mFont );
+  p.translate( width / 2.0, height / 2.0 );
+  p.scale( scale, scale );
+  p.rotate( angle );
+  p.drawText( -chrOffset, chr );
+  p.end();
+
+  cache->insert( key, image );
+  return image;
+}
+
 QgsStringMap QgsFontMarkerSymbolLayerV2::properties() const
 {
   QgsStringMap props;
@@ -115,6 +115,13 @@ class CORE_EXPORT QgsSimpleMarkerSymbolLayerV2 : public QgsMarkerSymbolLayerV2
     @return true in case of success, false if cache image size too large*/
     bool prepareCache( QgsSymbolV2RenderContext& context );
 
+    /** Returns the marker rendered with the given rotation from the shared sprite cache,
+     * rendering it if it is not cached yet. Returns a null image if the marker is too large.
+     * @note added in QGIS 2.12
+     * @note not available in python bindings
+     */
+    QImage sprite( QgsSymbolV2RenderContext& context, double angle, bool selected );
+
     QColor mBorderColor;
     Qt::PenStyle mOutlineStyle;
     double mOutlineWidth;
@@ -262,6 +269,13 @@ class CORE_EXPORT QgsFontMarkerSymbolLayerV2 : public QgsMarkerSymbolLayerV2
 
   protected:
 
+    /** Returns the character rendered with the given color, scale and rotation from the shared
+     * sprite cache, rendering it if it is not cached yet. Returns a null image if it is too large.
+     * @note added in QGIS 2.12
+     * @note not available in python bindings
+     */
+    QImage sprite( const QString& chr, const QPointF& chrOffset, const QColor& color, double scale, double angle ) const;
+
     QString mFontFamily;
     QFontMetrics* mFontMetrics;
     QChar mChr;
@@ -269,6 +283,8 @@ class CORE_EXPORT QgsFontMarkerSymbolLayerV2 : public QgsMarkerSymbolLayerV2
     QPointF mChrOffset;
     QFont mFont;
     double mOrigSize;
+    //! whether the markers are drawn from the sprite cache
+    bool mUsingCache;
 
 };
 
@@ -25,6 +25,7 @@
 
 #include "qgsrendercontext.h"
 #include "qgsclipper.h"
+#include "qgscoordinatetransformgrid.h"
 #include "qgsgeometry.h"
 #include "qgsgeometrycollectionv2.h"
 #include "qgsfeature.h"
@@ -41,6 +42,23 @@
 #include <QPolygonF>
 
 
+//! transforms a polygon to map coordinates, approximated by the grid of the context if there is one
+static void _transformPolygon( QPolygonF& poly, const QgsRenderContext& context )
+{
+  if ( const QgsCoordinateTransformGrid* grid = context.coordinateTransformGrid() )
+    grid->transformPolygon( poly );
+  else if ( const QgsCoordinateTransform* ct = context.coordinateTransform() )
+    ct->transformPolygon( poly );
+}
+
+//! transforms polygons to map coordinates in a single batch
+static void _transformPolygons( QList<QPolygonF>& polygons, const QgsRenderContext& context )
+{
+  if ( const QgsCoordinateTransformGrid* grid = context.coordinateTransformGrid() )
+    grid->transformPolygons( polygons );
+  else if ( const QgsCoordinateTransform* ct = context.coordinateTransform() )
+    ct->transformPolygons( polygons );
+}
 
 const unsigned char* QgsFeatureRendererV2::_getPoint( QPointF& pt, QgsRenderContext& context, const unsigned char* wkb )
 {
@@ -51,7 +69,13 @@ const unsigned char* QgsFeatureRendererV2::_getPoint( QPointF& pt, QgsRenderCont
   if (( QgsWKBTypes::Type )wkbType == QgsWKBTypes::Point25D || ( QgsWKBTypes::Type )wkbType == QgsWKBTypes::PointZ )
     wkbPtr += sizeof( double );
 
-  if ( context.coordinateTransform() )
+  if ( const QgsCoordinateTransformGrid* grid = context.coordinateTransformGrid() )
+  {
+    double x = pt.x(), y = pt.y();
+    grid->transformInPlace( x, y );
+    pt = QPointF( x, y );
+  }
+  else if ( context.coordinateTransform() )
   {
     double z = 0; // dummy variable for coordiante transform
     context.coordinateTransform()->transformInPlace( pt.rx(), pt.ry(), z );
@@ -73,7 +97,6 @@ const unsigned char* QgsFeatureRendererV2::_getLineString( QPolygonF& pts, QgsRe
 
   double x = 0.0;
   double y = 0.0;
-  const QgsCoordinateTransform* ct = context.coordinateTransform();
   const QgsMapToPixel& mtp = context.mapToPixel();
 
   //apply clipping for large lines to achieve a better rendering performance
@@ -102,10 +125,7 @@ const unsigned char* QgsFeatureRendererV2::_getLineString( QPolygonF& pts, QgsRe
   }
 
   //transform the QPolygonF to screen coordinates
-  if ( ct )
-  {
-    ct->transformPolygon( pts );
-  }
+  _transformPolygon( pts, context );
 
   QPointF* ptr = pts.data();
   for ( int i = 0; i < pts.size(); ++i, ++ptr )
@@ -132,12 +152,15 @@ const unsigned char* QgsFeatureRendererV2::_getPolygon( QPolygonF& pts, QList<QP
   double x, y;
   holes.clear();
 
-  const QgsCoordinateTransform* ct = context.coordinateTransform();
   const QgsMapToPixel& mtp = context.mapToPixel();
   const QgsRectangle& e = context.extent();
   double cw = e.width() / 10; double ch = e.height() / 10;
   QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
 
+  // first ring is the exterior ring
+  QList<QPolygonF> rings;
+  bool hasExterior = false;
+
   for ( unsigned int idx = 0; idx < numRings; idx++ )
   {
     unsigned int nPoints;
@@ -165,20 +188,24 @@ const unsigned char* QgsFeatureRendererV2::_getPolygon( QPolygonF& pts, QList<QP
     QRectF ptsRect = poly.boundingRect();
     if ( clipToExtent && !context.extent().contains( ptsRect ) ) QgsClipper::trimPolygon( poly, clipRect );
 
-    //transform the QPolygonF to screen coordinates
-    if ( ct )
-    {
-      ct->transformPolygon( poly );
-    }
+    if ( idx == 0 )
+      hasExterior = true;
+    rings.append( poly );
+  }
 
+  //transform the rings to screen coordinates, all rings at once
+  _transformPolygons( rings, context );
 
-    ptr = poly.data();
-    for ( int i = 0; i < poly.size(); ++i, ++ptr )
+  for ( int i = 0; i < rings.size(); ++i )
+  {
+    QPolygonF& poly = rings[i];
+    QPointF* ptr = poly.data();
+    for ( int j = 0; j < poly.size(); ++j, ++ptr )
     {
       mtp.transformInPlace( ptr->rx(), ptr->ry() );
     }
 
-    if ( idx == 0 )
+    if ( i == 0 && hasExterior )
       pts = poly;
     else
       holes.append( poly );
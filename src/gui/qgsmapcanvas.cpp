@@ -592,6 +592,16 @@ bool QgsMapCanvas::isParallelRenderingEnabled() const
   return mUseParallelRendering;
 }
 
+void QgsMapCanvas::setApproximateTransformEnabled( bool enabled )
+{
+  mSettings.setFlag( QgsMapSettings::ApproximateTransform, enabled );
+}
+
+bool QgsMapCanvas::isApproximateTransformEnabled() const
+{
+  return mSettings.testFlag( QgsMapSettings::ApproximateTransform );
+}
+
 void QgsMapCanvas::setMapUpdateInterval( int timeMiliseconds )
 {
   mMapUpdateTimer.setInterval( timeMiliseconds );
@@ -168,6 +168,15 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
     //! @note added in 2.4
     bool isParallelRenderingEnabled() const;
 
+    //! Set whether the reprojection of vector layers may be approximated by interpolation
+    //! @see QgsMapSettings::ApproximateTransform
+    //! @note added in 2.12
+    void setApproximateTransformEnabled( bool enabled );
+
+    //! Check whether the reprojection of vector layers may be approximated by interpolation
+    //! @note added in 2.12
+    bool isApproximateTransformEnabled() const;
+
     //! Set how often map preview should be updated while it is being rendered (in milliseconds)
     //! @note added in 2.4
     void setMapUpdateInterval( int timeMiliseconds );
@@ -18,6 +18,7 @@
 #include "qgsdelimitedtextprovider.h"
 
 #include <QtGlobal>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QDataStream>
@@ -299,6 +300,142 @@ void QgsDelimitedTextProvider::resetIndexes()
   if ( mBuildSpatialIndex && mGeomRep != GeomNone ) mSpatialIndex = new QgsSpatialIndex();
 }
 
+// The spatial index of all records is cached on disk, so that it is not built again
+// when the file is opened next time. Feature ids depend on the parsing and geometry
+// options, so the uri is a part of the key.
+
+QString QgsDelimitedTextProvider::spatialIndexCacheFile() const
+{
+  QUrl url = QUrl::fromEncoded( dataSourceUri().toAscii() );
+  url.removeAllQueryItems( "subset" );
+  url.removeAllQueryItems( "spatialIndex" );
+  return QgsSpatialIndex::cacheFilePath( mFile->fileName(), QString::fromAscii( url.toEncoded() ) );
+}
+
+// The results of the scan of all records are cached next to the spatial index. The
+// cache is only valid for the source file stamp (size, modification time and a hash of
+// the data at both ends of the file) it was written for.
+
+static const quint32 SCAN_CACHE_MAGIC = 0x51444353;
+static const quint32 SCAN_CACHE_VERSION = 2;
+
+QgsDelimitedTextProvider::ScanResult::ScanResult()
+    : nEmptyRecords( 0 )
+    , nBadFormatRecords( 0 )
+    , nIncompatibleGeometry( 0 )
+    , nInvalidGeometry( 0 )
+    , nEmptyGeometry( 0 )
+    , recordCount( 0 )
+{
+}
+
+QString QgsDelimitedTextProvider::scanCacheFile() const
+{
+  return spatialIndexCacheFile() + ".scan";
+}
+
+bool QgsDelimitedTextProvider::readScanCache( ScanResult& scan, bool withSubsetIndex )
+{
+  QFile file( scanCacheFile() );
+  if ( ! file.open( QIODevice::ReadOnly ) ) return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_4_7 );
+
+  quint32 magic, version;
+  QByteArray sourceStamp;
+  bool hasSubsetIndex;
+  stream >> magic >> version >> sourceStamp >> hasSubsetIndex;
+  if ( stream.status() != QDataStream::Ok || magic != SCAN_CACHE_MAGIC || version != SCAN_CACHE_VERSION
+       || sourceStamp.isEmpty() || sourceStamp != QgsSpatialIndex::sourceFileStamp( mFile->fileName() )
+       || ( withSubsetIndex && ! hasSubsetIndex ) )
+    return false;
+
+  QStringList fieldNames;
+  qint64 numberFeatures, recordCount;
+  qint64 nEmptyRecords, nBadFormatRecords, nIncompatibleGeometry, nInvalidGeometry, nEmptyGeometry;
+  qint32 wkbType, geometryType, nExtraInvalidLines;
+  double xMin, yMin, xMax, yMax;
+  bool wktHasPrefix, wktHasZM;
+  QStringList invalidLines;
+  QList<quint64> subsetIndex;
+  stream >> fieldNames >> numberFeatures >> recordCount
+  >> nEmptyRecords >> nBadFormatRecords >> nIncompatibleGeometry >> nInvalidGeometry >> nEmptyGeometry
+  >> wkbType >> geometryType >> xMin >> yMin >> xMax >> yMax >> wktHasPrefix >> wktHasZM
+  >> scan.isEmpty >> scan.couldBeInt >> scan.couldBeLongLong >> scan.couldBeDouble
+  >> invalidLines >> nExtraInvalidLines >> subsetIndex;
+  if ( stream.status() != QDataStream::Ok )
+    return false;
+
+  // the file has not been read, so set the names of the fields found by the scan
+  mFile->fieldNames();
+  mFile->setFieldNames( fieldNames );
+
+  mNumberFeatures = numberFeatures;
+  mWkbType = ( QGis::WkbType ) wkbType;
+  mGeometryType = ( QGis::GeometryType ) geometryType;
+  mExtent = QgsRectangle( xMin, yMin, xMax, yMax );
+  mWktHasPrefix = wktHasPrefix;
+  mWktHasZM = wktHasZM;
+  mInvalidLines = invalidLines;
+  mNExtraInvalidLines = nExtraInvalidLines;
+
+  scan.nEmptyRecords = nEmptyRecords;
+  scan.nBadFormatRecords = nBadFormatRecords;
+  scan.nIncompatibleGeometry = nIncompatibleGeometry;
+  scan.nInvalidGeometry = nInvalidGeometry;
+  scan.nEmptyGeometry = nEmptyGeometry;
+  scan.recordCount = recordCount;
+
+  if ( withSubsetIndex )
+  {
+    mSubsetIndex.clear();
+    mSubsetIndex.reserve( subsetIndex.size() );
+    Q_FOREACH ( quint64 id, subsetIndex )
+      mSubsetIndex.append(( quintptr ) id );
+  }
+
+  QgsDebugMsg( "Scan results read from " + scanCacheFile() );
+  return true;
+}
+
+void QgsDelimitedTextProvider::writeScanCache( const ScanResult& scan, bool withSubsetIndex )
+{
+  // the scan results are written before the spatial index, which creates the cache directory
+  QDir().mkpath( QFileInfo( scanCacheFile() ).absolutePath() );
+  QFile file( scanCacheFile() );
+  if ( ! file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+  {
+    QgsDebugMsg( "Cannot write scan results to " + scanCacheFile() );
+    return;
+  }
+
+  QList<quint64> subsetIndex;
+  if ( withSubsetIndex )
+  {
+    Q_FOREACH ( quintptr id, mSubsetIndex )
+      subsetIndex.append(( quint64 ) id );
+  }
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_4_7 );
+  stream << SCAN_CACHE_MAGIC << SCAN_CACHE_VERSION
+  << QgsSpatialIndex::sourceFileStamp( mFile->fileName() ) << withSubsetIndex
+  << mFile->fieldNames() << ( qint64 ) mNumberFeatures << ( qint64 ) scan.recordCount
+  << ( qint64 ) scan.nEmptyRecords << ( qint64 ) scan.nBadFormatRecords << ( qint64 ) scan.nIncompatibleGeometry
+  << ( qint64 ) scan.nInvalidGeometry << ( qint64 ) scan.nEmptyGeometry
+  << ( qint32 ) mWkbType << ( qint32 ) mGeometryType
+  << mExtent.xMinimum() << mExtent.yMinimum() << mExtent.xMaximum() << mExtent.yMaximum()
+  << mWktHasPrefix << mWktHasZM
+  << scan.isEmpty << scan.couldBeInt << scan.couldBeLongLong << scan.couldBeDouble
+  << mInvalidLines << ( qint32 ) mNExtraInvalidLines << subsetIndex;
+
+  if ( stream.status() != QDataStream::Ok )
+  {
+    file.remove();
+  }
+}
+
 bool QgsDelimitedTextProvider::createSpatialIndex()
 {
   if ( mBuildSpatialIndex ) return true; // Already built
@@ -340,6 +477,10 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   resetIndexes();
   bool buildSpatialIndex = buildIndexes && mSpatialIndex != 0;
 
+  // Reuse the index cached by an earlier scan if the file has not changed since
+
+  bool fillSpatialIndex = buildSpatialIndex && ! mSpatialIndex->readFromFile( spatialIndexCacheFile(), mFile->fileName() );
+
   // No point building a subset index if there is no geometry, as all
   // records will be included.
 
@@ -397,33 +538,29 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   // Also build subset and spatial indexes.
 
   QStringList parts;
-  long nEmptyRecords = 0;
-  long nBadFormatRecords = 0;
-  long nIncompatibleGeometry = 0;
-  long nInvalidGeometry = 0;
-  long nEmptyGeometry = 0;
+  ScanResult scan;
   mNumberFeatures = 0;
   mExtent = QgsRectangle();
 
-  QList<bool> isEmpty;
-  QList<bool> couldBeInt;
-  QList<bool> couldBeLongLong;
-  QList<bool> couldBeDouble;
+  // The results of the scan are cached with the spatial index, so the unchanged file is
+  // not read again when the cached index could be used
+
+  bool scanCached = buildSpatialIndex && ! fillSpatialIndex && readScanCache( scan, buildSubsetIndex );
 
-  while ( true )
+  while ( ! scanCached )
   {
     QgsDelimitedTextFile::Status status = mFile->nextRecord( parts );
     if ( status == QgsDelimitedTextFile::RecordEOF ) break;
     if ( status != QgsDelimitedTextFile::RecordOk )
     {
-      nBadFormatRecords++;
+      scan.nBadFormatRecords++;
       recordInvalidLine( tr( "Invalid record format at line %1" ) );
       continue;
     }
     // Skip over empty records
     if ( recordIsEmpty( parts ) )
     {
-      nEmptyRecords++;
+      scan.nEmptyRecords++;
       continue;
     }
 
@@ -434,7 +571,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
     {
       if ( mWktFieldIndex >= parts.size() || parts[mWktFieldIndex].isEmpty() )
       {
-        nEmptyGeometry++;
+        scan.nEmptyGeometry++;
         mNumberFeatures++;
       }
       else
@@ -471,7 +608,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
                 QgsRectangle bbox( geom->boundingBox() );
                 mExtent.combineExtentWith( &bbox );
               }
-              if ( buildSpatialIndex )
+              if ( fillSpatialIndex )
               {
                 QgsFeature f;
                 f.setFeatureId( mFile->recordId() );
@@ -484,7 +621,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
             }
             else
             {
-              nIncompatibleGeometry++;
+              scan.nIncompatibleGeometry++;
               geomValid = false;
             }
           }
@@ -493,7 +630,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
         else
         {
           geomValid = false;
-          nInvalidGeometry++;
+          scan.nInvalidGeometry++;
           recordInvalidLine( tr( "Invalid WKT at line %1" ) );
         }
       }
@@ -507,7 +644,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
       QString sY = mYFieldIndex < parts.size() ? parts[mYFieldIndex] : QString();
       if ( sX.isEmpty() && sY.isEmpty() )
       {
-        nEmptyGeometry++;
+        scan.nEmptyGeometry++;
         mNumberFeatures++;
       }
       else
@@ -529,7 +666,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
             mGeometryType = QGis::Point;
           }
           mNumberFeatures++;
-          if ( buildSpatialIndex && qIsFinite( pt.x() ) && qIsFinite( pt.y() ) )
+          if ( fillSpatialIndex && qIsFinite( pt.x() ) && qIsFinite( pt.y() ) )
           {
             QgsFeature f;
             f.setFeatureId( mFile->recordId() );
@@ -540,7 +677,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
         else
         {
           geomValid = false;
-          nInvalidGeometry++;
+          scan.nInvalidGeometry++;
           recordInvalidLine( tr( "Invalid X or Y fields at line %1" ) );
         }
       }
@@ -569,49 +706,55 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
 
       // Expand the columns to include this non empty field if necessary
 
-      while ( couldBeInt.size() <= i )
+      while ( scan.couldBeInt.size() <= i )
       {
-        isEmpty.append( true );
-        couldBeInt.append( false );
-        couldBeLongLong.append( false );
-        couldBeDouble.append( false );
+        scan.isEmpty.append( true );
+        scan.couldBeInt.append( false );
+        scan.couldBeLongLong.append( false );
+        scan.couldBeDouble.append( false );
       }
 
       // If this column has been empty so far then initiallize it
       // for possible types
 
-      if ( isEmpty[i] )
+      if ( scan.isEmpty[i] )
       {
-        isEmpty[i] = false;
-        couldBeInt[i] = true;
-        couldBeLongLong[i] = true;
-        couldBeDouble[i] = true;
+        scan.isEmpty[i] = false;
+        scan.couldBeInt[i] = true;
+        scan.couldBeLongLong[i] = true;
+        scan.couldBeDouble[i] = true;
       }
 
       // Now test for still valid possible types for the field
       // Types are possible until first record which cannot be parsed
 
-      if ( couldBeInt[i] )
+      if ( scan.couldBeInt[i] )
       {
-        value.toInt( &couldBeInt[i] );
+        value.toInt( &scan.couldBeInt[i] );
       }
 
-      if ( couldBeLongLong[i] && ! couldBeInt[i] )
+      if ( scan.couldBeLongLong[i] && ! scan.couldBeInt[i] )
       {
-        value.toLongLong( &couldBeLongLong[i] );
+        value.toLongLong( &scan.couldBeLongLong[i] );
       }
 
-      if ( couldBeDouble[i] && ! couldBeLongLong[i] )
+      if ( scan.couldBeDouble[i] && ! scan.couldBeLongLong[i] )
       {
         if ( ! mDecimalPoint.isEmpty() )
         {
           value.replace( mDecimalPoint, "." );
         }
-        value.toDouble( &couldBeDouble[i] );
+        value.toDouble( &scan.couldBeDouble[i] );
       }
     }
   }
 
+  if ( ! scanCached )
+  {
+    scan.recordCount = mFile->recordCount();
+    if ( buildSpatialIndex ) writeScanCache( scan, buildSubsetIndex );
+  }
+
   // Now create the attribute fields.  Field types are integer by preference,
   // failing that double, failing that text.
 
@@ -650,19 +793,19 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
         typeName = "double";
       }
     }
-    else if ( i < couldBeInt.size() )
+    else if ( i < scan.couldBeInt.size() )
     {
-      if ( couldBeInt[i] )
+      if ( scan.couldBeInt[i] )
       {
         fieldType = QVariant::Int;
         typeName = "integer";
       }
-      else if ( couldBeLongLong[i] )
+      else if ( scan.couldBeLongLong[i] )
       {
         fieldType = QVariant::LongLong;
         typeName = "longlong";
       }
-      else if ( couldBeDouble[i] )
+      else if ( scan.couldBeDouble[i] )
       {
         fieldType = QVariant::Double;
         typeName = "double";
@@ -678,14 +821,14 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
 
   QStringList warnings;
   if ( ! csvtMessage.isEmpty() ) warnings.append( csvtMessage );
-  if ( nBadFormatRecords > 0 )
-    warnings.append( tr( "%1 records discarded due to invalid format" ).arg( nBadFormatRecords ) );
-  if ( nEmptyGeometry > 0 )
-    warnings.append( tr( "%1 records have missing geometry definitions" ).arg( nEmptyGeometry ) );
-  if ( nInvalidGeometry > 0 )
-    warnings.append( tr( "%1 records discarded due to invalid geometry definitions" ).arg( nInvalidGeometry ) );
-  if ( nIncompatibleGeometry > 0 )
-    warnings.append( tr( "%1 records discarded due to incompatible geometry types" ).arg( nIncompatibleGeometry ) );
+  if ( scan.nBadFormatRecords > 0 )
+    warnings.append( tr( "%1 records discarded due to invalid format" ).arg( scan.nBadFormatRecords ) );
+  if ( scan.nEmptyGeometry > 0 )
+    warnings.append( tr( "%1 records have missing geometry definitions" ).arg( scan.nEmptyGeometry ) );
+  if ( scan.nInvalidGeometry > 0 )
+    warnings.append( tr( "%1 records discarded due to invalid geometry definitions" ).arg( scan.nInvalidGeometry ) );
+  if ( scan.nIncompatibleGeometry > 0 )
+    warnings.append( tr( "%1 records discarded due to incompatible geometry types" ).arg( scan.nIncompatibleGeometry ) );
 
   reportErrors( warnings );
 
@@ -695,12 +838,13 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
 
   if ( buildSubsetIndex )
   {
-    long recordCount = mFile->recordCount();
+    long recordCount = scan.recordCount;
     recordCount -= recordCount / SUBSET_ID_THRESHOLD_FACTOR;
     mUseSubsetIndex = mSubsetIndex.size() < recordCount;
     if ( ! mUseSubsetIndex ) mSubsetIndex = QList<quintptr>();
   }
 
+  if ( fillSpatialIndex ) mSpatialIndex->writeToFile( spatialIndexCacheFile(), mFile->fileName() );
   mUseSpatialIndex = buildSpatialIndex;
 
   mValid = mGeometryType != QGis::UnknownGeometry;
@@ -723,6 +867,16 @@ void QgsDelimitedTextProvider::rescanFile()
   bool buildSpatialIndex = mSpatialIndex != 0;
   bool buildSubsetIndex = mBuildSubsetIndex && ( mSubsetExpression || mGeomRep != GeomNone );
 
+  // Without a subset the index contains all records and can be cached
+
+  bool cacheSpatialIndex = buildSpatialIndex && ! mSubsetExpression;
+  bool fillSpatialIndex = buildSpatialIndex;
+  if ( cacheSpatialIndex && mSpatialIndex->readFromFile( spatialIndexCacheFile(), mFile->fileName() ) )
+  {
+    fillSpatialIndex = false;
+    cacheSpatialIndex = false;
+  }
+
   // In case file has been rewritten check that it is still valid
 
   mValid = mLayerValid && mFile->isValid();
@@ -791,7 +945,7 @@ void QgsDelimitedTextProvider::rescanFile()
         QgsRectangle bbox( f.constGeometry()->boundingBox() );
         mExtent.combineExtentWith( &bbox );
       }
-      if ( buildSpatialIndex ) mSpatialIndex->insertFeature( f );
+      if ( fillSpatialIndex ) mSpatialIndex->insertFeature( f );
     }
     if ( buildSubsetIndex ) mSubsetIndex.append(( quintptr ) f.id() );
     mNumberFeatures++;
@@ -804,6 +958,7 @@ void QgsDelimitedTextProvider::rescanFile()
     if ( ! mUseSubsetIndex ) mSubsetIndex.clear();
   }
 
+  if ( cacheSpatialIndex ) mSpatialIndex->writeToFile( spatialIndexCacheFile(), mFile->fileName() );
   mUseSpatialIndex = buildSpatialIndex;
 }
 
@@ -224,6 +224,32 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
     void rescanFile();
     void resetCachedSubset();
     void resetIndexes();
+    //! File used to cache the spatial index of all records of the file
+    QString spatialIndexCacheFile() const;
+
+    //! Results of the scan of all records that are not kept in members
+    struct ScanResult
+    {
+      ScanResult();
+      QList<bool> isEmpty;
+      QList<bool> couldBeInt;
+      QList<bool> couldBeLongLong;
+      QList<bool> couldBeDouble;
+      long nEmptyRecords;
+      long nBadFormatRecords;
+      long nIncompatibleGeometry;
+      long nInvalidGeometry;
+      long nEmptyGeometry;
+      long recordCount;
+    };
+
+    //! File used to cache the results of the scan of all records, next to the spatial index
+    QString scanCacheFile() const;
+    //! Restores the results of an earlier scan of the unchanged file, returns false if there are none
+    bool readScanCache( ScanResult& scan, bool withSubsetIndex );
+    //! Writes the results of the scan to the cache
+    void writeScanCache( const ScanResult& scan, bool withSubsetIndex );
+
     void clearInvalidLines();
     void recordInvalidLine( QString message );
     void reportErrors( QStringList messages = QStringList(), bool showDialog = false );
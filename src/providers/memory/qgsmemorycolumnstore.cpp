@@ -0,0 +1,448 @@
+/***************************************************************************
+    qgsmemorycolumnstore.cpp
+    ---------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsmemorycolumnstore.h"
+
+#include "qgsgeometry.h"
+
+#include <QSet>
+
+#include <cstring>
+
+//! size of the chunks of geometry data (larger geometries get a chunk of their own)
+static const qint64 GEOMETRY_CHUNK_SIZE = 64 * 1024 * 1024;
+
+// row with the smallest (or largest) value, skipping rows with a set bit
+template <typename T>
+static int extremeRow( const QVector<T>& values, const QBitArray& skip, bool minimum )
+{
+  int best = -1;
+  for ( int row = 0; row < values.count(); ++row )
+  {
+    if ( skip.testBit( row ) )
+      continue;
+
+    if ( best < 0 || ( minimum ? values[row] < values[best] : values[best] < values[row] ) )
+      best = row;
+  }
+  return best;
+}
+
+// distinct values in order of first occurrence, skipping rows with a set bit
+template <typename T>
+static void distinctValues( const QVector<T>& values, const QBitArray& skip, QList<QVariant>& result, int limit )
+{
+  QSet<T> seen;
+  for ( int row = 0; row < values.count(); ++row )
+  {
+    if ( limit >= 0 && result.size() >= limit )
+      return;
+
+    if ( skip.testBit( row ) || seen.contains( values[row] ) )
+      continue;
+
+    seen.insert( values[row] );
+    result.append( QVariant( values[row] ) );
+  }
+}
+
+
+QgsMemoryColumnStore::QgsMemoryColumnStore()
+    : mDeletedCount( 0 )
+    , mGeometryBytes( 0 )
+    , mUnusedGeometryBytes( 0 )
+{
+}
+
+void QgsMemoryColumnStore::addAttribute( QVariant::Type type )
+{
+  Column column( type );
+  for ( int row = 0; row < mIds.count(); ++row )
+    appendNull( column );
+  mColumns.append( column );
+}
+
+void QgsMemoryColumnStore::deleteAttribute( int index )
+{
+  if ( index >= 0 && index < mColumns.count() )
+    mColumns.remove( index );
+}
+
+void QgsMemoryColumnStore::addFeature( const QgsFeature& feature )
+{
+  int row = mIds.count();
+  mIds.append( feature.id() );
+  mRows.insert( feature.id(), row );
+  mDeleted.resize( row + 1 );
+
+  const QgsAttributes attrs = feature.attributes();
+  for ( int i = 0; i < mColumns.count(); ++i )
+  {
+    appendNull( mColumns[i] );
+    if ( i < attrs.count() )
+      setValue( mColumns[i], row, attrs.at( i ) );
+  }
+
+  mGeometryOffsets.append( 0 );
+  mGeometrySizes.append( 0 );
+  mBoundingBoxes.append( QgsRectangle() );
+  storeGeometry( row, feature.constGeometry() );
+}
+
+bool QgsMemoryColumnStore::deleteFeature( QgsFeatureId fid )
+{
+  int row = rowForId( fid );
+  if ( row < 0 )
+    return false;
+
+  mRows.remove( fid );
+  mDeleted.setBit( row );
+  ++mDeletedCount;
+
+  mUnusedGeometryBytes += mGeometrySizes[row];
+  mGeometrySizes[row] = 0;
+
+  compactIfNeeded();
+  return true;
+}
+
+void QgsMemoryColumnStore::setAttribute( int row, int index, const QVariant& value )
+{
+  if ( index >= 0 && index < mColumns.count() )
+    setValue( mColumns[index], row, value );
+}
+
+void QgsMemoryColumnStore::setGeometry( int row, const QgsGeometry* geometry )
+{
+  storeGeometry( row, geometry );
+  compactIfNeeded();
+}
+
+void QgsMemoryColumnStore::storeGeometry( int row, const QgsGeometry* geometry )
+{
+  const unsigned char* wkb = geometry ? geometry->asWkb() : 0;
+  int size = wkb ? geometry->wkbSize() : 0;
+
+  if ( size > 0 && size <= mGeometrySizes[row] )
+  {
+    // fits into the old place
+    qint64 offset = mGeometryOffsets[row];
+    memcpy( mGeometryChunks[ offset / GEOMETRY_CHUNK_SIZE ].data() + offset % GEOMETRY_CHUNK_SIZE, wkb, size );
+    mUnusedGeometryBytes += mGeometrySizes[row] - size;
+  }
+  else
+  {
+    mUnusedGeometryBytes += mGeometrySizes[row];
+    mGeometryOffsets[row] = size > 0 ? appendGeometryData( reinterpret_cast<const char*>( wkb ), size ) : 0;
+  }
+
+  mGeometrySizes[row] = size;
+  mBoundingBoxes[row] = size > 0 ? geometry->boundingBox() : QgsRectangle();
+}
+
+qint64 QgsMemoryColumnStore::appendGeometryData( const char* data, int size )
+{
+  if ( mGeometryChunks.isEmpty() || ( !mGeometryChunks.last().isEmpty() && mGeometryChunks.last().size() + ( qint64 ) size > GEOMETRY_CHUNK_SIZE ) )
+    mGeometryChunks.append( QByteArray() );
+
+  QByteArray& chunk = mGeometryChunks.last();
+  qint64 offset = ( mGeometryChunks.count() - 1 ) * GEOMETRY_CHUNK_SIZE + chunk.size();
+  chunk.append( data, size );
+  mGeometryBytes += size;
+  return offset;
+}
+
+const char* QgsMemoryColumnStore::geometryData( int row ) const
+{
+  qint64 offset = mGeometryOffsets[row];
+  return mGeometryChunks[ offset / GEOMETRY_CHUNK_SIZE ].constData() + offset % GEOMETRY_CHUNK_SIZE;
+}
+
+QVariant QgsMemoryColumnStore::attribute( int row, int index ) const
+{
+  if ( index < 0 || index >= mColumns.count() )
+    return QVariant();
+
+  return value( mColumns[index], row );
+}
+
+QgsGeometry* QgsMemoryColumnStore::geometry( int row ) const
+{
+  int size = mGeometrySizes[row];
+  if ( size == 0 )
+    return 0;
+
+  unsigned char* wkb = new unsigned char[size];
+  memcpy( wkb, geometryData( row ), size );
+
+  QgsGeometry* geom = new QgsGeometry();
+  geom->fromWkb( wkb, size );
+  return geom;
+}
+
+void QgsMemoryColumnStore::feature( int row, QgsFeature& feature, bool fetchGeometry, const QgsAttributeList* attributes ) const
+{
+  feature.setFeatureId( mIds[row] );
+
+  QgsAttributes attrs( mColumns.count() );
+  if ( attributes )
+  {
+    Q_FOREACH ( int idx, *attributes )
+    {
+      if ( idx >= 0 && idx < mColumns.count() )
+        attrs[idx] = value( mColumns[idx], row );
+    }
+  }
+  else
+  {
+    for ( int idx = 0; idx < mColumns.count(); ++idx )
+      attrs[idx] = value( mColumns[idx], row );
+  }
+  feature.setAttributes( attrs );
+
+  feature.setGeometry( fetchGeometry ? geometry( row ) : 0 );
+}
+
+QVariant QgsMemoryColumnStore::minimumValue( int index ) const
+{
+  return extremeValue( index, true );
+}
+
+QVariant QgsMemoryColumnStore::maximumValue( int index ) const
+{
+  return extremeValue( index, false );
+}
+
+QVariant QgsMemoryColumnStore::extremeValue( int index, bool minimum ) const
+{
+  if ( index < 0 || index >= mColumns.count() )
+    return QVariant();
+
+  const Column& column = mColumns[index];
+  QBitArray skip = column.nulls | mDeleted;
+
+  int row = -1;
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      row = extremeRow( column.intValues, skip, minimum );
+      break;
+    case QVariant::LongLong:
+      row = extremeRow( column.longValues, skip, minimum );
+      break;
+    case QVariant::Double:
+      row = extremeRow( column.doubleValues, skip, minimum );
+      break;
+    case QVariant::String:
+      row = extremeRow( column.stringValues, skip, minimum );
+      break;
+    default:
+      // values of other types are not ordered here
+      break;
+  }
+
+  return row >= 0 ? value( column, row ) : QVariant( column.type );
+}
+
+void QgsMemoryColumnStore::uniqueValues( int index, QList<QVariant>& values, int limit ) const
+{
+  values.clear();
+
+  if ( index < 0 || index >= mColumns.count() )
+    return;
+
+  const Column& column = mColumns[index];
+  QBitArray skip = column.nulls | mDeleted;
+
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      distinctValues( column.intValues, skip, values, limit );
+      break;
+    case QVariant::LongLong:
+      distinctValues( column.longValues, skip, values, limit );
+      break;
+    case QVariant::Double:
+    {
+      // there is no qHash( double ), compare the bit patterns instead
+      QSet<qint64> seen;
+      for ( int row = 0; row < column.doubleValues.count(); ++row )
+      {
+        if ( limit >= 0 && values.size() >= limit )
+          break;
+
+        qint64 bits;
+        memcpy( &bits, &column.doubleValues[row], sizeof( bits ) );
+        if ( skip.testBit( row ) || seen.contains( bits ) )
+          continue;
+
+        seen.insert( bits );
+        values.append( column.doubleValues[row] );
+      }
+      break;
+    }
+    case QVariant::String:
+      distinctValues( column.stringValues, skip, values, limit );
+      break;
+    default:
+    {
+      QSet<QString> seen;
+      for ( int row = 0; row < column.variantValues.count(); ++row )
+      {
+        if ( limit >= 0 && values.size() >= limit )
+          break;
+
+        const QVariant& v = column.variantValues[row];
+        if ( skip.testBit( row ) || seen.contains( v.toString() ) )
+          continue;
+
+        seen.insert( v.toString() );
+        values.append( v );
+      }
+      break;
+    }
+  }
+
+  // NULL is a distinct value too
+  if ( limit < 0 || values.size() < limit )
+  {
+    for ( int row = 0; row < mIds.count(); ++row )
+    {
+      if ( column.nulls.testBit( row ) && !isDeleted( row ) )
+      {
+        values.append( QVariant( column.type ) );
+        break;
+      }
+    }
+  }
+}
+
+QgsRectangle QgsMemoryColumnStore::extent() const
+{
+  QgsRectangle rect;
+  rect.setMinimal();
+  for ( int row = 0; row < mIds.count(); ++row )
+  {
+    if ( !isDeleted( row ) && hasGeometry( row ) )
+      rect.unionRect( mBoundingBoxes[row] );
+  }
+  return rect;
+}
+
+void QgsMemoryColumnStore::appendNull( Column& column )
+{
+  int row = column.nulls.size();
+  column.nulls.resize( row + 1 );
+  column.nulls.setBit( row );
+
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      column.intValues.append( 0 );
+      break;
+    case QVariant::LongLong:
+      column.longValues.append( 0 );
+      break;
+    case QVariant::Double:
+      column.doubleValues.append( 0.0 );
+      break;
+    case QVariant::String:
+      column.stringValues.append( QString() );
+      break;
+    default:
+      column.variantValues.append( QVariant() );
+      break;
+  }
+}
+
+void QgsMemoryColumnStore::setValue( Column& column, int row, const QVariant& value )
+{
+  bool ok = !value.isNull();
+
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      column.intValues[row] = ok ? value.toInt( &ok ) : 0;
+      break;
+    case QVariant::LongLong:
+      column.longValues[row] = ok ? value.toLongLong( &ok ) : 0;
+      break;
+    case QVariant::Double:
+      column.doubleValues[row] = ok ? value.toDouble( &ok ) : 0.0;
+      break;
+    case QVariant::String:
+      column.stringValues[row] = ok ? value.toString() : QString();
+      break;
+    default:
+      column.variantValues[row] = ok ? value : QVariant();
+      break;
+  }
+
+  // values which can not be converted to the type of the column become NULL
+  column.nulls.setBit( row, !ok );
+}
+
+QVariant QgsMemoryColumnStore::value( const Column& column, int row )
+{
+  if ( column.nulls.testBit( row ) )
+    return QVariant( column.type );
+
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      return column.intValues[row];
+    case QVariant::LongLong:
+      return column.longValues[row];
+    case QVariant::Double:
+      return column.doubleValues[row];
+    case QVariant::String:
+      return column.stringValues[row];
+    default:
+      return column.variantValues[row];
+  }
+}
+
+void QgsMemoryColumnStore::compactIfNeeded()
+{
+  if ( mDeletedCount * 2 <= mIds.count() && mUnusedGeometryBytes * 2 <= mGeometryBytes )
+    return;
+
+  QgsMemoryColumnStore store;
+  Q_FOREACH ( const Column& column, mColumns )
+    store.addAttribute( column.type );
+
+  for ( int row = 0; row < mIds.count(); ++row )
+  {
+    if ( isDeleted( row ) )
+      continue;
+
+    int newRow = store.mIds.count();
+    store.mIds.append( mIds[row] );
+    store.mRows.insert( mIds[row], newRow );
+
+    for ( int i = 0; i < mColumns.count(); ++i )
+    {
+      appendNull( store.mColumns[i] );
+      setValue( store.mColumns[i], newRow, value( mColumns[i], row ) );
+    }
+
+    int size = mGeometrySizes[row];
+    store.mGeometryOffsets.append( size > 0 ? store.appendGeometryData( geometryData( row ), size ) : 0 );
+    store.mGeometrySizes.append( size );
+    store.mBoundingBoxes.append( mBoundingBoxes[row] );
+  }
+  store.mDeleted.resize( store.mIds.count() );
+
+  *this = store;
+}
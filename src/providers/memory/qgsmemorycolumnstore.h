@@ -0,0 +1,167 @@
+/***************************************************************************
+    qgsmemorycolumnstore.h
+    ---------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSMEMORYCOLUMNSTORE_H
+#define QGSMEMORYCOLUMNSTORE_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QHash>
+#include <QVariant>
+#include <QVector>
+
+#include "qgsfeature.h"
+#include "qgsrectangle.h"
+
+class QgsGeometry;
+
+/**
+ * Columnar storage of the features of the memory provider.
+ *
+ * Attributes are kept in typed arrays (one per field) with a null mask, geometries
+ * are kept as WKB in large contiguous chunks addressed by 64 bit per-row offsets (so the
+ * total is not limited by the 2 GB size of a QByteArray), together with their bounding boxes. QgsFeature objects are only created when features are read.
+ *
+ * Rows are kept in the order of insertion (i.e. ascending feature id). Deleted rows are
+ * only flagged and the store is compacted once they make up half of the rows.
+ *
+ * All members are implicitly shared, so copies (e.g. for feature sources) are cheap.
+ *
+ * The store is internal to the memory provider. Statistics use it through the provider's
+ * minimumValue(), maximumValue() and uniqueValues(), rendering through feature iterators.
+ */
+class QgsMemoryColumnStore
+{
+  public:
+
+    //! Values of one attribute for all rows. Only the array matching the type is used.
+    struct Column
+    {
+      Column( QVariant::Type t = QVariant::Invalid ) : type( t ) {}
+
+      QVariant::Type type;
+      QVector<int> intValues;
+      QVector<qint64> longValues;
+      QVector<double> doubleValues;
+      QVector<QString> stringValues;
+      //! values of all other types
+      QVector<QVariant> variantValues;
+      //! bit is set for NULL values
+      QBitArray nulls;
+    };
+
+    QgsMemoryColumnStore();
+
+    //! Number of features
+    int featureCount() const { return mIds.count() - mDeletedCount; }
+
+    //! Number of rows, including deleted ones
+    int rowCount() const { return mIds.count(); }
+
+    //! Returns true if the feature of the row has been deleted
+    bool isDeleted( int row ) const { return mDeleted.testBit( row ); }
+
+    //! Returns the feature id of the row
+    QgsFeatureId featureId( int row ) const { return mIds[row]; }
+
+    //! Returns the row of a feature or -1 if there is no such feature
+    int rowForId( QgsFeatureId fid ) const { return mRows.value( fid, -1 ); }
+
+    //! Appends a column of the given type (filled with NULL values)
+    void addAttribute( QVariant::Type type );
+
+    //! Removes a column
+    void deleteAttribute( int index );
+
+    //! Appends a feature, its id must have been set already
+    void addFeature( const QgsFeature& feature );
+
+    //! Deletes a feature. Returns false if there is no such feature.
+    bool deleteFeature( QgsFeatureId fid );
+
+    //! Changes the value of an attribute. Values are converted to the type of the column.
+    void setAttribute( int row, int index, const QVariant& value );
+
+    //! Changes the geometry of a row, geometry may be null
+    void setGeometry( int row, const QgsGeometry* geometry );
+
+    //! Returns the value of an attribute
+    QVariant attribute( int row, int index ) const;
+
+    //! Returns true if the row has a geometry
+    bool hasGeometry( int row ) const { return mGeometrySizes[row] > 0; }
+
+    //! Returns the bounding box of the geometry of the row
+    const QgsRectangle& boundingBox( int row ) const { return mBoundingBoxes[row]; }
+
+    //! Returns a new geometry for the row (caller takes ownership), null if the row has no geometry
+    QgsGeometry* geometry( int row ) const;
+
+    /** Fills a feature with the data of a row.
+     * @param row row to read
+     * @param feature feature to fill
+     * @param fetchGeometry whether the geometry is created
+     * @param attributes indexes of attributes to read, all attributes if null. Other attributes are set to NULL.
+     */
+    void feature( int row, QgsFeature& feature, bool fetchGeometry = true, const QgsAttributeList* attributes = 0 ) const;
+
+    //! Direct access to the values of an attribute
+    const Column& column( int index ) const { return mColumns[index]; }
+
+    //! Returns the minimum non-NULL value of a column
+    QVariant minimumValue( int index ) const;
+
+    //! Returns the maximum non-NULL value of a column
+    QVariant maximumValue( int index ) const;
+
+    //! Returns the distinct values of a column (including NULL)
+    void uniqueValues( int index, QList<QVariant>& values, int limit = -1 ) const;
+
+    //! Returns the union of the bounding boxes of all geometries
+    QgsRectangle extent() const;
+
+  private:
+
+    static void appendNull( Column& column );
+    static void setValue( Column& column, int row, const QVariant& value );
+    static QVariant value( const Column& column, int row );
+    void storeGeometry( int row, const QgsGeometry* geometry );
+    //! Appends WKB to the geometry chunks and returns its offset
+    qint64 appendGeometryData( const char* data, int size );
+    const char* geometryData( int row ) const;
+    QVariant extremeValue( int index, bool minimum ) const;
+
+    //! Drops deleted rows and unused geometry bytes if they use too much memory
+    void compactIfNeeded();
+
+    QVector<QgsFeatureId> mIds;
+    QHash<QgsFeatureId, int> mRows;
+    QBitArray mDeleted;
+    int mDeletedCount;
+
+    QVector<Column> mColumns;
+
+    //! WKB of the geometries, a geometry never spans two chunks
+    QVector<QByteArray> mGeometryChunks;
+    //! offset of the geometry of each row: chunk index * chunk size + position in the chunk
+    QVector<qint64> mGeometryOffsets;
+    QVector<int> mGeometrySizes;
+    QVector<QgsRectangle> mBoundingBoxes;
+    //! bytes in all geometry chunks
+    qint64 mGeometryBytes;
+    //! bytes of the geometry chunks not referenced by any row
+    qint64 mUnusedGeometryBytes;
+};
+
+#endif // QGSMEMORYCOLUMNSTORE_H
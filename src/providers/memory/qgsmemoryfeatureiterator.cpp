@@ -20,11 +20,14 @@
 #include "qgsspatialindex.h"
 #include "qgsmessagelog.h"
 
+#include <QScopedPointer>
+
 
 
 QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource<QgsMemoryFeatureSource>( source, ownSource, request )
     , mSelectRectGeom( 0 )
+    , mSelectRow( 0 )
     , mSubsetExpression( 0 )
 {
   if ( !mSource->mSubsetString.isEmpty() )
@@ -44,13 +47,15 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource* sour
   {
     mUsingFeatureIdList = true;
     mFeatureIdList = mSource->mSpatialIndex->intersects( mRequest.filterRect() );
+    // rows of the column store are in ascending feature id order, read them sequentially
+    if ( mSource->mColumnar )
+      qSort( mFeatureIdList );
     QgsDebugMsg( "Features returned by spatial index: " + QString::number( mFeatureIdList.count() ) );
   }
   else if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
     mUsingFeatureIdList = true;
-    QgsFeatureMap::const_iterator it = mSource->mFeatures.find( mRequest.filterFid() );
-    if ( it != mSource->mFeatures.end() )
+    if ( mSource->mColumnar ? mSource->mColumnStore.rowForId( mRequest.filterFid() ) >= 0 : mSource->mFeatures.contains( mRequest.filterFid() ) )
       mFeatureIdList.append( mRequest.filterFid() );
   }
   else
@@ -76,13 +81,39 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature& feature )
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
+  if ( mSource->mColumnar )
+    return nextFeatureFromColumns( feature );
+  else if ( mUsingFeatureIdList )
     return nextFeatureUsingList( feature );
   else
     return nextFeatureTraverseAll( feature );
 }
 
 
+int QgsMemoryFeatureIterator::fetchFeatures( QgsFeatureList& features, int maxCount )
+{
+  int count = 0;
+  while ( count < maxCount && !mClosed )
+  {
+    features.append( QgsFeature() );
+    bool hasFeature;
+    if ( mSource->mColumnar )
+      hasFeature = nextFeatureFromColumns( features.last() );
+    else if ( mUsingFeatureIdList )
+      hasFeature = nextFeatureUsingList( features.last() );
+    else
+      hasFeature = nextFeatureTraverseAll( features.last() );
+    if ( !hasFeature )
+    {
+      features.removeLast();
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
+
 bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature& feature )
 {
   bool hasFeature = false;
@@ -183,6 +214,81 @@ bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature& feature )
   return hasFeature;
 }
 
+bool QgsMemoryFeatureIterator::nextFeatureFromColumns( QgsFeature& feature )
+{
+  const QgsMemoryColumnStore& store = mSource->mColumnStore;
+  bool hasFeature = false;
+  bool loaded = false;
+  int row = -1;
+
+  for ( ;; )
+  {
+    if ( mUsingFeatureIdList )
+    {
+      // candidates of the spatial index or the requested feature
+      if ( mFeatureIdListIterator == mFeatureIdList.constEnd() )
+        break;
+      row = store.rowForId( *mFeatureIdListIterator++ );
+      if ( row < 0 )
+        continue;
+    }
+    else
+    {
+      if ( mSelectRow >= store.rowCount() )
+        break;
+      row = mSelectRow++;
+      if ( store.isDeleted( row ) )
+        continue;
+    }
+
+    if ( !mRequest.filterRect().isNull() )
+    {
+      // bounding boxes are stored with the rows, only exact tests need the geometry
+      if ( !store.hasGeometry( row ) || !store.boundingBox( row ).intersects( mRequest.filterRect() ) )
+        continue;
+
+      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+      {
+        QScopedPointer<QgsGeometry> geom( store.geometry( row ) );
+        if ( !geom->intersects( mSelectRectGeom ) )
+          continue;
+      }
+    }
+
+    if ( mSubsetExpression )
+    {
+      store.feature( row, feature );
+      feature.setFields( mSource->mFields );
+      mSource->mExpressionContext.setFeature( feature );
+      if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
+        continue;
+      loaded = true;
+    }
+
+    hasFeature = true;
+    break;
+  }
+
+  if ( !hasFeature )
+  {
+    close();
+    return false;
+  }
+
+  // only materialize what has been requested
+  if ( !loaded )
+  {
+    bool fetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+    if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
+      store.feature( row, feature, fetchGeometry, &mRequest.subsetOfAttributes() );
+    else
+      store.feature( row, feature, fetchGeometry );
+    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+  }
+  feature.setValid( true );
+  return true;
+}
+
 bool QgsMemoryFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -190,6 +296,8 @@ bool QgsMemoryFeatureIterator::rewind()
 
   if ( mUsingFeatureIdList )
     mFeatureIdListIterator = mFeatureIdList.constBegin();
+  else if ( mSource->mColumnar )
+    mSelectRow = 0;
   else
     mSelectIterator = mSource->mFeatures.constBegin();
 
@@ -215,6 +323,8 @@ bool QgsMemoryFeatureIterator::close()
 QgsMemoryFeatureSource::QgsMemoryFeatureSource( const QgsMemoryProvider* p )
     : mFields( p->mFields )
     , mFeatures( p->mFeatures )
+    , mColumnar( p->mColumnar )
+    , mColumnStore( p->mColumnStore )
     , mSpatialIndex( p->mSpatialIndex ? new QgsSpatialIndex( *p->mSpatialIndex ) : 0 )  // just shallow copy
     , mSubsetString( p->mSubsetString )
 {
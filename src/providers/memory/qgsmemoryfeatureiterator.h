@@ -17,6 +17,7 @@
 
 #include "qgsfeatureiterator.h"
 #include "qgsexpressioncontext.h"
+#include "qgsmemorycolumnstore.h"
 
 class QgsMemoryProvider;
 
@@ -36,6 +37,8 @@ class QgsMemoryFeatureSource : public QgsAbstractFeatureSource
   protected:
     QgsFields mFields;
     QgsFeatureMap mFeatures;
+    bool mColumnar;
+    QgsMemoryColumnStore mColumnStore;
     QgsSpatialIndex* mSpatialIndex;
     QString mSubsetString;
     QgsExpressionContext mExpressionContext;
@@ -62,11 +65,16 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
     //! fetch next feature, return true on success
     virtual bool fetchFeature( QgsFeature& feature ) override;
 
+    //! fetch a block of features
+    virtual int fetchFeatures( QgsFeatureList& features, int maxCount ) override;
+
     bool nextFeatureUsingList( QgsFeature& feature );
     bool nextFeatureTraverseAll( QgsFeature& feature );
+    bool nextFeatureFromColumns( QgsFeature& feature );
 
     QgsGeometry* mSelectRectGeom;
     QgsFeatureMap::const_iterator mSelectIterator;
+    int mSelectRow;
     bool mUsingFeatureIdList;
     QList<QgsFeatureId> mFeatureIdList;
     QList<QgsFeatureId>::const_iterator mFeatureIdListIterator;
@@ -32,6 +32,7 @@ static const QString TEXT_PROVIDER_DESCRIPTION = "Memory provider";
 
 QgsMemoryProvider::QgsMemoryProvider( QString uri )
     : QgsVectorDataProvider( uri )
+    , mColumnar( false )
     , mSpatialIndex( 0 )
 {
   // Initialize the geometry with the uri to support old style uri's
@@ -71,6 +72,9 @@ QgsMemoryProvider::QgsMemoryProvider( QString uri )
 
   mNextFeatureId = 1;
 
+  // must be known before attributes are added
+  mColumnar = url.hasQueryItem( "columnar" ) && url.queryItemValue( "columnar" ) == "yes";
+
   mNativeTypes
   << QgsVectorDataProvider::NativeType( tr( "Whole number (integer)" ), "integer", QVariant::Int, 0, 10 )
   // Decimal number from OGR/Shapefile/dbf may come with length up to 32 and
@@ -233,6 +237,10 @@ QString QgsMemoryProvider::dataSourceUri( bool expandAuthConfig ) const
   {
     uri.addQueryItem( "index", "yes" );
   }
+  if ( mColumnar )
+  {
+    uri.addQueryItem( "columnar", "yes" );
+  }
 
   QgsAttributeList attrs = const_cast<QgsMemoryProvider *>( this )->attributeIndexes();
   for ( int i = 0; i < attrs.size(); i++ )
@@ -270,7 +278,7 @@ QGis::WkbType QgsMemoryProvider::geometryType() const
 
 long QgsMemoryProvider::featureCount() const
 {
-  return mFeatures.count();
+  return mColumnar ? mColumnStore.featureCount() : mFeatures.count();
 }
 
 const QgsFields & QgsMemoryProvider::fields() const
@@ -278,6 +286,34 @@ const QgsFields & QgsMemoryProvider::fields() const
   return mFields;
 }
 
+QVariant QgsMemoryProvider::minimumValue( int index )
+{
+  // the subset string would have to be evaluated for each feature
+  if ( !mColumnar || !mSubsetString.isEmpty() || index < 0 || index >= mFields.count() )
+    return QgsVectorDataProvider::minimumValue( index );
+
+  return mColumnStore.minimumValue( index );
+}
+
+QVariant QgsMemoryProvider::maximumValue( int index )
+{
+  if ( !mColumnar || !mSubsetString.isEmpty() || index < 0 || index >= mFields.count() )
+    return QgsVectorDataProvider::maximumValue( index );
+
+  return mColumnStore.maximumValue( index );
+}
+
+void QgsMemoryProvider::uniqueValues( int index, QList<QVariant> &uniqueValues, int limit )
+{
+  if ( !mColumnar || !mSubsetString.isEmpty() || index < 0 || index >= mFields.count() )
+  {
+    QgsVectorDataProvider::uniqueValues( index, uniqueValues, limit );
+    return;
+  }
+
+  mColumnStore.uniqueValues( index, uniqueValues, limit );
+}
+
 bool QgsMemoryProvider::isValid()
 {
   return ( mWkbType != QGis::WKBUnknown );
@@ -295,6 +331,18 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList & flist )
   // TODO: sanity checks of fields and geometries
   for ( QgsFeatureList::iterator it = flist.begin(); it != flist.end(); ++it )
   {
+    if ( mColumnar )
+    {
+      it->setFeatureId( mNextFeatureId );
+      mColumnStore.addFeature( *it );
+
+      if ( mSpatialIndex )
+        mSpatialIndex->insertFeature( *it );
+
+      mNextFeatureId++;
+      continue;
+    }
+
     mFeatures[mNextFeatureId] = *it;
     QgsFeature& newfeat = mFeatures[mNextFeatureId];
     newfeat.setFeatureId( mNextFeatureId );
@@ -314,8 +362,26 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList & flist )
 
 bool QgsMemoryProvider::deleteFeatures( const QgsFeatureIds & id )
 {
+  QgsAttributeList noAttributes;
   for ( QgsFeatureIds::const_iterator it = id.begin(); it != id.end(); ++it )
   {
+    if ( mColumnar )
+    {
+      int row = mColumnStore.rowForId( *it );
+      if ( row < 0 )
+        continue;
+
+      if ( mSpatialIndex )
+      {
+        QgsFeature f;
+        mColumnStore.feature( row, f, true, &noAttributes );
+        mSpatialIndex->deleteFeature( f );
+      }
+
+      mColumnStore.deleteFeature( *it );
+      continue;
+    }
+
     QgsFeatureMap::iterator fit = mFeatures.find( *it );
 
     // check whether such feature exists
@@ -354,6 +420,12 @@ bool QgsMemoryProvider::addAttributes( const QList<QgsField> &attributes )
     // add new field as a last one
     mFields.append( *it );
 
+    if ( mColumnar )
+    {
+      mColumnStore.addAttribute( it->type() );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature& f = fit.value();
@@ -376,6 +448,12 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds& attributes )
     int idx = *it;
     mFields.remove( idx );
 
+    if ( mColumnar )
+    {
+      mColumnStore.deleteAttribute( idx );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature& f = fit.value();
@@ -391,6 +469,18 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap & a
 {
   for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
   {
+    if ( mColumnar )
+    {
+      int row = mColumnStore.rowForId( it.key() );
+      if ( row < 0 )
+        continue;
+
+      const QgsAttributeMap& attrs = it.value();
+      for ( QgsAttributeMap::const_iterator it2 = attrs.begin(); it2 != attrs.end(); ++it2 )
+        mColumnStore.setAttribute( row, it2.key(), it2.value() );
+      continue;
+    }
+
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
     if ( fit == mFeatures.end() )
       continue;
@@ -404,8 +494,32 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap & a
 
 bool QgsMemoryProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
 {
+  QgsAttributeList noAttributes;
   for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
   {
+    if ( mColumnar )
+    {
+      int row = mColumnStore.rowForId( it.key() );
+      if ( row < 0 )
+        continue;
+
+      QgsFeature f;
+      if ( mSpatialIndex )
+      {
+        mColumnStore.feature( row, f, true, &noAttributes );
+        mSpatialIndex->deleteFeature( f );
+      }
+
+      mColumnStore.setGeometry( row, &it.value() );
+
+      if ( mSpatialIndex )
+      {
+        f.setGeometry( it.value() );
+        mSpatialIndex->insertFeature( f );
+      }
+      continue;
+    }
+
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
     if ( fit == mFeatures.end() )
       continue;
@@ -457,6 +571,17 @@ bool QgsMemoryProvider::createSpatialIndex()
     {
       mSpatialIndex->insertFeature( *it );
     }
+
+    QgsAttributeList noAttributes;
+    for ( int row = 0; mColumnar && row < mColumnStore.rowCount(); ++row )
+    {
+      if ( mColumnStore.isDeleted( row ) || !mColumnStore.hasGeometry( row ) )
+        continue;
+
+      QgsFeature f;
+      mColumnStore.feature( row, f, true, &noAttributes );
+      mSpatialIndex->insertFeature( f );
+    }
   }
   return true;
 }
@@ -471,7 +596,11 @@ int QgsMemoryProvider::capabilities() const
 
 void QgsMemoryProvider::updateExtent()
 {
-  if ( mFeatures.count() == 0 )
+  if ( mColumnar )
+  {
+    mExtent = mColumnStore.featureCount() == 0 ? QgsRectangle() : mColumnStore.extent();
+  }
+  else if ( mFeatures.count() == 0 )
   {
     mExtent = QgsRectangle();
   }
@@ -15,6 +15,7 @@
 
 #include "qgsvectordataprovider.h"
 #include "qgscoordinatereferencesystem.h"
+#include "qgsmemorycolumnstore.h"
 
 
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
@@ -67,6 +68,23 @@ class QgsMemoryProvider : public QgsVectorDataProvider
      */
     virtual const QgsFields & fields() const override;
 
+    /**
+     * Returns the minimum value of an attribute.
+     * Scans the attribute column directly when using columnar storage.
+     */
+    virtual QVariant minimumValue( int index ) override;
+
+    /**
+     * Returns the maximum value of an attribute.
+     * Scans the attribute column directly when using columnar storage.
+     */
+    virtual QVariant maximumValue( int index ) override;
+
+    /**
+     * Return unique values of an attribute.
+     * Scans the attribute column directly when using columnar storage.
+     */
+    virtual void uniqueValues( int index, QList<QVariant> &uniqueValues, int limit = -1 ) override;
 
     /**
       * Adds a list of features
@@ -173,6 +191,10 @@ class QgsMemoryProvider : public QgsVectorDataProvider
 
     // features
     QgsFeatureMap mFeatures;
+
+    // features are kept in mColumnStore instead of mFeatures ("columnar=yes" in uri)
+    bool mColumnar;
+    QgsMemoryColumnStore mColumnStore;
     QgsFeatureId mNextFeatureId;
 
     // indexing
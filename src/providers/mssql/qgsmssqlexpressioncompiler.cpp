@@ -0,0 +1,49 @@
+/***************************************************************************
+  qgsmssqlexpressioncompiler.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmssqlexpressioncompiler.h"
+
+// the default collations of SQL Server compare strings case insensitively
+QgsMssqlExpressionCompiler::QgsMssqlExpressionCompiler( QgsMssqlFeatureSource* source )
+    : QgsSqlExpressionCompiler( source->mFields, QgsSqlExpressionCompiler::CaseInsensitiveStringMatch )
+{
+}
+
+QString QgsMssqlExpressionCompiler::quotedIdentifier( const QString& identifier )
+{
+  QString quoted = identifier;
+  quoted.replace( ']', "]]" );
+  return quoted.prepend( '[' ).append( ']' );
+}
+
+QString QgsMssqlExpressionCompiler::quotedValue( const QVariant& value )
+{
+  if ( !value.isNull() && value.type() == QVariant::String )
+  {
+    // unicode string literal
+    return QgsSqlExpressionCompiler::quotedValue( value ).prepend( 'N' );
+  }
+
+  return QgsSqlExpressionCompiler::quotedValue( value );
+}
+
+QString QgsMssqlExpressionCompiler::sqlOperator( QgsExpression::BinaryOperator op )
+{
+  // T-SQL concatenates strings with +
+  if ( op == QgsExpression::boConcat )
+    return QString();
+
+  return QgsSqlExpressionCompiler::sqlOperator( op );
+}
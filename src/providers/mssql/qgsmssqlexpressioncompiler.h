@@ -0,0 +1,35 @@
+/***************************************************************************
+  qgsmssqlexpressioncompiler.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMSSQLEXPRESSIONCOMPILER_H
+#define QGSMSSQLEXPRESSIONCOMPILER_H
+
+#include "qgssqlexpressioncompiler.h"
+#include "qgsexpression.h"
+#include "qgsmssqlfeatureiterator.h"
+
+class QgsMssqlExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+
+    explicit QgsMssqlExpressionCompiler( QgsMssqlFeatureSource* source );
+
+  protected:
+    virtual QString quotedIdentifier( const QString& identifier ) override;
+    virtual QString quotedValue( const QVariant& value ) override;
+    virtual QString sqlOperator( QgsExpression::BinaryOperator op ) override;
+};
+
+#endif // QGSMSSQLEXPRESSIONCOMPILER_H
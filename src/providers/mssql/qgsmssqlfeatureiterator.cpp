@@ -17,6 +17,7 @@
 
 #include "qgsmssqlfeatureiterator.h"
 #include "qgsmssqlprovider.h"
+#include "qgsmssqlexpressioncompiler.h"
 #include "qgslogger.h"
 
 #include <QObject>
@@ -29,6 +30,7 @@ QgsMssqlFeatureIterator::QgsMssqlFeatureIterator( QgsMssqlFeatureSource* source,
 {
   mClosed = false;
   mQuery = NULL;
+  mExpressionCompiled = false;
 
   mParser.IsGeography = mSource->mIsGeography;
 
@@ -128,6 +130,22 @@ void QgsMssqlFeatureIterator::BuildStatement( const QgsFeatureRequest& request )
       mStatement += " WHERE (" + mSource->mSqlWhereClause + ")";
     else
       mStatement += " AND (" + mSource->mSqlWhereClause + ")";
+    filterAdded = true;
+  }
+
+  if ( request.filterType() == QgsFeatureRequest::FilterExpression
+       && QgsSqlExpressionCompiler::isEnabled() )
+  {
+    QgsMssqlExpressionCompiler compiler = QgsMssqlExpressionCompiler( mSource );
+
+    QgsSqlExpressionCompiler::Result result = compiler.compile( request.filterExpression() );
+    if ( result == QgsSqlExpressionCompiler::Complete || result == QgsSqlExpressionCompiler::Partial )
+    {
+      mFallbackStatement = mStatement;
+      mStatement += ( filterAdded ? " AND " : " WHERE " ) + compiler.result();
+      // a partial result selects a superset - the expression is still evaluated locally
+      mExpressionCompiled = result == QgsSqlExpressionCompiler::Complete;
+    }
   }
 
   QgsDebugMsg( mStatement );
@@ -184,6 +202,15 @@ bool QgsMssqlFeatureIterator::fetchFeature( QgsFeature& feature )
 }
 
 
+bool QgsMssqlFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
+{
+  if ( !mExpressionCompiled )
+    return QgsAbstractFeatureIterator::nextFeatureFilterExpression( f );
+  else
+    return fetchFeature( f );
+}
+
+
 bool QgsMssqlFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -204,6 +231,15 @@ bool QgsMssqlFeatureIterator::rewind()
   {
     QString msg = mQuery->lastError().text();
     QgsDebugMsg( msg );
+
+    if ( !mFallbackStatement.isEmpty() )
+    {
+      // the compiled filter expression was rejected - evaluate it locally
+      mStatement = mFallbackStatement;
+      mFallbackStatement.clear();
+      mExpressionCompiled = false;
+      return rewind();
+    }
   }
 
   return true;
@@ -65,6 +65,7 @@ class QgsMssqlFeatureSource : public QgsAbstractFeatureSource
     bool isSpatial() { return !mGeometryColName.isEmpty() || !mGeometryColType.isEmpty(); }
 
     friend class QgsMssqlFeatureIterator;
+    friend class QgsMssqlExpressionCompiler;
 };
 
 class QgsMssqlFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsMssqlFeatureSource>
@@ -87,6 +88,9 @@ class QgsMssqlFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsM
     //! fetch next feature, return true on success
     virtual bool fetchFeature( QgsFeature& feature ) override;
 
+    //! skip local evaluation of the filter expression if it has been compiled to SQL
+    virtual bool nextFeatureFilterExpression( QgsFeature& f ) override;
+
     // The current database
     QSqlDatabase mDatabase;
 
@@ -96,6 +100,12 @@ class QgsMssqlFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsM
     // The current sql statement
     QString mStatement;
 
+    // Sql statement without the compiled filter expression, used if the compiled statement fails
+    QString mFallbackStatement;
+
+    // Set to true, if the filter expression has been completely compiled to SQL
+    bool mExpressionCompiled;
+
     // Field index of FID column
     long mFidCol;
 
@@ -0,0 +1,46 @@
+/***************************************************************************
+  qgsogrexpressioncompiler.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsogrexpressioncompiler.h"
+
+QgsOgrExpressionCompiler::QgsOgrExpressionCompiler( QgsOgrFeatureSource* source )
+    : QgsSqlExpressionCompiler( source->mFields, QgsSqlExpressionCompiler::LikeIsCaseInsensitive | QgsSqlExpressionCompiler::MixedTypeComparisonsDiffer )
+    , mSource( source )
+{
+}
+
+QgsSqlExpressionCompiler::Result QgsOgrExpressionCompiler::compile( const QgsExpression* exp )
+{
+  // these drivers forward attribute filters to the database as they are,
+  // so the syntax is not OGR SQL nor SQLite
+  if ( mSource->mDriverName == "MySQL" ||
+       mSource->mDriverName == "PostgreSQL" ||
+       mSource->mDriverName == "OCI" ||
+       mSource->mDriverName == "ODBC" ||
+       mSource->mDriverName == "PGeo" ||
+       mSource->mDriverName == "MSSQLSpatial" )
+    return Fail;
+
+  return QgsSqlExpressionCompiler::compile( exp );
+}
+
+QString QgsOgrExpressionCompiler::sqlOperator( QgsExpression::BinaryOperator op )
+{
+  // string concatenation is only available where the filter is executed by SQLite
+  if ( op == QgsExpression::boConcat && mSource->mDriverName != "GPKG" && mSource->mDriverName != "SQLite" )
+    return QString();
+
+  return QgsSqlExpressionCompiler::sqlOperator( op );
+}
@@ -0,0 +1,40 @@
+/***************************************************************************
+  qgsogrexpressioncompiler.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSOGREXPRESSIONCOMPILER_H
+#define QGSOGREXPRESSIONCOMPILER_H
+
+#include "qgssqlexpressioncompiler.h"
+#include "qgsexpression.h"
+#include "qgsogrfeatureiterator.h"
+
+/** Translates expressions to attribute filters (OGR SQL or SQLite dialect) */
+class QgsOgrExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+
+    explicit QgsOgrExpressionCompiler( QgsOgrFeatureSource* source );
+
+    virtual Result compile( const QgsExpression* exp ) override;
+
+  protected:
+    virtual QString sqlOperator( QgsExpression::BinaryOperator op ) override;
+
+  private:
+
+    QgsOgrFeatureSource* mSource;
+};
+
+#endif // QGSOGREXPRESSIONCOMPILER_H
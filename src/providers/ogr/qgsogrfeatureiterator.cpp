@@ -15,6 +15,7 @@
 #include "qgsogrfeatureiterator.h"
 
 #include "qgsogrprovider.h"
+#include "qgsogrexpressioncompiler.h"
 #include "qgsogrgeometrysimplifier.h"
 
 #include "qgsapplication.h"
@@ -37,6 +38,8 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
     : QgsAbstractFeatureIteratorFromSource<QgsOgrFeatureSource>( source, ownSource, request )
     , ogrLayer( 0 )
     , mSubsetStringSet( false )
+    , mAttributeFilterSet( false )
+    , mExpressionCompiled( false )
     , mGeometrySimplifier( NULL )
 {
   mFeatureFetched = false;
@@ -82,6 +85,29 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
     OGR_L_SetSpatialFilter( ogrLayer, 0 );
   }
 
+  if ( request.filterType() == QgsFeatureRequest::FilterExpression
+       && QgsSqlExpressionCompiler::isEnabled() )
+  {
+    QgsOgrExpressionCompiler compiler = QgsOgrExpressionCompiler( source );
+
+    QgsSqlExpressionCompiler::Result result = compiler.compile( request.filterExpression() );
+    if ( result == QgsSqlExpressionCompiler::Complete || result == QgsSqlExpressionCompiler::Partial )
+    {
+      QString whereClause = compiler.result();
+      if ( OGR_L_SetAttributeFilter( ogrLayer, mSource->mEncoding->fromUnicode( whereClause ).constData() ) == OGRERR_NONE )
+      {
+        mAttributeFilterSet = true;
+        // a partial result selects a superset - the expression is still evaluated locally
+        mExpressionCompiled = result == QgsSqlExpressionCompiler::Complete;
+      }
+      else
+      {
+        QgsDebugMsg( QString( "Attribute filter %1 rejected by OGR" ).arg( whereClause ) );
+        OGR_L_SetAttributeFilter( ogrLayer, 0 );
+      }
+    }
+  }
+
   //start with first feature
   rewind();
 }
@@ -94,6 +120,14 @@ QgsOgrFeatureIterator::~QgsOgrFeatureIterator()
   close();
 }
 
+bool QgsOgrFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
+{
+  if ( !mExpressionCompiled )
+    return QgsAbstractFeatureIterator::nextFeatureFilterExpression( f );
+  else
+    return fetchFeature( f );
+}
+
 bool QgsOgrFeatureIterator::prepareSimplification( const QgsSimplifyMethod& simplifyMethod )
 {
   delete mGeometrySimplifier;
@@ -164,8 +198,8 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
       return false;
     }
 
-    if ( readFeature( fet, feature ) )
-      OGR_F_Destroy( fet );
+    readFeature( fet, feature );
+    OGR_F_Destroy( fet );
 
     feature.setValid( true );
     close(); // the feature has been read: we have finished here
@@ -176,7 +210,10 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
 
   while (( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
   {
-    if ( !readFeature( fet, feature ) )
+    bool ok = readFeature( fet, feature );
+    OGR_F_Destroy( fet );
+
+    if ( !ok )
       continue;
 
     if ( !mRequest.filterRect().isNull() && !feature.constGeometry() )
@@ -184,7 +221,6 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
 
     // we have a feature, end this cycle
     feature.setValid( true );
-    OGR_F_Destroy( fet );
     return true;
 
   } // while
@@ -194,6 +230,47 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
 }
 
 
+int QgsOgrFeatureIterator::fetchFeatures( QgsFeatureList& features, int maxCount )
+{
+  if ( mClosed )
+    return 0;
+
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+    return QgsAbstractFeatureIterator::fetchFeatures( features, maxCount );
+
+  int count = 0;
+  OGRFeatureH fet;
+  while ( count < maxCount && ( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
+  {
+    features.append( QgsFeature() );
+    QgsFeature& feature = features.last();
+
+    bool ok = readFeature( fet, feature );
+    OGR_F_Destroy( fet );
+
+    if ( !ok )
+    {
+      features.removeLast();
+      continue;
+    }
+
+    if ( !mRequest.filterRect().isNull() && !feature.constGeometry() )
+    {
+      features.removeLast();
+      continue;
+    }
+
+    feature.setValid( true );
+    ++count;
+  }
+
+  if ( count < maxCount )
+    close();
+
+  return count;
+}
+
+
 bool QgsOgrFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -216,6 +293,11 @@ bool QgsOgrFeatureIterator::close()
   {
     OGR_DS_ReleaseResultSet( mConn->ds, ogrLayer );
   }
+  else if ( mAttributeFilterSet )
+  {
+    // the layer is shared with other iterators through the connection pool
+    OGR_L_SetAttributeFilter( ogrLayer, 0 );
+  }
 
   QgsOgrConnPool::instance()->releaseConnection( mConn );
   mConn = 0;
@@ -300,7 +382,6 @@ bool QgsOgrFeatureIterator::readFeature( OGRFeatureH fet, QgsFeature& feature )
     if (( useIntersect && ( !feature.constGeometry() || !feature.constGeometry()->intersects( mRequest.filterRect() ) ) )
         || ( geometryTypeFilter && ( !feature.constGeometry() || QgsOgrProvider::ogrWkbSingleFlatten(( OGRwkbGeometryType )feature.constGeometry()->wkbType() ) != mSource->mOgrGeometryTypeFilter ) ) )
     {
-      OGR_F_Destroy( fet );
       return false;
     }
   }
@@ -43,6 +43,7 @@ class QgsOgrFeatureSource : public QgsAbstractFeatureSource
     QString mDriverName;
 
     friend class QgsOgrFeatureIterator;
+    friend class QgsOgrExpressionCompiler;
 };
 
 class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgrFeatureSource>
@@ -62,10 +63,16 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     //! fetch next feature, return true on success
     virtual bool fetchFeature( QgsFeature& feature ) override;
 
+    //! fetch a block of features
+    virtual int fetchFeatures( QgsFeatureList& features, int maxCount ) override;
+
     //! Setup the simplification of geometries to fetch using the specified simplify method
     virtual bool prepareSimplification( const QgsSimplifyMethod& simplifyMethod ) override;
 
+    //! skip local evaluation of the filter expression if it has been compiled to an attribute filter
+    virtual bool nextFeatureFilterExpression( QgsFeature& f ) override;
 
+    //! Reads the feature, returns false if it does not match the request. The OGR feature is not destroyed
     bool readFeature( OGRFeatureH fet, QgsFeature& feature );
 
     //! Get an attribute associated with a feature
@@ -78,6 +85,12 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
 
     bool mSubsetStringSet;
 
+    //! Set to true, if the compiled filter expression has been set as attribute filter
+    bool mAttributeFilterSet;
+
+    //! Set to true, if the attribute filter fully replaces local evaluation of the filter expression
+    bool mExpressionCompiled;
+
     //! Set to true, if geometry is in the requested columns
     bool mFetchGeometry;
 
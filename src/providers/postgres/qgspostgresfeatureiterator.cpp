@@ -76,14 +76,16 @@ QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource
     whereClause = QgsPostgresUtils::andWhereClauses( whereClause, fidsWhereClause );
   }
   else if ( request.filterType() == QgsFeatureRequest::FilterExpression
-            && QSettings().value( "/qgis/postgres/compileExpressions", false ).toBool() )
+            && QgsSqlExpressionCompiler::isEnabled() )
   {
     QgsPostgresExpressionCompiler compiler = QgsPostgresExpressionCompiler( source );
 
-    if ( compiler.compile( request.filterExpression() ) == QgsPostgresExpressionCompiler::Complete )
+    QgsSqlExpressionCompiler::Result result = compiler.compile( request.filterExpression() );
+    if ( result == QgsSqlExpressionCompiler::Complete || result == QgsSqlExpressionCompiler::Partial )
     {
       whereClause = QgsPostgresUtils::andWhereClauses( whereClause, compiler.result() );
-      mExpressionCompiled = true;
+      // a partial result selects a superset - the expression is still evaluated locally
+      mExpressionCompiled = result == QgsSqlExpressionCompiler::Complete;
     }
   }
 
@@ -120,38 +122,7 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature& feature )
     return false;
 
   if ( mFeatureQueue.empty() )
-  {
-    QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
-    QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
-    if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
-    {
-      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-    }
-
-    QgsPostgresResult queryResult;
-    for ( ;; )
-    {
-      queryResult = mConn->PQgetResult();
-      if ( !queryResult.result() )
-        break;
-
-      if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
-      {
-        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-        break;
-      }
-
-      int rows = queryResult.PQntuples();
-      if ( rows == 0 )
-        continue;
-
-      for ( int row = 0; row < rows; row++ )
-      {
-        mFeatureQueue.enqueue( QgsFeature() );
-        getFeature( queryResult, row, mFeatureQueue.back() );
-      } // for each row in queue
-    }
-  }
+    fillFeatureQueue( mFeatureQueueSize );
 
   if ( mFeatureQueue.empty() )
   {
@@ -172,6 +143,75 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature& feature )
   return true;
 }
 
+int QgsPostgresFeatureIterator::fetchFeatures( QgsFeatureList& features, int maxCount )
+{
+  if ( mClosed )
+    return 0;
+
+  int count = 0;
+  while ( count < maxCount )
+  {
+    // fetch the whole block with one round trip
+    if ( mFeatureQueue.empty() )
+      fillFeatureQueue( qMax( mFeatureQueueSize, maxCount - count ) );
+
+    if ( mFeatureQueue.empty() )
+    {
+      QgsDebugMsg( QString( "Finished after %1 features" ).arg( mFetched ) );
+      close();
+
+      mSource->mShared->ensureFeaturesCountedAtLeast( mFetched );
+      break;
+    }
+
+    while ( count < maxCount && !mFeatureQueue.empty() )
+    {
+      features.append( mFeatureQueue.dequeue() );
+      QgsFeature& feature = features.last();
+      feature.setValid( true );
+      feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+      mFetched++;
+      count++;
+    }
+  }
+
+  return count;
+}
+
+void QgsPostgresFeatureIterator::fillFeatureQueue( int count )
+{
+  QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( count ).arg( mCursorName );
+  QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( count ), 4 );
+  if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+  }
+
+  QgsPostgresResult queryResult;
+  for ( ;; )
+  {
+    queryResult = mConn->PQgetResult();
+    if ( !queryResult.result() )
+      break;
+
+    if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
+    {
+      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+      break;
+    }
+
+    int rows = queryResult.PQntuples();
+    if ( rows == 0 )
+      continue;
+
+    for ( int row = 0; row < rows; row++ )
+    {
+      mFeatureQueue.enqueue( QgsFeature() );
+      getFeature( queryResult, row, mFeatureQueue.back() );
+    } // for each row in queue
+  }
+}
+
 bool QgsPostgresFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
 {
   if ( !mExpressionCompiled )
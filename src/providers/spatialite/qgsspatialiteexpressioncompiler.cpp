@@ -0,0 +1,28 @@
+/***************************************************************************
+  qgsspatialiteexpressioncompiler.cpp
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsspatialiteexpressioncompiler.h"
+#include "qgsspatialiteprovider.h"
+
+// SQLite matches LIKE case insensitively (for ASCII characters) and compares text to numbers by type affinity
+QgsSpatiaLiteExpressionCompiler::QgsSpatiaLiteExpressionCompiler( QgsSpatiaLiteFeatureSource* source )
+    : QgsSqlExpressionCompiler( source->mFields, QgsSqlExpressionCompiler::LikeIsCaseInsensitive | QgsSqlExpressionCompiler::MixedTypeComparisonsDiffer )
+{
+}
+
+QString QgsSpatiaLiteExpressionCompiler::quotedIdentifier( const QString& identifier )
+{
+  return QgsSpatiaLiteProvider::quotedIdentifier( identifier );
+}
@@ -0,0 +1,33 @@
+/***************************************************************************
+  qgsspatialiteexpressioncompiler.h
+  --------------------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSPATIALITEEXPRESSIONCOMPILER_H
+#define QGSSPATIALITEEXPRESSIONCOMPILER_H
+
+#include "qgssqlexpressioncompiler.h"
+#include "qgsexpression.h"
+#include "qgsspatialitefeatureiterator.h"
+
+class QgsSpatiaLiteExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+
+    explicit QgsSpatiaLiteExpressionCompiler( QgsSpatiaLiteFeatureSource* source );
+
+  protected:
+    virtual QString quotedIdentifier( const QString& identifier ) override;
+};
+
+#endif // QGSSPATIALITEEXPRESSIONCOMPILER_H
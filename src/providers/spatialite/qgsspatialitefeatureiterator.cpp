@@ -17,6 +17,7 @@
 #include "qgsspatialiteconnection.h"
 #include "qgsspatialiteconnpool.h"
 #include "qgsspatialiteprovider.h"
+#include "qgsspatialiteexpressioncompiler.h"
 
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
@@ -26,6 +27,7 @@
 QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource<QgsSpatiaLiteFeatureSource>( source, ownSource, request )
     , sqliteStatement( NULL )
+    , mExpressionCompiled( false )
 {
 
   mHandle = QgsSpatiaLiteConnPool::instance()->acquireConnection( mSource->mSqlitePath );
@@ -35,6 +37,7 @@ QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteFeature
   mRowNumber = 0;
 
   QString whereClause;
+  QString expressionClause;
   if ( !request.filterRect().isNull() && !mSource->mGeometryColumn.isNull() )
   {
     // some kind of MBR spatial filtering is required
@@ -49,6 +52,19 @@ QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteFeature
   {
     whereClause += whereClauseFids();
   }
+  else if ( request.filterType() == QgsFeatureRequest::FilterExpression
+            && QgsSqlExpressionCompiler::isEnabled() )
+  {
+    QgsSpatiaLiteExpressionCompiler compiler = QgsSpatiaLiteExpressionCompiler( source );
+
+    QgsSqlExpressionCompiler::Result result = compiler.compile( request.filterExpression() );
+    if ( result == QgsSqlExpressionCompiler::Complete || result == QgsSqlExpressionCompiler::Partial )
+    {
+      expressionClause = compiler.result();
+      // a partial result selects a superset - the expression is still evaluated locally
+      mExpressionCompiled = result == QgsSqlExpressionCompiler::Complete;
+    }
+  }
 
   if ( !mSource->mSubsetString.isEmpty() )
   {
@@ -59,8 +75,21 @@ QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteFeature
     whereClause += "( " + mSource->mSubsetString + ")";
   }
 
+  bool success = false;
+  if ( !expressionClause.isEmpty() )
+  {
+    QString compiledWhereClause = whereClause.isEmpty() ? expressionClause : whereClause + " AND " + expressionClause;
+    success = prepareStatement( compiledWhereClause );
+    if ( !success )
+    {
+      // fall back to local evaluation of the expression
+      QgsDebugMsg( "Compiled expression failed: " + expressionClause );
+      mExpressionCompiled = false;
+    }
+  }
+
   // preparing the SQL statement
-  if ( !prepareStatement( whereClause ) )
+  if ( !success && !prepareStatement( whereClause ) )
   {
     // some error occurred
     sqliteStatement = NULL;
@@ -102,6 +131,49 @@ bool QgsSpatiaLiteFeatureIterator::fetchFeature( QgsFeature& feature )
 }
 
 
+int QgsSpatiaLiteFeatureIterator::fetchFeatures( QgsFeatureList& features, int maxCount )
+{
+  if ( mClosed )
+    return 0;
+
+  if ( sqliteStatement == NULL )
+  {
+    QgsDebugMsg( "Invalid current SQLite statement" );
+    close();
+    return 0;
+  }
+
+  int count = 0;
+  while ( count < maxCount )
+  {
+    features.append( QgsFeature() );
+    QgsFeature& feature = features.last();
+    if ( !getFeature( sqliteStatement, feature ) )
+    {
+      features.removeLast();
+      sqlite3_finalize( sqliteStatement );
+      sqliteStatement = NULL;
+      close();
+      break;
+    }
+
+    feature.setValid( true );
+    ++count;
+  }
+
+  return count;
+}
+
+
+bool QgsSpatiaLiteFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
+{
+  if ( !mExpressionCompiled )
+    return QgsAbstractFeatureIterator::nextFeatureFilterExpression( f );
+  else
+    return fetchFeature( f );
+}
+
+
 bool QgsSpatiaLiteFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -49,6 +49,7 @@ class QgsSpatiaLiteFeatureSource : public QgsAbstractFeatureSource
     QString mSqlitePath;
 
     friend class QgsSpatiaLiteFeatureIterator;
+    friend class QgsSpatiaLiteExpressionCompiler;
 };
 
 class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsSpatiaLiteFeatureSource>
@@ -69,6 +70,12 @@ class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIteratorFromSource
     //! fetch next feature, return true on success
     virtual bool fetchFeature( QgsFeature& feature ) override;
 
+    //! fetch a block of features
+    virtual int fetchFeatures( QgsFeatureList& features, int maxCount ) override;
+
+    //! skip local evaluation of the filter expression if it has been compiled to SQL
+    virtual bool nextFeatureFilterExpression( QgsFeature& f ) override;
+
     QString whereClauseRect();
     QString whereClauseFid();
     QString whereClauseFids();
@@ -96,6 +103,9 @@ class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIteratorFromSource
 
     bool mHasPrimaryKey;
     QgsFeatureId mRowNumber;
+
+    //! Set to true, if the filter expression has been completely compiled to SQL
+    bool mExpressionCompiled;
 };
 
 #endif // QGSSPATIALITEFEATUREITERATOR_H
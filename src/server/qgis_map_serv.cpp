@@ -34,6 +34,18 @@ int fcgi_accept()
 #endif
 }
 
+void fcgi_finish()
+{
+#ifdef Q_OS_WIN
+  if ( FCGX_IsCGI() )
+    FCGI_Finish();
+  else
+    FCGX_Finish();
+#else
+  FCGI_Finish();
+#endif
+}
+
 int main( int argc, char * argv[] )
 {
   QgsServer server;
@@ -42,6 +54,9 @@ int main( int argc, char * argv[] )
   while ( fcgi_accept() >= 0 )
   {
     server.handleRequest( );
+    // send the response before rebuilding capabilities documents of changed projects
+    fcgi_finish();
+    server.updateCapabilitiesCache();
   }
   return 0;
 }
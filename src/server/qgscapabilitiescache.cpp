@@ -18,6 +18,57 @@
 #include "qgscapabilitiescache.h"
 #include "qgslogger.h"
 #include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+
+#include <stdlib.h>
+
+//! Time (seconds) stale documents are returned if nobody regenerates them
+static const int STALE_DOCUMENT_MAX_AGE = 60;
+
+//! CGI variables used to build the capabilities documents
+static const char* REQUEST_VARIABLES[] = { "SERVER_NAME", "SERVER_PORT", "HTTPS", "REQUEST_URI", "SCRIPT_NAME", "QUERY_STRING", 0 };
+
+//! Removes all parameters except MAP from a query string
+static QString _mapParameterQuery( const QString& query )
+{
+  //keep the items as sent by the client, the service URL is built from the encoded query
+  QStringList mapItems;
+  QStringList queryItems = query.split( '&', QString::SkipEmptyParts );
+  for ( int i = 0; i < queryItems.size(); ++i )
+  {
+    if ( queryItems.at( i ).section( '=', 0, 0 ).compare( "MAP", Qt::CaseInsensitive ) == 0 )
+    {
+      mapItems.append( queryItems.at( i ) );
+    }
+  }
+  return mapItems.join( "&" );
+}
+
+/** Returns the CGI variables of the current request
+ * @param mapParameterOnly remove all parameters except MAP from the request URL (e.g. of a GetMap request)
+ */
+static QMap<QString, QString> _requestEnvironment( bool mapParameterOnly )
+{
+  QMap<QString, QString> environment;
+  for ( int i = 0; REQUEST_VARIABLES[i]; ++i )
+  {
+    environment.insert( REQUEST_VARIABLES[i], QString( getenv( REQUEST_VARIABLES[i] ) ) );
+  }
+
+  if ( mapParameterOnly )
+  {
+    environment["QUERY_STRING"] = _mapParameterQuery( environment["QUERY_STRING"] );
+    QString requestUri = environment["REQUEST_URI"];
+    int querySeparator = requestUri.indexOf( '?' );
+    if ( querySeparator >= 0 )
+    {
+      QString query = _mapParameterQuery( requestUri.mid( querySeparator + 1 ) );
+      environment["REQUEST_URI"] = requestUri.left( querySeparator ) + ( query.isEmpty() ? QString() : "?" + query );
+    }
+  }
+  return environment;
+}
 
 QgsCapabilitiesCache::QgsCapabilitiesCache()
 {
@@ -32,6 +83,13 @@ const QDomDocument* QgsCapabilitiesCache::searchCapabilitiesDocument( QString co
 {
   QCoreApplication::processEvents(); //get updates from file system watcher
 
+  //stale documents are served until they are regenerated, but not forever
+  QHash< QString, time_t >::const_iterator staleIt = mStaleSince.constFind( configFilePath );
+  if ( staleIt != mStaleSince.constEnd() && time( NULL ) - staleIt.value() > STALE_DOCUMENT_MAX_AGE )
+  {
+    removeEntry( configFilePath );
+  }
+
   if ( mCachedCapabilities.contains( configFilePath ) && mCachedCapabilities[ configFilePath ].contains( version ) )
   {
     return &mCachedCapabilities[configFilePath][version];
@@ -44,12 +102,10 @@ const QDomDocument* QgsCapabilitiesCache::searchCapabilitiesDocument( QString co
 
 void QgsCapabilitiesCache::insertCapabilitiesDocument( QString configFilePath, QString version, const QDomDocument* doc )
 {
-  if ( mCachedCapabilities.size() > 40 )
+  if ( mCachedCapabilities.size() > 40 && !mCachedCapabilities.contains( configFilePath ) )
   {
     //remove another cache entry to avoid memory problems
-    QHash<QString, QHash<QString, QDomDocument> >::iterator capIt = mCachedCapabilities.begin();
-    mFileSystemWatcher.removePath( capIt.key() );
-    mCachedCapabilities.erase( capIt );
+    removeEntry( mCachedCapabilities.begin().key() );
   }
 
   if ( !mCachedCapabilities.contains( configFilePath ) )
@@ -59,11 +115,108 @@ void QgsCapabilitiesCache::insertCapabilitiesDocument( QString configFilePath, Q
   }
 
   mCachedCapabilities[ configFilePath ].insert( version, doc->cloneNode().toDocument() );
+  mRequestEnvironments.insert( configFilePath, _requestEnvironment( false ) );
+
+  QHash< QString, QSet<QString> >::iterator requestedIt = mRequestedVersions.find( configFilePath );
+  if ( requestedIt != mRequestedVersions.end() )
+  {
+    requestedIt->remove( version );
+    if ( requestedIt->isEmpty() )
+    {
+      mRequestedVersions.erase( requestedIt );
+      mStaleSince.remove( configFilePath );
+    }
+  }
+}
+
+void QgsCapabilitiesCache::requestCapabilitiesDocument( const QString& configFilePath, const QString& version )
+{
+  if ( mCachedCapabilities.value( configFilePath ).contains( version ) || mRequestedVersions.value( configFilePath ).contains( version ) )
+  {
+    return;
+  }
+
+  mRequestedVersions[ configFilePath ].insert( version );
+  if ( !mRequestEnvironments.contains( configFilePath ) )
+  {
+    mRequestEnvironments.insert( configFilePath, _requestEnvironment( true ) );
+  }
+}
+
+bool QgsCapabilitiesCache::isStale( const QString& configFilePath ) const
+{
+  return mStaleSince.contains( configFilePath );
+}
+
+QList< QPair<QString, QString> > QgsCapabilitiesCache::pendingDocuments() const
+{
+  QList< QPair<QString, QString> > documents;
+  QHash< QString, QSet<QString> >::const_iterator requestedIt = mRequestedVersions.constBegin();
+  for ( ; requestedIt != mRequestedVersions.constEnd(); ++requestedIt )
+  {
+    Q_FOREACH ( const QString& version, requestedIt.value() )
+    {
+      documents.append( qMakePair( requestedIt.key(), version ) );
+    }
+  }
+  return documents;
+}
+
+void QgsCapabilitiesCache::discardPendingDocument( const QString& configFilePath, const QString& version )
+{
+  //a stale document which can not be built again is not served any more
+  if ( mStaleSince.contains( configFilePath ) && mCachedCapabilities.contains( configFilePath ) )
+  {
+    mCachedCapabilities[ configFilePath ].remove( version );
+  }
+
+  QHash< QString, QSet<QString> >::iterator requestedIt = mRequestedVersions.find( configFilePath );
+  if ( requestedIt != mRequestedVersions.end() )
+  {
+    requestedIt->remove( version );
+    if ( requestedIt->isEmpty() )
+    {
+      mRequestedVersions.erase( requestedIt );
+      mStaleSince.remove( configFilePath );
+    }
+  }
+}
+
+QMap<QString, QString> QgsCapabilitiesCache::requestEnvironment( const QString& configFilePath ) const
+{
+  return mRequestEnvironments.value( configFilePath );
+}
+
+void QgsCapabilitiesCache::removeEntry( const QString& configFilePath )
+{
+  mCachedCapabilities.remove( configFilePath );
+  mRequestedVersions.remove( configFilePath );
+  mStaleSince.remove( configFilePath );
+  mRequestEnvironments.remove( configFilePath );
+  mFileSystemWatcher.removePath( configFilePath );
 }
 
 void QgsCapabilitiesCache::removeChangedEntry( const QString& path )
 {
-  QgsDebugMsg( "Remove capabilities cache entry because file changed" );
-  mCachedCapabilities.remove( path );
-  mFileSystemWatcher.removePath( path );
+  if ( !mCachedCapabilities.contains( path ) )
+  {
+    removeEntry( path );
+    return;
+  }
+
+  QgsDebugMsg( "Capabilities cache entry is stale because file changed" );
+  Q_FOREACH ( const QString& version, mCachedCapabilities[ path ].keys() )
+  {
+    mRequestedVersions[ path ].insert( version );
+  }
+  if ( !mStaleSince.contains( path ) )
+  {
+    mStaleSince.insert( path, time( NULL ) );
+  }
+
+  //files replaced by editors are not watched any more
+  if ( !mFileSystemWatcher.files().contains( path ) && QFile::exists( path ) )
+  {
+    mFileSystemWatcher.addPath( path );
+  }
 }
@@ -21,9 +21,20 @@
 #include <QDomDocument>
 #include <QFileSystemWatcher>
 #include <QHash>
+#include <QMap>
 #include <QObject>
+#include <QPair>
+#include <QSet>
 
-/** A cache for capabilities xml documents (by configuration file path)*/
+#include <time.h>
+
+/** A cache for capabilities xml documents (by configuration file path).
+ *
+ * When a configuration file changes, its documents are marked as stale. Stale documents are
+ * still returned by searchCapabilitiesDocument() until QgsServer regenerates them after the
+ * response of a request was sent (see pendingDocuments()). Documents can also be requested
+ * ahead of time with requestCapabilitiesDocument(), e.g. when a project is loaded.
+ */
 class SERVER_EXPORT QgsCapabilitiesCache : public QObject
 {
     Q_OBJECT
@@ -36,12 +47,48 @@ class SERVER_EXPORT QgsCapabilitiesCache : public QObject
     /** Inserts new capabilities document (creates a copy of the document, does not take ownership)*/
     void insertCapabilitiesDocument( QString configFilePath, QString version, const QDomDocument* doc );
 
+    /** Requests a document to be built ahead of time (if it is not in the cache yet)
+     * @note added in QGIS 2.12
+     */
+    void requestCapabilitiesDocument( const QString& configFilePath, const QString& version );
+
+    /** Returns true if the configuration file of a cached document changed since it was built
+     * @note added in QGIS 2.12
+     */
+    bool isStale( const QString& configFilePath ) const;
+
+    /** Returns the stale and requested documents to be built (configuration file path / version)
+     * @note added in QGIS 2.12
+     */
+    QList< QPair<QString, QString> > pendingDocuments() const;
+
+    /** Removes a document from the pending documents (e.g. because it could not be built)
+     * @note added in QGIS 2.12
+     */
+    void discardPendingDocument( const QString& configFilePath, const QString& version );
+
+    /** Returns the CGI variables (e.g. SERVER_NAME) of the request a document was built or requested for.
+     * They are needed to build the document again outside of a request.
+     * @note added in QGIS 2.12
+     */
+    QMap<QString, QString> requestEnvironment( const QString& configFilePath ) const;
+
   private:
     QHash< QString, QHash< QString, QDomDocument > > mCachedCapabilities;
     QFileSystemWatcher mFileSystemWatcher;
 
+    /** Time the configuration files of stale documents changed*/
+    QHash< QString, time_t > mStaleSince;
+    /** Versions requested ahead of time by configuration file*/
+    QHash< QString, QSet<QString> > mRequestedVersions;
+    /** CGI variables of the requests by configuration file*/
+    QHash< QString, QMap<QString, QString> > mRequestEnvironments;
+
+    /** Removes the entries of a configuration file*/
+    void removeEntry( const QString& configFilePath );
+
   private slots:
-    /** Removes changed entry from this cache*/
+    /** Marks the entries of a changed file as stale*/
     void removeChangedEntry( const QString &path );
 };
 
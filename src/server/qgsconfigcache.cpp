@@ -22,6 +22,7 @@
 #include "qgswfsprojectparser.h"
 #include "qgswmsprojectparser.h"
 #include "qgssldconfigparser.h"
+#include "qgsservertilecache.h"
 
 #include <QFile>
 
@@ -173,5 +174,11 @@ void QgsConfigCache::removeChangedEntry( const QString& path )
   //xml document must be removed last, as other config cache destructors may require it
   mXmlDocumentCache.remove( path );
 
+  //tiles rendered with the old configuration
+  if ( QgsServerTileCache::instance() )
+  {
+    QgsServerTileCache::instance()->removeProject( path );
+  }
+
   mFileSystemWatcher.removePath( path );
 }
@@ -157,7 +157,13 @@ void QgsConfigParserUtils::appendLayerBoundingBoxes( QDomElement& layerElem, QDo
 
 QStringList QgsConfigParserUtils::createCRSListForLayer( QgsMapLayer* theMapLayer )
 {
-  QStringList crsNumbers;
+  //the list does not depend on the layer, read it from the srs database only once
+  static QStringList crsNumbers;
+  if ( !crsNumbers.isEmpty() )
+  {
+    return crsNumbers;
+  }
+
   QString myDatabaseFileName = QgsApplication::srsDbFilePath();
   sqlite3      *myDatabase;
   const char   *myTail;
@@ -169,8 +175,7 @@ QStringList QgsConfigParserUtils::createCRSListForLayer( QgsMapLayer* theMapLaye
   if ( myResult && theMapLayer )
   {
     //if the database cannot be opened, add at least the epsg number of the source coordinate system
-    crsNumbers.push_back( theMapLayer->crs().authid() );
-    return crsNumbers;
+    return QStringList() << theMapLayer->crs().authid();
   };
   QString mySql = "select upper(auth_name||':'||auth_id) from tbl_srs";
   myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.length(), &myPreparedStatement, &myTail );
@@ -24,9 +24,6 @@
 #include <QColor>
 #include <QPair>
 
-typedef QList< QPair<QRgb, int> > QgsColorBox; //Color / number of pixels
-typedef QMultiMap< int, QgsColorBox > QgsColorBoxMap; // sum of pixels / color box
-
 /** Base class for request handler using HTTP.
 It provides a method to set data to the client*/
 class QgsHttpRequestHandler: public QgsRequestHandler
@@ -79,17 +76,6 @@ class QgsHttpRequestHandler: public QgsRequestHandler
     QString readPostBody() const;
 
   private:
-    static void medianCut( QVector<QRgb>& colorTable, int nColors, const QImage& inputImage );
-    static void imageColors( QHash<QRgb, int>& colors, const QImage& image );
-    static void splitColorBox( QgsColorBox& colorBox, QgsColorBoxMap& colorBoxMap,
-                               QMap<int, QgsColorBox>::iterator colorBoxMapIt );
-    static bool minMaxRange( const QgsColorBox& colorBox, int& redRange, int& greenRange, int& blueRange, int& alphaRange );
-    static bool redCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
-    static bool greenCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
-    static bool blueCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
-    static bool alphaCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
-    /** Calculates a representative color for a box (pixel weighted average)*/
-    static QRgb boxColor( const QgsColorBox& box, int boxPixels );
     // TODO: if HAVE_SERVER_PYTHON
     QByteArray mResponseHeader;
     QByteArray mResponseBody;
@@ -17,9 +17,15 @@
 
 #include "qgsmslayercache.h"
 #include "qgsmessagelog.h"
+#include "qgsmsproviderpool.h"
+#include "qgsspatialindex.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qgslogger.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QTime>
+#include <QUrl>
 
 QgsMSLayerCache* QgsMSLayerCache::instance()
 {
@@ -27,8 +33,36 @@ QgsMSLayerCache* QgsMSLayerCache::instance()
   return &mInstance;
 }
 
+//! Default memory limit (MB) of the vector data providers kept in the pool without being used by a layer
+static const int DEFAULT_PROVIDER_POOL_MEMORY = 64;
+
+//! Maximum number of features of a layer with a spatial index in the cache
+static const long SPATIAL_INDEX_MAX_FEATURES = 1000000;
+
+//! Providers which gain from a spatial index in the cache (databases query their own indexes)
+static const char* INDEXED_PROVIDERS[] = { "ogr", "delimitedtext", "memory", "gpx" };
+
+//! Returns the file read by a file based provider or an empty string (e.g. for memory layers)
+static QString _providerFile( const QgsVectorDataProvider* provider )
+{
+  QString path = provider->dataSourceUri();
+  path = path.left( path.indexOf( '|' ) );
+  if ( path.startsWith( "file:" ) )
+  {
+    path = QUrl::fromEncoded( path.toAscii() ).toLocalFile();
+  }
+  else
+  {
+    path = path.left( path.indexOf( '?' ) );
+  }
+  QFileInfo fileInfo( path );
+  return fileInfo.isFile() ? fileInfo.absoluteFilePath() : QString();
+}
+
 QgsMSLayerCache::QgsMSLayerCache()
     : mProjectMaxLayers( 0 )
+    , mProviderPool( 0 )
+    , mSpatialIndexesEnabled( true )
 {
   mDefaultMaxLayers = 100;
   //max layer from environment variable overrides default
@@ -43,6 +77,31 @@ QgsMSLayerCache::QgsMSLayerCache()
     }
   }
   QObject::connect( &mFileSystemWatcher, SIGNAL( fileChanged( const QString& ) ), this, SLOT( removeProjectFileLayers( const QString& ) ) );
+
+  //layers with the same data source share a provider, unless disabled with QGIS_SERVER_SHARED_PROVIDERS=0
+  char* sharedProvidersEnv = getenv( "QGIS_SERVER_SHARED_PROVIDERS" );
+  if ( !sharedProvidersEnv || QString( sharedProvidersEnv ) != "0" )
+  {
+    int poolMemory = DEFAULT_PROVIDER_POOL_MEMORY;
+    char* poolMemoryEnv = getenv( "QGIS_SERVER_PROVIDER_POOL_MEMORY" );
+    if ( poolMemoryEnv )
+    {
+      bool conversionOk = false;
+      int poolMemoryInt = QString( poolMemoryEnv ).toInt( &conversionOk );
+      if ( conversionOk && poolMemoryInt >= 0 )
+      {
+        poolMemory = poolMemoryInt;
+      }
+    }
+    mProviderPool = new QgsMSProviderPool( qint64( poolMemory ) * 1024 * 1024 );
+    QgsVectorLayer::setDataProviderPool( mProviderPool );
+  }
+
+  char* spatialIndexEnv = getenv( "QGIS_SERVER_FEATUREINFO_INDEX" );
+  if ( spatialIndexEnv && QString( spatialIndexEnv ) == "0" )
+  {
+    mSpatialIndexesEnabled = false;
+  }
 }
 
 QgsMSLayerCache::~QgsMSLayerCache()
@@ -52,6 +111,16 @@ QgsMSLayerCache::~QgsMSLayerCache()
   {
     delete entry.layerPointer;
   }
+  qDeleteAll( mSpatialIndexes );
+
+  if ( mProviderPool )
+  {
+    if ( QgsVectorLayer::dataProviderPool() == mProviderPool )
+    {
+      QgsVectorLayer::setDataProviderPool( 0 );
+    }
+    delete mProviderPool;
+  }
 }
 
 void QgsMSLayerCache::insertLayer( const QString& url, const QString& layerName, QgsMapLayer* layer, const QString& configFile, const QList<QString>& tempFiles )
@@ -116,6 +185,89 @@ QgsMapLayer* QgsMSLayerCache::searchLayer( const QString& url, const QString& la
   }
 }
 
+const QgsSpatialIndex* QgsMSLayerCache::spatialIndex( QgsVectorLayer* layer )
+{
+  if ( !layer || !mSpatialIndexesEnabled )
+  {
+    return 0;
+  }
+
+  //the index contains all features, it can not be used while a subset (e.g. of the FILTER parameter) is set
+  if ( !layer->subsetString().isEmpty() )
+  {
+    return 0;
+  }
+
+  QgsVectorDataProvider* provider = layer->dataProvider();
+  QString sourceFile = provider ? _providerFile( provider ) : QString();
+  QDateTime sourceModified = sourceFile.isEmpty() ? QDateTime() : QFileInfo( sourceFile ).lastModified();
+
+  QHash< QgsMapLayer*, QgsSpatialIndex* >::const_iterator indexIt = mSpatialIndexes.find( layer );
+  if ( indexIt != mSpatialIndexes.constEnd() )
+  {
+    if ( mSpatialIndexFileTimes.value( layer ) == sourceModified )
+    {
+      return indexIt.value();
+    }
+    QgsMessageLog::logMessage( QString( "Layer cache: data source of layer '%1' modified, rebuilding spatial index" ).arg( layer->name() ), "Server", QgsMessageLog::INFO );
+    deleteSpatialIndex( layer );
+  }
+
+  bool cached = false;
+  Q_FOREACH ( const QgsMSLayerCacheEntry& entry, mEntries )
+  {
+    if ( entry.layerPointer == layer )
+    {
+      cached = true;
+      break;
+    }
+  }
+  if ( !cached )
+  {
+    return 0;
+  }
+
+  QgsSpatialIndex* index = 0;
+  bool indexedProvider = false;
+  for ( unsigned int i = 0; provider && i < sizeof( INDEXED_PROVIDERS ) / sizeof( INDEXED_PROVIDERS[0] ); ++i )
+  {
+    if ( provider->name() == INDEXED_PROVIDERS[i] )
+    {
+      indexedProvider = true;
+      break;
+    }
+  }
+
+  if ( indexedProvider && layer->hasGeometryType() && layer->featureCount() <= SPATIAL_INDEX_MAX_FEATURES )
+  {
+    QTime t;
+    t.start();
+    index = new QgsSpatialIndex( layer->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) ) );
+    QgsMessageLog::logMessage( QString( "Layer cache: built spatial index of layer '%1' in %2 ms" ).arg( layer->name() ).arg( t.elapsed() ), "Server", QgsMessageLog::INFO );
+  }
+
+  //layers without index are also stored, so the provider is not checked again
+  mSpatialIndexes.insert( layer, index );
+  mSpatialIndexFileTimes.insert( layer, sourceModified );
+  QObject::connect( layer, SIGNAL( editingStopped() ), this, SLOT( removeSpatialIndex() ), Qt::UniqueConnection );
+  return index;
+}
+
+void QgsMSLayerCache::removeSpatialIndex()
+{
+  QgsMapLayer* layer = qobject_cast<QgsMapLayer*>( sender() );
+  if ( layer )
+  {
+    deleteSpatialIndex( layer );
+  }
+}
+
+void QgsMSLayerCache::deleteSpatialIndex( QgsMapLayer* layer )
+{
+  delete mSpatialIndexes.take( layer );
+  mSpatialIndexFileTimes.remove( layer );
+}
+
 void QgsMSLayerCache::removeProjectFileLayers( const QString& project )
 {
   QgsMessageLog::logMessage( "Removing cache entries for project file: " + project, "Server", QgsMessageLog::INFO );
@@ -184,6 +336,7 @@ void QgsMSLayerCache::removeLeastUsedEntry()
 
 void QgsMSLayerCache::freeEntryRessources( QgsMSLayerCacheEntry& entry )
 {
+  deleteSpatialIndex( entry.layerPointer );
   delete entry.layerPointer;
 
   //remove the temporary files of a layer
@@ -222,4 +375,9 @@ void QgsMSLayerCache::logCacheContents() const
   {
     QgsMessageLog::logMessage( "Url: " + it.value().url + " Layer name: " + it.value().layerPointer->name() + " Project: " + it.value().configFile, "Server", QgsMessageLog::INFO );
   }
+
+  if ( mProviderPool )
+  {
+    mProviderPool->logContents();
+  }
 }
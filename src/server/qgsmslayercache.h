@@ -19,6 +19,7 @@
 #define QGSMSLAYERCACHE_H
 
 #include <time.h>
+#include <QDateTime>
 #include <QFileSystemWatcher>
 #include <QMultiHash>
 #include <QObject>
@@ -26,6 +27,9 @@
 #include <QString>
 
 class QgsMapLayer;
+class QgsMSProviderPool;
+class QgsSpatialIndex;
+class QgsVectorLayer;
 
 struct QgsMSLayerCacheEntry
 {
@@ -70,6 +74,20 @@ class QgsMSLayerCache: public QObject
 
     void setProjectMaxLayers( int n ) { mProjectMaxLayers = n; }
 
+    /** Returns the pool of vector data providers shared by the cached layers or null if sharing is disabled
+     * @note added in QGIS 2.12
+     */
+    QgsMSProviderPool* providerPool() const { return mProviderPool; }
+
+    /** Returns a spatial index of the features of a cached vector layer. The index is built when
+     * it is first requested and kept until the layer is removed from the cache or edited, or the
+     * file of the data source is modified. Returns null if the layer is not cached, has a subset
+     * string (e.g. from the FILTER parameter), has too many features or its provider queries
+     * a spatial index itself (e.g. databases). Indexes are disabled with QGIS_SERVER_FEATUREINFO_INDEX=0.
+     * @note added in QGIS 2.12
+     */
+    const QgsSpatialIndex* spatialIndex( QgsVectorLayer* layer );
+
     //for debugging
     void logCacheContents() const;
 
@@ -84,6 +102,8 @@ class QgsMSLayerCache: public QObject
     void removeLeastUsedEntry();
     /** Frees memory and removes temporary files of an entry*/
     void freeEntryRessources( QgsMSLayerCacheEntry& entry );
+    /** Deletes the spatial index of a layer*/
+    void deleteSpatialIndex( QgsMapLayer* layer );
 
   private:
     /** Cash entries with pair url/layer name as a key. The layer name is necessary for cases where the same
@@ -103,8 +123,23 @@ class QgsMSLayerCache: public QObject
     /** Maximum number of layers in the cache, overrides DEFAULT_MAX_N_LAYERS if larger*/
     int mProjectMaxLayers;
 
+    /** Vector data providers shared by layers with the same data source (also across projects)*/
+    QgsMSProviderPool* mProviderPool;
+
+    /** Spatial indexes of cached vector layers (null for layers which are not indexed)*/
+    QHash< QgsMapLayer*, QgsSpatialIndex* > mSpatialIndexes;
+
+    /** Modification times of the data source files when the spatial indexes were built (invalid if not file based)*/
+    QHash< QgsMapLayer*, QDateTime > mSpatialIndexFileTimes;
+
+    /** False if spatial indexes are disabled*/
+    bool mSpatialIndexesEnabled;
+
   private slots:
 
+    /** Removes the spatial index of the layer emitting the signal (e.g. after editing)*/
+    void removeSpatialIndex();
+
     /** Removes entries from a project (e.g. if a project file has changed)*/
     void removeProjectFileLayers( const QString& project );
 };
@@ -0,0 +1,224 @@
+/***************************************************************************
+                              qgsmsproviderpool.cpp
+                              ---------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmsproviderpool.h"
+#include "qgslogger.h"
+#include "qgsmessagelog.h"
+#include "qgsproviderregistry.h"
+#include "qgsvectordataprovider.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+
+//! Estimated memory of a provider without fields (handles, connection, caches)
+static const qint64 PROVIDER_BASE_MEMORY = 64 * 1024;
+//! Estimated memory per field of a provider
+static const qint64 PROVIDER_FIELD_MEMORY = 1024;
+
+QgsMSProviderPool::QgsMSProviderPool( qint64 maxIdleMemory )
+    : mMaxIdleMemory( maxIdleMemory )
+    , mIdleMemory( 0 )
+    , mUseCounter( 0 )
+{
+}
+
+QgsMSProviderPool::~QgsMSProviderPool()
+{
+  Q_FOREACH ( const Entry& entry, mEntries )
+  {
+    if ( entry.refCount > 0 )
+    {
+      QgsDebugMsg( QString( "Provider %1 still used by %2 layers" ).arg( entry.provider->dataSourceUri() ).arg( entry.refCount ) );
+    }
+    delete entry.provider;
+  }
+}
+
+bool QgsMSProviderPool::isShareable( const QString& providerKey )
+{
+  static QStringList shareableProviders = QStringList() << "postgres" << "ogr" << "spatialite" << "mssql"
+                                          << "oracle" << "db2" << "delimitedtext";
+  return shareableProviders.contains( providerKey );
+}
+
+QgsVectorDataProvider* QgsMSProviderPool::acquireProvider( const QString& providerKey, const QString& dataSource, const QString& encoding )
+{
+  if ( !isShareable( providerKey ) )
+  {
+    return 0;
+  }
+
+  QString key = providerKey + '\n' + encoding + '\n' + dataSource;
+  QgsVectorDataProvider* provider = useEntry( key );
+  if ( provider )
+  {
+    return provider;
+  }
+
+  //opening the data source may take long, so other layers are not blocked meanwhile
+  provider = ( QgsVectorDataProvider* )( QgsProviderRegistry::instance()->provider( providerKey, dataSource ) );
+  if ( !provider || !provider->isValid() )
+  {
+    delete provider;
+    return 0;
+  }
+  if ( !encoding.isEmpty() )
+  {
+    provider->setEncoding( encoding );
+  }
+
+  QMutexLocker locker( &mMutex );
+
+  //another layer may have opened the same data source in the meantime
+  if ( mEntries.contains( key ) )
+  {
+    locker.unlock();
+    delete provider;
+    return acquireProvider( providerKey, dataSource, encoding );
+  }
+
+  Entry entry;
+  entry.provider = provider;
+  entry.providerKey = providerKey;
+  entry.refCount = 1;
+  entry.lastUsed = ++mUseCounter;
+  entry.memory = estimatedMemory( provider );
+  mEntries.insert( key, entry );
+  mProviderKeys.insert( provider, key );
+
+  QgsMessageLog::logMessage( "Provider pool: created " + providerKey + " provider for " + dataSource, "Server", QgsMessageLog::INFO );
+  return provider;
+}
+
+QgsVectorDataProvider* QgsMSProviderPool::useEntry( const QString& key )
+{
+  QMutexLocker locker( &mMutex );
+
+  QHash<QString, Entry>::iterator entryIt = mEntries.find( key );
+  if ( entryIt == mEntries.end() )
+  {
+    return 0;
+  }
+
+  if ( entryIt->refCount == 0 )
+  {
+    mIdleMemory -= entryIt->memory;
+  }
+  ++entryIt->refCount;
+  entryIt->lastUsed = ++mUseCounter;
+  return entryIt->provider;
+}
+
+void QgsMSProviderPool::releaseProvider( QgsVectorDataProvider* provider )
+{
+  QMutexLocker locker( &mMutex );
+
+  QHash<QgsVectorDataProvider*, QString>::const_iterator keyIt = mProviderKeys.find( provider );
+  if ( keyIt == mProviderKeys.constEnd() )
+  {
+    QgsDebugMsg( "Provider not in pool" );
+    delete provider;
+    return;
+  }
+
+  Entry& entry = mEntries[ keyIt.value()];
+  if ( --entry.refCount > 0 )
+  {
+    return;
+  }
+
+  entry.lastUsed = ++mUseCounter;
+  mIdleMemory += entry.memory;
+  evictIdleProviders( mMaxIdleMemory );
+}
+
+void QgsMSProviderPool::setMaxIdleMemory( qint64 bytes )
+{
+  QMutexLocker locker( &mMutex );
+  mMaxIdleMemory = bytes;
+  evictIdleProviders( mMaxIdleMemory );
+}
+
+int QgsMSProviderPool::providerCount() const
+{
+  QMutexLocker locker( &mMutex );
+  return mEntries.size();
+}
+
+int QgsMSProviderPool::idleProviderCount() const
+{
+  QMutexLocker locker( &mMutex );
+  int count = 0;
+  Q_FOREACH ( const Entry& entry, mEntries )
+  {
+    if ( entry.refCount < 1 )
+    {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void QgsMSProviderPool::clearIdleProviders()
+{
+  QMutexLocker locker( &mMutex );
+  evictIdleProviders( 0 );
+}
+
+void QgsMSProviderPool::evictIdleProviders( qint64 maxIdleMemory )
+{
+  while ( mIdleMemory > maxIdleMemory )
+  {
+    QHash<QString, Entry>::iterator lowestIt = mEntries.end();
+    QHash<QString, Entry>::iterator entryIt = mEntries.begin();
+    for ( ; entryIt != mEntries.end(); ++entryIt )
+    {
+      if ( entryIt->refCount < 1 && ( lowestIt == mEntries.end() || entryIt->lastUsed < lowestIt->lastUsed ) )
+      {
+        lowestIt = entryIt;
+      }
+    }
+
+    if ( lowestIt == mEntries.end() )
+    {
+      mIdleMemory = 0;
+      return;
+    }
+
+    QgsMessageLog::logMessage( "Provider pool: removing unused " + lowestIt->providerKey + " provider for " + lowestIt->provider->dataSourceUri(), "Server", QgsMessageLog::INFO );
+    mIdleMemory -= lowestIt->memory;
+    mProviderKeys.remove( lowestIt->provider );
+    delete lowestIt->provider;
+    mEntries.erase( lowestIt );
+  }
+}
+
+qint64 QgsMSProviderPool::estimatedMemory( const QgsVectorDataProvider* provider )
+{
+  return PROVIDER_BASE_MEMORY + provider->fields().count() * PROVIDER_FIELD_MEMORY;
+}
+
+void QgsMSProviderPool::logContents() const
+{
+  QMutexLocker locker( &mMutex );
+  QgsMessageLog::logMessage( QString( "Provider pool contents (%1 bytes of unused providers):" ).arg( mIdleMemory ), "Server", QgsMessageLog::INFO );
+  QHash<QString, Entry>::const_iterator entryIt = mEntries.constBegin();
+  for ( ; entryIt != mEntries.constEnd(); ++entryIt )
+  {
+    QgsMessageLog::logMessage( QString( "Provider: %1 Uri: %2 Layers: %3" ).arg( entryIt->providerKey, entryIt->provider->dataSourceUri() ).arg( entryIt->refCount ), "Server", QgsMessageLog::INFO );
+  }
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+                              qgsmsproviderpool.h
+                              -------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMSPROVIDERPOOL_H
+#define QGSMSPROVIDERPOOL_H
+
+#include "qgsvectordataproviderpool.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * \class QgsMSProviderPool
+ * \brief Pool of vector data providers shared by the layers of all projects of the server.
+ *
+ * Providers are identified by provider key, data source URI and encoding, so projects referencing
+ * the same tables or files use one provider (with one connection and one field schema) instead of
+ * a provider per project layer. Providers are reference counted. Providers no longer used by any
+ * layer stay in the pool for layers loaded later and are deleted in least recently used order
+ * when their estimated memory exceeds the limit.
+ *
+ * The pool is owned by QgsMSLayerCache. QGIS_SERVER_PROVIDER_POOL_MEMORY sets the memory limit
+ * for unused providers in MB (default 64), QGIS_SERVER_SHARED_PROVIDERS=0 disables sharing.
+ *
+ * @note added in QGIS 2.12
+ */
+class SERVER_EXPORT QgsMSProviderPool: public QgsVectorDataProviderPool
+{
+  public:
+    /** Constructor
+     * @param maxIdleMemory memory limit (estimated, in bytes) of providers not used by a layer
+     */
+    explicit QgsMSProviderPool( qint64 maxIdleMemory );
+    ~QgsMSProviderPool();
+
+    QgsVectorDataProvider* acquireProvider( const QString& providerKey, const QString& dataSource, const QString& encoding ) override;
+    void releaseProvider( QgsVectorDataProvider* provider ) override;
+
+    //! Sets the memory limit (estimated, in bytes) of providers not used by a layer
+    void setMaxIdleMemory( qint64 bytes );
+    qint64 maxIdleMemory() const { return mMaxIdleMemory; }
+
+    //! Returns the number of providers in the pool
+    int providerCount() const;
+    //! Returns the number of providers not used by a layer
+    int idleProviderCount() const;
+
+    //! Deletes all providers not used by a layer
+    void clearIdleProviders();
+
+    //! Writes the contents of the pool to the message log (for debugging)
+    void logContents() const;
+
+    //! Returns true if providers of a provider key are shared (database and file based providers)
+    static bool isShareable( const QString& providerKey );
+
+  private:
+    struct Entry
+    {
+      QgsVectorDataProvider* provider;
+      QString providerKey;
+      int refCount;
+      quint64 lastUsed;
+      qint64 memory;
+    };
+
+    //! Returns the provider of an entry and counts the reference, null if there is no entry for the key
+    QgsVectorDataProvider* useEntry( const QString& key );
+
+    //! Deletes unused providers in least recently used order until the limit is met. Expects a locked mutex
+    void evictIdleProviders( qint64 maxIdleMemory );
+
+    //! Rough estimate of the memory used by a provider (handles, connection and field schema)
+    static qint64 estimatedMemory( const QgsVectorDataProvider* provider );
+
+    mutable QMutex mMutex;
+
+    //! Entries by provider key / encoding / data source
+    QHash<QString, Entry> mEntries;
+    //! Keys of the providers handed out by the pool
+    QHash<QgsVectorDataProvider*, QString> mProviderKeys;
+
+    qint64 mMaxIdleMemory;
+    qint64 mIdleMemory;
+    quint64 mUseCounter;
+};
+
+#endif // QGSMSPROVIDERPOOL_H
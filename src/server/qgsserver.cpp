@@ -37,6 +37,7 @@
 #include "qgsnetworkaccessmanager.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsserverlogger.h"
+#include "qgsserverrequestprofile.h"
 #include "qgseditorwidgetregistry.h"
 
 #include <QDomDocument>
@@ -45,6 +46,7 @@
 #include <QSettings>
 #include <QDateTime>
 #include <QScopedPointer>
+#include <QThreadPool>
 // TODO: remove, it's only needed by a single debug message
 #include <fcgi_stdio.h>
 #include <stdlib.h>
@@ -102,6 +104,28 @@ void QgsServer::setupNetworkAccessManager()
   nam->setCache( cache );
 }
 
+/**
+ * @brief QgsServer::setupThreadPool
+ * Layers of a GetMap request are rendered in parallel on the global thread pool.
+ * A FastCGI process serves one request at a time, so the size of the pool is the
+ * thread budget of each request. It defaults to the number of cores and can be
+ * lowered (e.g. when running many server processes) with QGIS_SERVER_MAX_THREADS.
+ */
+void QgsServer::setupThreadPool()
+{
+  char* maxThreadsEnv = getenv( "QGIS_SERVER_MAX_THREADS" );
+  if ( maxThreadsEnv )
+  {
+    bool conversionOk = false;
+    int maxThreads = QString( maxThreadsEnv ).toInt( &conversionOk );
+    if ( conversionOk && maxThreads > 0 )
+    {
+      QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+    }
+  }
+  QgsDebugMsg( QString( "Rendering thread budget: %1" ).arg( QThreadPool::globalInstance()->maxThreadCount() ) );
+}
+
 /**
  * @brief QgsServer::createRequestHandler factory, creates a request instance
  * @param captureOutput
@@ -342,6 +366,7 @@ bool QgsServer::init( int & argc, char ** argv )
 #endif
 
   setupNetworkAccessManager();
+  setupThreadPool();
   QDomImplementation::setInvalidDataPolicy( QDomImplementation::DropInvalidChars );
 
   // Instantiate the plugin directory so that providers are loaded
@@ -404,6 +429,73 @@ bool QgsServer::init( int & argc, char ** argv )
 
 
 
+void QgsServer::updateCapabilitiesCache()
+{
+  if ( !mInitialised || !mCapabilitiesCache )
+  {
+    return;
+  }
+
+  typedef QPair<QString, QString> ConfigVersionPair;
+  Q_FOREACH ( const ConfigVersionPair& document, mCapabilitiesCache->pendingDocuments() )
+  {
+    const QString& configFilePath = document.first;
+    bool projectSettings = ( document.second == "projectSettings" );
+    QString version = projectSettings ? "1.3.0" : document.second;
+
+    QTime time;
+    time.start();
+
+    //the documents contain the service URL, which is built from the CGI variables of the request
+    QMap<QString, QString> environment = mCapabilitiesCache->requestEnvironment( configFilePath );
+    QMap<QString, QByteArray> previousEnvironment;
+    QMap<QString, QString>::const_iterator envIt = environment.constBegin();
+    for ( ; envIt != environment.constEnd(); ++envIt )
+    {
+      previousEnvironment.insert( envIt.key(), qgetenv( envIt.key().toLocal8Bit().data() ) );
+      qputenv( envIt.key().toLocal8Bit().data(), envIt.value().toLocal8Bit() );
+    }
+
+    QMap<QString, QString> parameterMap;
+    parameterMap.insert( "SERVICE", "WMS" );
+    parameterMap.insert( "VERSION", version );
+    parameterMap.insert( "REQUEST", projectSettings ? "GetProjectSettings" : "GetCapabilities" );
+
+    bool built = false;
+    QgsWMSConfigParser* p = QgsConfigCache::instance()->wmsConfiguration( configFilePath, parameterMap );
+    if ( p )
+    {
+      QgsWMSServer wmsServer( configFilePath, parameterMap, p, 0, mMapRenderer, mCapabilitiesCache );
+      try
+      {
+        QDomDocument doc = wmsServer.getCapabilities( version, projectSettings );
+        mCapabilitiesCache->insertCapabilitiesDocument( configFilePath, document.second, &doc );
+        built = true;
+      }
+      catch ( QgsMapServiceException& ex )
+      {
+        QgsMessageLog::logMessage( "Capabilities of " + configFilePath + " could not be built: " + ex.message(), "Server", QgsMessageLog::WARNING );
+      }
+    }
+
+    if ( !built )
+    {
+      mCapabilitiesCache->discardPendingDocument( configFilePath, document.second );
+    }
+
+    QMap<QString, QByteArray>::const_iterator previousIt = previousEnvironment.constBegin();
+    for ( ; previousIt != previousEnvironment.constEnd(); ++previousIt )
+    {
+      qputenv( previousIt.key().toLocal8Bit().data(), previousIt.value() );
+    }
+
+    if ( built && QgsServerLogger::instance()->logLevel() < 1 )
+    {
+      QgsMessageLog::logMessage( QString( "Capabilities of %1 (%2) built in %3 ms" ).arg( configFilePath, document.second ).arg( time.elapsed() ), "Server", QgsMessageLog::INFO );
+    }
+  }
+}
+
 /**
  * @brief Handles the request
  * @param queryString
@@ -433,6 +525,8 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString queryStrin
 
   int logLevel = QgsServerLogger::instance()->logLevel();
   QTime time; //used for measuring request time if loglevel < 1
+  QgsServerRequestProfile* profile = QgsServerRequestProfile::instance();
+  profile->start();
   QgsMapLayerRegistry::instance()->removeAllMapLayers();
   mQgsApplication->processEvents();
   if ( logLevel < 1 )
@@ -507,7 +601,10 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString queryStrin
   {
     if ( serviceString == "WCS" )
     {
+      QTime configTime;
+      configTime.start();
       QgsWCSProjectParser* p = QgsConfigCache::instance()->wcsConfiguration( mConfigFilePath );
+      profile->addTime( "config", configTime.elapsed() );
       if ( !p )
       {
         theRequestHandler->setServiceException( QgsMapServiceException( "Project file error", "Error reading the project file" ) );
@@ -520,7 +617,10 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString queryStrin
     }
     else if ( serviceString == "WFS" )
     {
+      QTime configTime;
+      configTime.start();
       QgsWFSProjectParser* p = QgsConfigCache::instance()->wfsConfiguration( mConfigFilePath );
+      profile->addTime( "config", configTime.elapsed() );
       if ( !p )
       {
         theRequestHandler->setServiceException( QgsMapServiceException( "Project file error", "Error reading the project file" ) );
@@ -533,7 +633,10 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString queryStrin
     }
     else if ( serviceString == "WMS" )
     {
+      QTime configTime;
+      configTime.start();
       QgsWMSConfigParser* p = QgsConfigCache::instance()->wmsConfiguration( mConfigFilePath, parameterMap );
+      profile->addTime( "config", configTime.elapsed() );
       if ( !p )
       {
         theRequestHandler->setServiceException( QgsMapServiceException( "WMS configuration error", "There was an error reading the project file or the SLD configuration" ) );
@@ -542,6 +645,8 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString queryStrin
       {
         QgsWMSServer wmsServer( mConfigFilePath, parameterMap, p, theRequestHandler.data(), mMapRenderer, mCapabilitiesCache );
         wmsServer.executeRequest();
+        //build the capabilities of a newly loaded project ahead of time
+        mCapabilitiesCache->requestCapabilitiesDocument( mConfigFilePath, "1.3.0" );
       }
     }
     else
@@ -561,11 +666,17 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString queryStrin
   mServerInterface->clearRequestHandler( );
 #endif
 
+  if ( QgsServerRequestProfile::headerEnabled() && !theRequestHandler->headersSent() )
+  {
+    theRequestHandler->setHeader( "X-QGIS-Profile", profile->toString() );
+  }
+
   theRequestHandler->sendResponse();
 
   if ( logLevel < 1 )
   {
     QgsMessageLog::logMessage( "Request finished in " + QString::number( time.elapsed() ) + " ms", "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "Request profile: " + profile->toString(), "Server", QgsMessageLog::INFO );
   }
   // Returns the header and response bytestreams (to be used in Python bindings)
   return theRequestHandler->getResponse( );
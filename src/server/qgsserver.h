@@ -70,6 +70,13 @@ class SERVER_EXPORT QgsServer
      * @return the response headers and body QPair of QByteArray if called from python bindings, empty otherwise
      */
     QPair<QByteArray, QByteArray> handleRequest( const QString queryString = QString( ) );
+
+    /** Builds the capabilities documents which are stale because their project changed or
+     * which were requested ahead of time when a project was loaded (see QgsCapabilitiesCache).
+     * Called after the response of a request was sent, so no request waits for the documents.
+     * @note added in QGIS 2.12
+     */
+    void updateCapabilitiesCache();
     /* The following code was used to test type conversion in python bindings
     QPair<QByteArray, QByteArray> testQPair( QPair<QByteArray, QByteArray> pair );
     */
@@ -95,6 +102,8 @@ class SERVER_EXPORT QgsServer
     static QFileInfo defaultProjectFile();
     static QFileInfo defaultAdminSLD();
     static void setupNetworkAccessManager();
+    //! Limits the threads used for rendering a request, see QGIS_SERVER_MAX_THREADS
+    static void setupThreadPool();
     //! Create and return a request handler instance
     static QgsRequestHandler* createRequestHandler(
       const bool captureOutput = FALSE );
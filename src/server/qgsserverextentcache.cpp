@@ -0,0 +1,154 @@
+/***************************************************************************
+                              qgsserverextentcache.cpp
+                              ------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsserverextentcache.h"
+#include "qgsapplication.h"
+#include "qgsmessagelog.h"
+#include "qgsspatialindex.h"
+#include "qgsvectorlayer.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStringList>
+#include <QUrl>
+
+#include <stdlib.h>
+
+//! Default time (seconds) the extents of data sources which are not files are valid.
+//! Database tables may change at any time, so their extents are not cached unless configured
+static const int DEFAULT_EXTENT_MAX_AGE = 0;
+
+//! Returns the file of a file based data source or an empty string
+static QString _sourceFile( const QString& source )
+{
+  QString path = source.left( source.indexOf( '|' ) );
+  if ( path.startsWith( "file:" ) )
+  {
+    path = QUrl::fromEncoded( path.toAscii() ).toLocalFile();
+  }
+  QFileInfo fileInfo( path );
+  return fileInfo.isFile() ? fileInfo.absoluteFilePath() : QString();
+}
+
+QgsServerExtentCache::QgsServerExtentCache( const QString& filePath, int maxAge )
+    : mSettings( filePath, QSettings::IniFormat )
+    , mMaxAge( maxAge )
+    , mModified( false )
+{
+}
+
+QgsRectangle QgsServerExtentCache::layerExtent( QgsMapLayer* layer )
+{
+  QgsVectorLayer* vLayer = qobject_cast<QgsVectorLayer*>( layer );
+  if ( !vLayer || !vLayer->isValid() )
+  {
+    //raster extents are read from the file headers
+    return layer ? layer->extent() : QgsRectangle();
+  }
+
+  QString source = vLayer->source();
+  QString sourceFile = _sourceFile( source );
+  if ( sourceFile.isEmpty() && mMaxAge <= 0 )
+  {
+    return vLayer->extent();
+  }
+
+  QString key = QCryptographicHash::hash(( vLayer->providerType() + '\n' + source ).toUtf8(), QCryptographicHash::Md5 ).toHex();
+
+  //a file based extent is valid while the file content is unchanged, other extents for mMaxAge seconds
+  uint now = QDateTime::currentDateTime().toTime_t();
+  QString stamp = sourceFile.isEmpty() ? QString::number( now ) : QString::fromAscii( QgsSpatialIndex::sourceFileStamp( sourceFile ).toHex() );
+
+  mSettings.beginGroup( key );
+  QStringList coordinates = mSettings.value( "extent" ).toStringList();
+  QString cachedStamp = mSettings.value( "stamp" ).toString();
+  bool valid = coordinates.size() == 4
+               && ( sourceFile.isEmpty() ? now - cachedStamp.toUInt() < ( uint )mMaxAge : cachedStamp == stamp );
+  if ( valid )
+  {
+    mSettings.endGroup();
+    return QgsRectangle( coordinates[0].toDouble(), coordinates[1].toDouble(), coordinates[2].toDouble(), coordinates[3].toDouble() );
+  }
+
+  QgsRectangle extent = vLayer->extent();
+  coordinates.clear();
+  coordinates << QString::number( extent.xMinimum(), 'g', 17 ) << QString::number( extent.yMinimum(), 'g', 17 )
+  << QString::number( extent.xMaximum(), 'g', 17 ) << QString::number( extent.yMaximum(), 'g', 17 );
+  mSettings.setValue( "extent", coordinates );
+  mSettings.setValue( "stamp", stamp );
+  mSettings.endGroup();
+  mModified = true;
+  return extent;
+}
+
+void QgsServerExtentCache::clear()
+{
+  mSettings.clear();
+  mSettings.sync();
+  mModified = false;
+}
+
+void QgsServerExtentCache::sync()
+{
+  if ( !mModified )
+  {
+    return;
+  }
+  mSettings.sync();
+  mModified = false;
+}
+
+QgsServerExtentCache* QgsServerExtentCache::instance()
+{
+  static QgsServerExtentCache* sInstance = createFromEnvironment();
+  return sInstance;
+}
+
+QgsRectangle QgsServerExtentCache::extent( QgsMapLayer* layer )
+{
+  QgsServerExtentCache* cache = instance();
+  return cache ? cache->layerExtent( layer ) : layer->extent();
+}
+
+QgsServerExtentCache* QgsServerExtentCache::createFromEnvironment()
+{
+  QString filePath = getenv( "QGIS_SERVER_EXTENT_CACHE" );
+  if ( filePath == "0" )
+  {
+    return 0;
+  }
+  if ( filePath.isEmpty() )
+  {
+    filePath = QgsApplication::qgisSettingsDirPath() + "server_extent_cache.ini";
+  }
+
+  int maxAge = DEFAULT_EXTENT_MAX_AGE;
+  char* maxAgeEnv = getenv( "QGIS_SERVER_EXTENT_CACHE_TTL" );
+  if ( maxAgeEnv )
+  {
+    bool conversionOk = false;
+    int maxAgeInt = QString( maxAgeEnv ).toInt( &conversionOk );
+    if ( conversionOk && maxAgeInt >= 0 )
+    {
+      maxAge = maxAgeInt;
+    }
+  }
+
+  QgsMessageLog::logMessage( "Extent cache: " + filePath, "Server", QgsMessageLog::INFO );
+  return new QgsServerExtentCache( filePath, maxAge );
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+                              qgsserverextentcache.h
+                              ----------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSERVEREXTENTCACHE_H
+#define QGSSERVEREXTENTCACHE_H
+
+#include "qgsrectangle.h"
+
+#include <QSettings>
+#include <QString>
+
+class QgsMapLayer;
+
+/**
+ * \class QgsServerExtentCache
+ * \brief Persistent cache of vector layer extents for the capabilities documents.
+ *
+ * Calculating the extent of a layer can require a full scan of the data source (e.g. for
+ * PostGIS tables without estimated metadata). The cache stores the extents by provider and
+ * data source in a file, so they are calculated once and not again for every project, after
+ * project changes or after server restarts. Extents of file based data sources are valid as
+ * long as the content of the file (see QgsSpatialIndex::sourceFileStamp()) is unchanged,
+ * other extents for a configurable time.
+ *
+ * The cache file is QGIS_SERVER_EXTENT_CACHE (default: server_extent_cache.ini in the QGIS
+ * settings directory, 0 disables the cache). QGIS_SERVER_EXTENT_CACHE_TTL sets the time in
+ * seconds extents of databases are valid (default: 0, they are not cached, as tables may
+ * change at any time).
+ *
+ * Entries are identified by a hash of the provider and data source only, the data source itself
+ * (which may contain passwords) is not written to the file. New extents are kept in memory until
+ * sync() is called, which the server does once per capabilities document.
+ *
+ * @note added in QGIS 2.12
+ */
+class SERVER_EXPORT QgsServerExtentCache
+{
+  public:
+    /** Constructor
+     * @param filePath file storing the extents
+     * @param maxAge time in seconds the extents of data sources which are not files are valid,
+     * 0 to not cache them
+     */
+    QgsServerExtentCache( const QString& filePath, int maxAge );
+
+    /** Returns the extent of a layer from the cache. Extents not in the cache are calculated and stored */
+    QgsRectangle layerExtent( QgsMapLayer* layer );
+
+    //! Removes all extents
+    void clear();
+
+    //! Writes the extents calculated since the last call to the cache file
+    void sync();
+
+    /** Returns the global cache or 0 if the cache is disabled */
+    static QgsServerExtentCache* instance();
+
+    /** Returns the extent of a layer from the global cache or from the layer if the cache is disabled */
+    static QgsRectangle extent( QgsMapLayer* layer );
+
+  private:
+    static QgsServerExtentCache* createFromEnvironment();
+
+    QSettings mSettings;
+    int mMaxAge;
+    //! true if extents were added since the last sync
+    bool mModified;
+};
+
+#endif // QGSSERVEREXTENTCACHE_H
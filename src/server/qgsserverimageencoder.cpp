@@ -0,0 +1,809 @@
+/***************************************************************************
+                              qgsserverimageencoder.cpp
+                              -------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsserverimageencoder.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QtAlgorithms>
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef QList< QPair<QRgb, int> > ColorBox; //Color / number of pixels
+typedef QMultiMap< int, ColorBox > ColorBoxMap; // sum of pixels / color box
+
+//! Number of k-means iterations refining the median cut palette
+static const int KMEANS_ITERATIONS = 2;
+
+//! Bits of red / green / blue / alpha indexing the lookup table of palette colors
+static const int LOOKUP_RGB_BITS = 5;
+static const int LOOKUP_ALPHA_BITS = 4;
+
+static void splitColorBox( ColorBox& colorBox, ColorBoxMap& colorBoxMap,
+                           QMap<int, ColorBox>::iterator colorBoxMapIt );
+static bool minMaxRange( const ColorBox& colorBox, int& redRange, int& greenRange, int& blueRange, int& alphaRange );
+static bool redCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
+static bool greenCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
+static bool blueCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
+static bool alphaCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 );
+/** Calculates a representative color for a box (pixel weighted average)*/
+static QRgb boxColor( const ColorBox& box, int boxPixels );
+
+static void medianCut( QVector<QRgb>& colorTable, int nColors, const QHash<QRgb, int>& inputColors )
+{
+  if ( inputColors.size() <= nColors ) //all the colors in the image can be mapped to one palette color
+  {
+    colorTable.resize( inputColors.size() );
+    int index = 0;
+    QHash<QRgb, int>::const_iterator inputColorIt = inputColors.constBegin();
+    for ( ; inputColorIt != inputColors.constEnd(); ++inputColorIt )
+    {
+      colorTable[index] = inputColorIt.key();
+      ++index;
+    }
+    return;
+  }
+
+  //create first box
+  ColorBox firstBox; //QList< QPair<QRgb, int> >
+  int firstBoxPixelSum = 0;
+  QHash<QRgb, int>::const_iterator inputColorIt = inputColors.constBegin();
+  for ( ; inputColorIt != inputColors.constEnd(); ++inputColorIt )
+  {
+    firstBox.push_back( qMakePair( inputColorIt.key(), inputColorIt.value() ) );
+    firstBoxPixelSum += inputColorIt.value();
+  }
+
+  ColorBoxMap colorBoxMap; //QMultiMap< int, ColorBox >
+  colorBoxMap.insert( firstBoxPixelSum, firstBox );
+  QMap<int, ColorBox>::iterator colorBoxMapIt = colorBoxMap.end();
+
+  //split boxes until number of boxes == nColors or all the boxes have color count 1
+  bool allColorsMapped = false;
+  while ( colorBoxMap.size() < nColors )
+  {
+    //start at the end of colorBoxMap and pick the first entry with number of colors < 1
+    colorBoxMapIt = colorBoxMap.end();
+    while ( true )
+    {
+      --colorBoxMapIt;
+      if ( colorBoxMapIt.value().size() > 1 )
+      {
+        splitColorBox( colorBoxMapIt.value(), colorBoxMap, colorBoxMapIt );
+        break;
+      }
+      if ( colorBoxMapIt == colorBoxMap.begin() )
+      {
+        allColorsMapped = true;
+        break;
+      }
+    }
+
+    if ( allColorsMapped )
+    {
+      break;
+    }
+    else
+    {
+      continue;
+    }
+  }
+
+  //get representative colors for the boxes
+  int index = 0;
+  colorTable.resize( colorBoxMap.size() );
+  ColorBoxMap::const_iterator colorBoxIt = colorBoxMap.constBegin();
+  for ( ; colorBoxIt != colorBoxMap.constEnd(); ++colorBoxIt )
+  {
+    colorTable[index] = boxColor( colorBoxIt.value(), colorBoxIt.key() );
+    ++index;
+  }
+}
+
+static void splitColorBox( ColorBox& colorBox, ColorBoxMap& colorBoxMap,
+                           QMap<int, ColorBox>::iterator colorBoxMapIt )
+{
+
+  if ( colorBox.size() < 2 )
+  {
+    return; //need at least two colors for a split
+  }
+
+  //a,r,g,b ranges
+  int redRange = 0;
+  int greenRange = 0;
+  int blueRange = 0;
+  int alphaRange = 0;
+
+  if ( !minMaxRange( colorBox, redRange, greenRange, blueRange, alphaRange ) )
+  {
+    return;
+  }
+
+  //sort color box for a/r/g/b
+  if ( redRange >= greenRange && redRange >= blueRange && redRange >= alphaRange )
+  {
+    qSort( colorBox.begin(), colorBox.end(), redCompare );
+  }
+  else if ( greenRange >= redRange && greenRange >= blueRange && greenRange >= alphaRange )
+  {
+    qSort( colorBox.begin(), colorBox.end(), greenCompare );
+  }
+  else if ( blueRange >= redRange && blueRange >= greenRange && blueRange >= alphaRange )
+  {
+    qSort( colorBox.begin(), colorBox.end(), blueCompare );
+  }
+  else
+  {
+    qSort( colorBox.begin(), colorBox.end(), alphaCompare );
+  }
+
+  //get median
+  double halfSum = colorBoxMapIt.key() / 2.0;
+  int currentSum = 0;
+  int currentListIndex = 0;
+
+  ColorBox::iterator colorBoxIt = colorBox.begin();
+  for ( ; colorBoxIt != colorBox.end(); ++colorBoxIt )
+  {
+    currentSum += colorBoxIt->second;
+    if ( currentSum >= halfSum )
+    {
+      break;
+    }
+    ++currentListIndex;
+  }
+
+  if ( currentListIndex > ( colorBox.size() - 2 ) ) //if the median is contained in the last color, split one item before that
+  {
+    --currentListIndex;
+    currentSum -= colorBoxIt->second;
+  }
+  else
+  {
+    ++colorBoxIt; //the iterator needs to point behind the last item to remove
+  }
+
+  //do split: replace old color box, insert new one
+  ColorBox newColorBox1 = colorBox.mid( 0, currentListIndex + 1 );
+  colorBoxMap.insert( currentSum, newColorBox1 );
+
+  colorBox.erase( colorBox.begin(), colorBoxIt );
+  ColorBox newColorBox2 = colorBox;
+  colorBoxMap.erase( colorBoxMapIt );
+  colorBoxMap.insert( halfSum * 2.0 - currentSum, newColorBox2 );
+}
+
+static bool minMaxRange( const ColorBox& colorBox, int& redRange, int& greenRange, int& blueRange, int& alphaRange )
+{
+  if ( colorBox.size() < 1 )
+  {
+    return false;
+  }
+
+  int rMin = INT_MAX;
+  int gMin = INT_MAX;
+  int bMin = INT_MAX;
+  int aMin = INT_MAX;
+  int rMax = INT_MIN;
+  int gMax = INT_MIN;
+  int bMax = INT_MIN;
+  int aMax = INT_MIN;
+
+  int currentRed = 0; int currentGreen = 0; int currentBlue = 0; int currentAlpha = 0;
+
+  ColorBox::const_iterator colorBoxIt = colorBox.constBegin();
+  for ( ; colorBoxIt != colorBox.constEnd(); ++colorBoxIt )
+  {
+    currentRed = qRed( colorBoxIt->first );
+    if ( currentRed > rMax )
+    {
+      rMax = currentRed;
+    }
+    if ( currentRed < rMin )
+    {
+      rMin = currentRed;
+    }
+
+    currentGreen = qGreen( colorBoxIt->first );
+    if ( currentGreen > gMax )
+    {
+      gMax = currentGreen;
+    }
+    if ( currentGreen < gMin )
+    {
+      gMin = currentGreen;
+    }
+
+    currentBlue = qBlue( colorBoxIt->first );
+    if ( currentBlue > bMax )
+    {
+      bMax = currentBlue;
+    }
+    if ( currentBlue < bMin )
+    {
+      bMin = currentBlue;
+    }
+
+    currentAlpha = qAlpha( colorBoxIt->first );
+    if ( currentAlpha > aMax )
+    {
+      aMax = currentAlpha;
+    }
+    if ( currentAlpha < aMin )
+    {
+      aMin = currentAlpha;
+    }
+  }
+
+  redRange = rMax - rMin;
+  greenRange = gMax - gMin;
+  blueRange = bMax - bMin;
+  alphaRange = aMax - aMin;
+  return true;
+}
+
+static bool redCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 )
+{
+  return qRed( c1.first ) < qRed( c2.first );
+}
+
+static bool greenCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 )
+{
+  return qGreen( c1.first ) < qGreen( c2.first );
+}
+
+static bool blueCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 )
+{
+  return qBlue( c1.first ) < qBlue( c2.first );
+}
+
+static bool alphaCompare( const QPair<QRgb, int>& c1, const QPair<QRgb, int>& c2 )
+{
+  return qAlpha( c1.first ) < qAlpha( c2.first );
+}
+
+static QRgb boxColor( const ColorBox& box, int boxPixels )
+{
+  double avRed = 0;
+  double avGreen = 0;
+  double avBlue = 0;
+  double avAlpha = 0;
+  QRgb currentColor;
+  int currentPixel;
+
+  double weight;
+
+  ColorBox::const_iterator colorBoxIt = box.constBegin();
+  for ( ; colorBoxIt != box.constEnd(); ++colorBoxIt )
+  {
+    currentColor = colorBoxIt->first;
+    currentPixel = colorBoxIt->second;
+    weight = ( double )currentPixel / boxPixels;
+    avRed += ( qRed( currentColor ) * weight );
+    avGreen += ( qGreen( currentColor ) * weight );
+    avBlue += ( qBlue( currentColor ) * weight );
+    avAlpha += ( qAlpha( currentColor ) * weight );
+  }
+
+  return qRgba( avRed, avGreen, avBlue, avAlpha );
+}
+
+//! Returns the color of a pixel, with all fully transparent colors mapped to one color
+static inline QRgb _normalizedColor( QRgb c )
+{
+  return qAlpha( c ) == 0 ? 0 : c;
+}
+
+static inline int _colorDistance( QRgb c1, QRgb c2 )
+{
+  int dr = qRed( c1 ) - qRed( c2 );
+  int dg = qGreen( c1 ) - qGreen( c2 );
+  int db = qBlue( c1 ) - qBlue( c2 );
+  int da = qAlpha( c1 ) - qAlpha( c2 );
+  return dr * dr + dg * dg + db * db + da * da;
+}
+
+static int _nearestColor( const QVector<QRgb>& palette, QRgb c )
+{
+  int nearest = 0;
+  int minDistance = INT_MAX;
+  for ( int i = 0; i < palette.size(); ++i )
+  {
+    int d = _colorDistance( palette[i], c );
+    if ( d < minDistance )
+    {
+      minDistance = d;
+      nearest = i;
+      if ( d == 0 )
+      {
+        break;
+      }
+    }
+  }
+  return nearest;
+}
+
+/** Collects the colors of an image. Returns false (and stops) as soon as there are more than maxColors colors
+ * @param image image in ARGB32 format
+ */
+static bool _exactColors( const QImage& image, int maxColors, QHash<QRgb, int>& colors )
+{
+  QRgb lastColor = 0;
+  QHash<QRgb, int>::iterator lastIt = colors.end();
+  for ( int i = 0; i < image.height(); ++i )
+  {
+    const QRgb* line = reinterpret_cast<const QRgb*>( image.constScanLine( i ) );
+    for ( int j = 0; j < image.width(); ++j )
+    {
+      QRgb c = _normalizedColor( line[j] );
+      if ( lastIt != colors.end() && c == lastColor )
+      {
+        ++lastIt.value();
+        continue;
+      }
+      lastIt = colors.find( c );
+      if ( lastIt == colors.end() )
+      {
+        if ( colors.size() >= maxColors )
+        {
+          return false;
+        }
+        lastIt = colors.insert( c, 1 );
+      }
+      else
+      {
+        ++lastIt.value();
+      }
+      lastColor = c;
+    }
+  }
+  return true;
+}
+
+//! Histogram of a regular grid of at most maxSamples pixels
+static void _sampleColors( const QImage& image, int maxSamples, QHash<QRgb, int>& colors )
+{
+  int nPixels = image.width() * image.height();
+  int step = qMax( 1, ( int )ceil( sqrt(( double )nPixels / maxSamples ) ) );
+  for ( int i = step / 2; i < image.height(); i += step )
+  {
+    const QRgb* line = reinterpret_cast<const QRgb*>( image.constScanLine( i ) );
+    for ( int j = step / 2; j < image.width(); j += step )
+    {
+      ++colors[ _normalizedColor( line[j] )];
+    }
+  }
+}
+
+//! Moves each palette color to the weighted mean of the sample colors it represents
+static void _refinePalette( QVector<QRgb>& palette, const QHash<QRgb, int>& samples, int iterations )
+{
+  int n = palette.size();
+  QVector<double> sums( n * 5 );
+  for ( int iteration = 0; iteration < iterations; ++iteration )
+  {
+    sums.fill( 0 );
+    QHash<QRgb, int>::const_iterator sampleIt = samples.constBegin();
+    for ( ; sampleIt != samples.constEnd(); ++sampleIt )
+    {
+      QRgb c = sampleIt.key();
+      double weight = sampleIt.value();
+      double* s = sums.data() + 5 * _nearestColor( palette, c );
+      s[0] += qRed( c ) * weight;
+      s[1] += qGreen( c ) * weight;
+      s[2] += qBlue( c ) * weight;
+      s[3] += qAlpha( c ) * weight;
+      s[4] += weight;
+    }
+
+    for ( int i = 0; i < n; ++i )
+    {
+      const double* s = sums.constData() + 5 * i;
+      if ( s[4] > 0 )
+      {
+        palette[i] = qRgba( qRound( s[0] / s[4] ), qRound( s[1] / s[4] ), qRound( s[2] / s[4] ), qRound( s[3] / s[4] ) );
+      }
+    }
+  }
+}
+
+static bool _isOpaque( QRgb c )
+{
+  return qAlpha( c ) == 255;
+}
+
+/** Calculates the palette of an image in ARGB32 format
+ * @param exact set to true if the palette contains all the colors of the image
+ */
+static QVector<QRgb> _palette( const QImage& image, int nColors, int maxSamples, bool& exact )
+{
+  QVector<QRgb> colorTable;
+  QHash<QRgb, int> colors;
+  exact = _exactColors( image, nColors, colors );
+  if ( !exact )
+  {
+    colors.clear();
+    _sampleColors( image, maxSamples, colors );
+    medianCut( colorTable, nColors, colors );
+    _refinePalette( colorTable, colors, KMEANS_ITERATIONS );
+  }
+  else
+  {
+    medianCut( colorTable, nColors, colors );
+  }
+
+  //translucent colors first, so the tRNS chunk of the PNG is as short as possible
+  QVector<QRgb> sortedTable;
+  sortedTable.reserve( colorTable.size() );
+  for ( int i = 0; i < colorTable.size(); ++i )
+  {
+    if ( !_isOpaque( colorTable[i] ) )
+    {
+      sortedTable.append( colorTable[i] );
+    }
+  }
+  for ( int i = 0; i < colorTable.size(); ++i )
+  {
+    if ( _isOpaque( colorTable[i] ) )
+    {
+      sortedTable.append( colorTable[i] );
+    }
+  }
+  return sortedTable;
+}
+
+static QImage _argbImage( const QImage& image )
+{
+  if ( image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32 )
+  {
+    return image;
+  }
+  return image.convertToFormat( QImage::Format_ARGB32 );
+}
+
+//
+// PNG writer
+//
+
+//! CRC-32 lookup table of the PNG chunks
+struct CrcTable
+{
+  CrcTable()
+  {
+    for ( quint32 n = 0; n < 256; ++n )
+    {
+      quint32 c = n;
+      for ( int k = 0; k < 8; ++k )
+      {
+        c = ( c & 1 ) ? 0xedb88320u ^( c >> 1 ) : c >> 1;
+      }
+      values[n] = c;
+    }
+  }
+
+  quint32 values[256];
+};
+
+static quint32 _crc( const char* data, int length, quint32 crc = 0xffffffffu )
+{
+  static const CrcTable table;
+  for ( int i = 0; i < length; ++i )
+  {
+    crc = table.values[( crc ^ ( uchar )data[i] ) & 0xff] ^ ( crc >> 8 );
+  }
+  return crc;
+}
+
+static void _appendUInt32( QByteArray& ba, quint32 value )
+{
+  ba.append(( char )(( value >> 24 ) & 0xff ) );
+  ba.append(( char )(( value >> 16 ) & 0xff ) );
+  ba.append(( char )(( value >> 8 ) & 0xff ) );
+  ba.append(( char )( value & 0xff ) );
+}
+
+static void _appendChunk( QByteArray& png, const char* type, const char* data, int length )
+{
+  _appendUInt32( png, length );
+  int start = png.size();
+  png.append( type, 4 );
+  png.append( data, length );
+  _appendUInt32( png, _crc( png.constData() + start, length + 4 ) ^ 0xffffffffu );
+}
+
+static inline uchar _paeth( int a, int b, int c )
+{
+  int p = a + b - c;
+  int pa = abs( p - a );
+  int pb = abs( p - b );
+  int pc = abs( p - c );
+  if ( pa <= pb && pa <= pc )
+  {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+/** Writes a filtered row (filter type byte followed by the row bytes) of an image with one byte per pixel (or less)
+ * @param prior previous row or null for the first row
+ * @param type PNG filter type
+ */
+static void _filterRow( const uchar* row, const uchar* prior, int length, int type, uchar* out )
+{
+  out[0] = type;
+  ++out;
+  for ( int i = 0; i < length; ++i )
+  {
+    int a = i > 0 ? row[i - 1] : 0;
+    int b = prior ? prior[i] : 0;
+    int c = ( prior && i > 0 ) ? prior[i - 1] : 0;
+    switch ( type )
+    {
+      case 1: out[i] = row[i] - a; break;
+      case 2: out[i] = row[i] - b; break;
+      case 3: out[i] = row[i] - ( a + b ) / 2; break;
+      case 4: out[i] = row[i] - _paeth( a, b, c ); break;
+      default: out[i] = row[i]; break;
+    }
+  }
+}
+
+//! Sum of absolute differences of a filtered row (the usual heuristic for the choice of the filter)
+static int _filterCost( const uchar* filtered, int length )
+{
+  int cost = 0;
+  for ( int i = 1; i <= length; ++i )
+  {
+    cost += qAbs(( int )( signed char ) filtered[i] );
+  }
+  return cost;
+}
+
+//
+// QgsServerImageEncoder
+//
+
+QgsServerImageEncoder::QgsServerImageEncoder()
+    : mCompressionLevel( 1 )
+    , mAdaptiveFiltering( false )
+    , mMaxPaletteSamples( 16384 )
+{
+}
+
+QgsServerImageEncoder QgsServerImageEncoder::fromEnvironment()
+{
+  QgsServerImageEncoder encoder;
+  char* compressionEnv = getenv( "QGIS_SERVER_PNG_COMPRESSION" );
+  if ( compressionEnv )
+  {
+    bool conversionOk = false;
+    int level = QString( compressionEnv ).toInt( &conversionOk );
+    if ( conversionOk )
+    {
+      encoder.setCompressionLevel( level );
+    }
+  }
+  char* filterEnv = getenv( "QGIS_SERVER_PNG_FILTER" );
+  if ( filterEnv )
+  {
+    encoder.setAdaptiveFiltering( QString( filterEnv ).compare( "adaptive", Qt::CaseInsensitive ) == 0 );
+  }
+  return encoder;
+}
+
+QVector<QRgb> QgsServerImageEncoder::palette( const QImage& image, int nColors ) const
+{
+  bool exact;
+  return _palette( _argbImage( image ), qBound( 1, nColors, 256 ), mMaxPaletteSamples, exact );
+}
+
+QImage QgsServerImageEncoder::quantize( const QImage& image, int nColors ) const
+{
+  QImage argbImage = _argbImage( image );
+  bool exact;
+  QVector<QRgb> colorTable = _palette( argbImage, qBound( 1, nColors, 256 ), mMaxPaletteSamples, exact );
+
+  QImage palettedImage( argbImage.width(), argbImage.height(), QImage::Format_Indexed8 );
+  palettedImage.setColorTable( colorTable );
+
+  if ( exact )
+  {
+    QHash<QRgb, int> indexes;
+    for ( int i = 0; i < colorTable.size(); ++i )
+    {
+      indexes.insert( colorTable[i], i );
+    }
+
+    for ( int i = 0; i < argbImage.height(); ++i )
+    {
+      const QRgb* line = reinterpret_cast<const QRgb*>( argbImage.constScanLine( i ) );
+      uchar* out = palettedImage.scanLine( i );
+      QRgb lastColor = _normalizedColor( line[0] );
+      uchar lastIndex = indexes.value( lastColor );
+      for ( int j = 0; j < argbImage.width(); ++j )
+      {
+        QRgb c = _normalizedColor( line[j] );
+        if ( c != lastColor )
+        {
+          lastColor = c;
+          lastIndex = indexes.value( c );
+        }
+        out[j] = lastIndex;
+      }
+    }
+    return palettedImage;
+  }
+
+  //nearest palette colors of the cells of the color space, calculated when a cell is used first
+  const int rgbShift = 8 - LOOKUP_RGB_BITS;
+  const int alphaShift = 8 - LOOKUP_ALPHA_BITS;
+  QVector<qint16> lookup( 1 << ( 3 * LOOKUP_RGB_BITS + LOOKUP_ALPHA_BITS ), -1 );
+  qint16* lookupData = lookup.data();
+
+  for ( int i = 0; i < argbImage.height(); ++i )
+  {
+    const QRgb* line = reinterpret_cast<const QRgb*>( argbImage.constScanLine( i ) );
+    uchar* out = palettedImage.scanLine( i );
+    QRgb lastColor = 0;
+    int lastIndex = -1;
+    for ( int j = 0; j < argbImage.width(); ++j )
+    {
+      QRgb c = _normalizedColor( line[j] );
+      if ( lastIndex < 0 || c != lastColor )
+      {
+        int cell = (( qRed( c ) >> rgbShift ) << ( 2 * LOOKUP_RGB_BITS + LOOKUP_ALPHA_BITS ) )
+                   | (( qGreen( c ) >> rgbShift ) << ( LOOKUP_RGB_BITS + LOOKUP_ALPHA_BITS ) )
+                   | (( qBlue( c ) >> rgbShift ) << LOOKUP_ALPHA_BITS )
+                   | ( qAlpha( c ) >> alphaShift );
+        if ( lookupData[cell] < 0 )
+        {
+          lookupData[cell] = _nearestColor( colorTable, c );
+        }
+        lastColor = c;
+        lastIndex = lookupData[cell];
+      }
+      out[j] = lastIndex;
+    }
+  }
+  return palettedImage;
+}
+
+QByteArray QgsServerImageEncoder::encodePng8( const QImage& image ) const
+{
+  return encodePng( quantize( image, 256 ) );
+}
+
+QByteArray QgsServerImageEncoder::encodePng1( const QImage& image ) const
+{
+  return encodePng( image.convertToFormat( QImage::Format_Mono, Qt::MonoOnly | Qt::ThresholdDither |
+                    Qt::ThresholdAlphaDither | Qt::NoOpaqueDetection ) );
+}
+
+QByteArray QgsServerImageEncoder::encodePng( const QImage& image ) const
+{
+  QImage img = image;
+  if ( img.format() == QImage::Format_MonoLSB )
+  {
+    img = img.convertToFormat( QImage::Format_Mono );
+  }
+
+  int bitDepth;
+  if ( img.format() == QImage::Format_Indexed8 )
+  {
+    bitDepth = 8;
+  }
+  else if ( img.format() == QImage::Format_Mono )
+  {
+    bitDepth = 1;
+  }
+  else
+  {
+    return QByteArray();
+  }
+
+  int width = img.width();
+  int height = img.height();
+  int rowBytes = ( width * bitDepth + 7 ) / 8;
+
+  QVector<QRgb> colorTable = img.colorTable();
+  int nColors = bitDepth == 8 ? 256 : 2;
+  if ( colorTable.size() > nColors )
+  {
+    colorTable.resize( nColors );
+  }
+  if ( colorTable.isEmpty() )
+  {
+    colorTable << qRgb( 0, 0, 0 ) << qRgb( 255, 255, 255 );
+  }
+
+  //rows with filter type bytes
+  QByteArray raw( height * ( rowBytes + 1 ), 0 );
+  uchar* rawData = reinterpret_cast<uchar*>( raw.data() );
+  QByteArray candidate( mAdaptiveFiltering ? rowBytes + 1 : 0, 0 );
+  uchar* candidateData = reinterpret_cast<uchar*>( candidate.data() );
+  for ( int i = 0; i < height; ++i )
+  {
+    const uchar* row = img.constScanLine( i );
+    const uchar* prior = i > 0 ? img.constScanLine( i - 1 ) : 0;
+    uchar* out = rawData + i * ( rowBytes + 1 );
+    if ( !mAdaptiveFiltering )
+    {
+      out[0] = 0;
+      memcpy( out + 1, row, rowBytes );
+      continue;
+    }
+
+    _filterRow( row, prior, rowBytes, 0, out );
+    int minCost = _filterCost( out, rowBytes );
+    for ( int type = 1; type <= 4; ++type )
+    {
+      _filterRow( row, prior, rowBytes, type, candidateData );
+      int cost = _filterCost( candidateData, rowBytes );
+      if ( cost < minCost )
+      {
+        minCost = cost;
+        memcpy( out, candidateData, rowBytes + 1 );
+      }
+    }
+  }
+
+  QByteArray png;
+  png.reserve( raw.size() / 2 + 1024 );
+  png.append( "\x89PNG\r\n\x1a\n", 8 );
+
+  QByteArray header;
+  _appendUInt32( header, width );
+  _appendUInt32( header, height );
+  header.append(( char )bitDepth );
+  header.append(( char )3 ); //color type: paletted
+  header.append(( char )0 ); //compression
+  header.append(( char )0 ); //filter method
+  header.append(( char )0 ); //no interlace
+  _appendChunk( png, "IHDR", header.constData(), header.size() );
+
+  QByteArray plte;
+  QByteArray trns;
+  int lastTranslucent = -1;
+  for ( int i = 0; i < colorTable.size(); ++i )
+  {
+    QRgb c = colorTable[i];
+    plte.append(( char )qRed( c ) );
+    plte.append(( char )qGreen( c ) );
+    plte.append(( char )qBlue( c ) );
+    trns.append(( char )qAlpha( c ) );
+    if ( qAlpha( c ) != 255 )
+    {
+      lastTranslucent = i;
+    }
+  }
+  _appendChunk( png, "PLTE", plte.constData(), plte.size() );
+  if ( lastTranslucent >= 0 )
+  {
+    _appendChunk( png, "tRNS", trns.constData(), lastTranslucent + 1 );
+  }
+
+  //qCompress prepends the uncompressed size to the zlib stream
+  QByteArray compressed = qCompress( raw, mCompressionLevel );
+  _appendChunk( png, "IDAT", compressed.constData() + 4, compressed.size() - 4 );
+  _appendChunk( png, "IEND", 0, 0 );
+  return png;
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+                              qgsserverimageencoder.h
+                              -----------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSERVERIMAGEENCODER_H
+#define QGSSERVERIMAGEENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+
+/**
+ * \class QgsServerImageEncoder
+ * \brief Encodes the paletted PNG images of the server (GetMap with 'image/png; mode=8bit' and 'mode=1bit').
+ *
+ * The palette is calculated with median cut on a subsample of the image pixels and refined with
+ * k-means iterations on the same sample. Images with fewer colors than the palette size get
+ * their exact colors. Pixels are mapped to the palette through a lookup table of the color space.
+ *
+ * The PNG data is written directly, using a zlib compression level tuned for speed. Filtering of
+ * the rows is optional (PNG recommends no filtering for paletted images).
+ *
+ * The encoder of the server is configured with the environment variables QGIS_SERVER_PNG_COMPRESSION
+ * (zlib level 0-9, default 1) and QGIS_SERVER_PNG_FILTER ('adaptive' enables filtering).
+ *
+ * @note added in QGIS 2.12
+ */
+class QgsServerImageEncoder
+{
+  public:
+    QgsServerImageEncoder();
+
+    //! Creates an encoder configured with environment variables
+    static QgsServerImageEncoder fromEnvironment();
+
+    //! Sets the zlib compression level (0-9, -1 for the zlib default)
+    void setCompressionLevel( int level ) { mCompressionLevel = qBound( -1, level, 9 ); }
+    //! Returns the zlib compression level
+    int compressionLevel() const { return mCompressionLevel; }
+
+    /** Sets whether a filter is chosen for each row (minimum sum of absolute differences).
+     * If disabled, the rows are not filtered.
+     */
+    void setAdaptiveFiltering( bool enabled ) { mAdaptiveFiltering = enabled; }
+    //! Returns whether a filter is chosen for each row
+    bool adaptiveFiltering() const { return mAdaptiveFiltering; }
+
+    //! Sets the maximum number of pixels sampled to calculate a palette
+    void setMaxPaletteSamples( int samples ) { mMaxPaletteSamples = qMax( samples, 1 ); }
+    //! Returns the maximum number of pixels sampled to calculate a palette
+    int maxPaletteSamples() const { return mMaxPaletteSamples; }
+
+    /** Calculates a palette of at most nColors colors (not premultiplied) for an image
+     * @param image input image
+     * @param nColors maximum number of colors, at most 256
+     */
+    QVector<QRgb> palette( const QImage& image, int nColors = 256 ) const;
+
+    /** Converts an image to an 8 bit image with a palette of at most nColors colors
+     * @param image input image
+     * @param nColors maximum number of colors, at most 256
+     */
+    QImage quantize( const QImage& image, int nColors = 256 ) const;
+
+    //! Encodes an image as 8 bit paletted PNG
+    QByteArray encodePng8( const QImage& image ) const;
+
+    //! Encodes an image as 1 bit PNG
+    QByteArray encodePng1( const QImage& image ) const;
+
+    /** Encodes an 8 bit indexed or 1 bit image as PNG, using its color table as palette.
+     * Returns an empty array for images of other formats.
+     */
+    QByteArray encodePng( const QImage& image ) const;
+
+  private:
+    int mCompressionLevel;
+    bool mAdaptiveFiltering;
+    int mMaxPaletteSamples;
+};
+
+#endif // QGSSERVERIMAGEENCODER_H
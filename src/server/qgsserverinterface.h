@@ -23,6 +23,7 @@
 #include "qgscapabilitiescache.h"
 #include "qgsrequesthandler.h"
 #include "qgsserverfilter.h"
+#include "qgsserverrequestprofile.h"
 
 /**
  * \ingroup server
@@ -101,6 +102,13 @@ class SERVER_EXPORT QgsServerInterface
      */
     virtual void setConfigFilePath( QString configFilePath ) = 0;
 
+    /**
+     * Get pointer to the profile of the current request (timings of its stages and layers)
+     * @return QgsServerRequestProfile
+     * @note added in QGIS 2.12
+     */
+    virtual QgsServerRequestProfile* requestProfile() = 0;
+
   private:
     QString mConfigFilePath;
 };
@@ -55,6 +55,7 @@ class QgsServerInterfaceImpl : public QgsServerInterface
     QString configFilePath( ) override { return mConfigFilePath; }
     void setConfigFilePath( QString configFilePath ) override;
     void setFilters( QgsServerFiltersMap *filters ) override;
+    QgsServerRequestProfile* requestProfile() override { return QgsServerRequestProfile::instance(); }
 
   private:
 
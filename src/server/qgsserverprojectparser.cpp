@@ -25,6 +25,7 @@
 #include "qgsmaplayerregistry.h"
 #include "qgsmslayercache.h"
 #include "qgsrasterlayer.h"
+#include "qgsserverrequestprofile.h"
 #include "qgseditorwidgetregistry.h"
 
 #include <QDomDocument>
@@ -238,6 +239,7 @@ QgsMapLayer* QgsServerProjectParser::createLayerFromElement( const QDomElement&
     if ( layer->type() == QgsMapLayer::VectorLayer )
       addValueRelationLayersForLayer( dynamic_cast<QgsVectorLayer *>( layer ) );
 
+    QgsServerRequestProfile::instance()->addCount( "layer_cache_hits" );
     return layer;
   }
 
@@ -271,8 +273,12 @@ QgsMapLayer* QgsServerProjectParser::createLayerFromElement( const QDomElement&
       QObject::connect( layer, SIGNAL( readCustomSymbology( const QDomElement&, QString& ) ), QgsEditorWidgetRegistry::instance(), SLOT( readSymbology( const QDomElement&, QString& ) ) );
     }
 
+    QTime loadTime;
+    loadTime.start();
     layer->readLayerXML( const_cast<QDomElement&>( elem ) ); //should be changed to const in QgsMapLayer
     layer->setLayerName( layerName( elem ) );
+    QgsServerRequestProfile::instance()->addTime( "layer_load", loadTime.elapsed() );
+    QgsServerRequestProfile::instance()->addCount( "layers_loaded" );
 
     if ( layer->type() == QgsMapLayer::VectorLayer )
     {
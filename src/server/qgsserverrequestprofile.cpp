@@ -0,0 +1,130 @@
+/***************************************************************************
+                              qgsserverrequestprofile.cpp
+                              ---------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsserverrequestprofile.h"
+
+#include <QRegExp>
+#include <QStringList>
+#include <stdlib.h>
+
+//! stages in the order they are written by toString()
+static const char* STAGES[] = { "config", "layer_load", "render", "labeling", "encoding" };
+
+//! layer IDs are written as part of a key, so they must not contain separators
+static QString _key( const QString& layerId )
+{
+  QString key = layerId;
+  key.replace( QRegExp( "[\\s=]" ), "_" );
+  return key;
+}
+
+QgsServerRequestProfile::QgsServerRequestProfile()
+{
+  mStart.start();
+}
+
+QgsServerRequestProfile* QgsServerRequestProfile::instance()
+{
+  static QgsServerRequestProfile profile;
+  return &profile;
+}
+
+bool QgsServerRequestProfile::headerEnabled()
+{
+  static int enabled = -1;
+  if ( enabled < 0 )
+  {
+    bool ok;
+    int value = QString( getenv( "QGIS_SERVER_PROFILE" ) ).toInt( &ok );
+    enabled = ok && value > 0 ? 1 : 0;
+  }
+  return enabled == 1;
+}
+
+void QgsServerRequestProfile::start()
+{
+  mTimes.clear();
+  mCounts.clear();
+  mLayerRenderingTimes.clear();
+  mLayerFeatureCounts.clear();
+  mStart.start();
+}
+
+int QgsServerRequestProfile::elapsed() const
+{
+  return mStart.elapsed();
+}
+
+void QgsServerRequestProfile::addTime( const QString& stage, int ms )
+{
+  mTimes[stage] += ms;
+}
+
+void QgsServerRequestProfile::addCount( const QString& name, int count )
+{
+  mCounts[name] += count;
+}
+
+void QgsServerRequestProfile::addLayerRenderingTime( const QString& layerId, int ms )
+{
+  mLayerRenderingTimes[layerId] += ms;
+}
+
+void QgsServerRequestProfile::addLayerFeatureCount( const QString& layerId, int count )
+{
+  mLayerFeatureCounts[layerId] += count;
+}
+
+QString QgsServerRequestProfile::toString() const
+{
+  QStringList items;
+  items << QString( "total=%1" ).arg( elapsed() );
+
+  QMap<QString, int> times = mTimes;
+  for ( unsigned int i = 0; i < sizeof( STAGES ) / sizeof( STAGES[0] ); ++i )
+  {
+    if ( times.contains( STAGES[i] ) )
+      items << QString( "%1=%2" ).arg( STAGES[i] ).arg( times.take( STAGES[i] ) );
+  }
+  // stages added by plugins
+  for ( QMap<QString, int>::const_iterator it = times.constBegin(); it != times.constEnd(); ++it )
+  {
+    items << QString( "%1=%2" ).arg( _key( it.key() ) ).arg( it.value() );
+  }
+
+  for ( QMap<QString, int>::const_iterator it = mCounts.constBegin(); it != mCounts.constEnd(); ++it )
+  {
+    items << QString( "%1=%2" ).arg( _key( it.key() ) ).arg( it.value() );
+  }
+
+  QStringList layerIds = mLayerRenderingTimes.keys();
+  Q_FOREACH ( const QString& layerId, mLayerFeatureCounts.keys() )
+  {
+    if ( !mLayerRenderingTimes.contains( layerId ) )
+      layerIds << layerId;
+  }
+  Q_FOREACH ( const QString& layerId, layerIds )
+  {
+    QString key = _key( layerId );
+    if ( mLayerRenderingTimes.contains( layerId ) )
+      items << QString( "layer.%1.render=%2" ).arg( key ).arg( mLayerRenderingTimes.value( layerId ) );
+    if ( mLayerFeatureCounts.contains( layerId ) )
+      items << QString( "layer.%1.features=%2" ).arg( key ).arg( mLayerFeatureCounts.value( layerId ) );
+  }
+
+  return items.join( " " );
+}
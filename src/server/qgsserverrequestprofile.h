@@ -0,0 +1,95 @@
+/***************************************************************************
+                              qgsserverrequestprofile.h
+                              -------------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSERVERREQUESTPROFILE_H
+#define QGSSERVERREQUESTPROFILE_H
+
+#include <QMap>
+#include <QString>
+#include <QTime>
+
+/**
+ * \class QgsServerRequestProfile
+ * \brief Timings and counters collected while the server processes a request.
+ *
+ * The profile of the current request is reset by QgsServer when a request starts. Stage times
+ * (in milliseconds) are collected for the configuration cache lookup ("config"), reading of
+ * layers ("layer_load"), map rendering ("render"), labeling ("labeling") and image encoding
+ * ("encoding"), together with rendering time and fetched features of each layer.
+ *
+ * If the log level is 0, the profile is written to the server log when the request is finished.
+ * If the QGIS_SERVER_PROFILE environment variable is set to 1, it is also returned in the
+ * X-QGIS-Profile response header. Server plugins access it with QgsServerInterface::requestProfile()
+ * (e.g. in QgsServerFilter::responseComplete()).
+ *
+ * @note added in QGIS 2.12
+ */
+class SERVER_EXPORT QgsServerRequestProfile
+{
+  public:
+    QgsServerRequestProfile();
+
+    //! Returns the profile of the request currently processed
+    static QgsServerRequestProfile* instance();
+
+    //! Returns true if the profile should be sent in a response header (QGIS_SERVER_PROFILE=1)
+    static bool headerEnabled();
+
+    //! Clears the profile and starts measuring the total time of a new request
+    void start();
+
+    //! Returns the time elapsed since start() in milliseconds
+    int elapsed() const;
+
+    //! Adds time in milliseconds to a stage of the request (e.g. "render")
+    void addTime( const QString& stage, int ms );
+    //! Returns the time spent in a stage in milliseconds
+    int time( const QString& stage ) const { return mTimes.value( stage ); }
+    //! Returns the times of all stages
+    QMap<QString, int> times() const { return mTimes; }
+
+    //! Increments a counter (e.g. "layers_loaded")
+    void addCount( const QString& name, int count = 1 );
+    //! Returns the value of a counter
+    int count( const QString& name ) const { return mCounts.value( name ); }
+    //! Returns all counters
+    QMap<QString, int> counts() const { return mCounts; }
+
+    //! Adds the rendering time (in milliseconds) of a layer
+    void addLayerRenderingTime( const QString& layerId, int ms );
+    //! Returns the rendering times of the layers, keyed by layer ID
+    QMap<QString, int> layerRenderingTimes() const { return mLayerRenderingTimes; }
+
+    //! Adds the number of features fetched for rendering a layer
+    void addLayerFeatureCount( const QString& layerId, int count );
+    //! Returns the number of features fetched for rendering each layer, keyed by layer ID
+    QMap<QString, int> layerFeatureCounts() const { return mLayerFeatureCounts; }
+
+    /** Returns the profile as a single line of space separated key=value pairs, e.g.
+     * "total=120 config=1 layer_load=12 render=95 labeling=20 encoding=8 layers_loaded=2 layer.roads.render=60 layer.roads.features=1530"
+     */
+    QString toString() const;
+
+  private:
+    QTime mStart;
+    QMap<QString, int> mTimes;
+    QMap<QString, int> mCounts;
+    QMap<QString, int> mLayerRenderingTimes;
+    QMap<QString, int> mLayerFeatureCounts;
+};
+
+#endif // QGSSERVERREQUESTPROFILE_H
@@ -16,17 +16,28 @@ email                : marco.hugentobler at sourcepole dot com
 #include "qgsserverstreamingdevice.h"
 #include "qgsrequesthandler.h"
 
-QgsServerStreamingDevice::QgsServerStreamingDevice( const QString& formatName, QgsRequestHandler* rh, QObject* parent ): QIODevice( parent ), mFormatName( formatName ), mRequestHandler( rh )
+#include <cstring>
+
+QgsServerStreamingDevice::QgsServerStreamingDevice( const QString& formatName, QgsRequestHandler* rh, QObject* parent, int bufferSize )
+    : QIODevice( parent )
+    , mFormatName( formatName )
+    , mRequestHandler( rh )
+    , mBuffer( qMax( bufferSize, 0 ), '\0' )
+    , mBufferUsed( 0 )
 {
 }
 
-QgsServerStreamingDevice::QgsServerStreamingDevice(): QIODevice( 0 ), mRequestHandler( 0 )
+QgsServerStreamingDevice::QgsServerStreamingDevice(): QIODevice( 0 ), mRequestHandler( 0 ), mBufferUsed( 0 )
 {
 
 }
 
 QgsServerStreamingDevice::~QgsServerStreamingDevice()
 {
+  if ( isOpen() )
+  {
+    close();
+  }
 }
 
 bool QgsServerStreamingDevice::open( OpenMode mode )
@@ -43,13 +54,39 @@ bool QgsServerStreamingDevice::open( OpenMode mode )
 
 void QgsServerStreamingDevice::close()
 {
+  flush();
   QIODevice::close();
 }
 
-qint64 QgsServerStreamingDevice::writeData( const char * data, qint64 maxSize )
+void QgsServerStreamingDevice::flush()
 {
-  QByteArray ba( data, maxSize );
+  if ( mBufferUsed < 1 || !mRequestHandler )
+  {
+    return;
+  }
+
+  QByteArray ba = QByteArray::fromRawData( mBuffer.constData(), mBufferUsed );
   mRequestHandler->setGetFeatureResponse( &ba );
+  mBufferUsed = 0;
+}
+
+qint64 QgsServerStreamingDevice::writeData( const char * data, qint64 maxSize )
+{
+  if ( mBufferUsed + maxSize > mBuffer.size() )
+  {
+    flush();
+  }
+
+  if ( maxSize >= mBuffer.size() )
+  {
+    //does not fit into the buffer, send it without copying
+    QByteArray ba = QByteArray::fromRawData( data, maxSize );
+    mRequestHandler->setGetFeatureResponse( &ba );
+    return maxSize;
+  }
+
+  memcpy( mBuffer.data() + mBufferUsed, data, maxSize );
+  mBufferUsed += maxSize;
   return maxSize;
 }
 
@@ -16,14 +16,25 @@ email                : marco.hugentobler at sourcepole dot com
 #ifndef QGSSERVERSTREAMINGDEVICE_H
 #define QGSSERVERSTREAMINGDEVICE_H
 
+#include <QByteArray>
 #include <QIODevice>
 
 class QgsRequestHandler;
 
+/** Write only device sending the written data to the request handler in chunks.
+ * Data is collected in an output buffer of fixed size, so the memory used does not
+ * depend on the size of the response.
+ */
 class QgsServerStreamingDevice: public QIODevice
 {
   public:
-    QgsServerStreamingDevice( const QString& formatName, QgsRequestHandler* rh, QObject* parent = 0 );
+    /** Constructor
+     * @param formatName content type of the response
+     * @param rh request handler receiving the data (does not take ownership)
+     * @param parent parent object
+     * @param bufferSize size of the output buffer in bytes, 0 sends every write immediately
+     */
+    QgsServerStreamingDevice( const QString& formatName, QgsRequestHandler* rh, QObject* parent = 0, int bufferSize = 64 * 1024 );
     ~QgsServerStreamingDevice();
 
     bool isSequential() const override { return false; }
@@ -31,9 +42,15 @@ class QgsServerStreamingDevice: public QIODevice
     bool open( OpenMode mode ) override;
     void close() override;
 
+    //! Sends the buffered data to the request handler
+    void flush();
+
   protected:
     QString mFormatName;
     QgsRequestHandler* mRequestHandler;
+    QByteArray mBuffer;
+    //! Number of bytes of mBuffer in use
+    int mBufferUsed;
 
     QgsServerStreamingDevice(); //default constructor forbidden
 
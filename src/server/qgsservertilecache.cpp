@@ -0,0 +1,201 @@
+/***************************************************************************
+                              qgsservertilecache.cpp
+                              ----------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsservertilecache.h"
+#include "qgsmessagelog.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+#include <stdlib.h>
+
+QgsServerTileCache* QgsServerTileCache::mInstance = 0;
+bool QgsServerTileCache::mInitialized = false;
+QMutex QgsServerTileCache::mInstanceMutex;
+
+QgsServerTileCache* QgsServerTileCache::instance()
+{
+  QMutexLocker locker( &mInstanceMutex );
+  if ( !mInitialized )
+  {
+    mInstance = createFromEnvironment();
+    mInitialized = true;
+  }
+  return mInstance;
+}
+
+void QgsServerTileCache::setInstance( QgsServerTileCache* cache )
+{
+  QMutexLocker locker( &mInstanceMutex );
+  if ( cache != mInstance )
+  {
+    delete mInstance;
+  }
+  mInstance = cache;
+  mInitialized = true;
+}
+
+QgsServerTileCache* QgsServerTileCache::createFromEnvironment()
+{
+  QString cacheType = getenv( "QGIS_SERVER_TILE_CACHE" );
+  if ( cacheType.isEmpty() )
+  {
+    return 0;
+  }
+
+  if ( cacheType.compare( "memory", Qt::CaseInsensitive ) == 0 )
+  {
+    int maxSize = 256; //MB
+    char* cacheSizeEnv = getenv( "QGIS_SERVER_TILE_CACHE_SIZE" );
+    if ( cacheSizeEnv )
+    {
+      bool conversionOk = false;
+      int cacheSize = QString( cacheSizeEnv ).toInt( &conversionOk );
+      if ( conversionOk && cacheSize > 0 )
+      {
+        maxSize = cacheSize;
+      }
+    }
+    QgsMessageLog::logMessage( QString( "Tile cache: memory, %1 MB" ).arg( maxSize ), "Server", QgsMessageLog::INFO );
+    return new QgsServerMemoryTileCache( maxSize * 1024 );
+  }
+
+  QgsMessageLog::logMessage( "Tile cache: directory " + cacheType, "Server", QgsMessageLog::INFO );
+  return new QgsServerDiskTileCache( cacheType );
+}
+
+
+QgsServerMemoryTileCache::QgsServerMemoryTileCache( int maxSize )
+    : mTiles( maxSize )
+{
+}
+
+QImage QgsServerMemoryTileCache::tile( const QString& projectPath, const QByteArray& key )
+{
+  QMutexLocker locker( &mMutex );
+  QImage* image = mTiles.object( cacheKey( projectPath, key ) );
+  return image ? *image : QImage();
+}
+
+void QgsServerMemoryTileCache::insertTile( const QString& projectPath, const QByteArray& key, const QImage& image )
+{
+  QMutexLocker locker( &mMutex );
+  //cost in kB
+  mTiles.insert( cacheKey( projectPath, key ), new QImage( image ), qMax( 1, image.byteCount() / 1024 ) );
+}
+
+void QgsServerMemoryTileCache::removeProject( const QString& projectPath )
+{
+  QMutexLocker locker( &mMutex );
+  QByteArray prefix = cacheKey( projectPath, QByteArray() );
+  Q_FOREACH ( const QByteArray& key, mTiles.keys() )
+  {
+    if ( key.startsWith( prefix ) )
+    {
+      mTiles.remove( key );
+    }
+  }
+}
+
+QByteArray QgsServerMemoryTileCache::cacheKey( const QString& projectPath, const QByteArray& key )
+{
+  return projectPath.toUtf8() + '\n' + key;
+}
+
+
+QgsServerDiskTileCache::QgsServerDiskTileCache( const QString& directory )
+    : mDirectory( directory )
+{
+  QDir().mkpath( mDirectory );
+}
+
+QImage QgsServerDiskTileCache::tile( const QString& projectPath, const QByteArray& key )
+{
+  QString filePath = tileFilePath( projectPath, key );
+  if ( !QFile::exists( filePath ) )
+  {
+    return QImage();
+  }
+  return QImage( filePath, "PNG" );
+}
+
+void QgsServerDiskTileCache::insertTile( const QString& projectPath, const QByteArray& key, const QImage& image )
+{
+  QString filePath = tileFilePath( projectPath, key );
+  QDir().mkpath( QFileInfo( filePath ).absolutePath() );
+
+  //write to a temporary file with a unique name first, so that other server processes and threads
+  //writing the same tile never read partial tiles or write into the same file
+  QTemporaryFile tmpFile( filePath + ".XXXXXX" );
+  if ( !tmpFile.open() || !image.save( &tmpFile, "PNG", 100 ) )
+  {
+    QgsMessageLog::logMessage( "Tile cache: cannot write " + tmpFile.fileName(), "Server", QgsMessageLog::WARNING );
+    return;
+  }
+  tmpFile.close();
+  QFile::remove( filePath );
+  if ( QFile::rename( tmpFile.fileName(), filePath ) )
+  {
+    tmpFile.setAutoRemove( false );
+  }
+}
+
+void QgsServerDiskTileCache::removeProject( const QString& projectPath )
+{
+  removeDirectory( projectDirectory( projectPath ) );
+}
+
+QString QgsServerDiskTileCache::projectDirectory( const QString& projectPath ) const
+{
+  QByteArray hash = QCryptographicHash::hash( QFileInfo( projectPath ).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1 );
+  return mDirectory + "/" + QString::fromAscii( hash.toHex() );
+}
+
+QString QgsServerDiskTileCache::tileFilePath( const QString& projectPath, const QByteArray& key ) const
+{
+  QString modified = QString::number( QFileInfo( projectPath ).lastModified().toMSecsSinceEpoch() );
+  QByteArray hash = QCryptographicHash::hash( key, QCryptographicHash::Sha1 ).toHex();
+  //two levels of directories to keep the number of files per directory low
+  return projectDirectory( projectPath ) + "/" + modified + "/" + QString::fromAscii( hash.left( 2 ) ) + "/" + QString::fromAscii( hash ) + ".png";
+}
+
+void QgsServerDiskTileCache::removeDirectory( const QString& path )
+{
+  QDir dir( path );
+  if ( !dir.exists() )
+  {
+    return;
+  }
+
+  Q_FOREACH ( const QFileInfo& info, dir.entryInfoList( QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden ) )
+  {
+    if ( info.isDir() )
+    {
+      removeDirectory( info.absoluteFilePath() );
+    }
+    else
+    {
+      QFile::remove( info.absoluteFilePath() );
+    }
+  }
+  dir.rmdir( path );
+}
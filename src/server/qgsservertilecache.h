@@ -0,0 +1,130 @@
+/***************************************************************************
+                              qgsservertilecache.h
+                              --------------------
+  Date                 : October 2015
+  Copyright            : (C) 2015 by the QGIS project
+  Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSERVERTILECACHE_H
+#define QGSSERVERTILECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/**
+ * \class QgsServerTileCache
+ * \brief Cache for map tiles rendered by the WMS server.
+ *
+ * Tile aligned GetMap requests are rendered as metatiles, which are sliced into tiles
+ * and stored in the cache (see QgsWMSServer). Tiles are stored by project file and by a
+ * key describing the request. All tiles of a project are removed when QgsConfigCache
+ * notices a change of the project file.
+ *
+ * The global cache is configured with environment variables: QGIS_SERVER_TILE_CACHE
+ * is either "memory" (memory cache, QGIS_SERVER_TILE_CACHE_SIZE sets its size in MB)
+ * or a directory for a disk cache. Tile caching is disabled if it is not set. Other
+ * caches can be installed with setInstance().
+ *
+ * @note added in QGIS 2.12
+ */
+class SERVER_EXPORT QgsServerTileCache
+{
+  public:
+    virtual ~QgsServerTileCache() {}
+
+    /** Returns a cached tile or a null image if the tile is not in the cache
+     * @param projectPath project file of the request
+     * @param key identifies the tile within the project
+     */
+    virtual QImage tile( const QString& projectPath, const QByteArray& key ) = 0;
+
+    /** Stores a tile in the cache */
+    virtual void insertTile( const QString& projectPath, const QByteArray& key, const QImage& image ) = 0;
+
+    /** Removes all tiles of a project */
+    virtual void removeProject( const QString& projectPath ) = 0;
+
+    /** Returns the global tile cache or 0 if tile caching is disabled */
+    static QgsServerTileCache* instance();
+
+    /** Replaces the global tile cache. Takes ownership of the cache, 0 disables tile caching. */
+    static void setInstance( QgsServerTileCache* cache );
+
+  private:
+    static QgsServerTileCache* createFromEnvironment();
+
+    static QgsServerTileCache* mInstance;
+    static bool mInitialized;
+    //! protects the lazy creation and replacement of the global cache
+    static QMutex mInstanceMutex;
+};
+
+
+/**
+ * \class QgsServerMemoryTileCache
+ * \brief Tile cache keeping the tiles in memory, least recently used tiles are removed first.
+ * @note added in QGIS 2.12
+ */
+class SERVER_EXPORT QgsServerMemoryTileCache : public QgsServerTileCache
+{
+  public:
+    /** Constructor
+     * @param maxSize maximum size of the cached tiles in kB
+     */
+    explicit QgsServerMemoryTileCache( int maxSize = 256 * 1024 );
+
+    QImage tile( const QString& projectPath, const QByteArray& key ) override;
+    void insertTile( const QString& projectPath, const QByteArray& key, const QImage& image ) override;
+    void removeProject( const QString& projectPath ) override;
+
+  private:
+    static QByteArray cacheKey( const QString& projectPath, const QByteArray& key );
+
+    QCache<QByteArray, QImage> mTiles;
+    QMutex mMutex;
+};
+
+
+/**
+ * \class QgsServerDiskTileCache
+ * \brief Tile cache storing the tiles as PNG files in a directory.
+ *
+ * Tiles are stored in a sub directory per project and modification time of the project
+ * file, so tiles written before the project was changed are not used even if the server
+ * was not running when the file changed.
+ * @note added in QGIS 2.12
+ */
+class SERVER_EXPORT QgsServerDiskTileCache : public QgsServerTileCache
+{
+  public:
+    /** Constructor
+     * @param directory directory for the tiles, it is created if necessary
+     */
+    explicit QgsServerDiskTileCache( const QString& directory );
+
+    QImage tile( const QString& projectPath, const QByteArray& key ) override;
+    void insertTile( const QString& projectPath, const QByteArray& key, const QImage& image ) override;
+    void removeProject( const QString& projectPath ) override;
+
+  private:
+    QString projectDirectory( const QString& projectPath ) const;
+    QString tileFilePath( const QString& projectPath, const QByteArray& key ) const;
+    static void removeDirectory( const QString& path );
+
+    QString mDirectory;
+};
+
+#endif // QGSSERVERTILECACHE_H
@@ -557,6 +557,15 @@ void QgsSLDConfigParser::drawOverlays( QPainter* p, int dpi, int width, int heig
   }
 }
 
+bool QgsSLDConfigParser::hasOverlays() const
+{
+  if ( mFallbackParser )
+  {
+    return mFallbackParser->hasOverlays();
+  }
+  return false;
+}
+
 void QgsSLDConfigParser::loadLabelSettings( QgsLabelingEngineInterface * lbl ) const
 {
   if ( mFallbackParser )
@@ -79,6 +79,8 @@ class QgsSLDConfigParser : public QgsWMSConfigParser
     /** Draw text annotation items from the QGIS projectfile*/
     void drawOverlays( QPainter* p, int dpi, int width, int height ) const override;
 
+    bool hasOverlays() const override;
+
     /** Load PAL engine settings from projectfile*/
     void loadLabelSettings( QgsLabelingEngineInterface* lbl ) const override;
 
@@ -65,11 +65,246 @@ static const QString GML_NAMESPACE = "http://www.opengis.net/gml";
 static const QString OGC_NAMESPACE = "http://www.opengis.net/ogc";
 static const QString QGS_NAMESPACE = "http://www.qgis.org/gml";
 
+//size of the output buffer of GetFeature responses
+static const int GETFEATURE_BUFFER_SIZE = 64 * 1024;
+
+/* GML of GetFeature responses is written as text with the same layout
+ * as QDomDocument::toByteArray(), without building DOM nodes */
+
+//escapes the characters not allowed in XML text and attribute values and drops
+//the characters which are not allowed in XML documents at all
+static QString _xmlEscaped( const QString& text )
+{
+  QString escaped;
+  escaped.reserve( text.size() );
+  for ( int i = 0; i < text.size(); ++i )
+  {
+    QChar c = text.at( i );
+    ushort code = c.unicode();
+    if (( code < 0x20 && code != 0x9 && code != 0xA && code != 0xD ) || code == 0xFFFE || code == 0xFFFF )
+      continue;
+    else if ( c == '<' )
+      escaped += "&lt;";
+    else if ( c == '>' )
+      escaped += "&gt;";
+    else if ( c == '&' )
+      escaped += "&amp;";
+    else if ( c == '"' )
+      escaped += "&quot;";
+    else
+      escaped += c;
+  }
+  return escaped;
+}
+
+static void _appendLine( QString& gml, int indent, const QString& line )
+{
+  gml += QString( indent, ' ' );
+  gml += line;
+  gml += '\n';
+}
+
+static QString _srsNameAttribute( const QString& srsName )
+{
+  return srsName.isEmpty() ? QString() : " srsName=\"" + srsName + "\"";
+}
+
+//bounding box as GML2 Box or GML3 Envelope
+static void _appendGMLBoundingBox( QString& gml, int indent, const QgsRectangle& box, bool gml3, int prec, const QString& srsName )
+{
+  if ( gml3 )
+  {
+    _appendLine( gml, indent, "<gml:Envelope" + _srsNameAttribute( srsName ) + ">" );
+    _appendLine( gml, indent + 1, "<gml:lowerCorner>" + qgsDoubleToString( box.xMinimum(), prec ) + " " + qgsDoubleToString( box.yMinimum(), prec ) + "</gml:lowerCorner>" );
+    _appendLine( gml, indent + 1, "<gml:upperCorner>" + qgsDoubleToString( box.xMaximum(), prec ) + " " + qgsDoubleToString( box.yMaximum(), prec ) + "</gml:upperCorner>" );
+    _appendLine( gml, indent, "</gml:Envelope>" );
+  }
+  else
+  {
+    _appendLine( gml, indent, "<gml:Box" + _srsNameAttribute( srsName ) + ">" );
+    _appendLine( gml, indent + 1, "<gml:coordinates cs=\",\" ts=\" \">" + qgsDoubleToString( box.xMinimum(), prec ) + "," + qgsDoubleToString( box.yMinimum(), prec ) + " "
+                 + qgsDoubleToString( box.xMaximum(), prec ) + "," + qgsDoubleToString( box.yMaximum(), prec ) + "</gml:coordinates>" );
+    _appendLine( gml, indent, "</gml:Box>" );
+  }
+}
+
+//reads nPoints points from wkbPtr and appends them as coordinate element
+static void _appendGMLCoordinates( QString& gml, int indent, QgsConstWkbPtr& wkbPtr, int nPoints, bool hasZValue, bool gml3, bool position, int prec )
+{
+  QString cs = gml3 ? " " : ",";
+  QString coordString;
+  for ( int idx = 0; idx < nPoints; ++idx )
+  {
+    if ( idx != 0 )
+    {
+      coordString += ' ';
+    }
+
+    double x, y;
+    wkbPtr >> x >> y;
+    coordString += qgsDoubleToString( x, prec ) + cs + qgsDoubleToString( y, prec );
+
+    if ( hasZValue )
+    {
+      wkbPtr += sizeof( double );
+    }
+  }
+
+  if ( !gml3 )
+    _appendLine( gml, indent, "<gml:coordinates cs=\",\" ts=\" \">" + coordString + "</gml:coordinates>" );
+  else if ( position )
+    _appendLine( gml, indent, "<gml:pos srsDimension=\"2\">" + coordString + "</gml:pos>" );
+  else
+    _appendLine( gml, indent, "<gml:posList srsDimension=\"2\">" + coordString + "</gml:posList>" );
+}
+
+static void _appendGMLPolygonRings( QString& gml, int indent, QgsConstWkbPtr& wkbPtr, int numRings, bool hasZValue, bool gml3, int prec )
+{
+  for ( int idx = 0; idx < numRings; ++idx )
+  {
+    QString boundaryName = idx == 0 ? "gml:outerBoundaryIs" : "gml:innerBoundaryIs";
+    _appendLine( gml, indent, "<" + boundaryName + ">" );
+    _appendLine( gml, indent + 1, "<gml:LinearRing>" );
+    int nPoints;
+    wkbPtr >> nPoints;
+    _appendGMLCoordinates( gml, indent + 2, wkbPtr, nPoints, hasZValue, gml3, false, prec );
+    _appendLine( gml, indent + 1, "</gml:LinearRing>" );
+    _appendLine( gml, indent, "</" + boundaryName + ">" );
+  }
+}
+
+/* Geometry as GML2 or GML3, with the same elements as QgsOgcUtils::geometryToGML().
+ * Returns false if the geometry can not be written. */
+static bool _appendGMLGeometry( QString& gml, int indent, const QgsGeometry* geometry, bool gml3, int prec, const QString& srsName )
+{
+  if ( !geometry || !geometry->asWkb() )
+    return false;
+
+  QgsConstWkbPtr wkbPtr( geometry->asWkb() + 1 + sizeof( int ) );
+  QString srsAttribute = _srsNameAttribute( srsName );
+  bool hasZValue = false;
+
+  switch ( geometry->wkbType() )
+  {
+    case QGis::WKBPoint25D:
+    case QGis::WKBPoint:
+    {
+      _appendLine( gml, indent, "<gml:Point" + srsAttribute + ">" );
+      _appendGMLCoordinates( gml, indent + 1, wkbPtr, 1, false, gml3, true, prec );
+      _appendLine( gml, indent, "</gml:Point>" );
+      return true;
+    }
+    case QGis::WKBMultiPoint25D:
+      hasZValue = true;
+      //intentional fall-through
+    case QGis::WKBMultiPoint:
+    {
+      int nPoints;
+      wkbPtr >> nPoints;
+
+      _appendLine( gml, indent, "<gml:MultiPoint" + srsAttribute + ">" );
+      for ( int idx = 0; idx < nPoints; ++idx )
+      {
+        wkbPtr += 1 + sizeof( int );
+        _appendLine( gml, indent + 1, "<gml:pointMember>" );
+        _appendLine( gml, indent + 2, "<gml:Point>" );
+        _appendGMLCoordinates( gml, indent + 3, wkbPtr, 1, hasZValue, gml3, true, prec );
+        _appendLine( gml, indent + 2, "</gml:Point>" );
+        _appendLine( gml, indent + 1, "</gml:pointMember>" );
+      }
+      _appendLine( gml, indent, "</gml:MultiPoint>" );
+      return true;
+    }
+    case QGis::WKBLineString25D:
+      hasZValue = true;
+      //intentional fall-through
+    case QGis::WKBLineString:
+    {
+      int nPoints;
+      wkbPtr >> nPoints;
+
+      _appendLine( gml, indent, "<gml:LineString" + srsAttribute + ">" );
+      _appendGMLCoordinates( gml, indent + 1, wkbPtr, nPoints, hasZValue, gml3, false, prec );
+      _appendLine( gml, indent, "</gml:LineString>" );
+      return true;
+    }
+    case QGis::WKBMultiLineString25D:
+      hasZValue = true;
+      //intentional fall-through
+    case QGis::WKBMultiLineString:
+    {
+      int nLines;
+      wkbPtr >> nLines;
+
+      _appendLine( gml, indent, "<gml:MultiLineString" + srsAttribute + ">" );
+      for ( int jdx = 0; jdx < nLines; ++jdx )
+      {
+        wkbPtr += 1 + sizeof( int );
+        int nPoints;
+        wkbPtr >> nPoints;
+
+        _appendLine( gml, indent + 1, "<gml:lineStringMember>" );
+        _appendLine( gml, indent + 2, "<gml:LineString>" );
+        _appendGMLCoordinates( gml, indent + 3, wkbPtr, nPoints, hasZValue, gml3, false, prec );
+        _appendLine( gml, indent + 2, "</gml:LineString>" );
+        _appendLine( gml, indent + 1, "</gml:lineStringMember>" );
+      }
+      _appendLine( gml, indent, "</gml:MultiLineString>" );
+      return true;
+    }
+    case QGis::WKBPolygon25D:
+      hasZValue = true;
+      //intentional fall-through
+    case QGis::WKBPolygon:
+    {
+      int numRings;
+      wkbPtr >> numRings;
+
+      if ( numRings == 0 ) // sanity check for zero rings in polygon
+        return false;
+
+      _appendLine( gml, indent, "<gml:Polygon" + srsAttribute + ">" );
+      _appendGMLPolygonRings( gml, indent + 1, wkbPtr, numRings, hasZValue, gml3, prec );
+      _appendLine( gml, indent, "</gml:Polygon>" );
+      return true;
+    }
+    case QGis::WKBMultiPolygon25D:
+      hasZValue = true;
+      //intentional fall-through
+    case QGis::WKBMultiPolygon:
+    {
+      int numPolygons;
+      wkbPtr >> numPolygons;
+
+      _appendLine( gml, indent, "<gml:MultiPolygon" + srsAttribute + ">" );
+      for ( int kdx = 0; kdx < numPolygons; ++kdx )
+      {
+        wkbPtr += 1 + sizeof( int );
+        int numRings;
+        wkbPtr >> numRings;
+        if ( numRings == 0 )
+          continue;
+
+        _appendLine( gml, indent + 1, "<gml:polygonMember>" );
+        _appendLine( gml, indent + 2, "<gml:Polygon>" );
+        _appendGMLPolygonRings( gml, indent + 3, wkbPtr, numRings, hasZValue, gml3, prec );
+        _appendLine( gml, indent + 2, "</gml:Polygon>" );
+        _appendLine( gml, indent + 1, "</gml:polygonMember>" );
+      }
+      _appendLine( gml, indent, "</gml:MultiPolygon>" );
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
 QgsWFSServer::QgsWFSServer( const QString& configFilePath, QMap<QString, QString> &parameters, QgsWFSProjectParser* cp,
                             QgsRequestHandler* rh )
     : QgsOWSServer( configFilePath, parameters, rh )
     , mWithGeom( true )
     , mConfigParser( cp )
+    , mGetFeatureDevice( 0 )
 {
 }
 
@@ -77,11 +312,13 @@ QgsWFSServer::QgsWFSServer()
     : QgsOWSServer( QString(), QMap<QString, QString>(), 0 )
     , mWithGeom( true )
     , mConfigParser( 0 )
+    , mGetFeatureDevice( 0 )
 {
 }
 
 QgsWFSServer::~QgsWFSServer()
 {
+  delete mGetFeatureDevice;
 }
 
 void QgsWFSServer::executeRequest()
@@ -1102,15 +1339,21 @@ int QgsWFSServer::getFeature( QgsRequestHandler& request, const QString& format
 
 void QgsWFSServer::startGetFeature( QgsRequestHandler& request, const QString& format, int prec, QgsCoordinateReferenceSystem& crs, QgsRectangle* rect )
 {
-  QByteArray result;
+  //features are written to the response through a buffer of fixed size while they are read
+  delete mGetFeatureDevice;
+  mGetFeatureDevice = new QgsServerStreamingDevice( format == "GeoJSON" ? "text/plain; charset=utf-8" : "text/xml; charset=utf-8", &request, 0, GETFEATURE_BUFFER_SIZE );
+  if ( !mGetFeatureDevice->open( QIODevice::WriteOnly ) )
+  {
+    throw QgsMapServiceException( "Internal server error", "Error opening output device for writing" );
+  }
+
   QString fcString;
   if ( format == "GeoJSON" )
   {
     fcString = "{\"type\": \"FeatureCollection\",\n";
     fcString += " \"bbox\": [ " + qgsDoubleToString( rect->xMinimum(), prec ) + ", " + qgsDoubleToString( rect->yMinimum(), prec ) + ", " + qgsDoubleToString( rect->xMaximum(), prec ) + ", " + qgsDoubleToString( rect->yMaximum(), prec ) + "],\n";
     fcString += " \"features\": [\n";
-    result = fcString.toUtf8();
-    request.startGetFeatureResponse( &result, format );
+    writeGetFeature( fcString );
   }
   else
   {
@@ -1193,49 +1436,25 @@ void QgsWFSServer::startGetFeature( QgsRequestHandler& request, const QString& f
     fcString += " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"";
     fcString += " xsi:schemaLocation=\"" + WFS_NAMESPACE + " http://schemas.opengis.net/wfs/1.0.0/wfs.xsd " + QGS_NAMESPACE + " " + hrefString.replace( "&", "&amp;" ) + "\"";
     fcString += ">";
-    result = fcString.toUtf8();
-    request.startGetFeatureResponse( &result, format );
+    writeGetFeature( fcString );
 
-    QDomDocument doc;
-    QDomElement bbElem = doc.createElement( "gml:boundedBy" );
-    if ( format == "GML3" )
+    if ( rect )
     {
-      QDomElement envElem = QgsOgcUtils::rectangleToGMLEnvelope( rect, doc, prec );
-      if ( !envElem.isNull() )
-      {
-        if ( crs.isValid() )
-        {
-          envElem.setAttribute( "srsName", crs.authid() );
-        }
-        bbElem.appendChild( envElem );
-        doc.appendChild( bbElem );
-      }
-    }
-    else
-    {
-      QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( rect, doc, prec );
-      if ( !boxElem.isNull() )
-      {
-        if ( crs.isValid() )
-        {
-          boxElem.setAttribute( "srsName", crs.authid() );
-        }
-        bbElem.appendChild( boxElem );
-        doc.appendChild( bbElem );
-      }
+      QString bbString;
+      _appendLine( bbString, 0, "<gml:boundedBy>" );
+      _appendGMLBoundingBox( bbString, 1, *rect, format == "GML3", prec, crs.isValid() ? crs.authid() : QString() );
+      _appendLine( bbString, 0, "</gml:boundedBy>" );
+      writeGetFeature( bbString );
     }
-    result = doc.toByteArray();
-    request.setGetFeatureResponse( &result );
   }
-  fcString = "";
 }
 
 void QgsWFSServer::setGetFeature( QgsRequestHandler& request, const QString& format, QgsFeature* feat, int featIdx, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes ) /*const*/
 {
+  Q_UNUSED( request );
   if ( !feat->isValid() )
     return;
 
-  QByteArray result;
   if ( format == "GeoJSON" )
   {
     QString fcString;
@@ -1246,50 +1465,36 @@ void QgsWFSServer::setGetFeature( QgsRequestHandler& request, const QString& for
     fcString += createFeatureGeoJSON( feat, prec, crs, attrIndexes, excludedAttributes );
     fcString += "\n";
 
-    result = fcString.toUtf8();
-    request.setGetFeatureResponse( &result );
-    fcString = "";
+    writeGetFeature( fcString );
   }
   else
   {
-    QDomDocument gmlDoc;
-    QDomElement featureElement;
-    if ( format == "GML3" )
-    {
-      featureElement = createFeatureGML3( feat, gmlDoc, prec, crs, attrIndexes, excludedAttributes );
-      gmlDoc.appendChild( featureElement );
-    }
-    else
-    {
-      featureElement = createFeatureGML2( feat, gmlDoc, prec, crs, attrIndexes, excludedAttributes );
-      gmlDoc.appendChild( featureElement );
-    }
-
-    result = gmlDoc.toByteArray();
-    request.setGetFeatureResponse( &result );
-    gmlDoc.removeChild( featureElement );
+    writeGetFeature( createFeatureGML( feat, format == "GML3", prec, crs, attrIndexes, excludedAttributes ) );
   }
 }
 
 void QgsWFSServer::endGetFeature( QgsRequestHandler& request, const QString& format )
 {
-  QByteArray result;
-  QString fcString;
+  Q_UNUSED( request );
   if ( format == "GeoJSON" )
   {
-    fcString += " ]\n";
-    fcString += "}";
-
-    result = fcString.toUtf8();
-    request.endGetFeatureResponse( &result );
-    fcString = "";
+    writeGetFeature( " ]\n}" );
   }
   else
   {
-    fcString = "</wfs:FeatureCollection>";
-    result = fcString.toUtf8();
-    request.endGetFeatureResponse( &result );
-    fcString = "";
+    writeGetFeature( "</wfs:FeatureCollection>" );
+  }
+
+  //sends the rest of the buffer
+  delete mGetFeatureDevice;
+  mGetFeatureDevice = 0;
+}
+
+void QgsWFSServer::writeGetFeature( const QString& text )
+{
+  if ( mGetFeatureDevice )
+  {
+    mGetFeatureDevice->write( text.toUtf8() );
   }
 }
 
@@ -1765,127 +1970,50 @@ QString QgsWFSServer::createFeatureGeoJSON( QgsFeature* feat, int prec, QgsCoord
   return fStr;
 }
 
-QDomElement QgsWFSServer::createFeatureGML2( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes ) /*const*/
+QString QgsWFSServer::createFeatureGML( QgsFeature* feat, bool gml3, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/
 {
-  //gml:FeatureMember
-  QDomElement featureElement = doc.createElement( "gml:featureMember"/*wfs:FeatureMember*/ );
-
-  //qgs:%TYPENAME%
-  QDomElement typeNameElement = doc.createElement( "qgs:" + mTypeName /*qgs:%TYPENAME%*/ );
-  typeNameElement.setAttribute( "fid", mTypeName + "." + QString::number( feat->id() ) );
-  featureElement.appendChild( typeNameElement );
+  QString fid = _xmlEscaped( mTypeName + "." + QString::number( feat->id() ) );
 
-  if ( mWithGeom && mGeometryName != "NONE" )
-  {
-    //add geometry column (as gml)
-    QgsGeometry* geom = feat->geometry();
-
-    QDomElement geomElem = doc.createElement( "qgs:geometry" );
-    QDomElement gmlElem;
-    if ( mGeometryName == "EXTENT" )
-    {
-      QgsGeometry* bbox = QgsGeometry::fromRect( geom->boundingBox() );
-      gmlElem = QgsOgcUtils::geometryToGML( bbox , doc, prec );
-      delete bbox;
-    }
-    else if ( mGeometryName == "CENTROID" )
-    {
-      QgsGeometry* centroid = geom->centroid();
-      gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, prec );
-      delete centroid;
-    }
-    else
-      gmlElem = QgsOgcUtils::geometryToGML( geom, doc, prec );
-    if ( !gmlElem.isNull() )
-    {
-      QgsRectangle box = geom->boundingBox();
-      QDomElement bbElem = doc.createElement( "gml:boundedBy" );
-      QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( &box, doc, prec );
-
-      if ( crs.isValid() )
-      {
-        boxElem.setAttribute( "srsName", crs.authid() );
-        gmlElem.setAttribute( "srsName", crs.authid() );
-      }
-
-      bbElem.appendChild( boxElem );
-      typeNameElement.appendChild( bbElem );
-
-      geomElem.appendChild( gmlElem );
-      typeNameElement.appendChild( geomElem );
-    }
-  }
-
-  //read all attribute values from the feature
-  QgsAttributes featureAttributes = feat->attributes();
-  const QgsFields* fields = feat->fields();
-  for ( int i = 0; i < attrIndexes.count(); ++i )
-  {
-    int idx = attrIndexes[i];
-    QString attributeName = fields->at( idx ).name();
-    //skip attribute if it is excluded from WFS publication
-    if ( excludedAttributes.contains( attributeName ) )
-    {
-      continue;
-    }
-
-    QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( QString( " " ), QString( "_" ) ) );
-    QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-    fieldElem.appendChild( fieldText );
-    typeNameElement.appendChild( fieldElem );
-  }
-
-  return featureElement;
-}
-
-QDomElement QgsWFSServer::createFeatureGML3( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes ) /*const*/
-{
   //gml:FeatureMember
-  QDomElement featureElement = doc.createElement( "gml:featureMember"/*wfs:FeatureMember*/ );
+  QString gml;
+  _appendLine( gml, 0, "<gml:featureMember>" );
 
   //qgs:%TYPENAME%
-  QDomElement typeNameElement = doc.createElement( "qgs:" + mTypeName /*qgs:%TYPENAME%*/ );
-  typeNameElement.setAttribute( "gml:id", mTypeName + "." + QString::number( feat->id() ) );
-  featureElement.appendChild( typeNameElement );
+  _appendLine( gml, 1, "<qgs:" + mTypeName + ( gml3 ? " gml:id=\"" : " fid=\"" ) + fid + "\">" );
 
-  if ( mWithGeom && mGeometryName != "NONE" )
+  const QgsGeometry* geom = feat->constGeometry();
+  if ( geom && mWithGeom && mGeometryName != "NONE" )
   {
     //add geometry column (as gml)
-    QgsGeometry* geom = feat->geometry();
+    QString srsName = crs.isValid() ? crs.authid() : QString();
+    QgsRectangle box = geom->boundingBox();
 
-    QDomElement geomElem = doc.createElement( "qgs:geometry" );
-    QDomElement gmlElem;
+    QString geomString;
+    bool geomOk;
     if ( mGeometryName == "EXTENT" )
     {
-      QgsGeometry* bbox = QgsGeometry::fromRect( geom->boundingBox() );
-      gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, "GML3", prec );
+      QgsGeometry* bbox = QgsGeometry::fromRect( box );
+      geomOk = _appendGMLGeometry( geomString, 3, bbox, gml3, prec, srsName );
       delete bbox;
     }
     else if ( mGeometryName == "CENTROID" )
     {
       QgsGeometry* centroid = geom->centroid();
-      gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, "GML3", prec );
+      geomOk = _appendGMLGeometry( geomString, 3, centroid, gml3, prec, srsName );
       delete centroid;
     }
     else
-      gmlElem = QgsOgcUtils::geometryToGML( geom, doc, "GML3", prec );
-    if ( !gmlElem.isNull() )
-    {
-      QgsRectangle box = geom->boundingBox();
-      QDomElement bbElem = doc.createElement( "gml:boundedBy" );
-      QDomElement boxElem = QgsOgcUtils::rectangleToGMLEnvelope( &box, doc, prec );
+      geomOk = _appendGMLGeometry( geomString, 3, geom, gml3, prec, srsName );
 
-      if ( crs.isValid() )
-      {
-        boxElem.setAttribute( "srsName", crs.authid() );
-        gmlElem.setAttribute( "srsName", crs.authid() );
-      }
-
-      bbElem.appendChild( boxElem );
-      typeNameElement.appendChild( bbElem );
+    if ( geomOk )
+    {
+      _appendLine( gml, 2, "<gml:boundedBy>" );
+      _appendGMLBoundingBox( gml, 3, box, gml3, prec, srsName );
+      _appendLine( gml, 2, "</gml:boundedBy>" );
 
-      geomElem.appendChild( gmlElem );
-      typeNameElement.appendChild( geomElem );
+      _appendLine( gml, 2, "<qgs:geometry>" );
+      gml += geomString;
+      _appendLine( gml, 2, "</qgs:geometry>" );
     }
   }
 
@@ -1902,13 +2030,17 @@ QDomElement QgsWFSServer::createFeatureGML3( QgsFeature* feat, QDomDocument& doc
       continue;
     }
 
-    QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( QString( " " ), QString( "_" ) ) );
-    QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-    fieldElem.appendChild( fieldText );
-    typeNameElement.appendChild( fieldElem );
+    QString elementName = "qgs:" + attributeName.replace( QString( " " ), QString( "_" ) );
+    QString value = _xmlEscaped( featureAttributes[idx].toString() );
+    if ( value.isEmpty() )
+      _appendLine( gml, 2, "<" + elementName + "/>" );
+    else
+      _appendLine( gml, 2, "<" + elementName + ">" + value + "</" + elementName + ">" );
   }
 
-  return featureElement;
+  _appendLine( gml, 1, "</qgs:" + mTypeName + ">" );
+  _appendLine( gml, 0, "</gml:featureMember>" );
+  return gml;
 }
 
 QString QgsWFSServer::serviceUrl() const
@@ -45,6 +45,7 @@ class QgsRectangle;
 class QgsGeometry;
 class QgsSymbol;
 class QgsRequestHandler;
+class QgsServerStreamingDevice;
 class QFile;
 class QFont;
 class QImage;
@@ -102,11 +103,16 @@ class QgsWFSServer: public QgsOWSServer
 
     QgsWFSProjectParser* mConfigParser;
 
+    /* Output device of the running GetFeature response */
+    QgsServerStreamingDevice* mGetFeatureDevice;
+
   protected:
 
     void startGetFeature( QgsRequestHandler& request, const QString& format, int prec, QgsCoordinateReferenceSystem& crs, QgsRectangle* rect );
     void setGetFeature( QgsRequestHandler& request, const QString& format, QgsFeature* feat, int featIdx, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes );
     void endGetFeature( QgsRequestHandler& request, const QString& format );
+    /** Writes text of the GetFeature response to the output device*/
+    void writeGetFeature( const QString& text );
 
     //method for transaction
     QgsFeatureIds getFeatureIdsFromFilter( QDomElement filter, QgsVectorLayer* layer );
@@ -114,11 +120,8 @@ class QgsWFSServer: public QgsOWSServer
     //methods to write GeoJSON
     QString createFeatureGeoJSON( QgsFeature* feat, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes ) /*const*/;
 
-    //methods to write GML2
-    QDomElement createFeatureGML2( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes ) /*const*/;
-
-    //methods to write GML3
-    QDomElement createFeatureGML3( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, QgsAttributeList attrIndexes, QSet<QString> excludedAttributes ) /*const*/;
+    //methods to write GML2 and GML3
+    QString createFeatureGML( QgsFeature* feat, bool gml3, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/;
 
     void addTransactionResult( QDomDocument& responseDoc, QDomElement& responseElem, const QString& status, const QString& locator, const QString& message );
 };
@@ -78,6 +78,12 @@ class SERVER_EXPORT QgsWMSConfigParser
     /** Draw text annotation items from the QGIS projectfile*/
     virtual void drawOverlays( QPainter* p, int dpi, int width, int height ) const = 0;
 
+    /** Returns true if drawOverlays() draws anything. Overlays are placed relative to the whole
+     * image, so maps with overlays cannot be cut from larger images
+     * @note added in QGIS 2.12
+     */
+    virtual bool hasOverlays() const { return true; }
+
     /** Load PAL engine settings from the QGIS projectfile*/
     virtual void loadLabelSettings( QgsLabelingEngineInterface* lbl ) const = 0;
 
@@ -25,6 +25,7 @@
 #include "qgsmapserviceexception.h"
 #include "qgspallabeling.h"
 #include "qgsrendererv2.h"
+#include "qgsserverextentcache.h"
 #include "qgsvectorlayer.h"
 
 #include "qgscomposition.h"
@@ -1082,7 +1083,7 @@ void QgsWMSProjectParser::addLayers( QDomDocument &doc,
         QgsConfigParserUtils::appendCRSElementsToLayer( layerElem, doc, crsList, mProjectParser->supportedOutputCrsList() );
 
         //Ex_GeographicBoundingBox
-        QgsConfigParserUtils::appendLayerBoundingBoxes( layerElem, doc, currentLayer->extent(), currentLayer->crs() );
+        QgsConfigParserUtils::appendLayerBoundingBoxes( layerElem, doc, QgsServerExtentCache::extent( currentLayer ), currentLayer->crs() );
       }
 
       // add details about supported styles of the layer
@@ -1424,7 +1425,7 @@ void QgsWMSProjectParser::addOWSLayers( QDomDocument &doc,
       QgsCoordinateTransform t( layerCrs, projectCrs );
 
       //transform
-      QgsRectangle BBox = t.transformBoundingBox( currentLayer->extent() );
+      QgsRectangle BBox = t.transformBoundingBox( QgsServerExtentCache::extent( currentLayer ) );
       if ( combinedBBox.isEmpty() )
       {
         combinedBBox = BBox;
@@ -1828,6 +1829,11 @@ bool QgsWMSProjectParser::featureInfoFormatSIA2045() const
   return false;
 }
 
+bool QgsWMSProjectParser::hasOverlays() const
+{
+  return !mTextAnnotationItems.isEmpty() || !mSvgAnnotationElems.isEmpty();
+}
+
 void QgsWMSProjectParser::drawOverlays( QPainter* p, int dpi, int width, int height ) const
 {
   Q_UNUSED( width );
@@ -29,7 +29,11 @@
 #include "qgsmaplayerlegend.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaprenderer.h"
+#include "qgsmaprendererparalleljob.h"
+#include "qgsmslayercache.h"
+#include "qgsmapsettings.h"
 #include "qgsmaptopixel.h"
+#include "qgspallabeling.h"
 #include "qgsproject.h"
 #include "qgsrasteridentifyresult.h"
 #include "qgsrasterlayer.h"
@@ -47,7 +51,12 @@
 #include "qgsogcutils.h"
 #include "qgsfeature.h"
 #include "qgseditorwidgetregistry.h"
+#include "qgsserverextentcache.h"
+#include "qgsserverrequestprofile.h"
 #include "qgsserverstreamingdevice.h"
+#include "qgsservertilecache.h"
+#include "qgsspatialindex.h"
+#include "qgsexpressioncontext.h"
 
 #include <QImage>
 #include <QPainter>
@@ -63,6 +72,8 @@
 #include <QSvgGenerator>
 #include <QUrl>
 #include <QPaintEngine>
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
 QgsWMSServer::QgsWMSServer( const QString& configFilePath, QMap<QString, QString> &parameters, QgsWMSConfigParser* cp,
                             QgsRequestHandler* rh, QgsMapRenderer* renderer, QgsCapabilitiesCache* capCache )
@@ -182,7 +193,11 @@ void QgsWMSServer::executeRequest()
     QImage* result = 0;
     try
     {
-      result = getMap();
+      result = getMapFromTileCache();
+      if ( !result )
+      {
+        result = getMap();
+      }
     }
     catch ( QgsMapServiceException& ex )
     {
@@ -554,6 +569,12 @@ QDomDocument QgsWMSServer::getCapabilities( QString version, bool fullProjectInf
   }
   QgsDebugMsg( "layersAndStylesCapabilities returned" );
 
+  //write the layer extents calculated for this document at once
+  if ( QgsServerExtentCache* extentCache = QgsServerExtentCache::instance() )
+  {
+    extentCache->sync();
+  }
+
 #if 0
   //for debugging: save the document to disk
   QFile capabilitiesFile( QDir::tempPath() + "/capabilities.txt" );
@@ -598,6 +619,11 @@ QDomDocument QgsWMSServer::getContext()
     mConfigParser->owsGeneralAndResourceList( owsContextElem, doc, hrefString );
   }
 
+  if ( QgsServerExtentCache* extentCache = QgsServerExtentCache::instance() )
+  {
+    extentCache->sync();
+  }
+
   return doc;
 }
 
@@ -616,6 +642,76 @@ static QgsLayerTreeModelLegendNode* _findLegendNodeForRule( QgsLayerTreeModel* l
 }
 
 
+//tile aligned requests up to this size are served from the tile cache
+static const int MAX_TILE_SIZE = 512;
+//pixels rendered around metatiles, so that symbols and labels are not cut at their border
+static const int METATILE_BUFFER = 64;
+
+//number of tiles per row and column of a metatile, from QGIS_SERVER_METATILE_SIZE
+static int _metatileSize()
+{
+  static int size = -1;
+  if ( size < 0 )
+  {
+    size = 4;
+    char* sizeEnv = getenv( "QGIS_SERVER_METATILE_SIZE" );
+    if ( sizeEnv )
+    {
+      bool conversionOk = false;
+      int envSize = QString( sizeEnv ).toInt( &conversionOk );
+      if ( conversionOk && envSize > 0 )
+      {
+        size = envSize;
+      }
+    }
+  }
+  return size;
+}
+
+//whether reprojected vector layers may be transformed through an interpolation grid, from QGIS_SERVER_APPROXIMATE_TRANSFORM
+static bool _approximateTransform()
+{
+  static int approximate = -1;
+  if ( approximate < 0 )
+  {
+    approximate = 0;
+    char* approximateEnv = getenv( "QGIS_SERVER_APPROXIMATE_TRANSFORM" );
+    if ( approximateEnv )
+    {
+      bool conversionOk = false;
+      int envValue = QString( approximateEnv ).toInt( &conversionOk );
+      if ( conversionOk && envValue > 0 )
+      {
+        approximate = 1;
+      }
+    }
+  }
+  return approximate == 1;
+}
+
+//index of the grid cell starting at min, for a grid with origin 0 and cell size size. Returns false if min is not on the grid.
+static bool _gridIndex( double min, double size, qint64& index )
+{
+  double i = min / size;
+  if ( qAbs( i ) > 1e15 )
+    return false;
+  index = qRound64( i );
+  //a thousandth of a tile is less than a pixel for all tile sizes
+  return qAbs( i - index ) < 1e-3;
+}
+
+//first cell of the metatile containing cell index
+static qint64 _metatileIndex( qint64 index, int metatileSize )
+{
+  return index >= 0 ? index / metatileSize * metatileSize : (( index + 1 ) / metatileSize - 1 ) * metatileSize;
+}
+
+static QString _bboxString( const QgsRectangle& r )
+{
+  return QString( "%1,%2,%3,%4" ).arg( r.xMinimum(), 0, 'g', 17 ).arg( r.yMinimum(), 0, 'g', 17 )
+         .arg( r.xMaximum(), 0, 'g', 17 ).arg( r.yMaximum(), 0, 'g', 17 );
+}
+
 static QgsRectangle _parseBBOX( const QString &bboxStr, bool &ok )
 {
   ok = false;
@@ -899,37 +995,34 @@ QImage* QgsWMSServer::getLegendGraphics()
 
 void QgsWMSServer::runHitTest( QPainter* painter, HitTest& hitTest )
 {
-  QPaintDevice* thePaintDevice = painter->device();
+  QgsMapSettings settings = mapSettings();
 
-  // setup QgsRenderContext in the same way as QgsMapRenderer does
-  QgsRenderContext context;
+  // setup QgsRenderContext in the same way as the render job does
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( settings );
   context.setPainter( painter ); // we are not going to draw anything, but we still need a working painter
-  context.setRenderingStopped( false );
-  context.setRasterScaleFactor(( thePaintDevice->logicalDpiX() + thePaintDevice->logicalDpiY() ) / 2.0 / mMapRenderer->outputDpi() );
-  context.setScaleFactor( mMapRenderer->outputUnits() == QgsMapRenderer::Millimeters ? mMapRenderer->outputDpi() / 25.4 : 1.0 );
-  context.setRendererScale( mMapRenderer->scale() );
-  context.setMapToPixel( *mMapRenderer->coordinateTransform() );
-  context.setExtent( mMapRenderer->extent() );
+  if ( mMapRenderer->outputUnits() != QgsMapRenderer::Millimeters )
+  {
+    context.setScaleFactor( 1.0 );
+  }
 
-  Q_FOREACH ( const QString& layerID, mMapRenderer->layerSet() )
+  Q_FOREACH ( const QString& layerID, settings.layers() )
   {
     QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( layerID ) );
     if ( !vl || !vl->rendererV2() )
       continue;
 
-    if ( vl->hasScaleBasedVisibility() && ( mMapRenderer->scale() < vl->minimumScale() || mMapRenderer->scale() > vl->maximumScale() ) )
+    if ( vl->hasScaleBasedVisibility() && ( settings.scale() < vl->minimumScale() || settings.scale() > vl->maximumScale() ) )
     {
       hitTest[vl] = SymbolV2Set(); // no symbols -> will not be shown
       continue;
     }
 
-    if ( mMapRenderer->hasCrsTransformEnabled() )
+    if ( settings.hasCrsTransformEnabled() )
     {
-      QgsRectangle r1 = mMapRenderer->extent(), r2;
-      mMapRenderer->splitLayersExtent( vl, r1, r2 );
-      if ( !r1.isFinite() || !r2.isFinite() ) //there was a problem transforming the extent. Skip the layer
+      QgsRectangle r1 = settings.outputExtentToLayerExtent( vl, settings.visibleExtent() );
+      if ( !r1.isFinite() ) //there was a problem transforming the extent. Skip the layer
         continue;
-      context.setCoordinateTransform( mMapRenderer->transformation( vl ) );
+      context.setCoordinateTransform( settings.layerTransform( vl ) );
       context.setExtent( r1 );
     }
 
@@ -1310,7 +1403,7 @@ QImage* QgsWMSServer::getMap( HitTest* hitTest )
   if ( hitTest )
     runHitTest( &thePainter, *hitTest );
   else
-    mMapRenderer->render( &thePainter );
+    renderMap( &thePainter );
 
   if ( mConfigParser )
   {
@@ -1333,6 +1426,144 @@ QImage* QgsWMSServer::getMap( HitTest* hitTest )
   return theImage;
 }
 
+QImage* QgsWMSServer::getMapFromTileCache()
+{
+  QgsServerTileCache* cache = QgsServerTileCache::instance();
+  if ( !cache || !mConfigParser )
+  {
+    return 0;
+  }
+
+  //annotations would be drawn once on the metatile instead of on every tile
+  if ( mConfigParser->hasOverlays() )
+  {
+    return 0;
+  }
+
+  //requests changing the rendering in other ways than layers and styles are not cached
+  Q_FOREACH ( const QString& parameter, QStringList() << "SLD" << "SLD_BODY" << "FILTER" << "SELECTION" )
+  {
+    if ( mParameters.contains( parameter ) )
+    {
+      return 0;
+    }
+  }
+
+  bool widthOk, heightOk, bboxOk;
+  int width = mParameters.value( "WIDTH" ).toInt( &widthOk );
+  int height = mParameters.value( "HEIGHT" ).toInt( &heightOk );
+  QgsRectangle tileExtent = _parseBBOX( mParameters.value( "BBOX" ), bboxOk );
+  if ( !widthOk || !heightOk || !bboxOk || width <= 0 || height <= 0 || width > MAX_TILE_SIZE || height > MAX_TILE_SIZE || tileExtent.isEmpty() )
+  {
+    return 0;
+  }
+
+  QString crs = mParameters.value( "CRS", mParameters.value( "SRS" ) );
+  bool axisInverted = mParameters.value( "VERSION", "1.3.0" ) != "1.1.1" && QgsCRSCache::instance()->crsByAuthId( crs ).axisInverted();
+  if ( axisInverted )
+  {
+    tileExtent.invert();
+  }
+
+  //the request is a tile if its extent is a cell of a grid with origin 0/0 and cells of the size of the extent
+  qint64 column, row;
+  if ( !_gridIndex( tileExtent.xMinimum(), tileExtent.width(), column ) || !_gridIndex( tileExtent.yMinimum(), tileExtent.height(), row ) )
+  {
+    return 0;
+  }
+
+  QByteArray key = tileCacheKey( column, row, tileExtent );
+  QImage tile = cache->tile( mConfigFilePath, key );
+  if ( !tile.isNull() )
+  {
+    QgsDebugMsg( "Tile cache: hit" );
+    return new QImage( tile );
+  }
+
+  //render the metatile containing the tile
+  int metatileSize = _metatileSize();
+  int metaWidth = metatileSize * width + 2 * METATILE_BUFFER;
+  int metaHeight = metatileSize * height + 2 * METATILE_BUFFER;
+  if (( mConfigParser->maxWidth() != -1 && metaWidth > mConfigParser->maxWidth() )
+      || ( mConfigParser->maxHeight() != -1 && metaHeight > mConfigParser->maxHeight() ) )
+  {
+    return 0;
+  }
+
+  qint64 metaColumn = _metatileIndex( column, metatileSize );
+  qint64 metaRow = _metatileIndex( row, metatileSize );
+  double bufferX = METATILE_BUFFER * tileExtent.width() / width;
+  double bufferY = METATILE_BUFFER * tileExtent.height() / height;
+  QgsRectangle metaExtent( metaColumn * tileExtent.width() - bufferX, metaRow * tileExtent.height() - bufferY,
+                           ( metaColumn + metatileSize ) * tileExtent.width() + bufferX, ( metaRow + metatileSize ) * tileExtent.height() + bufferY );
+  if ( axisInverted )
+  {
+    metaExtent.invert();
+  }
+
+  QMap<QString, QString> originalParameters = mParameters;
+  mParameters.insert( "BBOX", _bboxString( metaExtent ) );
+  mParameters.insert( "WIDTH", QString::number( metaWidth ) );
+  mParameters.insert( "HEIGHT", QString::number( metaHeight ) );
+
+  QImage* metaImage = 0;
+  try
+  {
+    metaImage = getMap();
+  }
+  catch ( QgsMapServiceException& )
+  {
+    mParameters = originalParameters;
+    throw;
+  }
+  mParameters = originalParameters;
+
+  if ( !metaImage )
+  {
+    return 0;
+  }
+
+  //slice it. Rows of the grid go up, rows of the image go down
+  QImage* result = 0;
+  for ( int j = 0; j < metatileSize; ++j )
+  {
+    for ( int i = 0; i < metatileSize; ++i )
+    {
+      QImage slice = metaImage->copy( METATILE_BUFFER + i * width, METATILE_BUFFER + ( metatileSize - 1 - j ) * height, width, height );
+      QgsRectangle sliceExtent( ( metaColumn + i ) * tileExtent.width(), ( metaRow + j ) * tileExtent.height(),
+                                ( metaColumn + i + 1 ) * tileExtent.width(), ( metaRow + j + 1 ) * tileExtent.height() );
+      cache->insertTile( mConfigFilePath, tileCacheKey( metaColumn + i, metaRow + j, sliceExtent ), slice );
+
+      if ( metaColumn + i == column && metaRow + j == row )
+      {
+        result = new QImage( slice );
+      }
+    }
+  }
+
+  delete metaImage;
+  return result;
+}
+
+QByteArray QgsWMSServer::tileCacheKey( qint64 column, qint64 row, const QgsRectangle& tileExtent ) const
+{
+  //parameters are sorted by name
+  QByteArray key;
+  QMap<QString, QString>::const_iterator paramIt = mParameters.constBegin();
+  for ( ; paramIt != mParameters.constEnd(); ++paramIt )
+  {
+    if ( paramIt.key() == "BBOX" )
+    {
+      continue;
+    }
+    key += paramIt.key().toUtf8() + '=' + paramIt.value().toUtf8() + '&';
+  }
+  key += QString( "TILE=%1,%2,%3,%4&METATILE=%5,%6" ).arg( column ).arg( row )
+         .arg( tileExtent.width(), 0, 'g', 12 ).arg( tileExtent.height(), 0, 'g', 12 )
+         .arg( _metatileSize() ).arg( METATILE_BUFFER ).toUtf8();
+  return key;
+}
+
 void QgsWMSServer::getMapAsDxf()
 {
   QgsServerStreamingDevice d( "application/dxf" , mRequestHandler );
@@ -1574,6 +1805,7 @@ int QgsWMSServer::getFeatureInfo( QDomDocument& result, QString version )
   //layers can have assigned a different name for GetCapabilities
   QHash<QString, QString> layerAliasMap = mConfigParser->featureInfoLayerAliasMap();
 
+  QList<QgsMapLayer*> infoLayers;
   QList<QgsMapLayer*> layerList;
   QgsMapLayer* currentLayer = 0;
   QStringList::const_iterator layerIt;
@@ -1602,67 +1834,104 @@ int QgsWMSServer::getFeatureInfo( QDomDocument& result, QString version )
         continue;
       }
 
-      //switch depending on vector or raster
-      QgsVectorLayer* vectorLayer = dynamic_cast<QgsVectorLayer*>( currentLayer );
+      infoLayers.append( currentLayer );
+    }
+  }
+
+  //query the vector layers in parallel, the response is written afterwards in the order of the layers
+  bool hasGeometry = mConfigParser->featureInfoWithWktGeometry() || featuresRect;
+  QList<FeatureInfoJob> jobs;
+  QMap<QgsVectorLayer*, int> jobIndexes;
+  QList<QgsMapLayer*>::const_iterator infoLayerIt = infoLayers.constBegin();
+  for ( ; infoLayerIt != infoLayers.constEnd(); ++infoLayerIt )
+  {
+    QgsVectorLayer* vectorLayer = dynamic_cast<QgsVectorLayer*>( *infoLayerIt );
+    if ( !vectorLayer || jobIndexes.contains( vectorLayer ) )
+    {
+      continue;
+    }
+    jobIndexes.insert( vectorLayer, jobs.size() );
+    jobs.append( FeatureInfoJob() );
+    prepareFeatureInfoJob( jobs.last(), vectorLayer, infoPoint.data(), featureCount, renderContext, hasGeometry );
+  }
 
-      QDomElement layerElement;
-      if ( infoFormat.startsWith( "application/vnd.ogc.gml" ) )
+  QtConcurrent::blockingMap( jobs, fetchFeatureInfoStatic );
+
+  for ( QList<FeatureInfoJob>::iterator jobIt = jobs.begin(); jobIt != jobs.end(); ++jobIt )
+  {
+    if ( jobIt->renderer )
+    {
+      jobIt->renderer->stopRender( jobIt->context );
+      delete jobIt->renderer;
+      jobIt->renderer = 0;
+    }
+    jobIt->iterator.close();
+  }
+
+  for ( infoLayerIt = infoLayers.constBegin(); infoLayerIt != infoLayers.constEnd(); ++infoLayerIt )
+  {
+    currentLayer = *infoLayerIt;
+
+    //switch depending on vector or raster
+    QgsVectorLayer* vectorLayer = dynamic_cast<QgsVectorLayer*>( currentLayer );
+
+    QDomElement layerElement;
+    if ( infoFormat.startsWith( "application/vnd.ogc.gml" ) )
+    {
+      layerElement = getFeatureInfoElement;
+    }
+    else
+    {
+      layerElement = result.createElement( "Layer" );
+      QString layerName = mConfigParser && mConfigParser->useLayerIDs() ? currentLayer->id() : currentLayer->name();
+
+      //check if the layer is given a different name for GetFeatureInfo output
+      QHash<QString, QString>::const_iterator layerAliasIt = layerAliasMap.find( layerName );
+      if ( layerAliasIt != layerAliasMap.constEnd() )
       {
-        layerElement = getFeatureInfoElement;
+        layerName = layerAliasIt.value();
       }
-      else
+      layerElement.setAttribute( "name", layerName );
+      getFeatureInfoElement.appendChild( layerElement );
+      if ( sia2045 ) //the name might not be unique after alias replacement
       {
-        layerElement = result.createElement( "Layer" );
-        QString layerName = mConfigParser && mConfigParser->useLayerIDs() ? currentLayer->id() : currentLayer->name();
-
-        //check if the layer is given a different name for GetFeatureInfo output
-        QHash<QString, QString>::const_iterator layerAliasIt = layerAliasMap.find( layerName );
-        if ( layerAliasIt != layerAliasMap.constEnd() )
-        {
-          layerName = layerAliasIt.value();
-        }
-        layerElement.setAttribute( "name", layerName );
-        getFeatureInfoElement.appendChild( layerElement );
-        if ( sia2045 ) //the name might not be unique after alias replacement
-        {
-          layerElement.setAttribute( "id", currentLayer->id() );
-        }
+        layerElement.setAttribute( "id", currentLayer->id() );
       }
+    }
 
-      if ( vectorLayer )
+    if ( vectorLayer )
+    {
+      if ( featureInfoFromVectorLayer( vectorLayer, jobs.at( jobIndexes.value( vectorLayer ) ).features, result, layerElement, mMapRenderer, renderContext,
+                                       version, infoFormat, featuresRect ) != 0 )
       {
-        if ( featureInfoFromVectorLayer( vectorLayer, infoPoint.data(), featureCount, result, layerElement, mMapRenderer, renderContext,
-                                         version, infoFormat, featuresRect ) != 0 )
-        {
-          continue;
-        }
+        continue;
       }
-      else //raster layer
+    }
+    else //raster layer
+    {
+      if ( infoFormat.startsWith( "application/vnd.ogc.gml" ) )
       {
-        if ( infoFormat.startsWith( "application/vnd.ogc.gml" ) )
-        {
-          layerElement = result.createElement( "gml:featureMember"/*wfs:FeatureMember*/ );
-          getFeatureInfoElement.appendChild( layerElement );
-        }
+        layerElement = result.createElement( "gml:featureMember"/*wfs:FeatureMember*/ );
+        getFeatureInfoElement.appendChild( layerElement );
+      }
 
-        QgsRasterLayer* rasterLayer = dynamic_cast<QgsRasterLayer*>( currentLayer );
-        if ( rasterLayer )
+      QgsRasterLayer* rasterLayer = dynamic_cast<QgsRasterLayer*>( currentLayer );
+      if ( rasterLayer )
+      {
+        if ( !infoPoint.data() )
         {
-          if ( !infoPoint.data() )
-          {
-            continue;
-          }
-          QgsPoint layerInfoPoint = mMapRenderer->mapToLayerCoordinates( currentLayer, *( infoPoint.data() ) );
-          if ( featureInfoFromRasterLayer( rasterLayer, &layerInfoPoint, result, layerElement, version, infoFormat ) != 0 )
-          {
-            continue;
-          }
+          continue;
         }
-        else
+        QgsPoint layerInfoPoint = mMapRenderer->mapToLayerCoordinates( currentLayer, *( infoPoint.data() ) );
+        if ( featureInfoFromRasterLayer( rasterLayer, &layerInfoPoint, result, layerElement, version, infoFormat ) != 0 )
         {
           continue;
         }
       }
+      else
+      {
+        continue;
+      }
     }
   }
 
@@ -1938,6 +2207,79 @@ int QgsWMSServer::configureMapRender( const QPaintDevice* paintDevice ) const
   return 0;
 }
 
+QgsMapSettings QgsWMSServer::mapSettings() const
+{
+  QgsMapSettings settings = mMapRenderer->mapSettings();
+
+  //the output image is already filled with the background color
+  settings.setBackgroundColor( Qt::transparent );
+  settings.setFlag( QgsMapSettings::RenderLayersInTiles, QThreadPool::globalInstance()->maxThreadCount() > 1 );
+  settings.setFlag( QgsMapSettings::ApproximateTransform, _approximateTransform() );
+
+  QgsProject* prj = QgsProject::instance();
+  settings.setSelectionColor( QColor( prj->readNumEntry( "Gui", "/SelectionColorRedPart", 255 ),
+                                      prj->readNumEntry( "Gui", "/SelectionColorGreenPart", 255 ),
+                                      prj->readNumEntry( "Gui", "/SelectionColorBluePart", 0 ),
+                                      prj->readNumEntry( "Gui", "/SelectionColorAlphaPart", 255 ) ) );
+
+  //layer coordinate transforms from the project file, as in configureMapRender
+  settings.datumTransformStore().clear();
+  if ( mConfigParser && settings.hasCrsTransformEnabled() )
+  {
+    QList< QPair< QString, QgsLayerCoordinateTransform > > lt = mConfigParser->layerCoordinateTransforms();
+    QList< QPair< QString, QgsLayerCoordinateTransform > >::const_iterator ltIt = lt.constBegin();
+    for ( ; ltIt != lt.constEnd(); ++ltIt )
+    {
+      QgsLayerCoordinateTransform t = ltIt->second;
+      settings.datumTransformStore().addEntry( ltIt->first, t.srcAuthId, t.destAuthId, t.srcDatumTransform, t.destDatumTransform );
+    }
+  }
+
+  QgsExpressionContext context;
+  context << QgsExpressionContextUtils::globalScope()
+  << QgsExpressionContextUtils::projectScope()
+  << QgsExpressionContextUtils::mapSettingsScope( settings );
+  settings.setExpressionContext( context );
+
+  return settings;
+}
+
+void QgsWMSServer::renderMap( QPainter* painter ) const
+{
+  QgsServerRequestProfile* profile = QgsServerRequestProfile::instance();
+  QTime renderTime;
+  renderTime.start();
+
+  if ( mMapRenderer->outputUnits() != QgsMapRenderer::Millimeters )
+  {
+    //symbol sizes in pixels (e.g. from SLD) are only supported by the legacy renderer
+    mMapRenderer->render( painter );
+    profile->addTime( "render", renderTime.elapsed() );
+    return;
+  }
+
+  QgsMapRendererParallelJob job( mapSettings() );
+  //the render job creates its own labeling engine, it gets the engine settings of the project configuration
+  job.setLabelingEngineSettings( dynamic_cast<QgsPalLabeling*>( mMapRenderer->labelingEngine() ) );
+  job.start();
+  job.waitForFinished();
+
+  painter->drawImage( 0, 0, job.renderedImage() );
+
+  profile->addTime( "render", renderTime.elapsed() );
+  profile->addTime( "labeling", job.labelingTime() );
+  QMap<QString, int> layerTimes = job.perLayerRenderingTime();
+  for ( QMap<QString, int>::const_iterator it = layerTimes.constBegin(); it != layerTimes.constEnd(); ++it )
+  {
+    profile->addLayerRenderingTime( it.key(), it.value() );
+  }
+  QMap<QString, int> featureCounts = job.perLayerFeatureCount();
+  for ( QMap<QString, int>::const_iterator it = featureCounts.constBegin(); it != featureCounts.constEnd(); ++it )
+  {
+    profile->addLayerFeatureCount( it.key(), it.value() );
+  }
+}
+
 int QgsWMSServer::readLayersAndStyles( QStringList& layersList, QStringList& stylesList ) const
 {
   //get layer and style lists from the parameters trying LAYERS and LAYER as well as STYLE and STYLES for GetLegendGraphic compatibility
@@ -2007,84 +2349,117 @@ bool QgsWMSServer::infoPointToMapCoordinates( int i, int j, QgsPoint* infoPoint,
   return true;
 }
 
-int QgsWMSServer::featureInfoFromVectorLayer( QgsVectorLayer* layer,
-    const QgsPoint* infoPoint,
-    int nFeatures,
-    QDomDocument& infoDocument,
-    QDomElement& layerElement,
-    QgsMapRenderer* mapRender,
-    QgsRenderContext& renderContext,
-    QString version,
-    QString infoFormat,
-    QgsRectangle* featureBBox ) const
+void QgsWMSServer::prepareFeatureInfoJob( FeatureInfoJob& job, QgsVectorLayer* layer, const QgsPoint* infoPoint, int nFeatures,
+    const QgsRenderContext& renderContext, bool hasGeometry ) const
 {
-  if ( !layer || !mapRender )
+  layer->updateFields();
+
+  job.renderer = layer->rendererV2() ? layer->rendererV2()->clone() : 0;
+  job.context = renderContext;
+  job.context.expressionContext() << QgsExpressionContextUtils::layerScope( layer );
+  job.maxFeatures = nFeatures;
+  job.searchRect = QgsRectangle();
+  if ( !job.renderer )
   {
-    return 1;
+    return;
   }
 
-  //we need a selection rect (0.01 of map width)
-  QgsRectangle mapRect = mapRender->extent();
-  QgsRectangle layerRect = mapRender->mapToLayerCoordinates( layer, mapRect );
-
-
-  QgsRectangle searchRect;
-
   //info point could be 0 in case there is only an attribute filter
+  QgsRectangle searchRect;
   if ( infoPoint )
   {
-    searchRect = featureInfoSearchRect( layer, mapRender, renderContext, *infoPoint );
+    searchRect = featureInfoSearchRect( layer, mMapRenderer, renderContext, *infoPoint );
   }
   else if ( mParameters.contains( "BBOX" ) )
   {
-    searchRect = layerRect;
+    searchRect = mMapRenderer->mapToLayerCoordinates( layer, mMapRenderer->extent() );
   }
 
-  //do a select with searchRect and go through all the features
-
-  QgsFeature feature;
-  QgsAttributes featureAttributes;
-  int featureCounter = 0;
-  layer->updateFields();
-  const QgsFields& fields = layer->pendingFields();
-  bool addWktGeometry = mConfigParser && mConfigParser->featureInfoWithWktGeometry();
-  const QSet<QString>& excludedAttributes = layer->excludeAttributesWMS();
+  //only fetch features drawn by the renderer (e.g. compile the rule filters of a rule based renderer into the request)
+  job.renderer->startRender( job.context, layer->pendingFields() );
+  QString rendererFilter = job.renderer->filter();
 
   QgsFeatureRequest fReq;
-  bool hasGeometry = addWktGeometry || featureBBox;
   fReq.setFlags((( hasGeometry ) ? QgsFeatureRequest::NoFlags : QgsFeatureRequest::NoGeometry ) | QgsFeatureRequest::ExactIntersect );
-  if ( !searchRect.isEmpty() )
+
+  //a request has either feature ids or an expression as filter, so the spatial index of the
+  //layer cache is only used if the renderer has no filter
+  const QgsSpatialIndex* index = searchRect.isEmpty() || !rendererFilter.isEmpty() ? 0 : QgsMSLayerCache::instance()->spatialIndex( layer );
+  if ( index )
   {
-    fReq.setFilterRect( searchRect );
+    //candidates from the spatial index of the layer cache, the worker tests the intersection with the search rectangle
+    fReq.setFilterFids( index->intersects( searchRect ).toSet() );
+    fReq.setFlags( QgsFeatureRequest::NoFlags );
+    job.searchRect = searchRect;
   }
-  QgsFeatureIterator fit = layer->getFeatures( fReq );
-
-  bool featureBBoxInitialized = false;
-  while ( fit.nextFeature( feature ) )
+  else
   {
-    ++featureCounter;
-    if ( featureCounter > nFeatures )
+    if ( !searchRect.isEmpty() )
+    {
+      fReq.setFilterRect( searchRect );
+    }
+    if ( !rendererFilter.isEmpty() )
     {
-      break;
+      fReq.setFilterExpression( rendererFilter );
+      fReq.setExpressionContext( job.context.expressionContext() );
     }
+  }
+
+  job.iterator = layer->getFeatures( fReq );
+}
+
+void QgsWMSServer::fetchFeatureInfoStatic( FeatureInfoJob& job )
+{
+  if ( !job.renderer )
+  {
+    return;
+  }
 
-    QgsFeatureRendererV2* r2 = layer->rendererV2();
-    if ( !r2 )
+  QgsFeature feature;
+  while ( job.features.size() < job.maxFeatures && job.iterator.nextFeature( feature ) )
+  {
+    if ( !job.searchRect.isEmpty() && ( !feature.constGeometry() || !feature.constGeometry()->intersects( job.searchRect ) ) )
     {
       continue;
     }
 
-    renderContext.expressionContext().setFeature( feature );
-
     //check if feature is rendered at all
-    r2->startRender( renderContext, layer->pendingFields() );
-    bool renderV2 = r2->willRenderFeature( feature, renderContext );
-    r2->stopRender( renderContext );
-    if ( !renderV2 )
+    job.context.expressionContext().setFeature( feature );
+    if ( !job.renderer->willRenderFeature( feature, job.context ) )
     {
       continue;
     }
 
+    job.features.append( feature );
+  }
+}
+
+int QgsWMSServer::featureInfoFromVectorLayer( QgsVectorLayer* layer,
+    const QgsFeatureList& features,
+    QDomDocument& infoDocument,
+    QDomElement& layerElement,
+    QgsMapRenderer* mapRender,
+    QgsRenderContext& renderContext,
+    QString version,
+    QString infoFormat,
+    QgsRectangle* featureBBox ) const
+{
+  if ( !layer || !mapRender )
+  {
+    return 1;
+  }
+
+  QgsAttributes featureAttributes;
+  const QgsFields& fields = layer->pendingFields();
+  bool addWktGeometry = mConfigParser && mConfigParser->featureInfoWithWktGeometry();
+  const QSet<QString>& excludedAttributes = layer->excludeAttributesWMS();
+  bool hasGeometry = addWktGeometry || featureBBox;
+
+  bool featureBBoxInitialized = false;
+  Q_FOREACH ( QgsFeature feature, features )
+  {
+    renderContext.expressionContext().setFeature( feature );
+
     QgsRectangle box;
     if ( hasGeometry )
     {
@@ -20,6 +20,9 @@
 
 #include "qgsowsserver.h"
 #include "qgswmsconfigparser.h"
+#include "qgsfeature.h"
+#include "qgsfeatureiterator.h"
+#include "qgsrendercontext.h"
 #include <QDomDocument>
 #include <QMap>
 #include <QPair>
@@ -36,6 +39,7 @@ class QgsFeature;
 class QgsFeatureRendererV2;
 class QgsMapLayer;
 class QgsMapRenderer;
+class QgsMapSettings;
 class QgsPoint;
 class QgsRasterLayer;
 class QgsRasterRenderer;
@@ -129,6 +133,19 @@ class QgsWMSServer: public QgsOWSServer
      @param paintDevice the device that is used for painting (for dpi)
      @return 0 in case of success*/
     int configureMapRender( const QPaintDevice* paintDevice ) const;
+    /** Returns the requested map from the tile cache if the request is aligned to a tile grid.
+     On a cache miss a metatile containing the requested tile is rendered, sliced and stored in the cache.
+     @return 0 if tile caching is disabled or if the request can not be served as a tile*/
+    QImage* getMapFromTileCache();
+    /** Key of a tile in the tile cache: all request parameters except BBOX plus the tile position*/
+    QByteArray tileCacheKey( qint64 column, qint64 row, const QgsRectangle& tileExtent ) const;
+    /** Returns map settings for the current configuration of mMapRenderer
+     (extent, output size, layers, CRS and datum transforms)*/
+    QgsMapSettings mapSettings() const;
+    /** Renders the layers configured in mMapRenderer. The layers are rendered in parallel
+     on the global thread pool, except if the output units are pixels (which only the
+     legacy renderer supports)*/
+    void renderMap( QPainter* painter ) const;
     /** Reads the layers and style lists from the parameters LAYERS and STYLES
      @return 0 in case of success*/
     int readLayersAndStyles( QStringList& layersList, QStringList& stylesList ) const;
@@ -137,12 +154,33 @@ class QgsWMSServer: public QgsOWSServer
     @return 0 in case of success*/
     int initializeSLDParser( QStringList& layersList, QStringList& stylesList );
     static bool infoPointToMapCoordinates( int i, int j, QgsPoint* infoPoint, QgsMapRenderer* mapRenderer );
+
+    /** Query of a vector layer for GetFeatureInfo. The features are fetched by a worker thread*/
+    struct FeatureInfoJob
+    {
+      QgsFeatureIterator iterator;
+      QgsFeatureRendererV2* renderer; // must be deleted, null if the layer has no renderer
+      QgsRenderContext context;
+      QgsRectangle searchRect; // if not empty, the features of the iterator are tested for intersection
+      int maxFeatures;
+      QgsFeatureList features; // features which are rendered
+    };
+
+    /** Sets up the feature request of a vector layer for GetFeatureInfo. Candidates are taken from the
+     spatial index of the layer cache if available, and the filter of the renderer is added to the request.
+     Called in the main thread, QgsFeatureRendererV2::stopRender() has to be called on the job's renderer
+     after fetching*/
+    void prepareFeatureInfoJob( FeatureInfoJob& job, QgsVectorLayer* layer, const QgsPoint* infoPoint, int nFeatures,
+                                const QgsRenderContext& renderContext, bool hasGeometry ) const;
+    /** Fetches the features of a GetFeatureInfo query which are rendered (called by worker threads)*/
+    static void fetchFeatureInfoStatic( FeatureInfoJob& job );
+
     /** Appends feature info xml for the layer to the layer element of the feature info dom document
+    @param features the features to write (see fetchFeatureInfoStatic)
     @param featureBBox the bounding box of the selected features in output CRS
     @return 0 in case of success*/
     int featureInfoFromVectorLayer( QgsVectorLayer* layer,
-                                    const QgsPoint* infoPoint,
-                                    int nFeatures,
+                                    const QgsFeatureList& features,
                                     QDomDocument& infoDocument,
                                     QDomElement& layerElement,
                                     QgsMapRenderer* mapRender,
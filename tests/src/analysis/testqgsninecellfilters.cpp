@@ -0,0 +1,187 @@
+/***************************************************************************
+     testqgsninecellfilters.cpp
+     --------------------------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QtTest/QtTest>
+
+#include "qgsapplication.h"
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsslopefilter.h"
+
+#include <gdal.h>
+
+//! Filter implementing only processNineCellWindow(), i.e. using the default row processing
+class TestQgsSumFilter : public QgsNineCellFilter
+{
+  public:
+    TestQgsSumFilter( const QString& inputFile, const QString& outputFile )
+        : QgsNineCellFilter( inputFile, outputFile, "GTiff" )
+    {}
+
+    float processNineCellWindow( float* x11, float* x21, float* x31,
+                                 float* x12, float* x22, float* x32,
+                                 float* x13, float* x23, float* x33 ) override
+    {
+      if ( *x22 == mInputNodataValue )
+        return mOutputNodataValue;
+
+      float sum = 0;
+      float* cells[] = { x11, x21, x31, x12, x22, x32, x13, x23, x33 };
+      for ( int i = 0; i < 9; ++i )
+      {
+        if ( *cells[i] != mInputNodataValue )
+          sum += *cells[i];
+      }
+      return sum;
+    }
+};
+
+/** \ingroup UnitTests
+ * This is a unit test for the nine cell raster filters
+ */
+class TestQgsNineCellFilters : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init() {}
+    void cleanup() {}
+
+    void slope();
+    void aspect();
+    void hillshade();
+    void defaultRowProcessing();
+
+  private:
+    //! Runs the filter and compares the output with processNineCellWindow() calls for each cell
+    void checkFilter( QgsNineCellFilter& filter, const QString& outputFile );
+
+    QString mDemPath;
+    QVector<float> mDem;
+};
+
+static const int DEM_COLUMNS = 203;
+static const int DEM_ROWS = 300; //more rows than a block
+static const float DEM_NODATA = -9999;
+
+void TestQgsNineCellFilters::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  GDALAllRegister();
+
+  //a smooth surface with some nodata holes
+  mDem.resize( DEM_COLUMNS * DEM_ROWS );
+  for ( int row = 0; row < DEM_ROWS; ++row )
+  {
+    for ( int col = 0; col < DEM_COLUMNS; ++col )
+    {
+      float value = 100 + 20 * sin( col / 15.0 ) * cos( row / 25.0 ) + row * 0.3;
+      if (( row * 7 + col * 3 ) % 97 == 0 || ( row == 128 && col > 50 && col < 60 ) )
+        value = DEM_NODATA;
+      mDem[row * DEM_COLUMNS + col] = value;
+    }
+  }
+
+  mDemPath = QDir::tempPath() + "/ninecellfilter_dem.tif";
+  GDALDatasetH dataset = GDALCreate( GDALGetDriverByName( "GTiff" ), mDemPath.toUtf8().constData(), DEM_COLUMNS, DEM_ROWS, 1, GDT_Float32, 0 );
+  QVERIFY( dataset );
+  double geoTransform[6] = { 1000.0, 25.0, 0.0, 5000.0, 0.0, -20.0 };
+  GDALSetGeoTransform( dataset, geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, DEM_NODATA );
+  QCOMPARE( GDALRasterIO( band, GF_Write, 0, 0, DEM_COLUMNS, DEM_ROWS, mDem.data(), DEM_COLUMNS, DEM_ROWS, GDT_Float32, 0, 0 ), CE_None );
+  GDALClose( dataset );
+}
+
+void TestQgsNineCellFilters::cleanupTestCase()
+{
+  QFile::remove( mDemPath );
+  QgsApplication::exitQgis();
+}
+
+void TestQgsNineCellFilters::checkFilter( QgsNineCellFilter& filter, const QString& outputFile )
+{
+  QCOMPARE( filter.processRaster( 0 ), 0 );
+
+  QVector<float> result( DEM_COLUMNS * DEM_ROWS );
+  GDALDatasetH dataset = GDALOpen( outputFile.toUtf8().constData(), GA_ReadOnly );
+  QVERIFY( dataset );
+  QCOMPARE( GDALGetRasterXSize( dataset ), DEM_COLUMNS );
+  QCOMPARE( GDALGetRasterYSize( dataset ), DEM_ROWS );
+  GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, DEM_COLUMNS, DEM_ROWS, result.data(), DEM_COLUMNS, DEM_ROWS, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+  QFile::remove( outputFile );
+
+  float nodata = DEM_NODATA;
+  for ( int row = 0; row < DEM_ROWS; ++row )
+  {
+    for ( int col = 0; col < DEM_COLUMNS; ++col )
+    {
+      float x[3][3];
+      for ( int dy = -1; dy <= 1; ++dy )
+      {
+        for ( int dx = -1; dx <= 1; ++dx )
+        {
+          int r = row + dy;
+          int c = col + dx;
+          x[dx + 1][dy + 1] = r < 0 || r >= DEM_ROWS || c < 0 || c >= DEM_COLUMNS ? nodata : mDem[r * DEM_COLUMNS + c];
+        }
+      }
+
+      float expected = filter.processNineCellWindow( &x[0][0], &x[1][0], &x[2][0], &x[0][1], &x[1][1], &x[2][1], &x[0][2], &x[1][2], &x[2][2] );
+      float actual = result[row * DEM_COLUMNS + col];
+      if ( qAbs( expected - actual ) > 1e-4 * qMax( 1.0f, qAbs( expected ) ) )
+      {
+        QFAIL( QString( "Cell %1/%2: expected %3, got %4" ).arg( row ).arg( col ).arg( expected ).arg( actual ).toLocal8Bit().constData() );
+      }
+    }
+  }
+}
+
+void TestQgsNineCellFilters::slope()
+{
+  QString outputFile = QDir::tempPath() + "/ninecellfilter_slope.tif";
+  QgsSlopeFilter filter( mDemPath, outputFile, "GTiff" );
+  filter.setZFactor( 2.0 );
+  checkFilter( filter, outputFile );
+}
+
+void TestQgsNineCellFilters::aspect()
+{
+  QString outputFile = QDir::tempPath() + "/ninecellfilter_aspect.tif";
+  QgsAspectFilter filter( mDemPath, outputFile, "GTiff" );
+  checkFilter( filter, outputFile );
+}
+
+void TestQgsNineCellFilters::hillshade()
+{
+  QString outputFile = QDir::tempPath() + "/ninecellfilter_hillshade.tif";
+  QgsHillshadeFilter filter( mDemPath, outputFile, "GTiff", 315, 45 );
+  checkFilter( filter, outputFile );
+}
+
+void TestQgsNineCellFilters::defaultRowProcessing()
+{
+  QString outputFile = QDir::tempPath() + "/ninecellfilter_sum.tif";
+  TestQgsSumFilter filter( mDemPath, outputFile );
+  checkFilter( filter, outputFile );
+}
+
+QTEST_MAIN( TestQgsNineCellFilters )
+#include "testqgsninecellfilters.moc"
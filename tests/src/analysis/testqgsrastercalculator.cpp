@@ -16,6 +16,7 @@ Email                : nyall dot dawson at gmail dot com
 
 #include "qgsrastercalculator.h"
 #include "qgsrastercalcnode.h"
+#include "qgsrastercalcprogram.h"
 #include "qgsrasterlayer.h"
 #include "qgsrastermatrix.h"
 #include "qgsapplication.h"
@@ -57,6 +58,12 @@ class TestQgsRasterCalculator : public QObject
     void calcWithLayers();
     void calcWithReprojectedLayers();
 
+    void programDualOp_data();
+    void programDualOp(); //test operators of the compiled program
+    void programRasterRaster(); //test nodata handling of the compiled program
+    void programMatrixNotCompiled();
+    void calcInBlocks(); //test calculation of a raster spanning several blocks
+
   private:
 
     QgsRasterLayer * mpLandsatRasterLayer;
@@ -528,5 +535,152 @@ void TestQgsRasterCalculator::calcWithReprojectedLayers()
   delete block;
 }
 
+void TestQgsRasterCalculator::programDualOp_data()
+{
+  dualOp_data();
+}
+
+void TestQgsRasterCalculator::programDualOp()
+{
+  QFETCH( QgsRasterCalcNode::Operator, op );
+  QFETCH( double, left );
+  QFETCH( double, right );
+  QFETCH( double, expected );
+
+  QgsRasterCalcNode node( op, new QgsRasterCalcNode( left ), new QgsRasterCalcNode( right ) );
+  QScopedPointer<QgsRasterCalcProgram> program( QgsRasterCalcProgram::compile( &node, -9999 ) );
+  QVERIFY( program );
+  QVERIFY( program->rasterNames().isEmpty() );
+
+  float result[3];
+  program->run( QVector<QgsRasterBlock*>(), 0, 1, 0, 3, result, 3 );
+  for ( int i = 0; i < 3; ++i )
+  {
+    QCOMPARE( result[i], ( float ) expected );
+  }
+}
+
+void TestQgsRasterCalculator::programRasterRaster()
+{
+  QgsRasterBlock m1( QGis::Float32, 2, 3, -1.0 );
+  m1.setValue( 0, 0, 1.0 );
+  m1.setValue( 0, 1, 2.0 );
+  m1.setValue( 1, 0, -2.0 );
+  m1.setValue( 1, 1, -1.0 ); //nodata
+  m1.setValue( 2, 0, 5.0 );
+  m1.setValue( 2, 1, -1.0 ); //nodata
+
+  QgsRasterBlock m2( QGis::Float32, 2, 3, -2.0 ); //different no data value
+  m2.setValue( 0, 0, -1.0 );
+  m2.setValue( 0, 1, -2.0 ); //nodata
+  m2.setValue( 1, 0, 13.0 );
+  m2.setValue( 1, 1, -2.0 ); //nodata
+  m2.setValue( 2, 0, 15.0 );
+  m2.setValue( 2, 1, -1.0 );
+
+  // sqrt( raster2 + raster1 * 1 ) - 0
+  QgsRasterCalcNode node( QgsRasterCalcNode::opMINUS,
+                          new QgsRasterCalcNode( QgsRasterCalcNode::opSQRT,
+                                                 new QgsRasterCalcNode( QgsRasterCalcNode::opPLUS, new QgsRasterCalcNode( "raster2" ),
+                                                     new QgsRasterCalcNode( QgsRasterCalcNode::opMUL, new QgsRasterCalcNode( "raster1" ), new QgsRasterCalcNode( 1.0 ) ) ),
+                                                 0 ),
+                          new QgsRasterCalcNode( 0.0 ) );
+
+  QScopedPointer<QgsRasterCalcProgram> program( QgsRasterCalcProgram::compile( &node, -9999 ) );
+  QVERIFY( program );
+  QCOMPARE( program->rasterNames(), QStringList() << "raster2" << "raster1" );
+
+  QVector<QgsRasterBlock*> inputs;
+  inputs << &m2 << &m1;
+
+  //skip the first row
+  float result[4];
+  program->run( inputs, 1, 2, 0, 2, result, 2 );
+  QCOMPARE( result[0], ( float ) sqrt( 11.0 ) );
+  QCOMPARE( result[1], -9999.0f );
+  QCOMPARE( result[2], ( float ) sqrt( 20.0 ) );
+  QCOMPARE( result[3], -9999.0f );
+
+  //compare with tree evaluation
+  QMap<QString, QgsRasterBlock*> rasterData;
+  rasterData.insert( "raster1", &m1 );
+  rasterData.insert( "raster2", &m2 );
+  QgsRasterMatrix matrix;
+  matrix.setNodataValue( -9999 );
+  QVERIFY( node.calculate( rasterData, matrix ) );
+
+  float all[6];
+  program->run( inputs, 0, 3, 0, 2, all, 2 );
+  for ( int i = 0; i < 6; ++i )
+  {
+    QCOMPARE( all[i], ( float ) matrix.data()[i] );
+  }
+}
+
+void TestQgsRasterCalculator::programMatrixNotCompiled()
+{
+  double* data = new double[2];
+  data[0] = 1.0;
+  data[1] = 2.0;
+  QgsRasterMatrix m( 2, 1, data, -1.0 );
+  QgsRasterCalcNode node( QgsRasterCalcNode::opPLUS, new QgsRasterCalcNode( &m ), new QgsRasterCalcNode( 1.0 ) );
+
+  QgsRasterCalcProgram* program = QgsRasterCalcProgram::compile( &node, -9999 );
+  QVERIFY( !program );
+}
+
+void TestQgsRasterCalculator::calcInBlocks()
+{
+  QgsRasterCalculatorEntry entry1;
+  entry1.bandNumber = 1;
+  entry1.raster = mpLandsatRasterLayer;
+  entry1.ref = "landsat@1";
+
+  QgsRasterCalculatorEntry entry2;
+  entry2.bandNumber = 2;
+  entry2.raster = mpLandsatRasterLayer;
+  entry2.ref = "landsat@2";
+
+  QVector<QgsRasterCalculatorEntry> entries;
+  entries << entry1 << entry2;
+
+  QTemporaryFile tmpFile;
+  tmpFile.open(); // fileName is no avialable until open
+  QString tmpName = tmpFile.fileName();
+  tmpFile.close();
+
+  //more rows and columns than a block
+  int nColumns = 600;
+  int nRows = 300;
+  QgsRectangle extent = mpLandsatRasterLayer->extent();
+  QgsRasterCalculator rc( QString( "\"landsat@1\" * 2 - \"landsat@2\" / 4" ),
+                          tmpName,
+                          "GTiff",
+                          extent, mpLandsatRasterLayer->crs(), nColumns, nRows, entries );
+  QCOMPARE( rc.processCalculation(), 0 );
+
+  QgsRasterLayer* result = new QgsRasterLayer( tmpName, "result" );
+  QCOMPARE( result->width(), nColumns );
+  QCOMPARE( result->height(), nRows );
+  QgsRasterBlock* block = result->dataProvider()->block( 1, extent, nColumns, nRows );
+  QgsRasterBlock* band1 = mpLandsatRasterLayer->dataProvider()->block( 1, extent, nColumns, nRows );
+  QgsRasterBlock* band2 = mpLandsatRasterLayer->dataProvider()->block( 2, extent, nColumns, nRows );
+  for ( int row = 0; row < nRows; ++row )
+  {
+    for ( int column = 0; column < nColumns; ++column )
+    {
+      float expected = band1->value( row, column ) * 2 - band2->value( row, column ) / 4;
+      if ( block->value( row, column ) != expected )
+      {
+        QFAIL( QString( "Cell %1/%2: expected %3, got %4" ).arg( row ).arg( column ).arg( expected ).arg( block->value( row, column ) ).toLocal8Bit().constData() );
+      }
+    }
+  }
+  delete result;
+  delete block;
+  delete band1;
+  delete band2;
+}
+
 QTEST_MAIN( TestQgsRasterCalculator )
 #include "testqgsrastercalculator.moc"
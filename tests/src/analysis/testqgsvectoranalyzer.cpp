@@ -16,6 +16,7 @@ Email                : sherman at mrcc dot com
 
 //header for class being tested
 #include <qgsgeometryanalyzer.h>
+#include <qgsoverlayanalyzer.h>
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 
@@ -44,7 +45,13 @@ class TestQgsVectorAnalyzer : public QObject
     void simplifyGeometry();
     void polygonCentroids();
     void layerExtent();
+    void bufferDissolve();
+    void dissolvePolygons();
+    void convexHulls();
+    void intersection();
   private:
+    long outputFeatureCount( const QString& fileName );
+
     QgsGeometryAnalyzer mAnalyzer;
     QgsVectorLayer * mpLineLayer;
     QgsVectorLayer * mpPolyLayer;
@@ -137,5 +144,45 @@ void TestQgsVectorAnalyzer::layerExtent()
   QVERIFY( mAnalyzer.extent( mpPointLayer, myFileName ) );
 }
 
+void TestQgsVectorAnalyzer::bufferDissolve()
+{
+  QString myTmpDir = QDir::tempPath() + "/";
+  QString myFileName = myTmpDir +  "buffer_dissolve_layer.shp";
+  QVERIFY( mAnalyzer.buffer( mpPointLayer, myFileName, 1.0, false, true ) );
+  QCOMPARE( outputFeatureCount( myFileName ), 1L );
+}
+
+void TestQgsVectorAnalyzer::dissolvePolygons()
+{
+  QString myTmpDir = QDir::tempPath() + "/";
+  QString myFileName = myTmpDir +  "dissolve_layer.shp";
+  QVERIFY( mAnalyzer.dissolve( mpPolyLayer, myFileName ) );
+  QCOMPARE( outputFeatureCount( myFileName ), 1L );
+}
+
+void TestQgsVectorAnalyzer::convexHulls()
+{
+  QString myTmpDir = QDir::tempPath() + "/";
+  QString myFileName = myTmpDir +  "convex_hull_layer.shp";
+  QVERIFY( mAnalyzer.convexHull( mpPointLayer, myFileName ) );
+  QCOMPARE( outputFeatureCount( myFileName ), 1L );
+}
+
+void TestQgsVectorAnalyzer::intersection()
+{
+  QString myTmpDir = QDir::tempPath() + "/";
+  QString myFileName = myTmpDir +  "intersection_layer.shp";
+  QgsOverlayAnalyzer overlayAnalyzer;
+  QVERIFY( overlayAnalyzer.intersection( mpPolyLayer, mpPolyLayer, myFileName ) );
+  // every polygon intersects at least itself
+  QVERIFY( outputFeatureCount( myFileName ) >= mpPolyLayer->featureCount() );
+}
+
+long TestQgsVectorAnalyzer::outputFeatureCount( const QString& fileName )
+{
+  QgsVectorLayer layer( fileName, "output", "ogr" );
+  return layer.isValid() ? layer.featureCount() : -1;
+}
+
 QTEST_MAIN( TestQgsVectorAnalyzer )
 #include "testqgsvectoranalyzer.moc"
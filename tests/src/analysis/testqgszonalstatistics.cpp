@@ -17,10 +17,14 @@
 #include <QtTest/QtTest>
 
 #include "qgsapplication.h"
+#include "qgsgeometry.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qgszonalstatistics.h"
 #include "qgsmaplayerregistry.h"
 
+#include <gdal.h>
+
 /** \ingroup UnitTests
  * This is a unit test for the zonal statistics class
  */
@@ -38,6 +42,7 @@ class TestQgsZonalStatistics : public QObject
     void cleanup() {}
 
     void testStatistics();
+    void testOverlappingZones();
 
   private:
     QgsVectorLayer* mVectorLayer;
@@ -135,5 +140,67 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "myqgis2_me" ).toDouble(), 0.833333333333333 );
 }
 
+void TestQgsZonalStatistics::testOverlappingZones()
+{
+  //10 x 10 raster with value row * 10 + column
+  QString rasterPath = QDir::tempPath() + "/zonalstatistics_grid.tif";
+  GDALAllRegister();
+  GDALDatasetH dataset = GDALCreate( GDALGetDriverByName( "GTiff" ), rasterPath.toUtf8().constData(), 10, 10, 1, GDT_Float32, 0 );
+  QVERIFY( dataset );
+  double geoTransform[6] = { 0.0, 1.0, 0.0, 10.0, 0.0, -1.0 };
+  GDALSetGeoTransform( dataset, geoTransform );
+  float values[100];
+  for ( int i = 0; i < 100; ++i )
+    values[i] = i;
+  GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Write, 0, 0, 10, 10, values, 10, 10, GDT_Float32, 0, 0 );
+  GDALClose( dataset );
+
+  QgsVectorLayer layer( "Polygon", "zones", "memory" );
+  QVERIFY( layer.isValid() );
+  QgsFeatureList features;
+  QgsFeature whole;
+  whole.setGeometry( QgsGeometry::fromWkt( "POLYGON((0 0, 10 0, 10 10, 0 10, 0 0))" ) );
+  QgsFeature overlapping;
+  overlapping.setGeometry( QgsGeometry::fromWkt( "POLYGON((2 2, 6 2, 6 6, 2 6, 2 2))" ) );
+  QgsFeature withHole;
+  withHole.setGeometry( QgsGeometry::fromWkt( "POLYGON((0 0, 4 0, 4 4, 0 4, 0 0),(1 1, 1 3, 3 3, 3 1, 1 1))" ) );
+  QgsFeature outside;
+  outside.setGeometry( QgsGeometry::fromWkt( "POLYGON((20 20, 24 20, 24 24, 20 24, 20 20))" ) );
+  features << whole << overlapping << withHole << outside;
+  QVERIFY( layer.dataProvider()->addFeatures( features ) );
+
+  QgsZonalStatistics zs( &layer, rasterPath, "", 1, QgsZonalStatistics::Count | QgsZonalStatistics::Sum | QgsZonalStatistics::Min
+                         | QgsZonalStatistics::Max | QgsZonalStatistics::Variety );
+  QCOMPARE( zs.calculateStatistics( NULL ), 0 );
+
+  QgsFeatureIterator it = layer.getFeatures();
+  QgsFeature f;
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.attribute( "count" ).toDouble(), 100.0 );
+  QCOMPARE( f.attribute( "sum" ).toDouble(), 4950.0 );
+  QCOMPARE( f.attribute( "min" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "max" ).toDouble(), 99.0 );
+  QCOMPARE( f.attribute( "variety" ).toInt(), 100 );
+
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.attribute( "count" ).toDouble(), 16.0 );
+  QCOMPARE( f.attribute( "sum" ).toDouble(), 936.0 );
+  QCOMPARE( f.attribute( "min" ).toDouble(), 42.0 );
+  QCOMPARE( f.attribute( "max" ).toDouble(), 75.0 );
+
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.attribute( "count" ).toDouble(), 12.0 );
+  QCOMPARE( f.attribute( "sum" ).toDouble(), 918.0 );
+  QCOMPARE( f.attribute( "min" ).toDouble(), 60.0 );
+  QCOMPARE( f.attribute( "max" ).toDouble(), 93.0 );
+  QCOMPARE( f.attribute( "variety" ).toInt(), 12 );
+
+  //no statistics outside of the raster
+  QVERIFY( it.nextFeature( f ) );
+  QVERIFY( f.attribute( "count" ).isNull() );
+
+  QFile::remove( rasterPath );
+}
+
 QTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
@@ -15,6 +15,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgscoordinatetransform.h"
+#include "qgscoordinatetransformgrid.h"
 #include "qgsapplication.h"
 #include <QObject>
 #include <QtTest/QtTest>
@@ -27,6 +28,9 @@ class TestQgsCoordinateTransform: public QObject
     void initTestCase();
     void cleanupTestCase();
     void transformBoundingBox();
+    void transformPolygons();
+    void transformPolygonFailure();
+    void transformGrid();
 
   private:
 
@@ -73,5 +77,105 @@ void TestQgsCoordinateTransform::transformBoundingBox()
   QVERIFY( qgsDoubleNear( resultRect.yMaximum(), expectedRect.yMaximum(), 0.001 ) );
 }
 
+void TestQgsCoordinateTransform::transformPolygons()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  QPolygonF exterior;
+  exterior << QPointF( 10, 40 ) << QPointF( 20, 40 ) << QPointF( 20, 50 ) << QPointF( 10, 40 );
+  QPolygonF hole;
+  hole << QPointF( 12, 42 ) << QPointF( 14, 42 ) << QPointF( 12, 44 ) << QPointF( 12, 42 );
+
+  QList<QPolygonF> rings;
+  rings << exterior << QPolygonF() << hole;
+  tr.transformPolygons( rings );
+
+  // must match transforming each ring on its own
+  tr.transformPolygon( exterior );
+  tr.transformPolygon( hole );
+
+  QCOMPARE( rings.count(), 3 );
+  QVERIFY( rings.at( 1 ).isEmpty() );
+  for ( int i = 0; i < exterior.count(); ++i )
+  {
+    QVERIFY( qgsDoubleNear( rings.at( 0 ).at( i ).x(), exterior.at( i ).x(), 0.000001 ) );
+    QVERIFY( qgsDoubleNear( rings.at( 0 ).at( i ).y(), exterior.at( i ).y(), 0.000001 ) );
+  }
+  for ( int i = 0; i < hole.count(); ++i )
+  {
+    QVERIFY( qgsDoubleNear( rings.at( 2 ).at( i ).x(), hole.at( i ).x(), 0.000001 ) );
+    QVERIFY( qgsDoubleNear( rings.at( 2 ).at( i ).y(), hole.at( i ).y(), 0.000001 ) );
+  }
+  QVERIFY( qgsDoubleNear( exterior.at( 1 ).x(), 2226389.816, 0.01 ) );
+}
+
+void TestQgsCoordinateTransform::transformPolygonFailure()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  // the pole cannot be projected to web mercator, the polygon must be left unchanged
+  QPolygonF poly;
+  poly << QPointF( 20, 90 );
+  QPolygonF shared( poly );
+  bool failed = false;
+  try
+  {
+    tr.transformPolygon( poly );
+  }
+  catch ( QgsCsException & )
+  {
+    failed = true;
+  }
+  QVERIFY( failed );
+  QCOMPARE( poly.count(), 1 );
+  QCOMPARE( poly.at( 0 ), QPointF( 20, 90 ) );
+  QCOMPARE( shared.at( 0 ), QPointF( 20, 90 ) );
+}
+
+void TestQgsCoordinateTransform::transformGrid()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  double tolerance = 100.0; // meters, about a quarter of a pixel at 1:1.5M
+  QgsCoordinateTransformGrid grid( &tr, QgsRectangle( 0, 30, 20, 60 ), tolerance );
+  QVERIFY( grid.isValid() );
+  QVERIFY( grid.rows() > 3 );
+
+  // points inside the grid are interpolated within the tolerance, others are transformed exactly
+  QPolygonF poly;
+  for ( int i = 0; i <= 50; ++i )
+    poly << QPointF( -5 + i * 0.5, 25 + i * 0.8 );
+  QPolygonF exact = poly;
+  tr.transformPolygon( exact );
+  grid.transformPolygon( poly );
+  for ( int i = 0; i < poly.count(); ++i )
+  {
+    QVERIFY( qgsDoubleNear( poly.at( i ).x(), exact.at( i ).x(), tolerance ) );
+    QVERIFY( qgsDoubleNear( poly.at( i ).y(), exact.at( i ).y(), tolerance ) );
+  }
+
+  double x = 10.3, y = 45.7;
+  grid.transformInPlace( x, y );
+  QgsPoint p = tr.transform( 10.3, 45.7 );
+  QVERIFY( qgsDoubleNear( x, p.x(), tolerance ) );
+  QVERIFY( qgsDoubleNear( y, p.y(), tolerance ) );
+
+  // the transform can not be approximated if the grid is not allowed to be refined
+  QgsCoordinateTransformGrid coarseGrid( &tr, QgsRectangle( 0, 30, 20, 60 ), 0.001, 3 );
+  QVERIFY( !coarseGrid.isValid() );
+}
+
 QTEST_MAIN( TestQgsCoordinateTransform )
 #include "testqgscoordinatetransform.moc"
@@ -665,6 +665,138 @@ class TestQgsExpression: public QObject
       run_evaluation_test( exp3, evalError, result );
     }
 
+    void evaluation_compiled_data()
+    {
+      evaluation_data();
+    }
+
+    void evaluation_compiled()
+    {
+      QFETCH( QString, string );
+
+      // compiled program must give exactly the same results as the tree walker
+      QgsExpressionContext context;
+      QgsExpression exp( string );
+      exp.setCompilationEnabled( false );
+      bool prepareRes = exp.prepare( &context );
+      QVariant expected = exp.evaluate( &context );
+
+      QgsExpression compiledExp( string );
+      QCOMPARE( compiledExp.prepare( &context ), prepareRes );
+      QVariant res = compiledExp.evaluate( &context );
+      QCOMPARE( compiledExp.hasEvalError(), exp.hasEvalError() );
+      QCOMPARE( res.type(), expected.type() );
+      if ( expected.type() != QVariant::UserType )
+        QCOMPARE( res, expected );
+    }
+
+    void eval_columns_compiled_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<QVariant>( "result" );
+
+      QTest::newRow( "int plus" ) << "foo + 1" << QVariant( 21 );
+      QTest::newRow( "int div" ) << "foo / 8" << QVariant( 2.5 );
+      QTest::newRow( "int div zero" ) << "foo / 0" << QVariant();
+      QTest::newRow( "int mod zero" ) << "foo % 0" << QVariant();
+      QTest::newRow( "double times" ) << "dbl * 2" << QVariant( 5.0 );
+      QTest::newRow( "int vs double" ) << "foo > dbl" << QVariant( 1 );
+      QTest::newRow( "null plus" ) << "x1 + 1" << QVariant();
+      QTest::newRow( "null comparison" ) << "x1 > 1" << QVariant();
+      QTest::newRow( "null and false" ) << "x1 > 1 and foo < 0" << QVariant( 0 );
+      QTest::newRow( "null or true" ) << "x1 > 1 or foo > 0" << QVariant( 1 );
+      QTest::newRow( "is null" ) << "x1 is null" << QVariant( 1 );
+      QTest::newRow( "not" ) << "not foo" << QVariant( 0 );
+      QTest::newRow( "minus" ) << "-dbl" << QVariant( -2.5 );
+      QTest::newRow( "string concat" ) << "x2 || foo" << QVariant( "abc20" );
+      QTest::newRow( "string compare" ) << "x2 = 'abc'" << QVariant( 1 );
+      QTest::newRow( "function" ) << "abs(-foo) + 1" << QVariant( 21.0 );
+      QTest::newRow( "in" ) << "foo in (1, 20)" << QVariant( 1 );
+      QTest::newRow( "folded constant" ) << "foo + (2 * 3)" << QVariant( 26 );
+    }
+
+    void eval_columns_compiled()
+    {
+      QFETCH( QString, string );
+      QFETCH( QVariant, result );
+
+      QgsFields fields;
+      fields.append( QgsField( "x1" ) );
+      fields.append( QgsField( "x2", QVariant::String ) );
+      fields.append( QgsField( "foo", QVariant::Int ) );
+      fields.append( QgsField( "dbl", QVariant::Double ) );
+
+      QgsFeature f;
+      f.initAttributes( 4 );
+      f.setAttribute( 1, QVariant( "abc" ) );
+      f.setAttribute( 2, QVariant( 20 ) );
+      f.setAttribute( 3, QVariant( 2.5 ) );
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+
+      QgsExpression exp( string );
+      QCOMPARE( exp.prepare( &context ), true );
+      QVERIFY( exp.isCompiled() );
+      QVariant res = exp.evaluate( &context );
+      QCOMPARE( exp.hasEvalError(), false );
+      QCOMPARE( res, result );
+
+      // the program must be reusable
+      QCOMPARE( exp.evaluate( &context ), result );
+
+      exp.setCompilationEnabled( false );
+      QCOMPARE( exp.prepare( &context ), true );
+      QVERIFY( !exp.isCompiled() );
+      QCOMPARE( exp.evaluate( &context ), result );
+    }
+
+    void benchmark_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "compiled" );
+
+      QString arithmetic( "(foo * 2 + dbl) / 3 > 5 and foo % 7 <> 0 or -dbl < 1" );
+      QString mixed( "abs(foo - 10) * dbl + 1 > 10 and x2 = 'abc'" );
+      QTest::newRow( "arithmetic tree" ) << arithmetic << false;
+      QTest::newRow( "arithmetic compiled" ) << arithmetic << true;
+      QTest::newRow( "mixed tree" ) << mixed << false;
+      QTest::newRow( "mixed compiled" ) << mixed << true;
+    }
+
+    void benchmark()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+
+      QgsFields fields;
+      fields.append( QgsField( "x2", QVariant::String ) );
+      fields.append( QgsField( "foo", QVariant::Int ) );
+      fields.append( QgsField( "dbl", QVariant::Double ) );
+
+      QgsFeature f;
+      f.initAttributes( 3 );
+      f.setAttribute( 0, QVariant( "abc" ) );
+      f.setAttribute( 1, QVariant( 20 ) );
+      f.setAttribute( 2, QVariant( 2.5 ) );
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+
+      QgsExpression exp( string );
+      exp.setCompilationEnabled( compiled );
+      exp.prepare( &context );
+      QCOMPARE( exp.isCompiled(), compiled );
+
+      QBENCHMARK
+      {
+        for ( int i = 0; i < 10000; ++i )
+        {
+          f.setAttribute( 1, QVariant( i ) );
+          context.setFeature( f );
+          exp.evaluate( &context );
+        }
+      }
+    }
+
     void eval_precedence()
     {
       QCOMPARE( QgsExpression::BinaryOperatorText[QgsExpression::boDiv], "/" );
@@ -16,6 +16,8 @@
 #include <QtTest/QtTest>
 
 #include <qgsapplication.h>
+#include <qgscoordinatetransform.h>
+#include <qgslabelingcache.h>
 #include <qgslabelingenginev2.h>
 #include <qgsmaplayerregistry.h>
 #include <qgsmaprenderersequentialjob.h>
@@ -24,6 +26,87 @@
 #include <qgsvectorlayerdiagramprovider.h>
 #include <qgsvectorlayerlabeling.h>
 #include <qgsvectorlayerlabelprovider.h>
+#include <pal/feature.h>
+#include <pal/labelposition.h>
+#include <pal/layer.h>
+#include <pal/pal.h>
+#include <pal/problem.h>
+
+#include <geos_c.h>
+#include <QThreadPool>
+
+//! Provider of the pal layers of the tests, the features are registered directly in pal
+class TestLabelProvider : public QgsAbstractLabelProvider
+{
+  public:
+    ~TestLabelProvider() { qDeleteAll( mFeatures ); }
+
+    virtual QList<QgsLabelFeature*> labelFeatures( QgsRenderContext& context ) override
+    {
+      Q_UNUSED( context );
+      return mFeatures;
+    }
+
+    virtual void drawLabel( QgsRenderContext& context, pal::LabelPosition* label ) const override
+    {
+      Q_UNUSED( context );
+      Q_UNUSED( label );
+    }
+
+    QList<QgsLabelFeature*> mFeatures;
+};
+
+/** Solves a pal problem with groups of points with conflicting labels and isolated points
+ * in two layers and returns the placed labels
+ */
+static QStringList _palSolution( pal::SearchMethod method, bool components )
+{
+  TestLabelProvider provider1, provider2;
+  QStringList solution;
+  {
+    pal::Pal p;
+    p.setSearch( method );
+    pal::Layer* layers[2];
+    layers[0] = p.addLayer( &provider1, "layer1", pal::P_POINT, 0.5, true, true );
+    layers[1] = p.addLayer( &provider2, "layer2", pal::P_POINT, 0.5, true, true );
+    TestLabelProvider* providers[2] = { &provider1, &provider2 };
+
+    for ( int group = 0; group < 6; ++group )
+    {
+      for ( int k = 0; k < 6; ++k )
+      {
+        // five close points and one isolated point per group
+        QgsPoint point = k < 5 ? QgsPoint( group * 100 + k * 1.5, k % 2 ) : QgsPoint( group * 100 + 50, 50 );
+        QgsGeometry* geometry = QgsGeometry::fromPoint( point );
+        GEOSGeometry* geosGeometry = GEOSGeom_clone_r( QgsGeometry::getGEOSHandler(), geometry->asGeos() );
+        delete geometry;
+
+        QgsLabelFeature* feature = new QgsLabelFeature( group * 10 + k, geosGeometry, QSizeF( 4, 1 ) );
+        providers[k % 2]->mFeatures << feature;
+        layers[k % 2]->registerFeature( feature );
+      }
+    }
+
+    double bbox[] = { -10, -10, 700, 100 };
+    pal::Problem* problem = p.extractProblem( bbox );
+    problem->reduce();
+    if ( components )
+      problem->solveComponents();
+    else
+      problem->solve();
+
+    std::list<pal::LabelPosition*>* labels = problem->getSolution( false );
+    for ( std::list<pal::LabelPosition*>::const_iterator it = labels->begin(); it != labels->end(); ++it )
+    {
+      pal::LabelPosition* label = *it;
+      solution << QString( "%1 %2 %3 %4" ).arg( label->getFeaturePart()->layer()->name() ).arg( label->getFeaturePart()->featureId() )
+      .arg( label->getX(), 0, 'g', 17 ).arg( label->getY(), 0, 'g', 17 );
+    }
+    delete labels;
+    delete problem;
+  }
+  return solution;
+}
 
 class TestQgsLabelingEngineV2 : public QObject
 {
@@ -36,6 +119,9 @@ class TestQgsLabelingEngineV2 : public QObject
     void testBasic();
     void testDiagrams();
     void testRuleBased();
+    void testCache();
+    void testSolveComponents();
+    void testThreadCount();
 
   private:
     QgsVectorLayer* vl;
@@ -213,5 +299,135 @@ void TestQgsLabelingEngineV2::testRuleBased()
 
 }
 
+void TestQgsLabelingEngineV2::testCache()
+{
+  QSize size( 640, 480 );
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( size );
+  mapSettings.setExtent( vl->extent() );
+  mapSettings.setLayers( QStringList() << vl->id() );
+
+  vl->setCustomProperty( "labeling", "pal" );
+  vl->setCustomProperty( "labeling/enabled", true );
+  vl->setCustomProperty( "labeling/fieldName", "Class" );
+  vl->setCustomProperty( "labeling/fontSize", 24 );
+
+  QgsLabelingCache cache;
+  QList<QImage> images;
+  QList<int> reused;
+  for ( int i = 0; i < 2; ++i )
+  {
+    QImage img( size, QImage::Format_ARGB32_Premultiplied );
+    img.fill( 0 );
+    QPainter p( &img );
+    QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+    context.setPainter( &p );
+
+    // the second run reuses the placements of the first one
+    QgsLabelingEngineV2 engine;
+    engine.setMapSettings( mapSettings );
+    engine.setLabelingCache( &cache );
+    engine.addProvider( new QgsVectorLayerLabelProvider( vl ) );
+    engine.run( context );
+    p.end();
+
+    images << img;
+    reused << cache.reusedSolutions();
+  }
+  QCOMPARE( images.at( 0 ), images.at( 1 ) );
+  QCOMPARE( reused.at( 0 ), 0 );
+  QVERIFY( reused.at( 1 ) > 0 );
+  QCOMPARE( reused.at( 1 ), cache.size() );
+  QVERIFY( cache.reusedCandidates() > 0 );
+
+  // candidates of features inside of both extents are reused after panning,
+  // also with an approximated transform of the rendered geometries
+  QgsCoordinateReferenceSystem destCrs( "EPSG:3857" );
+  QgsCoordinateTransform ct( vl->crs(), destCrs );
+  QgsRectangle extent = ct.transformBoundingBox( vl->extent() );
+  mapSettings.setCrsTransformEnabled( true );
+  mapSettings.setDestinationCrs( destCrs );
+  mapSettings.setFlag( QgsMapSettings::ApproximateTransform, true );
+  QList<int> reusedCandidates;
+  for ( int i = 0; i < 2; ++i )
+  {
+    mapSettings.setExtent( QgsRectangle( extent.xMinimum() + i * extent.width() / 10, extent.yMinimum(),
+                                         extent.xMaximum() + i * extent.width() / 10, extent.yMaximum() ) );
+
+    QImage img( size, QImage::Format_ARGB32_Premultiplied );
+    img.fill( 0 );
+    QPainter p( &img );
+    QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+    context.setPainter( &p );
+
+    QgsLabelingEngineV2 engine;
+    engine.setMapSettings( mapSettings );
+    engine.setLabelingCache( &cache );
+    engine.addProvider( new QgsVectorLayerLabelProvider( vl ) );
+    engine.run( context );
+    p.end();
+
+    reusedCandidates << cache.reusedCandidates();
+  }
+  QCOMPARE( reusedCandidates.at( 0 ), 0 );
+  QVERIFY( reusedCandidates.at( 1 ) > 0 );
+
+  // placements are removed if the parameters change
+  QgsLabelingCache::FeatureSolution solution;
+  solution.candidate = 1;
+  cache.setSolution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution );
+  QVERIFY( cache.solution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution ) );
+  QCOMPARE( solution.candidate, 1 );
+  QVERIFY( !cache.init( "other parameters" ) );
+  QVERIFY( cache.init( "other parameters" ) );
+  QVERIFY( !cache.solution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution ) );
+
+  cache.setSolution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution );
+  cache.clearLayer( vl->id() );
+  QVERIFY( !cache.solution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution ) );
+
+  // placements not used in the previous run are removed
+  cache.setSolution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution );
+  cache.setSolution( vl->id(), QgsLabelingCache::FeatureKey( 0, 2 ), solution );
+  QVERIFY( cache.init( "other parameters" ) );
+  QCOMPARE( cache.size(), 2 );
+  QVERIFY( cache.solution( vl->id(), QgsLabelingCache::FeatureKey( 0, 1 ), solution ) );
+  QVERIFY( cache.init( "other parameters" ) );
+  QCOMPARE( cache.size(), 1 );
+  QVERIFY( !cache.solution( vl->id(), QgsLabelingCache::FeatureKey( 0, 2 ), solution ) );
+  QVERIFY( cache.init( "other parameters" ) );
+  QCOMPARE( cache.size(), 0 );
+
+  vl->setCustomProperty( "labeling/enabled", false );
+  vl->removeCustomProperty( "labeling/fontSize" );
+}
+
+void TestQgsLabelingEngineV2::testSolveComponents()
+{
+  // groups of conflicting labels solved separately give the solution of the whole problem
+  QStringList whole = _palSolution( pal::FALP, false );
+  QVERIFY( whole.count() > 6 );
+  QCOMPARE( _palSolution( pal::FALP, true ), whole );
+}
+
+void TestQgsLabelingEngineV2::testThreadCount()
+{
+  QThreadPool* pool = QThreadPool::globalInstance();
+  int maxThreadCount = pool->maxThreadCount();
+
+  Q_FOREACH ( pal::SearchMethod method, QList<pal::SearchMethod>() << pal::FALP << pal::CHAIN << pal::POPMUSIC_TABU )
+  {
+    pool->setMaxThreadCount( 1 );
+    QStringList singleThread = _palSolution( method, true );
+    pool->setMaxThreadCount( 4 );
+    QStringList severalThreads = _palSolution( method, true );
+
+    QVERIFY( !singleThread.isEmpty() );
+    QCOMPARE( singleThread, severalThreads );
+  }
+
+  pool->setMaxThreadCount( maxThreadCount );
+}
+
 QTEST_MAIN( TestQgsLabelingEngineV2 )
 #include "testqgslabelingenginev2.moc"
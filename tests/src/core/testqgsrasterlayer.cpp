@@ -28,6 +28,7 @@
 //qgis includes...
 #include <qgsrasterlayer.h>
 #include <qgsrasterpyramid.h>
+#include <qgsrasterblock.h>
 #include <qgsrasterbandstats.h>
 #include <qgsrasteridentifyresult.h>
 #include <qgsmaplayerregistry.h>
@@ -80,6 +81,7 @@ class TestQgsRasterLayer : public QObject
     void registry();
     void transparency();
     void setRenderer();
+    void blockReuse();
   private:
     bool render( const QString& theFileName );
     bool setQml( const QString& theType );
@@ -603,5 +605,35 @@ void TestQgsRasterLayer::setRenderer()
   QCOMPARE( mpRasterLayer->renderer(), renderer );
 }
 
+void TestQgsRasterLayer::blockReuse()
+{
+  // memory of a deleted block is reused for the next block of the same size
+  QgsRasterBlock* block = new QgsRasterBlock( QGis::Float32, 100, 100 );
+  QVERIFY( !block->isEmpty() );
+  char* bits = block->bits();
+  delete block;
+
+  block = new QgsRasterBlock( QGis::Float32, 100, 100 );
+  QCOMPARE( block->bits(), bits );
+  block->setValue( 0, 0, 1.5 );
+  QCOMPARE( block->value( 0, 0 ), 1.5 );
+
+  // a block of different size gets its own memory
+  QgsRasterBlock* otherBlock = new QgsRasterBlock( QGis::Float32, 50, 50 );
+  QVERIFY( otherBlock->bits() != bits );
+  delete otherBlock;
+  delete block;
+
+  // images shared with a copy returned by image() are not reused
+  block = new QgsRasterBlock( QGis::ARGB32_Premultiplied, 100, 100 );
+  block->setColor( 0, qRgba( 255, 0, 0, 255 ) );
+  QImage image = block->image();
+  delete block;
+  block = new QgsRasterBlock( QGis::ARGB32_Premultiplied, 100, 100 );
+  block->setColor( 0, qRgba( 0, 0, 255, 255 ) );
+  QCOMPARE( image.pixel( 0, 0 ), qRgba( 255, 0, 0, 255 ) );
+  delete block;
+}
+
 QTEST_MAIN( TestQgsRasterLayer )
 #include "testqgsrasterlayer.moc"
@@ -14,6 +14,7 @@
  ***************************************************************************/
 
 #include <QtTest/QtTest>
+#include <QDir>
 #include <QObject>
 #include <QString>
 
@@ -117,6 +118,73 @@ class TestQgsSpatialIndex : public QObject
       QVERIFY( fids[0] == 1 );
     }
 
+    void testWriteAndRead()
+    {
+      QString sourcePath = QDir::tempPath() + "/spatialindex_source.txt";
+      QString indexPath = QDir::tempPath() + "/spatialindex_test.qsix";
+      QFile source( sourcePath );
+      QVERIFY( source.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+      source.write( "some data" );
+      source.close();
+
+      QgsSpatialIndex index;
+      Q_FOREACH ( const QgsFeature& f, _pointFeatures() )
+        index.insertFeature( f );
+      for ( int i = 0; i < 1000; ++i )
+        index.insertFeature( _pointFeature( 100 + i, -100 - i % 50, -100 - i / 50 ) );
+
+      QVERIFY( index.writeToFile( indexPath, sourcePath ) );
+
+      QgsSpatialIndex indexRead;
+      QVERIFY( indexRead.readFromFile( indexPath, sourcePath ) );
+
+      QList<QgsFeatureId> fids = indexRead.intersects( QgsRectangle( -10, -10, 0, 10 ) );
+      QCOMPARE( fids.count(), 2 );
+      QVERIFY( fids.contains( 2 ) );
+      QVERIFY( fids.contains( 3 ) );
+
+      QList<QgsFeatureId> fidsBig = indexRead.intersects( QgsRectangle( -1000, -1000, -100, -100 ) );
+      QList<QgsFeatureId> fidsExpected = index.intersects( QgsRectangle( -1000, -1000, -100, -100 ) );
+      QCOMPARE( fidsBig.count(), 1000 );
+      qSort( fidsBig );
+      qSort( fidsExpected );
+      QCOMPARE( fidsBig, fidsExpected );
+
+      QCOMPARE( indexRead.nearestNeighbor( QgsPoint( 1.1, -0.9 ), 1 ), QList<QgsFeatureId>() << 4 );
+
+      // changes are kept in memory only
+      indexRead.insertFeature( _pointFeature( 5, 5, 5 ) );
+      QCOMPARE( indexRead.intersects( QgsRectangle( 4, 4, 6, 6 ) ), QList<QgsFeatureId>() << 5 );
+      QgsSpatialIndex indexReadAgain;
+      QVERIFY( indexReadAgain.readFromFile( indexPath, sourcePath ) );
+      QVERIFY( indexReadAgain.intersects( QgsRectangle( 4, 4, 6, 6 ) ).isEmpty() );
+
+      // copies of the index do not lose features with negative coordinates
+      QgsSpatialIndex indexCopy( indexReadAgain );
+      indexCopy.insertFeature( _pointFeature( 5, 5, 5 ) );
+      QCOMPARE( indexCopy.intersects( QgsRectangle( -1000, -1000, -100, -100 ) ).count(), 1000 );
+
+      // the index is not used anymore once the source changes
+      QVERIFY( source.open( QIODevice::Append ) );
+      source.write( " and some more" );
+      source.close();
+      QgsSpatialIndex indexOutdated;
+      QVERIFY( !indexOutdated.readFromFile( indexPath, sourcePath ) );
+      QVERIFY( !indexOutdated.readFromFile( QDir::tempPath() + "/no_such_index.qsix", sourcePath ) );
+
+      QFile::remove( indexPath );
+      QFile::remove( sourcePath );
+    }
+
+    void testCacheFilePath()
+    {
+      QString path1 = QgsSpatialIndex::cacheFilePath( "/data/points.csv" );
+      QString path2 = QgsSpatialIndex::cacheFilePath( "/data/points.csv", "xField=x&yField=y" );
+      QVERIFY( path1 != path2 );
+      QCOMPARE( QgsSpatialIndex::cacheFilePath( "/data/points.csv" ), path1 );
+      QVERIFY( path1.startsWith( QgsApplication::qgisSettingsDirPath() ) );
+    }
+
     void benchmarkIntersect()
     {
       // add 50K features to the index
@@ -32,6 +32,7 @@
 #include "qgssinglesymbolrendererv2.h"
 
 #include "qgsstylev2.h"
+#include "qgsmarkerspritecache.h"
 
 /** \ingroup UnitTests
  * This is a unit test to verify that symbols are working correctly
@@ -68,6 +69,7 @@ class TestQgsSymbolV2 : public QObject
     void testParseColor();
     void testParseColorList();
     void symbolProperties();
+    void markerSpriteCache();
 };
 
 TestQgsSymbolV2::TestQgsSymbolV2()
@@ -455,5 +457,30 @@ void TestQgsSymbolV2::symbolProperties()
   delete fillSymbol2;
 }
 
+void TestQgsSymbolV2::markerSpriteCache()
+{
+  QgsMarkerSpriteCache cache( 1024 * 1024 );
+
+  QImage image( 10, 10, QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+  QVERIFY( cache.sprite( "a" ).isNull() );
+  QVERIFY( cache.insert( "a", image ) );
+  QCOMPARE( cache.sprite( "a" ), image );
+  QVERIFY( cache.sprite( "b" ).isNull() );
+
+  //images larger than a part of the cache are not kept
+  QImage large( 1000, 1000, QImage::Format_ARGB32_Premultiplied );
+  QVERIFY( !cache.insert( "large", large ) );
+  QVERIFY( cache.sprite( "large" ).isNull() );
+
+  cache.clear();
+  QVERIFY( cache.sprite( "a" ).isNull() );
+
+  QCOMPARE( QgsMarkerSpriteCache::rotationBucket( 0.3 ), 0.0 );
+  QCOMPARE( QgsMarkerSpriteCache::rotationBucket( 44.6 ), 45.0 );
+  QCOMPARE( QgsMarkerSpriteCache::rotationBucket( -90.0 ), 270.0 );
+  QCOMPARE( QgsMarkerSpriteCache::rotationBucket( 359.8 ), 0.0 );
+}
+
 QTEST_MAIN( TestQgsSymbolV2 )
 #include "testqgssymbolv2.moc"
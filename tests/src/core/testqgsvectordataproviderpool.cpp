@@ -0,0 +1,203 @@
+/***************************************************************************
+    testqgsvectordataproviderpool.cpp
+     --------------------------------------
+    Date                 : October 2015
+    Copyright            : (C) 2015 by the QGIS project
+    Email                : qgis-developer at lists dot osgeo dot org
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QObject>
+
+#include <qgsapplication.h>
+#include <qgsmaplayerregistry.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectordataproviderpool.h>
+#include <qgsvectorlayer.h>
+
+/** Pool sharing one provider per data source, counting the references */
+class TestPool : public QgsVectorDataProviderPool
+{
+  public:
+    ~TestPool()
+    {
+      qDeleteAll( mProviders );
+    }
+
+    QgsVectorDataProvider* acquireProvider( const QString& providerKey, const QString& dataSource, const QString& encoding ) override
+    {
+      QString key = providerKey + dataSource + encoding;
+      if ( !mProviders.contains( key ) )
+      {
+        QgsVectorDataProvider* provider = ( QgsVectorDataProvider* )( QgsProviderRegistry::instance()->provider( providerKey, dataSource ) );
+        if ( !encoding.isEmpty() )
+          provider->setEncoding( encoding );
+        mProviders.insert( key, provider );
+      }
+      QgsVectorDataProvider* provider = mProviders.value( key );
+      mRefCounts[provider]++;
+      return provider;
+    }
+
+    void releaseProvider( QgsVectorDataProvider* provider ) override
+    {
+      mRefCounts[provider]--;
+    }
+
+    QHash<QString, QgsVectorDataProvider*> mProviders;
+    QHash<QgsVectorDataProvider*, int> mRefCounts;
+};
+
+/** @ingroup UnitTests
+ * This is a unit test for sharing vector data providers between layers
+ *
+ * @see QgsVectorDataProviderPool
+ */
+class TestQgsVectorDataProviderPool : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void sharedProvider();
+    void subsetDetaches();
+    void encodingDetaches();
+    void joinLayerDetaches();
+
+  private:
+    QString mPointsPath;
+};
+
+void TestQgsVectorDataProviderPool::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  mPointsPath = QString( TEST_DATA_DIR ) + "/points.shp";
+}
+
+void TestQgsVectorDataProviderPool::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsVectorDataProviderPool::cleanup()
+{
+  QgsVectorLayer::setDataProviderPool( 0 );
+}
+
+void TestQgsVectorDataProviderPool::sharedProvider()
+{
+  TestPool pool;
+  QgsVectorLayer::setDataProviderPool( &pool );
+
+  QgsVectorLayer* layer1 = new QgsVectorLayer( mPointsPath, "points1", "ogr" );
+  QgsVectorLayer* layer2 = new QgsVectorLayer( mPointsPath, "points2", "ogr" );
+  QVERIFY( layer1->isValid() );
+  QVERIFY( layer2->isValid() );
+  QVERIFY( layer1->hasSharedDataProvider() );
+  QCOMPARE( layer1->dataProvider(), layer2->dataProvider() );
+  QCOMPARE( pool.mProviders.count(), 1 );
+  QCOMPARE( pool.mRefCounts.value( layer1->dataProvider() ), 2 );
+  QCOMPARE( layer1->featureCount(), layer2->featureCount() );
+
+  QgsVectorDataProvider* provider = layer1->dataProvider();
+  delete layer1;
+  QCOMPARE( pool.mRefCounts.value( provider ), 1 );
+  QCOMPARE( layer2->pendingFields().count(), provider->fields().count() );
+  delete layer2;
+  QCOMPARE( pool.mRefCounts.value( provider ), 0 );
+
+  //layers without pool own their provider
+  QgsVectorLayer::setDataProviderPool( 0 );
+  QgsVectorLayer layer3( mPointsPath, "points3", "ogr" );
+  QVERIFY( layer3.isValid() );
+  QVERIFY( !layer3.hasSharedDataProvider() );
+  QVERIFY( layer3.dataProvider() != provider );
+}
+
+void TestQgsVectorDataProviderPool::subsetDetaches()
+{
+  TestPool pool;
+  QgsVectorLayer::setDataProviderPool( &pool );
+
+  QgsVectorLayer layer1( mPointsPath, "points1", "ogr" );
+  QgsVectorLayer layer2( mPointsPath, "points2", "ogr" );
+  QgsVectorDataProvider* provider = layer1.dataProvider();
+  long count = layer2.featureCount();
+
+  //setting the same subset keeps the shared provider
+  QVERIFY( layer1.setSubsetString( QString() ) );
+  QVERIFY( layer1.hasSharedDataProvider() );
+
+  QVERIFY( layer1.setSubsetString( "\"Class\"='Jet'" ) );
+  QVERIFY( !layer1.hasSharedDataProvider() );
+  QVERIFY( layer1.dataProvider() != provider );
+  QCOMPARE( pool.mRefCounts.value( provider ), 1 );
+  QVERIFY( layer1.featureCount() < count );
+
+  //the other layer is not filtered
+  QVERIFY( layer2.hasSharedDataProvider() );
+  QCOMPARE( layer2.featureCount(), count );
+  QVERIFY( layer2.subsetString().isEmpty() );
+}
+
+void TestQgsVectorDataProviderPool::encodingDetaches()
+{
+  TestPool pool;
+  QgsVectorLayer::setDataProviderPool( &pool );
+
+  QgsVectorLayer layer1( mPointsPath, "points1", "ogr" );
+  QgsVectorLayer layer2( mPointsPath, "points2", "ogr" );
+  QgsVectorDataProvider* provider = layer1.dataProvider();
+  QString encoding = provider->encoding() == "UTF-8" ? "ISO-8859-1" : "UTF-8";
+
+  layer1.setProviderEncoding( encoding );
+  QVERIFY( !layer1.hasSharedDataProvider() );
+  QCOMPARE( layer1.dataProvider()->encoding(), encoding );
+  QVERIFY( layer2.dataProvider()->encoding() != encoding );
+  QCOMPARE( pool.mRefCounts.value( provider ), 1 );
+}
+
+void TestQgsVectorDataProviderPool::joinLayerDetaches()
+{
+  TestPool pool;
+  QgsVectorLayer::setDataProviderPool( &pool );
+
+  QgsVectorLayer layer1( mPointsPath, "points1", "ogr" );
+  QgsVectorLayer* joinLayer = new QgsVectorLayer( mPointsPath, "points2", "ogr" );
+  QgsVectorDataProvider* provider = layer1.dataProvider();
+  QVERIFY( joinLayer->hasSharedDataProvider() );
+  QgsMapLayerRegistry::instance()->addMapLayer( joinLayer, false );
+
+  //joins set the subset string of the join layer's provider, so it must not be shared
+  QgsVectorJoinInfo joinInfo;
+  joinInfo.targetFieldName = "Class";
+  joinInfo.joinLayerId = joinLayer->id();
+  joinInfo.joinFieldName = "Class";
+  joinInfo.memoryCache = false;
+  QVERIFY( layer1.addJoin( joinInfo ) );
+  QVERIFY( !joinLayer->hasSharedDataProvider() );
+  QVERIFY( joinLayer->dataProvider() != provider );
+  QCOMPARE( pool.mRefCounts.value( provider ), 1 );
+
+  QgsFeature f;
+  QVERIFY( layer1.getFeatures().nextFeature( f ) );
+  QVERIFY( layer1.dataProvider()->subsetString().isEmpty() );
+  QVERIFY( provider->subsetString().isEmpty() );
+
+  QgsMapLayerRegistry::instance()->removeMapLayer( joinLayer->id() );
+}
+
+QTEST_MAIN( TestQgsVectorDataProviderPool )
+#include "testqgsvectordataproviderpool.moc"
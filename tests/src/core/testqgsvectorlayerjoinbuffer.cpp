@@ -22,7 +22,33 @@
 #include <qgsvectordataprovider.h>
 #include <qgsapplication.h>
 #include <qgsvectorlayerjoinbuffer.h>
+#include <qgsvectorlayerjoincache.h>
 #include <qgsmaplayerregistry.h>
+#include <qgsexpression.h>
+
+/** Expression function counting its evaluations. Used in the subset string of the joined
+ * layer it counts the features read from the provider, i.e. one per feature and query.
+ */
+class CountingFunction : public QgsExpression::Function
+{
+  public:
+    CountingFunction()
+        : QgsExpression::Function( "join_test_count", 0, "Tests" )
+    {}
+
+    virtual QVariant func( const QVariantList& values, const QgsExpressionContext* context, QgsExpression* parent ) override
+    {
+      Q_UNUSED( values );
+      Q_UNUSED( context );
+      Q_UNUSED( parent );
+      ++count;
+      return true;
+    }
+
+    static int count;
+};
+
+int CountingFunction::count = 0;
 
 /** @ingroup UnitTests
  * This is a unit test for the vector layer join buffer
@@ -53,6 +79,12 @@ class TestVectorLayerJoinBuffer : public QObject
     void testJoinSubset_data();
     void testJoinSubset();
     void testJoinTwoTimes();
+    void testJoinBatch_data();
+    void testJoinBatch();
+    void testJoinBatchLooseMatch();
+    void testJoinCacheKeys();
+    void testJoinCacheAttributes();
+    void testJoinCacheMemoryLimit();
 
   private:
     QgsVectorLayer* mLayerA;
@@ -109,6 +141,8 @@ void TestVectorLayerJoinBuffer::initTestCase()
   QgsMapLayerRegistry::instance()->addMapLayer( mLayerA );
   QgsMapLayerRegistry::instance()->addMapLayer( mLayerB );
   QgsMapLayerRegistry::instance()->addMapLayer( mLayerC );
+
+  QgsExpression::registerFunction( new CountingFunction(), true );
 }
 
 void TestVectorLayerJoinBuffer::init()
@@ -121,6 +155,7 @@ void TestVectorLayerJoinBuffer::cleanup()
 
 void TestVectorLayerJoinBuffer::cleanupTestCase()
 {
+  QgsExpression::unregisterFunction( "join_test_count" );
   QgsApplication::exitQgis();
 }
 
@@ -339,6 +374,189 @@ void TestVectorLayerJoinBuffer::testJoinTwoTimes()
   QCOMPARE( mLayerA->vectorJoins().count(), 0 );
 }
 
+void TestVectorLayerJoinBuffer::testJoinBatch_data()
+{
+  QTest::addColumn<bool>( "memoryCache" );
+
+  QTest::newRow( "with cache" ) << true;
+  QTest::newRow( "without cache" ) << false;
+}
+
+void TestVectorLayerJoinBuffer::testJoinBatch()
+{
+  QFETCH( bool, memoryCache );
+
+  QgsVectorJoinInfo joinInfo;
+  joinInfo.targetFieldName = "id_a";
+  joinInfo.joinLayerId = mLayerB->id();
+  joinInfo.joinFieldName = "id_b";
+  joinInfo.memoryCache = memoryCache;
+  mLayerA->addJoin( joinInfo );
+
+  QVERIFY( mLayerA->fields().count() == 2 );
+
+  // count the joined features read from the provider
+  mLayerB->dataProvider()->setSubsetString( "join_test_count()" );
+  CountingFunction::count = 0;
+
+  QgsFeatureIterator fi = mLayerA->getFeatures();
+  QgsFeatureList features;
+  QCOMPARE( fi.nextFeatures( features, 10 ), 2 );
+  QCOMPARE( features.count(), 2 );
+  QCOMPARE( features[0].attribute( "id_a" ).toInt(), 1 );
+  QCOMPARE( features[0].attribute( "B_value_b" ).toInt(), 11 );
+  QCOMPARE( features[1].attribute( "id_a" ).toInt(), 2 );
+  QCOMPARE( features[1].attribute( "B_value_b" ).toInt(), 12 );
+
+  // a single query for the whole block (the cache or the batch), a query per feature would read 4
+  QCOMPARE( CountingFunction::count, 2 );
+
+  // the subset string of the joined layer is restored after the batch
+  QCOMPARE( mLayerB->dataProvider()->subsetString(), QString( "join_test_count()" ) );
+  mLayerB->dataProvider()->setSubsetString( QString() );
+
+  mLayerA->removeJoin( mLayerB->id() );
+
+  QVERIFY( mLayerA->fields().count() == 1 );
+}
+
+void TestVectorLayerJoinBuffer::testJoinBatchLooseMatch()
+{
+  // the provider compares the string '01' with the integer 1 as numbers
+  QgsVectorLayer* layerD = new QgsVectorLayer( "Point?field=id_d:string", "D", "memory" );
+  QVERIFY( layerD->isValid() );
+
+  QgsFeature fD1( layerD->dataProvider()->fields(), 1 );
+  fD1.setAttribute( "id_d", "01" );
+  QgsFeature fD2( layerD->dataProvider()->fields(), 2 );
+  fD2.setAttribute( "id_d", "2" );
+  layerD->dataProvider()->addFeatures( QgsFeatureList() << fD1 << fD2 );
+
+  QgsVectorJoinInfo joinInfo;
+  joinInfo.targetFieldName = "id_d";
+  joinInfo.joinLayerId = mLayerB->id();
+  joinInfo.joinFieldName = "id_b";
+  joinInfo.memoryCache = false;
+  layerD->addJoin( joinInfo );
+
+  // same joined values with and without batching
+  QgsFeature f;
+  QgsFeatureIterator fi = layerD->getFeatures();
+  QVERIFY( fi.nextFeature( f ) );
+  QCOMPARE( f.attribute( "B_value_b" ).toInt(), 11 );
+
+  fi = layerD->getFeatures();
+  QgsFeatureList features;
+  QCOMPARE( fi.nextFeatures( features, 10 ), 2 );
+  QCOMPARE( features[0].attribute( "B_value_b" ).toInt(), 11 );
+  QCOMPARE( features[1].attribute( "B_value_b" ).toInt(), 12 );
+
+  delete layerD;
+}
+
+void TestVectorLayerJoinBuffer::testJoinCacheKeys()
+{
+  QgsVectorLayerJoinCache::Table table( QgsAttributeList() << 1 );
+  table.insert( 5, QgsAttributes() << 55 );
+  table.insert( "abc", QgsAttributes() << 66 );
+  QCOMPARE( table.count(), 2 );
+  QVERIFY( table.bytes() > 0 );
+
+  // integral values match whatever their type
+  QVERIFY( table.find( 5 ) );
+  QCOMPARE( table.find( 5 )->at( 0 ).toInt(), 55 );
+  QVERIFY( table.find( QVariant( 5.0 ) ) );
+  QVERIFY( table.find( QVariant( qlonglong( 5 ) ) ) );
+  QVERIFY( table.find( QString( "5" ) ) );
+
+  // other representations do not
+  QVERIFY( !table.find( QString( "05" ) ) );
+  QVERIFY( !table.find( QString( "+5" ) ) );
+  QVERIFY( !table.find( QVariant( 5.5 ) ) );
+  QVERIFY( !table.find( QVariant() ) );
+
+  // strings are compared case sensitive
+  QVERIFY( table.find( QString( "abc" ) ) );
+  QCOMPARE( table.find( QString( "abc" ) )->at( 0 ).toInt(), 66 );
+  QVERIFY( !table.find( QString( "ABC" ) ) );
+
+  // the first value of a key is kept
+  table.insert( 5.0, QgsAttributes() << 77 );
+  QCOMPARE( table.count(), 2 );
+  QCOMPARE( table.find( 5 )->at( 0 ).toInt(), 55 );
+}
+
+void TestVectorLayerJoinBuffer::testJoinCacheAttributes()
+{
+  QgsVectorLayerJoinCache cache;
+
+  QSharedPointer<const QgsVectorLayerJoinCache::Table> table1 = cache.table( mLayerB, 0, QgsAttributeList() << 1 );
+  QVERIFY( table1 );
+  QCOMPARE( table1->attributes(), QgsAttributeList() << 1 );
+  QCOMPARE( table1->count(), 2 );
+  QCOMPARE( table1->find( 1 )->at( 0 ).toInt(), 11 );
+
+  // other attributes extend the cached ones
+  QSharedPointer<const QgsVectorLayerJoinCache::Table> table2 = cache.table( mLayerB, 0, QgsAttributeList() << 0 );
+  QVERIFY( table2 );
+  QCOMPARE( table2->attributes(), QgsAttributeList() << 1 << 0 );
+  QCOMPARE( table2->find( 2 )->at( 0 ).toInt(), 12 );
+  QCOMPARE( table2->find( 2 )->at( 1 ).toInt(), 2 );
+
+  // the previous table is still valid for its users
+  QCOMPARE( table1->find( 2 )->at( 0 ).toInt(), 12 );
+
+  // cached attributes are not reloaded
+  mLayerB->dataProvider()->setSubsetString( "join_test_count()" );
+  CountingFunction::count = 0;
+  QCOMPARE( cache.table( mLayerB, 0, QgsAttributeList() << 0 ), table2 );
+  QCOMPARE( cache.table( mLayerB, 0, QgsAttributeList() << 0 << 1 ), table2 );
+  QCOMPARE( CountingFunction::count, 0 );
+  mLayerB->dataProvider()->setSubsetString( QString() );
+
+  cache.clear();
+  QSharedPointer<const QgsVectorLayerJoinCache::Table> table3 = cache.table( mLayerB, 0, QgsAttributeList() << 0 );
+  QVERIFY( table3 );
+  QCOMPARE( table3->attributes(), QgsAttributeList() << 0 );
+}
+
+void TestVectorLayerJoinBuffer::testJoinCacheMemoryLimit()
+{
+  QgsVectorLayerJoinCache cache( 1 );
+
+  mLayerB->dataProvider()->setSubsetString( "join_test_count()" );
+  CountingFunction::count = 0;
+
+  // the layer does not fit, the join falls back to queries
+  QVERIFY( !cache.table( mLayerB, 0, QgsAttributeList() << 1 ) );
+  int count = CountingFunction::count;
+  QVERIFY( count > 0 );
+
+  // what did not fit is not loaded again
+  QVERIFY( !cache.table( mLayerB, 0, QgsAttributeList() << 1 ) );
+  QVERIFY( !cache.table( mLayerB, 0, QgsAttributeList() << 1 << 0 ) );
+  QCOMPARE( CountingFunction::count, count );
+
+  // unless the cache is cleared
+  cache.clear();
+  QVERIFY( !cache.table( mLayerB, 0, QgsAttributeList() << 1 ) );
+  QCOMPARE( CountingFunction::count, 2 * count );
+
+  mLayerB->dataProvider()->setSubsetString( QString() );
+
+  QgsVectorLayerJoinCache largeCache;
+  QVERIFY( largeCache.table( mLayerB, 0, QgsAttributeList() << 1 ) );
+
+  // the default limit is configurable
+  QCOMPARE( largeCache.maxBytes(), qint64( 256 ) * 1024 * 1024 );
+  QSettings().setValue( "/qgis/joinCacheMaxMegabytes", 16 );
+  QCOMPARE( QgsVectorLayerJoinCache().maxBytes(), qint64( 16 ) * 1024 * 1024 );
+  qputenv( "QGIS_JOIN_CACHE_MAX_MB", "8" );
+  QCOMPARE( QgsVectorLayerJoinCache().maxBytes(), qint64( 8 ) * 1024 * 1024 );
+  qputenv( "QGIS_JOIN_CACHE_MAX_MB", "" );
+  QSettings().remove( "/qgis/joinCacheMaxMegabytes" );
+  QCOMPARE( QgsVectorLayerJoinCache().maxBytes(), qint64( 256 ) * 1024 * 1024 );
+}
 
 QTEST_MAIN( TestVectorLayerJoinBuffer )
 #include "testqgsvectorlayerjoinbuffer.moc"
@@ -84,6 +84,20 @@ class ProviderTestCase(object):
         expected = [4]
         assert set(expected) == result, 'Expected {} and got {} when testing for combination of filterRect and expression'.format(set(expected), result)
 
+    def testGetFeaturesInBlocks(self):
+        tests = [(QgsFeatureRequest(), [1, 2, 3, 4, 5]),
+                 (QgsFeatureRequest().setFilterExpression('"cnt" > 0'), [1, 2, 3, 4])]
+        for request, expected in tests:
+            it = self.provider.getFeatures(request)
+            result = []
+            while True:
+                count, features = it.nextFeatures([], 2)
+                assert count == len(features), 'Got {} features but {} reported'.format(len(features), count)
+                if count == 0:
+                    break
+                result.extend([f['pk'] for f in features])
+            assert expected == sorted(result), 'Expected {} and got {} when fetching in blocks'.format(expected, result)
+
     def testMinValue(self):
         assert self.provider.minimumValue(1) == -200
         assert self.provider.minimumValue(2) == 'Apple'
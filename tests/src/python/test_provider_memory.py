@@ -18,7 +18,7 @@ import shutil
 import glob
 
 from qgis.core import QGis, QgsField, QgsPoint, QgsVectorLayer, QgsFeatureRequest, QgsFeature, QgsProviderRegistry, \
-    QgsGeometry, NULL
+    QgsGeometry, QgsRectangle, NULL
 from PyQt4.QtCore import QSettings
 from utilities import (unitTestDataPath,
                        getQgisTestApp,
@@ -172,5 +172,109 @@ class TestPyQgsMemoryProvider(TestCase, ProviderTestCase):
         assert myProvider is not None
 
 
+class TestPyQgsMemoryProviderColumnar(TestPyQgsMemoryProvider):
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        # Create test layer with columnar storage
+        cls.vl = QgsVectorLayer(u'Point?crs=epsg:4326&field=pk:integer&field=cnt:integer&field=name:string(0)&key=pk&columnar=yes',
+                                u'test', u'memory')
+        assert (cls.vl.isValid())
+        cls.provider = cls.vl.dataProvider()
+
+        f1 = QgsFeature()
+        f1.setAttributes([5, -200, NULL])
+        f1.setGeometry(QgsGeometry.fromWkt('Point (-71.123 78.23)'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([3, 300, 'Pear'])
+
+        f3 = QgsFeature()
+        f3.setAttributes([1, 100, 'Orange'])
+        f3.setGeometry(QgsGeometry.fromWkt('Point (-70.332 66.33)'))
+
+        f4 = QgsFeature()
+        f4.setAttributes([2, 200, 'Apple'])
+        f4.setGeometry(QgsGeometry.fromWkt('Point (-68.2 70.8)'))
+
+        f5 = QgsFeature()
+        f5.setAttributes([4, 400, 'Honey'])
+        f5.setGeometry(QgsGeometry.fromWkt('Point (-65.32 78.3)'))
+
+        cls.provider.addFeatures([f1, f2, f3, f4, f5])
+
+    def testUriRoundTrip(self):
+        assert 'columnar=yes' in self.provider.dataSourceUri()
+
+    def testEditColumns(self):
+        layer = QgsVectorLayer('Point?field=name:string&field=age:integer&columnar=yes&index=yes', 'test', 'memory')
+        provider = layer.dataProvider()
+
+        features = []
+        for i in range(10):
+            f = QgsFeature()
+            f.setAttributes(['f{}'.format(i), i])
+            f.setGeometry(QgsGeometry.fromPoint(QgsPoint(i, i)))
+            features.append(f)
+        res, features = provider.addFeatures(features)
+        assert res
+        ids = [f.id() for f in features]
+
+        # deleting most features compacts the store
+        assert provider.deleteFeatures(ids[:7])
+        self.assertEqual(provider.featureCount(), 3)
+        self.assertEqual([f['age'] for f in provider.getFeatures()], [7, 8, 9])
+
+        assert provider.changeAttributeValues({ids[8]: {1: 80}})
+        assert provider.changeGeometryValues({ids[9]: QgsGeometry.fromPoint(QgsPoint(100, 50))})
+        f = provider.getFeatures(QgsFeatureRequest(ids[8])).next()
+        self.assertEqual(f['age'], 80)
+        self.assertEqual(provider.extent().xMaximum(), 100)
+
+        # spatial index has been updated
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(99, 49, 101, 51))
+        self.assertEqual([f.id() for f in provider.getFeatures(request)], [ids[9]])
+
+        # only the requested attributes are read
+        request = QgsFeatureRequest().setFlags(QgsFeatureRequest.NoGeometry).setSubsetOfAttributes([1])
+        f = provider.getFeatures(request).next()
+        self.assertEqual(f['name'], NULL)
+        self.assertEqual(f['age'], 7)
+        assert f.geometry() is None
+
+        assert provider.addAttributes([QgsField('size', QVariant.Double)])
+        assert provider.deleteAttributes([0])
+        self.assertEqual([f.attributes() for f in provider.getFeatures()], [[7, NULL], [80, NULL], [9, NULL]])
+
+        self.assertEqual(provider.minimumValue(0), 7)
+        self.assertEqual(provider.maximumValue(0), 80)
+        self.assertEqual(set(provider.uniqueValues(1)), set([NULL]))
+
+    def testSpatialIndex(self):
+        layer = QgsVectorLayer('Point?field=age:integer&columnar=yes', 'test', 'memory')
+        provider = layer.dataProvider()
+
+        features = []
+        for i in range(20):
+            f = QgsFeature()
+            f.setAttributes([i])
+            f.setGeometry(QgsGeometry.fromPoint(QgsPoint(i % 5, i // 5)))
+            features.append(f)
+        res, features = provider.addFeatures(features)
+        assert res
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(0.5, 0.5, 2.5, 2.5))
+        expected = [f['age'] for f in provider.getFeatures(request)]
+        self.assertEqual(expected, [6, 7, 11, 12])
+
+        # the candidates of the index are read in the order of the rows
+        assert provider.createSpatialIndex()
+        self.assertEqual([f['age'] for f in provider.getFeatures(request)], expected)
+
+        assert provider.deleteFeatures([features[6].id()])
+        self.assertEqual([f['age'] for f in provider.getFeatures(request)], [7, 11, 12])
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -39,7 +39,8 @@ from PyQt4.QtCore import (QCoreApplication,
                           QObject
                           )
 
-from qgis.core import (QgsProviderRegistry,
+from qgis.core import (QgsApplication,
+                       QgsProviderRegistry,
                        QgsVectorLayer,
                        QgsFeatureRequest,
                        QgsRectangle,
@@ -728,5 +729,47 @@ class TestQgsDelimitedTextProviderOther(TestCase):
         requests = None
         runTest(filename, requests, **params)
 
+    def test_039_spatial_index_scan_cache(self):
+        # Scan results cached with the spatial index are reused, unless the file content changes
+        (filehandle, filename) = tempfile.mkstemp(suffix='.csv')
+        if os.name == "nt":
+            filename = filename.replace("\\", "/")
+        with os.fdopen(filehandle, "w") as f:
+            f.write("id,x,y\n1,10,20\n2,30,40\n")
+
+        cachedir = os.path.join(QgsApplication.qgisSettingsDirPath(), 'spatialindex')
+        cached = set(os.listdir(cachedir)) if os.path.isdir(cachedir) else set()
+
+        url = QUrl.fromLocalFile(filename)
+        url.addQueryItem("type", "csv")
+        url.addQueryItem("xField", "x")
+        url.addQueryItem("yField", "y")
+        url.addQueryItem("spatialIndex", "yes")
+        url.addQueryItem("watchFile", "no")
+
+        def ids(rect):
+            layer = QgsVectorLayer(url.toString(), u'test', u'delimitedtext')
+            assert layer.isValid(), "{} is invalid".format(filename)
+            request = QgsFeatureRequest().setFilterRect(QgsRectangle(*rect))
+            return sorted(f['id'] for f in layer.getFeatures(request))
+
+        self.assertEqual(ids([25, 35, 45, 45]), [2])
+        scanfiles = [os.path.join(cachedir, n) for n in set(os.listdir(cachedir)) - cached if n.endswith('.scan')]
+        self.assertEqual(len(scanfiles), 1)
+        scanfile = scanfiles[0]
+
+        # unchanged file: the cached scan is read and not written again
+        os.utime(scanfile, (0, 0))
+        self.assertEqual(ids([25, 35, 45, 45]), [2])
+        self.assertEqual(os.path.getmtime(scanfile), 0)
+
+        # same size and (likely) the same modification second, but different content
+        with file(filename, 'w') as f:
+            f.write("id,x,y\n1,35,40\n2,90,90\n")
+        self.assertEqual(ids([25, 35, 45, 45]), [1])
+        self.assertNotEqual(os.path.getmtime(scanfile), 0)
+
+        os.remove(filename)
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,109 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsMapRendererParallelJob.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+"""
+__author__ = 'The QGIS Project'
+__date__ = '18/10/2015'
+__copyright__ = 'Copyright 2015, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import qgis
+
+from PyQt4.QtCore import QSize, QThreadPool
+
+from qgis.core import (QgsVectorLayer,
+                       QgsFeature,
+                       QgsGeometry,
+                       QgsPoint,
+                       QgsMapLayerRegistry,
+                       QgsMapSettings,
+                       QgsMapRendererParallelJob,
+                       QgsEffectStack,
+                       QgsDrawSourceEffect,
+                       QgsPaintEffectRegistry
+                       )
+
+from utilities import (getQgisTestApp,
+                       TestCase,
+                       unittest
+                       )
+
+QGISAPP, CANVAS, IFACE, PARENT = getQgisTestApp()
+
+
+class TestQgsMapRendererParallelJob(TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        # the layer is only split into tiles when the thread pool has several threads
+        cls.maxThreadCount = QThreadPool.globalInstance().maxThreadCount()
+        QThreadPool.globalInstance().setMaxThreadCount(max(4, cls.maxThreadCount))
+
+        # enough features to let the renderer split the layer into tiles
+        cls.layer = QgsVectorLayer('Point?crs=epsg:4326', 'points', 'memory')
+        features = []
+        for i in range(30000):
+            f = QgsFeature()
+            f.setGeometry(QgsGeometry.fromPoint(QgsPoint((i * 7) % 360 - 180, (i * 13) % 180 - 90)))
+            features.append(f)
+        cls.layer.dataProvider().addFeatures(features)
+        QgsMapLayerRegistry.instance().addMapLayer(cls.layer)
+
+    @classmethod
+    def tearDownClass(cls):
+        QgsMapLayerRegistry.instance().removeAllMapLayers()
+        QThreadPool.globalInstance().setMaxThreadCount(cls.maxThreadCount)
+
+    def renderImage(self, tiled):
+        settings = QgsMapSettings()
+        settings.setLayers([self.layer.id()])
+        settings.setExtent(self.layer.extent())
+        settings.setOutputSize(QSize(400, 300))
+        settings.setFlag(QgsMapSettings.DrawLabeling, False)
+        settings.setFlag(QgsMapSettings.RenderLayersInTiles, tiled)
+
+        job = QgsMapRendererParallelJob(settings)
+        job.start()
+        job.waitForFinished()
+        return job.renderedImage()
+
+    def testTiledRendering(self):
+        """ rendering of a layer split into tiles must match the rendering in one piece """
+        expected = self.renderImage(False)
+        result = self.renderImage(True)
+
+        self.assertEqual(expected.size(), result.size())
+        self.assertEqual(expected, result)
+
+    def testTiledRenderingWithEffect(self):
+        """ layers with a paint effect must not be rendered blank when tiling is enabled """
+        renderer = self.layer.rendererV2()
+        effect = QgsEffectStack()
+        effect.appendEffect(QgsDrawSourceEffect())
+        renderer.setPaintEffect(effect)
+        try:
+            expected = self.renderImage(False)
+            result = self.renderImage(True)
+        finally:
+            renderer.setPaintEffect(QgsPaintEffectRegistry.defaultStack())
+            renderer.paintEffect().setEnabled(False)
+
+        self.assertEqual(expected, result)
+        # something was drawn
+        self.assertNotEqual(result, self.renderEmpty())
+
+    def renderEmpty(self):
+        settings = QgsMapSettings()
+        settings.setOutputSize(QSize(400, 300))
+        job = QgsMapRendererParallelJob(settings)
+        job.start()
+        job.waitForFinished()
+        return job.renderedImage()
+
+if __name__ == '__main__':
+    unittest.main()
@@ -14,6 +14,8 @@ __revision__ = '$Format:%H$'
 
 import os
 import re
+import shutil
+import tempfile
 import unittest
 import urllib
 from qgis.server import QgsServer
@@ -166,6 +168,386 @@ class TestQgsServer(unittest.TestCase):
         for request in ('GetCapabilities', 'GetProjectSettings'):
             self.wms_request_compare(request)
 
+    def test_tile_cache(self):
+        """Test that tile aligned GetMap requests are rendered as metatiles and cached"""
+        from qgis.server import QgsServerTileCache, QgsServerMemoryTileCache
+
+        class RecordingTileCache(QgsServerTileCache):
+
+            def __init__(self):
+                QgsServerTileCache.__init__(self)
+                self.cache = QgsServerMemoryTileCache()
+                self.inserted = []
+
+            def tile(self, projectPath, key):
+                return self.cache.tile(projectPath, key)
+
+            def insertTile(self, projectPath, key, image):
+                self.inserted.append(str(key))
+                self.cache.insertTile(projectPath, key, image)
+
+            def removeProject(self, projectPath):
+                self.cache.removeProject(projectPath)
+
+        cache = RecordingTileCache()
+        QgsServerTileCache.setInstance(cache)
+        try:
+            project = self.testdata_path + "test+project.qgs"
+            query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetMap&LAYERS=%s&STYLES=&SRS=EPSG:3857&FORMAT=image/png&WIDTH=256&HEIGHT=256&BBOX=%%s' % (urllib.quote(project), urllib.quote('testlayer \xc3\xa8\xc3\xa9'))
+
+            header, body = [str(_v) for _v in self.server.handleRequest(query % '1000,1000,2000,2000')]
+            self.assertTrue('image/png' in header)
+            # the metatile with 4x4 tiles was sliced
+            self.assertEqual(len(cache.inserted), 16)
+            self.assertEqual(len(set(cache.inserted)), 16)
+
+            # a neighbouring tile is served from the cache
+            header, body2 = [str(_v) for _v in self.server.handleRequest(query % '2000,1000,3000,2000')]
+            self.assertTrue('image/png' in header)
+            self.assertEqual(len(cache.inserted), 16)
+
+            # the same tile gives the same result
+            header, body3 = [str(_v) for _v in self.server.handleRequest(query % '1000,1000,2000,2000')]
+            self.assertEqual(body, body3)
+
+            # requests not aligned to a tile grid are rendered directly
+            header, body = [str(_v) for _v in self.server.handleRequest(query % '1100,1000,2100,2000')]
+            self.assertTrue('image/png' in header)
+            self.assertEqual(len(cache.inserted), 16)
+        finally:
+            QgsServerTileCache.setInstance(None)
+
+    def test_capabilities_cache(self):
+        """Test requesting capabilities documents ahead of time"""
+        from qgis.server import QgsCapabilitiesCache
+        from PyQt4.QtXml import QDomDocument
+
+        cache = QgsCapabilitiesCache()
+        path = self.testdata_path + "test+project.qgs"
+        cache.requestCapabilitiesDocument(path, '1.3.0')
+        self.assertEqual(cache.pendingDocuments(), [(path, '1.3.0')])
+        self.assertIsNone(cache.searchCapabilitiesDocument(path, '1.3.0'))
+
+        doc = QDomDocument()
+        doc.setContent('<WMS_Capabilities/>')
+        cache.insertCapabilitiesDocument(path, '1.3.0', doc)
+        self.assertEqual(cache.pendingDocuments(), [])
+        self.assertFalse(cache.isStale(path))
+        self.assertIsNotNone(cache.searchCapabilitiesDocument(path, '1.3.0'))
+
+        # documents in the cache are not built again
+        cache.requestCapabilitiesDocument(path, '1.3.0')
+        self.assertEqual(cache.pendingDocuments(), [])
+
+        # documents which can not be built are discarded
+        cache.requestCapabilitiesDocument(path, '1.1.1')
+        cache.discardPendingDocument(path, '1.1.1')
+        self.assertEqual(cache.pendingDocuments(), [])
+
+    def test_capabilities_cache_update(self):
+        """Test capabilities documents built ahead of time are identical to documents built for a request"""
+        tmp_path = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, tmp_path)
+        for f in os.listdir(self.testdata_path):
+            if f.startswith('testlayer.'):
+                shutil.copy(self.testdata_path + f, tmp_path)
+        prebuilt_project = os.path.join(tmp_path, 'project_a.qgs')
+        direct_project = os.path.join(tmp_path, 'project_b.qgs')
+        shutil.copy(self.testdata_path + 'test+project.qgs', prebuilt_project)
+        shutil.copy(self.testdata_path + 'test+project.qgs', direct_project)
+        cache = self.server.serverInterface().capabiblitiesCache()
+
+        # a GetMap request of a new project requests its capabilities, which are built after the response
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetMap&LAYERS=%s&STYLES=&SRS=EPSG:3857&FORMAT=image/png&WIDTH=20&HEIGHT=10&BBOX=1100,1000,2100,1500' % (urllib.quote(prebuilt_project), urllib.quote('testlayer \xc3\xa8\xc3\xa9'))
+        self.server.handleRequest(query)
+        self.assertIsNone(cache.searchCapabilitiesDocument(prebuilt_project, '1.3.0'))
+        self.server.updateCapabilitiesCache()
+        self.assertEqual(cache.pendingDocuments(), [])
+        self.assertIsNotNone(cache.searchCapabilitiesDocument(prebuilt_project, '1.3.0'))
+
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.3.0&REQUEST=GetCapabilities'
+        header, prebuilt = [str(_v) for _v in self.server.handleRequest(query % urllib.quote(prebuilt_project))]
+        self.assertIsNone(cache.searchCapabilitiesDocument(direct_project, '1.3.0'))
+        header, direct = [str(_v) for _v in self.server.handleRequest(query % urllib.quote(direct_project))]
+        # the service URL of the document built ahead of time is the URL of the GetMap request without its parameters
+        self.assertTrue('project_a.qgs' in prebuilt, prebuilt)
+        self.assertEqual(prebuilt, direct.replace('project_b.qgs', 'project_a.qgs'))
+
+    def test_extent_cache(self):
+        """Test the persistent cache of layer extents"""
+        from qgis.server import QgsServerExtentCache
+        from qgis.core import QgsVectorLayer, QgsRectangle
+        from PyQt4.QtCore import QSettings
+
+        tmp_path = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, tmp_path)
+        for f in os.listdir(self.testdata_path):
+            if f.startswith('testlayer.'):
+                shutil.copy(self.testdata_path + f, tmp_path)
+        shp = os.path.join(tmp_path, 'testlayer.shp')
+        layer = QgsVectorLayer(shp, 'testlayer', 'ogr')
+        self.assertTrue(layer.isValid())
+        cache_file = os.path.join(tmp_path, 'extents.ini')
+
+        cache = QgsServerExtentCache(cache_file, 3600)
+        self.assertEqual(cache.layerExtent(layer), layer.extent())
+        # extents are written once by sync
+        self.assertFalse(os.path.exists(cache_file))
+        cache.sync()
+        content = open(cache_file).read()
+        self.assertTrue('extent' in content, content)
+        # the data source is not written to the file
+        self.assertFalse('testlayer' in content, content)
+
+        # extents are read from the file
+        settings = QSettings(cache_file, QSettings.IniFormat)
+        key = settings.childGroups()[0]
+        settings.setValue(key + '/extent', ['1', '2', '3', '4'])
+        settings.sync()
+        cache = QgsServerExtentCache(cache_file, 3600)
+        self.assertEqual(cache.layerExtent(layer), QgsRectangle(1, 2, 3, 4))
+
+        # extents of modified files are calculated again
+        mtime = os.path.getmtime(shp)
+        os.utime(shp, (mtime + 10, mtime + 10))
+        self.assertEqual(cache.layerExtent(layer), layer.extent())
+
+        # also if only the content changes, within the resolution of the modification time
+        settings.setValue(key + '/extent', ['1', '2', '3', '4'])
+        settings.sync()
+        cache = QgsServerExtentCache(cache_file, 3600)
+        self.assertEqual(cache.layerExtent(layer), QgsRectangle(1, 2, 3, 4))
+        mtime = os.path.getmtime(shp)
+        with open(shp, 'r+b') as f:
+            f.seek(-1, os.SEEK_END)
+            last = f.read(1)
+            f.seek(-1, os.SEEK_END)
+            f.write(chr(ord(last) ^ 1))
+        os.utime(shp, (mtime, mtime))
+        self.assertNotEqual(cache.layerExtent(layer), QgsRectangle(1, 2, 3, 4))
+
+        # extents of other data sources are only cached with a time to live
+        memory_layer = QgsVectorLayer('Point', 'memorylayer', 'memory')
+        cache = QgsServerExtentCache(os.path.join(tmp_path, 'memory.ini'), 0)
+        cache.layerExtent(memory_layer)
+        cache.sync()
+        self.assertFalse(os.path.exists(os.path.join(tmp_path, 'memory.ini')))
+        cache = QgsServerExtentCache(os.path.join(tmp_path, 'memory.ini'), 3600)
+        cache.layerExtent(memory_layer)
+        cache.sync()
+        self.assertEqual(len(QSettings(os.path.join(tmp_path, 'memory.ini'), QSettings.IniFormat).childGroups()), 1)
+
+        cache.clear()
+        self.assertEqual(QSettings(cache_file, QSettings.IniFormat).childGroups(), [])
+
+    def test_image_encoder(self):
+        """Test the paletted PNG encoder"""
+        from qgis.server import QgsServerImageEncoder
+        from PyQt4.QtGui import QImage, QColor
+
+        encoder = QgsServerImageEncoder()
+        self.assertEqual(encoder.compressionLevel(), 1)
+        self.assertFalse(encoder.adaptiveFiltering())
+
+        # few colors are encoded exactly, including transparency
+        image = QImage(64, 32, QImage.Format_ARGB32)
+        image.fill(QColor(255, 0, 0).rgba())
+        for x in range(32):
+            for y in range(32):
+                image.setPixel(x, y, QColor(0, 0, 255, 128).rgba())
+        for adaptive in (False, True):
+            encoder.setAdaptiveFiltering(adaptive)
+            data = encoder.encodePng8(image)
+            self.assertTrue(str(data).startswith('\x89PNG'))
+            decoded = QImage()
+            self.assertTrue(decoded.loadFromData(data, 'PNG'))
+            self.assertEqual(decoded.size(), image.size())
+            self.assertEqual(len(decoded.colorTable()), 2)
+            self.assertEqual(decoded.pixel(40, 10), QColor(255, 0, 0).rgba())
+            self.assertEqual(QColor.fromRgba(decoded.pixel(10, 10)).alpha(), 128)
+            self.assertEqual(QColor.fromRgba(decoded.pixel(10, 10)).blue(), 255)
+
+        # gradients are reduced to 256 colors
+        gradient = QImage(256, 256, QImage.Format_ARGB32)
+        for x in range(256):
+            for y in range(256):
+                gradient.setPixel(x, y, QColor(x, y, 128).rgba())
+        self.assertEqual(len(encoder.palette(gradient, 256)), 256)
+        decoded = QImage()
+        self.assertTrue(decoded.loadFromData(encoder.encodePng8(gradient), 'PNG'))
+        color = QColor.fromRgba(decoded.pixel(100, 200))
+        self.assertTrue(abs(color.red() - 100) < 24)
+        self.assertTrue(abs(color.green() - 200) < 24)
+
+        # 1 bit images
+        decoded = QImage()
+        self.assertTrue(decoded.loadFromData(encoder.encodePng1(image), 'PNG'))
+        self.assertEqual(decoded.size(), image.size())
+
+    def test_request_profile(self):
+        """Test the profile of a GetMap request"""
+        from qgis.server import QgsServerRequestProfile
+
+        project = self.testdata_path + "test+project.qgs"
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetMap&LAYERS=%s&STYLES=&SRS=EPSG:3857&FORMAT=image/png&WIDTH=200&HEIGHT=100&BBOX=1100,1000,2100,1500' % (urllib.quote(project), urllib.quote('testlayer \xc3\xa8\xc3\xa9'))
+        header, body = [str(_v) for _v in self.server.handleRequest(query)]
+        self.assertTrue('image/png' in header)
+
+        profile = QgsServerRequestProfile.instance()
+        for stage in ('config', 'render', 'encoding'):
+            self.assertTrue(stage in profile.times(), stage)
+        self.assertEqual(len(profile.layerRenderingTimes()), 1)
+        self.assertEqual(profile.layerFeatureCounts().keys(), profile.layerRenderingTimes().keys())
+        line = profile.toString()
+        self.assertTrue(line.startswith('total='))
+        self.assertTrue(' render=' in line)
+        self.assertTrue('.features=' in line)
+
+        profile.start()
+        profile.addTime('plugin', 5)
+        profile.addTime('plugin', 2)
+        profile.addCount('hits')
+        self.assertEqual(profile.time('plugin'), 7)
+        self.assertEqual(profile.count('hits'), 1)
+        self.assertTrue(' plugin=7 hits=1' in profile.toString())
+
+    def test_getmap_parallel_job(self):
+        """Test a GetMap request rendered by the parallel render job"""
+        from qgis.core import QgsProject
+        from PyQt4.QtCore import QSize
+        from PyQt4.QtGui import QImage, QColor
+
+        project = self.testdata_path + "test+project.qgs"
+        layer = urllib.quote('testlayer \xc3\xa8\xc3\xa9')
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetMap&LAYERS=%s,%s&STYLES=,&SRS=EPSG:4326&FORMAT=image/png&TRANSPARENT=TRUE&WIDTH=200&HEIGHT=100&BBOX=8.2030,44.9012,8.2040,44.9017' % (urllib.quote(project), layer, layer)
+        QgsProject.instance().clear()
+        header, body = [str(_v) for _v in self.server.handleRequest(query)]
+        self.assertTrue('image/png' in header)
+        image = QImage()
+        self.assertTrue(image.loadFromData(body, 'PNG'))
+        self.assertEqual(image.size(), QSize(200, 100))
+        self.assertTrue(any(QColor.fromRgba(image.pixel(x, y)).alpha() > 0 for x in range(200) for y in range(100)))
+        # the label engine settings are handed to the job, they are not written to the project
+        self.assertFalse(QgsProject.instance().isDirty())
+
+    def test_getfeatureinfo(self):
+        """Test GetFeatureInfo with the feature count limit"""
+        project = self.testdata_path + "test+project.qgs"
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetFeatureInfo&LAYERS=%s&QUERY_LAYERS=%s&STYLES=&SRS=EPSG:4326&INFO_FORMAT=text/xml&WIDTH=100&HEIGHT=100&BBOX=8.2034,44.9013,8.2036,44.9015&X=50&Y=50&FI_POINT_TOLERANCE=100&FEATURE_COUNT=%%d' % (urllib.quote(project), urllib.quote('testlayer \xc3\xa8\xc3\xa9'), urllib.quote('testlayer \xc3\xa8\xc3\xa9'))
+        # the second requests use the spatial index of the cached layer
+        for i in range(2):
+            header, body = [str(_v) for _v in self.server.handleRequest(query % 10)]
+            self.assertEqual(body.count('<Feature '), 3, body)
+            header, body = [str(_v) for _v in self.server.handleRequest(query % 2)]
+            self.assertEqual(body.count('<Feature '), 2, body)
+
+    def test_getfeatureinfo_filter(self):
+        """Test that GetFeatureInfo with FILTER does not change the results of later unfiltered requests"""
+        project = self.wfs_project()
+        layer = urllib.quote('testlayer \xc3\xa8\xc3\xa9')
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetFeatureInfo&LAYERS=%s&QUERY_LAYERS=%s&STYLES=&SRS=EPSG:4326&INFO_FORMAT=text/xml&WIDTH=100&HEIGHT=100&BBOX=8.2034,44.9013,8.2036,44.9015&X=50&Y=50&FI_POINT_TOLERANCE=100&FEATURE_COUNT=10' % (urllib.quote(project), layer, layer)
+        filter_query = query + '&FILTER=' + urllib.quote('testlayer \xc3\xa8\xc3\xa9:"name" = \'two\'')
+        for i in range(2):
+            header, body = [str(_v) for _v in self.server.handleRequest(filter_query)]
+            self.assertEqual(body.count('<Feature '), 1, body)
+            self.assertTrue('value="two"' in body, body)
+            header, body = [str(_v) for _v in self.server.handleRequest(query)]
+            self.assertEqual(body.count('<Feature '), 3, body)
+
+    def test_getfeatureinfo_rule_renderer(self):
+        """Test that GetFeatureInfo only returns the features drawn by a rule based renderer"""
+        project = self.project_copy('test+project_rules.qgs', '<renderer-v2 symbollevels="0" type="singleSymbol">',
+                                    '<renderer-v2 symbollevels="0" type="RuleRenderer"><rules><rule filter="&quot;name&quot; = \'two\'" symbol="0"/></rules>')
+        layer = urllib.quote('testlayer \xc3\xa8\xc3\xa9')
+        query = 'MAP=%s&SERVICE=WMS&VERSION=1.1.1&REQUEST=GetFeatureInfo&LAYERS=%s&QUERY_LAYERS=%s&STYLES=&SRS=EPSG:4326&INFO_FORMAT=text/xml&WIDTH=100&HEIGHT=100&BBOX=8.2034,44.9013,8.2036,44.9015&X=50&Y=50&FI_POINT_TOLERANCE=100&FEATURE_COUNT=10' % (urllib.quote(project), layer, layer)
+        # the second request is made with the layer from the layer cache
+        for i in range(2):
+            header, body = [str(_v) for _v in self.server.handleRequest(query)]
+            self.assertEqual(body.count('<Feature '), 1, body)
+            self.assertTrue('value="two"' in body, body)
+
+    def test_provider_pool(self):
+        """Test sharing, reference counting and eviction of pooled providers"""
+        from qgis.server import QgsMSProviderPool
+
+        source = self.testdata_path + 'testlayer.shp'
+        pool = QgsMSProviderPool(0)
+        self.assertFalse(QgsMSProviderPool.isShareable('memory'))
+        self.assertIsNone(pool.acquireProvider('memory', 'Point', ''))
+        self.assertIsNone(pool.acquireProvider('ogr', self.testdata_path + 'missing.shp', ''))
+
+        # layers with the same data source share one provider
+        provider = pool.acquireProvider('ogr', source, 'UTF-8')
+        self.assertTrue(provider.isValid())
+        self.assertEqual(pool.acquireProvider('ogr', source, 'UTF-8'), provider)
+        self.assertEqual(pool.providerCount(), 1)
+        # ... but not with a different encoding
+        other = pool.acquireProvider('ogr', source, 'System')
+        self.assertNotEqual(other, provider)
+        self.assertEqual(pool.providerCount(), 2)
+
+        # providers are kept while they are used
+        pool.releaseProvider(provider)
+        self.assertEqual(pool.providerCount(), 2)
+        self.assertEqual(pool.idleProviderCount(), 0)
+
+        # unused providers are deleted if they exceed the limit
+        pool.releaseProvider(provider)
+        self.assertEqual(pool.providerCount(), 1)
+        pool.releaseProvider(other)
+        self.assertEqual(pool.providerCount(), 0)
+
+        # with a limit for one provider the least recently used one is deleted
+        pool.setMaxIdleMemory(100 * 1024)
+        first = pool.acquireProvider('ogr', source, 'UTF-8')
+        second = pool.acquireProvider('ogr', source, 'System')
+        pool.releaseProvider(first)
+        self.assertEqual(pool.idleProviderCount(), 1)
+        pool.releaseProvider(second)
+        self.assertEqual(pool.providerCount(), 1)
+        self.assertEqual(pool.idleProviderCount(), 1)
+        # the remaining provider is the most recently used one
+        self.assertEqual(pool.acquireProvider('ogr', source, 'System'), second)
+        self.assertEqual(pool.idleProviderCount(), 0)
+        pool.releaseProvider(second)
+        pool.clearIdleProviders()
+        self.assertEqual(pool.providerCount(), 0)
+
+    ## WFS tests
+    def project_copy(self, name, before, after):
+        """Copy of the test project and its layer with before replaced by after in the project"""
+        tmp_path = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, tmp_path)
+        for f in os.listdir(self.testdata_path):
+            if f.startswith('testlayer.'):
+                shutil.copy(self.testdata_path + f, tmp_path)
+        project = open(self.testdata_path + 'test+project.qgs').read()
+        self.assertTrue(before in project)
+        project = project.replace(before, after)
+        path = os.path.join(tmp_path, name)
+        f = open(path, 'w')
+        f.write(project)
+        f.close()
+        return path
+
+    def wfs_project(self):
+        """Copy of the test project with the test layer published as WFS layer"""
+        return self.project_copy('test+project_wfs.qgs', '<WFSLayers type="QStringList"/>', '<WFSLayers type="QStringList"><value>testlayer20150528120452665</value></WFSLayers>')
+
+    def test_getfeature(self):
+        """Test GetFeature responses against the documents written before they were streamed"""
+        project = self.wfs_project()
+        for output_format, content_type in (('GML2', 'text/xml'), ('GML3', 'text/xml'), ('GeoJSON', 'text/plain')):
+            query_string = 'MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=%s&OUTPUTFORMAT=%s' % (urllib.quote(project), urllib.quote('testlayer_\xc3\xa8\xc3\xa9'), output_format)
+            header, body = [str(_v) for _v in self.server.handleRequest(query_string)]
+            self.assertTrue(content_type in header, header)
+            f = open(self.testdata_path + 'wfs_getfeature_' + output_format.lower() + '.txt')
+            expected = f.read()
+            f.close()
+            # the URL of the schema contains the path of the project
+            body = re.sub(r'xsi:schemaLocation="[^"]*"', 'xsi:schemaLocation=""', body)
+            self.assertEqual(body, expected, msg="GetFeature %s failed.\n Expected:\n%s\n\n Response:\n%s" % (output_format, expected, body))
+
     # The following code was used to test type conversion in python bindings
     #def test_qpair(self):
     #    """Test QPair bindings"""